@@ -48,6 +48,9 @@
 
 #define PINGPONG_REFRESH_DELAY 8000
 
+// Frames kept by the flight recorder when PINGPONG_FLIGHT_DIR is set
+#define PINGPONG_FLIGHT_LEN 4096
+
 #define PAD_WIDTH 5
 #define PAD_WIDTH_HALF 2
 
@@ -95,13 +98,20 @@ void pingpong_pad_mov(struct pad_obj_t *pad, mov_dir_t dir);
 void pingpong_update_scrn();
 
 int pingpong_send_msg(enum msg_id_e msg_id);
-int pingpong_recv_msg();
+void pingpong_wait_msgs();
+void pingpong_on_win_size(void *arg, const struct tcpipc_msg_view_t *view);
+void pingpong_on_pad_pos(void *arg, const struct tcpipc_msg_view_t *view);
+void pingpong_on_ball_pos(void *arg, const struct tcpipc_msg_view_t *view);
+void pingpong_on_game_status(void *arg, const struct tcpipc_msg_view_t *view);
+void pingpong_on_sync(void *arg, const struct tcpipc_msg_view_t *view);
 
 /** Global Variables **/
 bool is_server = true;
 int win_width = 0;
 int win_height = 0;
 bool end = false;
+bool opp_win_known = false;
+bool synced = false;
 
 struct ball_obj_t ball_obj;
 struct pad_obj_t p1_pad, p2_pad;
@@ -110,6 +120,8 @@ WINDOW *main_window;
 struct window_info_t term_win_info;
 struct window_info_t opp_term_win_info;
 
+struct tcpipc_ctx *tcp_ctx;
+
 /*******************************************************************************
  * @brief
  *
@@ -137,8 +149,7 @@ int main(int argc, char **argv)
 
   for (nodelay(stdscr, 1); !end; usleep(PINGPONG_REFRESH_DELAY))
   {
-    while (pingpong_recv_msg() > 0)
-      ;
+    tcpipc_dispatch(tcp_ctx, 0);
 
     if (++cont % PINGPONG_BALL_SPEED == 0)
     {
@@ -147,6 +158,9 @@ int main(int argc, char **argv)
 
     pingpong_read_keypad();
     pingpong_update_scrn();
+
+    // Send this frame's updates in one go
+    tcpipc_flush(tcp_ctx);
   }
 
   pingpong_close();
@@ -155,6 +169,9 @@ int main(int argc, char **argv)
 
 void pingpong_init()
 {
+  struct tcpipc_opts_t tcp_opts;
+  const char *flight_dir, *reconnect_ms;
+
 #if PINGPONG_EN_JOYSTICK
   joystick_init();
 #endif
@@ -188,9 +205,29 @@ void pingpong_init()
   noecho();
   curs_set(0);
 
+  tcpipc_opts_default(&tcp_opts);
+  tcp_opts.tx_batch = 1;
+  tcp_opts.conflate = 1;
+  tcp_opts.ping_interval_ms = 1000;
+
+  // Off unless asked for, every lost connection writes a dump file
+  flight_dir = getenv("PINGPONG_FLIGHT_DIR");
+
+  if (flight_dir != NULL)
+  {
+    tcp_opts.flight_len = PINGPONG_FLIGHT_LEN;
+    tcp_opts.flight_dir = flight_dir;
+  }
+
+  // Off unless asked for, the game freezes while the link is retried
+  reconnect_ms = getenv("PINGPONG_RECONNECT_MS");
+
+  if (reconnect_ms != NULL)
+    tcp_opts.reconnect_ms = atoi(reconnect_ms);
+
   if (is_server)
   {
-    tcpipc_init(TCP_ROLE_SERVER, "", 9000);
+    tcp_ctx = tcpipc_init_opts(TCP_ROLE_SERVER, "", 9000, &tcp_opts);
 
     // set color pair for player paddle
     init_pair(MY_PADDLE_COLOR, COLOR_CYAN, COLOR_BLACK);
@@ -200,7 +237,8 @@ void pingpong_init()
   }
   else
   {
-    tcpipc_init(TCP_ROLE_CLIENT, "10.0.0.242", 9000);
+    tcp_ctx = tcpipc_init_opts(TCP_ROLE_CLIENT, "10.0.0.242", 9000,
+                               &tcp_opts);
 
     // set color pair for player paddle
     init_pair(MY_PADDLE_COLOR, COLOR_YELLOW, COLOR_BLACK);
@@ -209,6 +247,24 @@ void pingpong_init()
     init_pair(OPP_PADDLE_COLOR, COLOR_CYAN, COLOR_BLACK);
   }
 
+  if (tcp_ctx == NULL)
+  {
+    delwin(main_window);
+    endwin();
+    printf("Could not connect to the opponent\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // Positions are latest-value-wins, a newer update supersedes a lost one
+  tcpipc_set_msg_class(tcp_ctx, MSG_ID_PAD_POS, TCPIPC_MSG_STATE);
+  tcpipc_set_msg_class(tcp_ctx, MSG_ID_BALL_POS, TCPIPC_MSG_STATE);
+
+  tcpipc_on(tcp_ctx, MSG_ID_WIN_SIZE, pingpong_on_win_size, NULL);
+  tcpipc_on(tcp_ctx, MSG_ID_PAD_POS, pingpong_on_pad_pos, NULL);
+  tcpipc_on(tcp_ctx, MSG_ID_BALL_POS, pingpong_on_ball_pos, NULL);
+  tcpipc_on(tcp_ctx, MSG_ID_GAME_STATUS, pingpong_on_game_status, NULL);
+  tcpipc_on(tcp_ctx, MSG_ID_SYNC, pingpong_on_sync, NULL);
+
   /* set color pair for ball */
   init_pair(BALL_COLOR, COLOR_RED, COLOR_BLACK);
 
@@ -216,9 +272,11 @@ void pingpong_init()
   init_pair(SCORE_COLOR, COLOR_GREEN, COLOR_BLACK);
 
   pingpong_send_msg(MSG_ID_WIN_SIZE);
+  tcpipc_flush(tcp_ctx);
 
   // Get opponents window size
-  while (pingpong_recv_msg() != MSG_ID_WIN_SIZE);
+  while (!end && !opp_win_known)
+    pingpong_wait_msgs();
 
   // Set game window size to minimum specs
   if (term_win_info.width <= opp_term_win_info.width)
@@ -239,7 +297,7 @@ void pingpong_close()
 #if PINGPONG_EN_JOYSTICK
   joystick_close();
 #endif
-  tcpipc_close();
+  tcpipc_close(tcp_ctx);
   delwin(main_window);
   endwin();
   refresh();
@@ -281,14 +339,16 @@ void pingpong_new_round()
   if (is_server)
   {
     pingpong_send_msg(MSG_ID_BALL_POS);
-    usleep(1000);
     pingpong_send_msg(MSG_ID_GAME_STATUS);
-    usleep(1000);
     pingpong_send_msg(MSG_ID_SYNC);
+    tcpipc_flush(tcp_ctx);
   }
   else
   {
-    while (pingpong_recv_msg() != MSG_ID_SYNC);
+    synced = false;
+
+    while (!end && !synced)
+      pingpong_wait_msgs();
   }
 }
 
@@ -357,6 +417,10 @@ void pingpong_pad_mov(struct pad_obj_t *pad, mov_dir_t dir)
  *******************************************************************************/
 void pingpong_update_scrn()
 {
+#if PINGPONG_EN_LOGS
+  struct tcpipc_rtt_t rtt;
+#endif
+
   erase();
 
   attron(COLOR_PAIR(SCORE_COLOR));
@@ -381,52 +445,50 @@ void pingpong_update_scrn()
   mvprintw(0, 0, "%d,%d", ball_obj.x, ball_obj.y);
   mvprintw(1, 0, "%d,%d", p1_pad.x, p1_pad.y);
   mvprintw(2, 0, "%d,%d", p2_pad.x, p2_pad.y);
+
+  if (tcpipc_get_rtt(tcp_ctx, &rtt) == 0)
+    mvprintw(3, 0, "rtt %luus +-%luus", (unsigned long)(rtt.rtt_ns / 1000),
+             (unsigned long)(rtt.jitter_ns / 1000));
 #endif
 }
 
 int pingpong_send_msg(enum msg_id_e msg_id)
 {
-  uint8_t msg_buffer[16];
+  uint8_t msg_buffer[TCPIPC_MSG_MAX_LEN];
   struct msg_packet_t msg_packet;
+  union tcpipc_msg_u msg;
+
+  memset(&msg, 0, sizeof(msg));
 
   switch (msg_id)
   {
   case MSG_ID_WIN_SIZE:
-    msg_buffer[0] = (term_win_info.width >> 0) & 0xFF;
-    msg_buffer[1] = (term_win_info.width >> 8) & 0xFF;
-    msg_buffer[2] = (term_win_info.height >> 0) & 0xFF;
-    msg_buffer[3] = (term_win_info.height >> 8) & 0xFF;
-
-    msg_packet.msg_len = 4;
+    msg.win_size.width = term_win_info.width;
+    msg.win_size.height = term_win_info.height;
+    msg_packet.msg_len = tcpipc_msg_win_size_encode(msg_buffer, &msg.win_size);
     break;
 
   case MSG_ID_PAD_POS:
-    msg_buffer[0] = (p1_pad.x >> 0) & 0xFF;
-    msg_buffer[1] = (p1_pad.x >> 8) & 0xFF;
-
-    msg_packet.msg_len = 2;
+    msg.pad_pos.x = p1_pad.x;
+    msg_packet.msg_len = tcpipc_msg_pad_pos_encode(msg_buffer, &msg.pad_pos);
     break;
 
   case MSG_ID_BALL_POS:
-    msg_buffer[0] = (ball_obj.x >> 0) & 0xFF;
-    msg_buffer[1] = (ball_obj.x >> 8) & 0xFF;
-    msg_buffer[2] = (ball_obj.y >> 0) & 0xFF;
-    msg_buffer[3] = (ball_obj.y >> 8) & 0xFF;
-    msg_buffer[4] = (ball_obj.movhor & 0x0F) |
-                    ((ball_obj.movver << 4) & 0xF0);
-
-    msg_packet.msg_len = 5;
+    msg.ball_pos.x = ball_obj.x;
+    msg.ball_pos.y = ball_obj.y;
+    msg.ball_pos.flags = ball_obj.movhor | (ball_obj.movver << 4);
+    msg_packet.msg_len = tcpipc_msg_ball_pos_encode(msg_buffer, &msg.ball_pos);
     break;
 
   case MSG_ID_GAME_STATUS:
-    msg_buffer[0] = p1_pad.wins;
-    msg_buffer[1] = p2_pad.wins;
-
-    msg_packet.msg_len = 2;
+    msg.game_status.wins = p1_pad.wins;
+    msg.game_status.opp_wins = p2_pad.wins;
+    msg_packet.msg_len = tcpipc_msg_game_status_encode(msg_buffer,
+                                                       &msg.game_status);
     break;
 
   case MSG_ID_SYNC:
-    msg_packet.msg_len = 1;
+    msg_packet.msg_len = TCPIPC_MSG_SYNC_LEN;
     break;
 
   default:
@@ -436,57 +498,77 @@ int pingpong_send_msg(enum msg_id_e msg_id)
 
   msg_packet.msg_id = msg_id;
   msg_packet.msg_data = msg_buffer;
-  tcpipc_send(&msg_packet);
+  tcpipc_send(tcp_ctx, &msg_packet);
   return 0;
 }
 
-int pingpong_recv_msg()
+/*******************************************************************************
+ * @brief   Blocks until messages from the opponent arrive and handles them.
+ *
+ * @return
+ *******************************************************************************/
+void pingpong_wait_msgs()
 {
-  struct msg_packet_t msg_packet;
+  // Blocking forever only fails once the opponent is gone
+  if (tcpipc_dispatch_wait(tcp_ctx, -1, 0) < 0)
+    end = true;
+}
 
-  if (tcpipc_recv(&msg_packet))
-    return -1;
+/*******************************************************************************
+ * @brief   Handlers of the messages from the opponent, see tcpipc_schema.h
+ *          for the layouts. Payloads too short for theirs are ignored.
+ *
+ * @return
+ *******************************************************************************/
+void pingpong_on_win_size(void *arg, const struct tcpipc_msg_view_t *view)
+{
+  struct tcpipc_msg_win_size_t msg;
 
-  switch (msg_packet.msg_id)
-  {
-  case MSG_ID_WIN_SIZE:
-    opp_term_win_info.width = (msg_packet.msg_data[0] << 0) |
-                              (msg_packet.msg_data[1] << 8);
-    opp_term_win_info.height = (msg_packet.msg_data[2] << 0) |
-                               (msg_packet.msg_data[3] << 8);
-    break;
+  if (tcpipc_msg_win_size_decode(&msg, view->msg_data, view->msg_len))
+    return;
 
-  case MSG_ID_PAD_POS:
-    p2_pad.x = (msg_packet.msg_data[0] | (msg_packet.msg_data[1] << 8));
-    p2_pad.x = win_width - p2_pad.x;
-    break;
+  opp_term_win_info.width = msg.width;
+  opp_term_win_info.height = msg.height;
+  opp_win_known = true;
+}
 
-  case MSG_ID_BALL_POS:
-    ball_obj.x = (msg_packet.msg_data[0] << 0) |
-                 (msg_packet.msg_data[1] << 8);
-    ball_obj.x = win_width - ball_obj.x;
-    ball_obj.y = (msg_packet.msg_data[2] << 0) |
-                 (msg_packet.msg_data[3] << 8);
-    ball_obj.y = win_height - ball_obj.y;
-
-    ball_obj.movhor = !(bool)(msg_packet.msg_data[4] & 0x0F);
-    ball_obj.movver = !(bool)(msg_packet.msg_data[4] & 0xF0);
-    break;
+void pingpong_on_pad_pos(void *arg, const struct tcpipc_msg_view_t *view)
+{
+  struct tcpipc_msg_pad_pos_t msg;
 
-  case MSG_ID_GAME_STATUS:
-    p2_pad.wins = msg_packet.msg_data[0];
-    p1_pad.wins = msg_packet.msg_data[1];
-    break;
+  if (tcpipc_msg_pad_pos_decode(&msg, view->msg_data, view->msg_len))
+    return;
 
-  case MSG_ID_SYNC:
-    break;
+  p2_pad.x = win_width - msg.x;
+}
 
-  default:
-    printf("Invalid msg id received\n");
-    return -1;
-  }
+void pingpong_on_ball_pos(void *arg, const struct tcpipc_msg_view_t *view)
+{
+  struct tcpipc_msg_ball_pos_t msg;
+
+  if (tcpipc_msg_ball_pos_decode(&msg, view->msg_data, view->msg_len))
+    return;
 
-  return msg_packet.msg_id;
+  ball_obj.x = win_width - msg.x;
+  ball_obj.y = win_height - msg.y;
+  ball_obj.movhor = !(msg.flags & 0x0F);
+  ball_obj.movver = !(msg.flags & 0xF0);
+}
+
+void pingpong_on_game_status(void *arg, const struct tcpipc_msg_view_t *view)
+{
+  struct tcpipc_msg_game_status_t msg;
+
+  if (tcpipc_msg_game_status_decode(&msg, view->msg_data, view->msg_len))
+    return;
+
+  p2_pad.wins = msg.wins;
+  p1_pad.wins = msg.opp_wins;
+}
+
+void pingpong_on_sync(void *arg, const struct tcpipc_msg_view_t *view)
+{
+  synced = true;
 }
 
 void pingpong_read_keypad()
@@ -5,354 +5,2653 @@
  * @author  Ajay Kandagal <ajka9053@colorado.edu>
  * @date    Apr 10th 2023
  *******************************************************************************/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
 #include "tcpipc.h"
+#include "tcpipc_ctx.h"
+
+/** Private Function Prototypes **/
+static int tcpipc_server_setup(struct tcpipc_ctx *ctx, int port);
+static int tcpipc_server_connect(struct tcpipc_ctx *ctx);
+static int tcpipc_client_setup(struct tcpipc_ctx *ctx, char *serv_addr,
+                               int serv_port);
+static int tcpipc_client_connect(struct tcpipc_ctx *ctx);
+static int tcpipc_client_dial(struct tcpipc_ctx *ctx, uint64_t deadline);
+static int tcpipc_connect_once(struct tcpipc_ctx *ctx, int timeout_ms);
+static int tcpipc_accept_wait(struct tcpipc_ctx *ctx, uint64_t deadline);
+static void tcpipc_setup_stream(struct tcpipc_ctx *ctx);
+static int tcpipc_reconnect(struct tcpipc_ctx *ctx);
+static struct tcpipc_ctx *tcpipc_terminate(struct tcpipc_ctx *ctx);
+static void *tcpipc_recv_thread(void *argv);
+static int tcpipc_recv_stream(struct tcpipc_ctx *ctx);
+static void tcpipc_recv_poll(struct tcpipc_ctx *ctx, int spilled,
+                             uint64_t wait_ns);
+static void tcpipc_recv_frame(void *arg, uint8_t msg_id, const uint8_t *data,
+                              uint32_t len);
+static int tcpipc_wait(struct tcpipc_ctx *ctx, int timeout_ms,
+                       uint64_t deadline);
+static int tcpipc_dispatch_visit(void *arg,
+                                 const struct tcpipc_msg_view_t *view);
+static void tcpipc_tune_socket(struct tcpipc_ctx *ctx, int fd);
+static void tcpipc_tune_thread(struct tcpipc_ctx *ctx);
+static int tcpipc_send_frame(struct tcpipc_ctx *ctx, uint8_t chan,
+                             uint8_t msg_id, const uint8_t *data,
+                             uint32_t len);
+static size_t tcpipc_put_prefix(struct tcpipc_ctx *ctx, uint8_t *buf,
+                                uint8_t chan);
+static int tcpipc_flush_frames(struct tcpipc_ctx *ctx);
+static int tcpipc_send_internal(struct tcpipc_ctx *ctx, uint8_t msg_id,
+                                const uint8_t *data, uint32_t len);
+static void tcpipc_ping_poll(struct tcpipc_ctx *ctx);
+static uint64_t tcpipc_flush_poll(struct tcpipc_ctx *ctx);
+static void tcpipc_recv_internal(struct tcpipc_ctx *ctx, uint8_t msg_id,
+                                 const uint8_t *data, uint32_t len);
+static int tcpipc_send_dgram_prefixed(struct tcpipc_ctx *ctx, uint8_t chan,
+                                      uint8_t msg_id, const uint8_t *data,
+                                      uint32_t len);
+static int tcpipc_bulk_start(struct tcpipc_ctx *ctx, uint8_t chan,
+                             uint8_t msg_id, const uint8_t *buf, int fd,
+                             off_t off, uint32_t len);
+static uint32_t tcpipc_bulk_frag_len(struct tcpipc_ctx *ctx);
+static int tcpipc_bulk_frag(struct tcpipc_ctx *ctx);
+static int tcpipc_bulk_frag_copy(struct tcpipc_ctx *ctx, uint32_t len,
+                                 uint8_t flags);
+static void tcpipc_recv_bulk(struct tcpipc_ctx *ctx, uint8_t chan);
+static int tcpipc_send_resume(struct tcpipc_ctx *ctx);
+static void tcpipc_recv_session(struct tcpipc_ctx *ctx, uint8_t msg_id,
+                                const uint8_t *data, uint32_t len);
+static void tcpipc_recv_count(struct tcpipc_ctx *ctx, uint32_t len);
+static void tcpipc_tx_lock(struct tcpipc_ctx *ctx);
+static int tcpipc_tx_trylock(struct tcpipc_ctx *ctx, int nowait);
+static int tcpipc_tx_unlock(struct tcpipc_ctx *ctx);
+static void tcpipc_tx_wait(void *arg, int waiting);
+static void tcpipc_ctl_post(struct tcpipc_ctx *ctx, int ctl);
+static void tcpipc_ctl_send(struct tcpipc_ctx *ctx);
+static void tcpipc_ctl_resume(struct tcpipc_ctx *ctx);
+static void tcpipc_log_frame(void *arg, const uint8_t *hdr, size_t hdr_len,
+                             const uint8_t *data, size_t len);
+
+/*******************************************************************************
+ * @brief   Opens a connection with the default options.
+ *
+ * @return  Connection handle, NULL on failure
+ *******************************************************************************/
+struct tcpipc_ctx *tcpipc_init(enum tcp_role_e tcp_role, char *addr, int port)
+{
+    return tcpipc_init_opts(tcp_role, addr, port, NULL);
+}
+
+/*******************************************************************************
+ * @brief   Same as tcpipc_init() with explicit options, NULL selects defaults.
+ *          Every handle owns its sockets, buffers and receive thread, so
+ *          several connections can be driven from one process.
+ *
+ * @return  Connection handle, NULL on failure
+ *******************************************************************************/
+struct tcpipc_ctx *tcpipc_init_opts(enum tcp_role_e tcp_role, char *addr,
+                                    int port, const struct tcpipc_opts_t *opts)
+{
+    struct tcpipc_ctx *ctx;
+    size_t ctx_size;
+    int ret;
+
+    ctx_size = (sizeof(struct tcpipc_ctx) + RECV_MSG_CACHE_LINE - 1) &
+               ~(size_t)(RECV_MSG_CACHE_LINE - 1);
+    ctx = (struct tcpipc_ctx *)aligned_alloc(RECV_MSG_CACHE_LINE, ctx_size);
+
+    if (ctx == NULL)
+    {
+        perror("Failed to allocate context");
+        return NULL;
+    }
+
+    memset(ctx, 0, sizeof(struct tcpipc_ctx));
+    ctx->client_info.fd = -1;
+    ctx->server_info.fd = -1;
+    ctx->udp.fd = -1;
+    ctx->tx_ring.ring_fd = -1;
+    ctx->recv_cb.event_fd = -1;
+    ctx->capture.fd = -1;
+    pthread_mutex_init(&ctx->tx_lock, NULL);
+    pthread_cond_init(&ctx->tx_idle, NULL);
+
+    if (opts)
+        ctx->opts = *opts;
+    else
+        tcpipc_opts_default(&ctx->opts);
+
+    tcpipc_clock_init(&ctx->clock, ctx->opts.ping_interval_ms);
+
+    if (ctx->opts.flight_len &&
+        tcpipc_flight_init(&ctx->flight, ctx->opts.flight_len,
+                           ctx->opts.flight_dir, port,
+                           tcp_role == TCP_ROLE_SERVER ? "server" : "client"))
+        return tcpipc_terminate(ctx);
+
+    if (ctx->opts.capture &&
+        tcpipc_capture_open(&ctx->capture, ctx->opts.capture_dir, port,
+                            tcp_role == TCP_ROLE_SERVER ? "server" : "client"))
+        return tcpipc_terminate(ctx);
+
+    // Over UDP a late PING is worthless, keep it off the reliable lane
+    if (ctx->opts.ping_interval_ms)
+    {
+        ctx->msg_class[TCPIPC_MSG_ID_PING] = TCPIPC_MSG_STATE;
+        ctx->msg_class[TCPIPC_MSG_ID_PONG] = TCPIPC_MSG_STATE;
+    }
+
+    // The channel and the send time travel on top of the payload
+    if (tcpipc_decoder_init(&ctx->decoder, ctx->opts.len_size,
+                            ctx->opts.rx_buf_size,
+                            ctx->opts.max_msg_len +
+                                (ctx->opts.channels ? TCPIPC_CHAN_LEN : 0) +
+                                (ctx->opts.timestamping ? TCPIPC_TSTAMP_LEN
+                                                        : 0)))
+    {
+        printf("Invalid receive buffer options\n");
+        return tcpipc_terminate(ctx);
+    }
+
+    if (ctx->opts.transport == TCPIPC_TRANSPORT_UDP)
+    {
+        if (tcpipc_udp_setup(&ctx->udp, tcp_role == TCP_ROLE_SERVER, addr,
+                             port, &ctx->client_info.exit_status))
+            return tcpipc_terminate(ctx);
+
+        tcpipc_tune_socket(ctx, ctx->udp.fd);
+        ctx->client_info.fd = ctx->udp.fd;
+        ctx->client_info.port = port;
+        ctx->sock_info = &ctx->client_info;
+        tcp_role = TCP_ROLE_NONE;
+    }
+    else if (ctx->opts.transport == TCPIPC_TRANSPORT_SHM)
+    {
+        if (tcpipc_shm_setup(&ctx->shm, tcp_role == TCP_ROLE_SERVER, port))
+            return tcpipc_terminate(ctx);
+
+        ctx->client_info.port = port;
+        ctx->sock_info = &ctx->client_info;
+        tcp_role = TCP_ROLE_NONE;
+    }
+
+    ctx->role = tcp_role;
+
+    // Frames are numbered from the first one, see tcpipc_resume_t
+    if (ctx->opts.reconnect_ms && tcp_role != TCP_ROLE_NONE)
+    {
+        if (tcpipc_resume_init(&ctx->resume, ctx->opts.resume_log_size))
+        {
+            printf("Invalid resume log size\n");
+            return tcpipc_terminate(ctx);
+        }
+
+        atomic_store(&ctx->resume.link, TCPIPC_LINK_RESUMING);
+
+        if (ctx->opts.ping_interval_ms)
+            ctx->resume.silent_ns = TCPIPC_RESUME_SILENT_PINGS *
+                                    ctx->clock.interval_ns;
+    }
+
+    // The receive thread sends too, PONGs, ACKs and RESUMEs, and flushes
+    // batches that aged past tx_flush_usec with no send to do it
+    ctx->tx_shared = ctx->clock.interval_ns || ctx->resume.buf ||
+                     (ctx->opts.tx_batch && ctx->opts.tx_flush_usec &&
+                      ctx->opts.transport == TCPIPC_TRANSPORT_TCP);
+
+    switch (tcp_role)
+    {
+    case TCP_ROLE_NONE:
+        break;
+    case TCP_ROLE_SERVER:
+        if (tcpipc_server_setup(ctx, port))
+            return tcpipc_terminate(ctx);
+
+        if (tcpipc_server_connect(ctx))
+            return tcpipc_terminate(ctx);
+
+        ctx->sock_info = &ctx->client_info;
+        break;
+    case TCP_ROLE_CLIENT:
+        if (tcpipc_client_setup(ctx, addr, port))
+            return tcpipc_terminate(ctx);
+
+        if (tcpipc_client_connect(ctx))
+            return tcpipc_terminate(ctx);
+
+        ctx->sock_info = &ctx->client_info;
+        break;
+    default:
+        printf("Invalid TCP role selected\n");
+        return tcpipc_terminate(ctx);
+    }
+
+    if (tcpipc_txq_init(&ctx->txq, ctx->client_info.fd, ctx->opts.tx_buf_size,
+                        ctx->opts.tx_batch ? ctx->opts.tx_flush_bytes : 0,
+                        ctx->opts.tx_batch ? ctx->opts.tx_flush_usec : 0))
+    {
+        printf("Invalid transmit buffer options\n");
+        return tcpipc_terminate(ctx);
+    }
+
+    // Senders let go of tx_lock while the socket is full
+    if (ctx->tx_shared)
+    {
+        ctx->txq.wait_cb = tcpipc_tx_wait;
+        ctx->txq.wait_arg = ctx;
+    }
+
+    // Only a batched stream holds frames back long enough to reorder them
+    if (ctx->opts.channels &&
+        tcpipc_chan_init(&ctx->chan, ctx->opts.channels, ctx->opts.chan_weight,
+                         ctx->opts.tx_batch &&
+                                 ctx->opts.transport == TCPIPC_TRANSPORT_TCP
+                             ? ctx->opts.tx_buf_size
+                             : 0,
+                         ctx->opts.tx_flush_bytes, ctx->opts.tx_flush_usec))
+    {
+        printf("Invalid channel options\n");
+        return tcpipc_terminate(ctx);
+    }
+
+    // Queued frames leave their channels out of order, they are logged then
+    if (ctx->resume.buf && ctx->chan.size)
+    {
+        ctx->chan.log_cb = tcpipc_log_frame;
+        ctx->chan.log_arg = ctx;
+    }
+
+    // The receive thread sets up its own ring, see tcpipc_recv_thread()
+    if (ctx->opts.io_uring && ctx->opts.transport == TCPIPC_TRANSPORT_TCP &&
+        tcpipc_uring_available() &&
+        tcpipc_uring_init(&ctx->tx_ring, TCPIPC_URING_ENTRIES, 0) == 0)
+        ctx->txq.uring = &ctx->tx_ring;
+
+    if (ctx->opts.transport == TCPIPC_TRANSPORT_TCP)
+        tcpipc_setup_stream(ctx);
+
+    if (recv_msg_cb_init(&ctx->recv_cb, ctx->opts.rx_queue_len) ||
+        recv_msg_cb_set_overflow(&ctx->recv_cb, ctx->opts.rx_overflow,
+                                 ctx->opts.rx_queue_max) ||
+        recv_msg_cb_init_event(&ctx->recv_cb) ||
+        recv_msg_cb_init_stamps(&ctx->recv_cb) ||
+        (ctx->opts.conflate && recv_msg_cb_init_conflate(&ctx->recv_cb)) ||
+        (ctx->opts.timestamping &&
+         recv_msg_cb_init_trace(&ctx->recv_cb, TCPIPC_TSTAMP_LOG_LEN)))
+    {
+        printf("Failed to create receive queue\n");
+        return tcpipc_terminate(ctx);
+    }
+
+    tcpipc_flight_record(&ctx->flight, TCPIPC_FLIGHT_UP, 0, 0);
+
+    // Opens the session, the lock is taken for tcpipc_tx_wait() only
+    if (ctx->resume.buf)
+    {
+        ctx->resume.last_rx_ns = tcpipc_now_ns();
+
+        tcpipc_tx_lock(ctx);
+        ret = tcpipc_send_resume(ctx);
+        pthread_mutex_unlock(&ctx->tx_lock);
+
+        if (ret)
+            return tcpipc_terminate(ctx);
+    }
+
+    if (pthread_create(&ctx->recv_tid, NULL, tcpipc_recv_thread, ctx))
+    {
+        printf("Failed to start receive thread\n");
+        return tcpipc_terminate(ctx);
+    }
+
+    ctx->recv_started = 1;
+    tcpipc_stats_register(ctx);
+
+    return ctx;
+}
+
+/*******************************************************************************
+ * @brief   Fills opts with the default options.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_opts_default(struct tcpipc_opts_t *opts)
+{
+    memset(opts, 0, sizeof(struct tcpipc_opts_t));
+
+    opts->len_size = TCPIPC_LEN_8;
+    opts->rx_buf_size = BUFFER_MAX_SIZE * 4;
+    opts->max_msg_len = TCPIPC_DEF_MAX_MSG_LEN;
+    opts->tx_batch = 0;
+    opts->tx_buf_size = TCPIPC_TXQ_DEF_SIZE;
+    opts->tx_flush_bytes = TCPIPC_TXQ_DEF_SIZE;
+    opts->tx_flush_usec = 1000;
+    opts->transport = TCPIPC_TRANSPORT_TCP;
+    opts->conflate = 0;
+    opts->rx_queue_len = RECV_MSG_CB_DEF_LEN;
+    opts->rx_queue_max = RECV_MSG_CB_DEF_MAX_LEN;
+    opts->rx_overflow = RECV_MSG_OVERFLOW_DROP_NEWEST;
+    opts->io_uring = 0;
+    opts->rx_inline = 0;
+    opts->rx_cpu = -1;
+    opts->rx_priority = 0;
+    opts->busy_poll_usec = 0;
+    opts->sock_rcvbuf = 0;
+    opts->sock_sndbuf = 0;
+    opts->quickack = 0;
+    opts->rx_busy_spin = 0;
+    opts->ping_interval_ms = 0;
+    opts->timestamping = 0;
+    opts->flight_len = 0;
+    opts->flight_dir = NULL;
+    opts->channels = 0;
+
+    for (int i = 0; i < TCPIPC_CHAN_MAX; i++)
+        opts->chan_weight[i] = TCPIPC_CHAN_DEF_WEIGHT;
+
+    opts->bulk_frag_len = TCPIPC_BULK_DEF_FRAG_LEN;
+    opts->bulk_max_len = 0;
+    opts->bulk_zerocopy = 0;
+    opts->reconnect_ms = 0;
+    opts->reconnect_backoff_ms = TCPIPC_RESUME_DEF_BACKOFF_MS;
+    opts->resume_log_size = TCPIPC_RESUME_DEF_LOG_SIZE;
+    opts->capture = 0;
+    opts->capture_dir = NULL;
+}
+
+/*******************************************************************************
+ * @brief   Flushes pending frames, stops the receive thread and frees the
+ *          handle.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_close(struct tcpipc_ctx *ctx)
+{
+    if (ctx == NULL)
+        return;
+
+    // The receive thread may be writing a PONG
+    tcpipc_tx_lock(ctx);
+    tcpipc_flush_frames(ctx);
+
+    // Tells the peer not to wait for us to come back
+    if (ctx->resume.buf)
+        tcpipc_send_internal(ctx, TCPIPC_MSG_ID_RESUME, NULL, 0);
+
+    // Stop our own receive loop, a blocked read on the stream returns 0 once
+    // it is shut down. A reconnect installs its stream under the same lock,
+    // before this or not at all.
+    ctx->client_info.exit_status = 1;
+
+    if (ctx->opts.transport == TCPIPC_TRANSPORT_TCP &&
+        ctx->client_info.fd >= 0)
+        shutdown(ctx->client_info.fd, SHUT_RDWR);
+
+    pthread_mutex_unlock(&ctx->tx_lock);
+
+    if (ctx->opts.transport == TCPIPC_TRANSPORT_SHM)
+        tcpipc_shm_shutdown(&ctx->shm);
+
+    // The receive thread may be parked on a full queue
+    recv_msg_cb_unblock(&ctx->recv_cb);
+
+    if (ctx->recv_started)
+        pthread_join(ctx->recv_tid, NULL);
+
+    tcpipc_terminate(ctx);
+}
+
+/*******************************************************************************
+ * @brief   Sends a message. With batching enabled the frame is queued and goes
+ *          out on tcpipc_flush() or when a flush threshold is crossed.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_send(struct tcpipc_ctx *ctx, struct msg_packet_t *msg_packet)
+{
+    return tcpipc_send_chan(ctx, 0, msg_packet);
+}
+
+/*******************************************************************************
+ * @brief   Sends a message on channel chan, see channels. tcpipc_send() uses
+ *          channel 0.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_send_chan(struct tcpipc_ctx *ctx, uint8_t chan,
+                     struct msg_packet_t *msg_packet)
+{
+    uint64_t frame_len = msg_packet->msg_len;
+    int ret;
+
+    if (chan && chan >= ctx->chan.count)
+    {
+        printf("Invalid channel: %u\n", chan);
+        return -1;
+    }
+
+    if (ctx->chan.count)
+        frame_len += TCPIPC_CHAN_LEN;
+
+    if (ctx->opts.timestamping)
+        frame_len += TCPIPC_TSTAMP_LEN;
+
+    if (frame_len > tcpipc_len_size_max(ctx->opts.len_size))
+    {
+        printf("Message too long for length field: %u\n", msg_packet->msg_len);
+        return -1;
+    }
+
+    tcpipc_stat_add(&ctx->counters.msgs_out, 1);
+    tcpipc_stat_add(&ctx->counters.bytes_out, msg_packet->msg_len);
+
+    if (ctx->chan.count)
+    {
+        tcpipc_stat_add(&ctx->chan.q[chan].msgs_out, 1);
+        tcpipc_stat_add(&ctx->chan.q[chan].bytes_out, msg_packet->msg_len);
+    }
+
+    // Without PINGs or resume the application thread is the only sender
+    if (!ctx->tx_shared)
+        return tcpipc_send_frame(ctx, chan, msg_packet->msg_id,
+                                 msg_packet->msg_data, msg_packet->msg_len);
+
+    tcpipc_tx_lock(ctx);
+    ret = tcpipc_send_frame(ctx, chan, msg_packet->msg_id,
+                            msg_packet->msg_data, msg_packet->msg_len);
+    tcpipc_ping_poll(ctx);
+    tcpipc_tx_unlock(ctx);
+
+    return ret;
+}
+
+/*******************************************************************************
+ * @brief   Starts sending len bytes of buf as one message with msg_id on
+ *          channel chan. tcpipc_bulk_poll() or tcpipc_bulk_wait() move it
+ *          forward; buf must stay untouched until they report it done.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_bulk_send(struct tcpipc_ctx *ctx, uint8_t chan, uint8_t msg_id,
+                     const void *buf, uint32_t len)
+{
+    return tcpipc_bulk_start(ctx, chan, msg_id, (const uint8_t *)buf, -1, 0,
+                             len);
+}
+
+/*******************************************************************************
+ * @brief   Same as tcpipc_bulk_send() with len bytes of the file fd from off.
+ *          The file position of fd is not used.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_bulk_sendfile(struct tcpipc_ctx *ctx, uint8_t chan, uint8_t msg_id,
+                         int fd, off_t off, uint32_t len)
+{
+    return tcpipc_bulk_start(ctx, chan, msg_id, NULL, fd, off, len);
+}
+
+/*******************************************************************************
+ * @brief   Sends the next fragment of the bulk transfer, or collects its
+ *          zero-copy completions once all are sent. Each fragment is written
+ *          on its own, so PONGs and frames sent between two calls go out
+ *          between fragments instead of after the whole transfer.
+ *
+ * @return  1 while the transfer is in progress, 0 when it is done or none
+ *          was started, -1 on failure, which ends the transfer
+ *******************************************************************************/
+int tcpipc_bulk_poll(struct tcpipc_ctx *ctx)
+{
+    struct tcpipc_bulk_tx_t *tx = &ctx->bulk_tx;
+    int ret = 0;
+
+    if (!tx->active)
+        return 0;
+
+    // The receiver dropped what it got of a transfer cut by a lost link, and
+    // completions of the old stream never come
+    if (ctx->resume.buf &&
+        atomic_load_explicit(&ctx->resume.epoch, memory_order_relaxed) !=
+            tx->epoch)
+    {
+        printf("Bulk transfer cut by a lost link\n");
+        tx->zc_done = tx->zc_calls;
+        ret = -1;
+    }
+    else if (!tx->last_sent)
+    {
+        // The reliable datagram lane takes no more until the peer ACKs
+        if (ctx->opts.transport == TCPIPC_TRANSPORT_UDP &&
+            tcpipc_udp_window_full(&ctx->udp))
+            return 1;
+
+        // Fragments are not logged, they wait for the link to be back
+        if (ctx->resume.buf && atomic_load_explicit(&ctx->resume.link,
+                                                    memory_order_relaxed) !=
+                                   TCPIPC_LINK_UP)
+            return 1;
+
+        if (!ctx->tx_shared)
+            ret = tcpipc_bulk_frag(ctx);
+        else
+        {
+            tcpipc_tx_lock(ctx);
+            ret = tcpipc_bulk_frag(ctx);
+            tcpipc_ping_poll(ctx);
+            tcpipc_tx_unlock(ctx);
+        }
+
+        if (ret == 0 && !tx->last_sent)
+            return 1;
+    }
+
+    if (ret == 0 && tx->zc_done != tx->zc_calls)
+    {
+        tcpipc_bulk_reap(tx, ctx->client_info.fd);
+
+        if (tx->zc_done != tx->zc_calls)
+            return 1;
+    }
+
+    tx->active = 0;
+    free(tx->scratch);
+    tx->scratch = NULL;
+
+    return ret;
+}
+
+/*******************************************************************************
+ * @brief   Runs tcpipc_bulk_poll() until the transfer is done, waiting up to
+ *          timeout_ms in total. Once every fragment is out it sleeps until
+ *          the socket error queue has completions.
+ *
+ * @return  0 when done, -1 on failure or timeout
+ *******************************************************************************/
+int tcpipc_bulk_wait(struct tcpipc_ctx *ctx, int timeout_ms)
+{
+    uint64_t deadline = tcpipc_now_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    int64_t remaining_ms = -1;
+    uint32_t sent = ctx->bulk_tx.sent;
+    struct pollfd pfd;
+    int ret;
+
+    while ((ret = tcpipc_bulk_poll(ctx)) == 1)
+    {
+        if (timeout_ms >= 0)
+        {
+            remaining_ms = ((int64_t)(deadline - tcpipc_now_ns())) / 1000000;
+
+            if (remaining_ms < 0)
+                return -1;
+        }
+
+        if (!ctx->bulk_tx.last_sent)
+        {
+            // Nothing went out, the datagram window is full or the link down
+            if (ctx->bulk_tx.sent == sent)
+                usleep(TCPIPC_BULK_RETRY_USEC);
+
+            sent = ctx->bulk_tx.sent;
+            continue;
+        }
+
+        // No events asked, poll() only reports the error queue
+        pfd.fd = ctx->client_info.fd;
+        pfd.events = 0;
+
+        if (poll(&pfd, 1, remaining_ms) < 0 && errno != EINTR)
+            return -1;
+    }
+
+    return ret;
+}
+
+/*******************************************************************************
+ * @brief   Selects how messages with the given ID are delivered. STATE
+ *          messages are latest-value-wins and may be dropped when stale,
+ *          CONTROL messages are reliable and ordered (the default).
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_set_msg_class(struct tcpipc_ctx *ctx, uint8_t msg_id,
+                          enum tcpipc_msg_class_e cls)
+{
+    ctx->msg_class[msg_id] = cls;
+
+    if (ctx->opts.conflate)
+        recv_msg_cb_set_conflate(&ctx->recv_cb, msg_id,
+                                 cls == TCPIPC_MSG_STATE);
+}
+
+/*******************************************************************************
+ * @brief   Writes all queued frames in a single system call.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_flush(struct tcpipc_ctx *ctx)
+{
+    int ret;
+
+    if (!ctx->tx_shared)
+        return tcpipc_flush_frames(ctx);
+
+    tcpipc_tx_lock(ctx);
+    ret = tcpipc_flush_frames(ctx);
+    tcpipc_ping_poll(ctx);
+    tcpipc_tx_unlock(ctx);
+
+    return ret;
+}
+
+/*******************************************************************************
+ * @brief   Dequeues a message without blocking.
+ *
+ * @return  0 on success, -1 if no message is pending
+ *******************************************************************************/
+int tcpipc_recv(struct tcpipc_ctx *ctx, struct msg_packet_t *msg_packet)
+{
+    return recv_msg_cb_dequeue(&ctx->recv_cb, msg_packet);
+}
+
+/*******************************************************************************
+ * @brief   Dequeues a message, blocking up to timeout_ms for one to arrive.
+ *          A negative timeout waits forever.
+ *
+ * @return  0 on success, -1 on timeout or when the peer is gone
+ *******************************************************************************/
+int tcpipc_recv_wait(struct tcpipc_ctx *ctx, struct msg_packet_t *msg_packet,
+                     int timeout_ms)
+{
+    uint64_t deadline = tcpipc_now_ns() + (uint64_t)timeout_ms * 1000000ULL;
+
+    while (recv_msg_cb_dequeue(&ctx->recv_cb, msg_packet))
+    {
+        if (tcpipc_wait(ctx, timeout_ms, deadline))
+            return -1;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Returns a file descriptor that polls readable while received
+ *          messages may be pending, for use in an external poll/epoll loop.
+ *          Drain it with tcpipc_recv() until it returns -1.
+ *
+ * @return  File descriptor, -1 if not initialized
+ *******************************************************************************/
+int tcpipc_get_fd(struct tcpipc_ctx *ctx)
+{
+    return ctx->recv_cb.event_fd;
+}
+
+/*******************************************************************************
+ * @brief   Tells whether the link to the peer is up. With reconnect_ms set it
+ *          is down from a loss until the peer resumed the session.
+ *
+ * @return  1 if up, 0 if down or gone
+ *******************************************************************************/
+int tcpipc_link_up(struct tcpipc_ctx *ctx)
+{
+    if (ctx->sock_info == NULL || ctx->sock_info->exit_status)
+        return 0;
+
+    if (ctx->resume.buf == NULL)
+        return 1;
+
+    return atomic_load_explicit(&ctx->resume.link, memory_order_acquire) ==
+           TCPIPC_LINK_UP;
+}
+
+/*******************************************************************************
+ * @brief   Releases the payload of a message returned by tcpipc_recv().
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_msg_free(struct msg_packet_t *msg_packet)
+{
+    msg_packet_free(msg_packet);
+}
+
+/*******************************************************************************
+ * @brief   Borrows the oldest received message without copying it. The view
+ *          must be handed back with tcpipc_recv_release() before the next
+ *          borrow.
+ *
+ * @return  0 on success, -1 if no message is pending
+ *******************************************************************************/
+int tcpipc_recv_view(struct tcpipc_ctx *ctx, struct tcpipc_msg_view_t *view)
+{
+    struct msg_packet_t *slot = recv_msg_cb_peek(&ctx->recv_cb);
+
+    if (slot == NULL)
+        return -1;
+
+    view->msg_id = slot->msg_id;
+    view->msg_chan = slot->msg_chan;
+    view->msg_len = slot->msg_len;
+    view->msg_data = slot->msg_data;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Releases the message borrowed with tcpipc_recv_view().
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_recv_release(struct tcpipc_ctx *ctx)
+{
+    recv_msg_cb_consume(&ctx->recv_cb);
+}
+
+/*******************************************************************************
+ * @brief   Calls visit_cb on up to max pending messages in order, releasing
+ *          each one after the callback returns. max <= 0 visits all.
+ *
+ * @return  Number of messages visited
+ *******************************************************************************/
+int tcpipc_recv_visit(struct tcpipc_ctx *ctx, tcpipc_visit_cb_t visit_cb,
+                      void *arg, int max)
+{
+    struct tcpipc_msg_view_t view;
+    int count = 0, stop = 0;
+
+    while (!stop && (max <= 0 || count < max))
+    {
+        if (tcpipc_recv_view(ctx, &view))
+            break;
+
+        stop = visit_cb(arg, &view);
+        tcpipc_recv_release(ctx);
+        count++;
+    }
+
+    return count;
+}
+
+/*******************************************************************************
+ * @brief   Registers handler for msg_id, replacing the previous one. A NULL
+ *          handler unregisters it. Handlers are called by tcpipc_dispatch(),
+ *          or on the receive thread with rx_inline.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_on(struct tcpipc_ctx *ctx, uint8_t msg_id,
+               tcpipc_handler_cb_t handler, void *arg)
+{
+    struct tcpipc_handler_t *entry = &ctx->handlers[msg_id];
+
+    // Hidden while arg changes so the receive thread never pairs them wrongly
+    atomic_store_explicit(&entry->cb, NULL, memory_order_relaxed);
+    atomic_store_explicit(&entry->arg, arg, memory_order_relaxed);
+    atomic_store_explicit(&entry->cb, handler, memory_order_release);
+}
+
+/*******************************************************************************
+ * @brief   Drains up to max pending messages in one batch, passing each to
+ *          the handler of its ID. Messages without a handler are dropped.
+ *          max <= 0 drains all.
+ *
+ * @return  Number of messages drained
+ *******************************************************************************/
+int tcpipc_dispatch(struct tcpipc_ctx *ctx, int max)
+{
+    return tcpipc_recv_visit(ctx, tcpipc_dispatch_visit, ctx, max);
+}
+
+/*******************************************************************************
+ * @brief   Same as tcpipc_dispatch(), blocking up to timeout_ms for a first
+ *          message to arrive. A negative timeout waits forever.
+ *
+ * @return  Number of messages drained, -1 on timeout or when the peer is gone
+ *******************************************************************************/
+int tcpipc_dispatch_wait(struct tcpipc_ctx *ctx, int timeout_ms, int max)
+{
+    uint64_t deadline = tcpipc_now_ns() + (uint64_t)timeout_ms * 1000000ULL;
+    int count;
+
+    while ((count = tcpipc_dispatch(ctx, max)) == 0)
+    {
+        if (tcpipc_wait(ctx, timeout_ms, deadline))
+            return -1;
+    }
+
+    return count;
+}
+
+/*******************************************************************************
+ * @brief   Copies the counters of channel chan. Safe to call from any thread.
+ *
+ * @return  0 on success, -1 if the channel does not exist
+ *******************************************************************************/
+int tcpipc_get_chan_stats(struct tcpipc_ctx *ctx, uint8_t chan,
+                          struct tcpipc_chan_stats_t *stats)
+{
+    struct tcpipc_chan_q_t *q;
+
+    memset(stats, 0, sizeof(struct tcpipc_chan_stats_t));
+
+    if (chan >= ctx->chan.count)
+        return -1;
+
+    q = &ctx->chan.q[chan];
+    stats->msgs_out = tcpipc_stat_get(&q->msgs_out);
+    stats->bytes_out = tcpipc_stat_get(&q->bytes_out);
+    stats->msgs_in = tcpipc_stat_get(&q->msgs_in);
+    stats->bytes_in = tcpipc_stat_get(&q->bytes_in);
+    stats->wait_max_ns = tcpipc_stat_get(&q->wait_max_ns);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Copies the round trip and clock offset estimates of a connection
+ *          opened with ping_interval_ms. Safe to call from any thread.
+ *
+ * @return  0 on success, -1 if no PONG was received yet
+ *******************************************************************************/
+int tcpipc_get_rtt(struct tcpipc_ctx *ctx, struct tcpipc_rtt_t *rtt)
+{
+    struct tcpipc_clock_t *clk = &ctx->clock;
+
+    memset(rtt, 0, sizeof(struct tcpipc_rtt_t));
+
+    rtt->samples = atomic_load_explicit(&clk->samples, memory_order_acquire);
+
+    if (rtt->samples == 0)
+        return -1;
+
+    rtt->rtt_ns = tcpipc_stat_get(&clk->rtt_ns);
+    rtt->rtt_min_ns = tcpipc_stat_get(&clk->rtt_min_ns);
+    rtt->jitter_ns = tcpipc_stat_get(&clk->jitter_ns);
+    rtt->offset_ns = (int64_t)tcpipc_stat_get(&clk->offset_ns);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Converts a time stamp taken with the peer's tcpipc_now_ns() to our
+ *          clock, using the current offset estimate.
+ *
+ * @return  Local time stamp, peer_ns unchanged if there is no estimate yet
+ *******************************************************************************/
+uint64_t tcpipc_peer_to_local_ns(struct tcpipc_ctx *ctx, uint64_t peer_ns)
+{
+    if (atomic_load_explicit(&ctx->clock.samples, memory_order_acquire) == 0)
+        return peer_ns;
+
+    return peer_ns - tcpipc_stat_get(&ctx->clock.offset_ns);
+}
+
+/*******************************************************************************
+ * @brief   Converts a time stamp taken with our tcpipc_now_ns() to the peer's
+ *          clock, using the current offset estimate.
+ *
+ * @return  Peer time stamp, local_ns unchanged if there is no estimate yet
+ *******************************************************************************/
+uint64_t tcpipc_local_to_peer_ns(struct tcpipc_ctx *ctx, uint64_t local_ns)
+{
+    if (atomic_load_explicit(&ctx->clock.samples, memory_order_acquire) == 0)
+        return local_ns;
+
+    return local_ns + tcpipc_stat_get(&ctx->clock.offset_ns);
+}
+
+/*******************************************************************************
+ * @brief   Moves up to max latency records of consumed messages, oldest
+ *          first, into recs. send_ns is converted to our clock when a clock
+ *          offset estimate exists.
+ *
+ * @return  Number of records copied
+ *******************************************************************************/
+int tcpipc_latency_read(struct tcpipc_ctx *ctx, struct recv_msg_trace_t *recs,
+                        int max)
+{
+    int count = recv_msg_cb_read_trace(&ctx->recv_cb, recs, max);
+
+    for (int i = 0; i < count; i++)
+        recs[i].send_ns = tcpipc_peer_to_local_ns(ctx, recs[i].send_ns);
+
+    return count;
+}
+
+/*******************************************************************************
+ * @brief   Writes the flight recorder of a connection to its dump file.
+ *          Async-signal-safe.
+ *
+ * @return  0 on success, -1 on failure or if the recorder is off
+ *******************************************************************************/
+int tcpipc_dump_flight(struct tcpipc_ctx *ctx)
+{
+    return tcpipc_flight_dump(&ctx->flight);
+}
+
+/*******************************************************************************
+ * @brief   Receive thread of one connection, feeds the context's queue.
+ *
+ * @return
+ *******************************************************************************/
+static void *tcpipc_recv_thread(void *argv)
+{
+    struct tcpipc_ctx *ctx = (struct tcpipc_ctx *)argv;
+    struct socket_info_t *sock_info = ctx->sock_info;
+    int lost = 0;
+
+    tcpipc_tune_thread(ctx);
+
+    if (ctx->opts.transport == TCPIPC_TRANSPORT_UDP)
+    {
+        tcpipc_udp_recv_loop(&ctx->udp, &sock_info->exit_status,
+                             tcpipc_recv_frame, ctx);
+        lost = !sock_info->exit_status;
+        sock_info->exit_status = 1;
+    }
+    else if (ctx->opts.transport == TCPIPC_TRANSPORT_SHM)
+    {
+        tcpipc_shm_recv_loop(&ctx->shm, &sock_info->exit_status,
+                             &ctx->decoder, tcpipc_recv_frame, ctx);
+        lost = !sock_info->exit_status;
+        sock_info->exit_status = 1;
+    }
+    else
+    {
+        // A lost stream is replaced for as long as reconnecting succeeds
+        while (tcpipc_recv_stream(ctx) && tcpipc_reconnect(ctx) == 0)
+            ;
+    }
+
+    // Left the loop on its own, tcpipc_close() did not ask for it
+    if (!sock_info->exit_status)
+        lost = 1;
+
+    sock_info->exit_status = 1;
+    recv_msg_cb_notify(&ctx->recv_cb);
+
+    tcpipc_flight_record(&ctx->flight, TCPIPC_FLIGHT_DOWN, 0, 0);
+
+    if (lost && ctx->flight.slots)
+        tcpipc_flight_dump(&ctx->flight);
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * @brief   Reads the current stream until it fails or the handle is closed.
+ *          With PINGs and resume enabled a peer silent for
+ *          TCPIPC_RESUME_SILENT_PINGS intervals counts as lost.
+ *
+ * @return  1 if the stream was lost, 0 if tcpipc_close() stopped it
+ *******************************************************************************/
+static int tcpipc_recv_stream(struct tcpipc_ctx *ctx)
+{
+    struct socket_info_t *sock_info = ctx->sock_info;
+    uint8_t *buffer;
+    size_t space;
+    ssize_t buffer_len;
+    int flags = ctx->opts.rx_busy_spin ? MSG_DONTWAIT : 0;
+    int quickack = 1, spilled;
+    uint8_t ctrl[TCPIPC_TSTAMP_CTRL_LEN];
+    struct msghdr rx_msg;
+    struct iovec iov;
+    uint64_t kernel_ns, wait_ns;
+
+    memset(&rx_msg, 0, sizeof(rx_msg));
+    rx_msg.msg_iov = &iov;
+    rx_msg.msg_iovlen = 1;
+
+    if (ctx->opts.timestamping)
+        rx_msg.msg_control = ctrl;
+
+    // The io_uring loop only wakes up for data, the receive thread has to
+    // send PINGs, aged batches and the spill on its own
+    if (ctx->opts.io_uring && !ctx->opts.rx_busy_spin &&
+        !ctx->opts.timestamping && !ctx->tx_shared &&
+        tcpipc_uring_recv_loop(sock_info->fd, &sock_info->exit_status,
+                               &ctx->decoder, tcpipc_recv_frame, ctx,
+                               &ctx->counters.rx_syscalls,
+                               &ctx->counters.partial_reads) == 0)
+        return !sock_info->exit_status;
+
+    while (!sock_info->exit_status)
+    {
+        spilled = 0;
+        wait_ns = ctx->txq.flush_usec * 1000ULL;
+
+        // Never waits for the lock, its holder sends the spill first anyway
+        if (ctx->tx_shared && tcpipc_tx_trylock(ctx, 1) == 0)
+        {
+            tcpipc_ping_poll(ctx);
+            wait_ns = tcpipc_flush_poll(ctx);
+            spilled = tcpipc_tx_unlock(ctx);
+        }
+
+        buffer = tcpipc_decoder_wbuf(&ctx->decoder, &space);
+
+        if (buffer == NULL)
+        {
+            printf("Received message exceeds maximum length\n");
+            break;
+        }
+
+        iov.iov_base = buffer;
+        iov.iov_len = space;
+        rx_msg.msg_controllen = rx_msg.msg_control ? sizeof(ctrl) : 0;
+
+        buffer_len = recvmsg(sock_info->fd, &rx_msg, flags);
+        tcpipc_stat_add(&ctx->counters.rx_syscalls, 1);
+
+        if (buffer_len < 0 && (errno == EAGAIN || errno == EINTR))
+        {
+            if (ctx->resume.silent_ns &&
+                tcpipc_now_ns() - ctx->resume.last_rx_ns >
+                    ctx->resume.silent_ns)
+            {
+                printf("Peer silent\n");
+                break;
+            }
+
+            if (!ctx->opts.rx_busy_spin)
+                tcpipc_recv_poll(ctx, spilled, wait_ns);
+
+            continue;
+        }
+
+        if (buffer_len < 0)
+        {
+            perror("Error while getting data");
+            break;
+        }
+        if (buffer_len == 0)
+        {
+            printf("Disconnected\n");
+            break;
+        }
+
+        if (ctx->resume.silent_ns)
+            ctx->resume.last_rx_ns = tcpipc_now_ns();
+
+        // The kernel clears quick ACK mode again after a while
+        if (ctx->opts.quickack)
+        {
+            setsockopt(sock_info->fd, IPPROTO_TCP, TCP_QUICKACK, &quickack,
+                       sizeof(quickack));
+            tcpipc_stat_add(&ctx->counters.rx_syscalls, 1);
+        }
+
+        // Applies to every frame this read completes
+        if (rx_msg.msg_control &&
+            (kernel_ns = tcpipc_tstamp_rx(&rx_msg)) != 0)
+            ctx->rx_kernel_ns = kernel_ns;
+
+        tcpipc_decoder_commit(&ctx->decoder, buffer_len);
+
+        if (tcpipc_decoder_parse(&ctx->decoder, tcpipc_recv_frame, ctx) < 0)
+        {
+            printf("Received message exceeds maximum length\n");
+            break;
+        }
+
+        // The read ended inside a frame, the rest comes with the next one
+        if (ctx->decoder.wr != ctx->decoder.rd)
+            tcpipc_stat_add(&ctx->counters.partial_reads, 1);
+    }
+
+    return !sock_info->exit_status;
+}
+
+/*******************************************************************************
+ * @brief   Waits until the stream has data, for at most one PING interval or
+ *          wait_ns when set. While the receive thread has bytes in the spill
+ *          it also wakes up once the socket has room for them.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_recv_poll(struct tcpipc_ctx *ctx, int spilled,
+                             uint64_t wait_ns)
+{
+    uint64_t ping_ns = ctx->opts.ping_interval_ms * 1000000ULL;
+    struct timespec ts;
+    struct pollfd pfd;
+
+    pfd.fd = ctx->sock_info->fd;
+    pfd.events = POLLIN | (spilled ? POLLOUT : 0);
+
+    if (ping_ns && (wait_ns == 0 || ping_ns < wait_ns))
+        wait_ns = ping_ns;
+
+    ts.tv_sec = wait_ns / 1000000000ULL;
+    ts.tv_nsec = wait_ns % 1000000000ULL;
+
+    // Microseconds matter for a batch, poll() only takes milliseconds
+    ppoll(&pfd, 1, wait_ns ? &ts : NULL, NULL);
+}
+
+/*******************************************************************************
+ * @brief   Decoder callback, queues one received frame on the context passed
+ *          in arg.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_recv_frame(void *arg, uint8_t msg_id, const uint8_t *data,
+                              uint32_t len)
+{
+    struct tcpipc_ctx *ctx = (struct tcpipc_ctx *)arg;
+    struct msg_packet_t *msg_packet;
+    struct tcpipc_msg_view_t view;
+    tcpipc_handler_cb_t handler;
+    uint8_t chan = 0;
+
+    if (ctx->chan.count)
+    {
+        if (len < TCPIPC_CHAN_LEN || data[0] >= ctx->chan.count)
+        {
+            tcpipc_stat_add(&ctx->counters.rx_drops, 1);
+            return;
+        }
+
+        chan = data[0];
+        data += TCPIPC_CHAN_LEN;
+        len -= TCPIPC_CHAN_LEN;
+    }
+
+    if (ctx->opts.timestamping)
+    {
+        if (len < TCPIPC_TSTAMP_LEN)
+        {
+            tcpipc_stat_add(&ctx->counters.rx_drops, 1);
+            return;
+        }
+
+        recv_msg_cb_stage_stamp(&ctx->recv_cb, tcpipc_tstamp_get(data),
+                                ctx->rx_kernel_ns);
+        data += TCPIPC_TSTAMP_LEN;
+        len -= TCPIPC_TSTAMP_LEN;
+    }
+
+    tcpipc_flight_record(&ctx->flight, TCPIPC_FLIGHT_RX, msg_id, len);
+
+    // Library traffic, neither counted nor seen by the application
+    if (ctx->clock.interval_ns && msg_id >= TCPIPC_MSG_ID_PING &&
+        msg_id <= TCPIPC_MSG_ID_PONG)
+    {
+        tcpipc_recv_internal(ctx, msg_id, data, len);
+        return;
+    }
+
+    if (ctx->resume.buf)
+    {
+        if (msg_id == TCPIPC_MSG_ID_ACK || msg_id == TCPIPC_MSG_ID_RESUME)
+        {
+            tcpipc_recv_session(ctx, msg_id, data, len);
+            return;
+        }
+
+        if (tcpipc_resume_logged(msg_id))
+            tcpipc_recv_count(ctx, len);
+    }
+
+    // Fragments are collected, only the whole transfer is counted and queued
+    if (ctx->opts.bulk_max_len && msg_id == TCPIPC_MSG_ID_BULK)
+    {
+        if (tcpipc_bulk_rx_frag(&ctx->bulk_rx, data, len,
+                                ctx->opts.bulk_max_len))
+            tcpipc_recv_bulk(ctx, chan);
+        return;
+    }
+
+    tcpipc_stat_add(&ctx->counters.msgs_in, 1);
+    tcpipc_stat_add(&ctx->counters.bytes_in, len);
+
+    if (ctx->chan.count)
+    {
+        tcpipc_stat_add(&ctx->chan.q[chan].msgs_in, 1);
+        tcpipc_stat_add(&ctx->chan.q[chan].bytes_in, len);
+    }
+
+    tcpipc_capture_frame(&ctx->capture, tcpipc_now_ns(), msg_id, chan, data,
+                         len);
+
+    // Handled in place, the payload is never copied
+    if (ctx->opts.rx_inline)
+    {
+        handler = atomic_load_explicit(&ctx->handlers[msg_id].cb,
+                                       memory_order_acquire);
+
+        if (handler)
+        {
+            view.msg_id = msg_id;
+            view.msg_chan = chan;
+            view.msg_len = len;
+            view.msg_data = data;
+            handler(atomic_load_explicit(&ctx->handlers[msg_id].arg,
+                                         memory_order_relaxed),
+                    &view);
+            return;
+        }
+    }
+
+    // Conflated STATE ids overwrite their pending entry instead of queueing
+    switch (recv_msg_cb_put_latest(&ctx->recv_cb, msg_id, chan, data, len))
+    {
+    case 0:
+        return;
+    case -1:
+        tcpipc_stat_add(&ctx->counters.rx_drops, 1);
+        tcpipc_flight_record(&ctx->flight, TCPIPC_FLIGHT_DROP, msg_id, len);
+        return;
+    default:
+        break;
+    }
+
+    msg_packet = recv_msg_cb_reserve(&ctx->recv_cb);
+
+    // Payload is copied once, from the decoder buffer into the queue slot
+    if (msg_packet == NULL)
+    {
+        tcpipc_stat_add(&ctx->counters.rx_drops, 1);
+        tcpipc_flight_record(&ctx->flight, TCPIPC_FLIGHT_DROP, msg_id, len);
+        return;
+    }
+
+    msg_packet->msg_id = msg_id;
+    msg_packet->msg_chan = chan;
+    msg_packet->msg_len = len;
+
+    if (msg_packet_alloc(msg_packet, len))
+        memcpy(msg_packet->msg_data, data, len);
+    else if (len)
+    {
+        tcpipc_stat_add(&ctx->counters.rx_drops, 1);
+        tcpipc_flight_record(&ctx->flight, TCPIPC_FLIGHT_DROP, msg_id, len);
+        return;
+    }
+
+    recv_msg_cb_publish(&ctx->recv_cb);
+}
+
+/*******************************************************************************
+ * @brief
+ *
+ * @return
+ *******************************************************************************/
+static int tcpipc_server_setup(struct tcpipc_ctx *ctx, int port)
+{
+    struct socket_info_t *server_info = &ctx->server_info;
+    int opt = 1;
+
+    server_info->fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    // Check if socket is created successfully
+    if (server_info->fd < 0)
+    {
+        perror("Server: Failed to create socket");
+        return -1;
+    }
+
+    // Set socket options for reusing address and port
+    if (setsockopt(server_info->fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT,
+                   &opt, sizeof(opt)))
+    {
+        perror("Server: Failed to set socket options");
+        return -1;
+    }
+
+    // Accepted connections inherit buffer sizes and busy polling
+    tcpipc_tune_socket(ctx, server_info->fd);
+
+    server_info->port = port;
+    server_info->addr.sin_family = AF_INET;
+    server_info->addr.sin_addr.s_addr = INADDR_ANY;
+    server_info->addr.sin_port = htons(server_info->port);
+
+    if (bind(server_info->fd, (struct sockaddr *)&server_info->addr,
+             sizeof(server_info->addr)))
+    {
+        perror("Server: Failed to bind");
+        return -1;
+    }
+
+    if (listen(server_info->fd, MAX_BACKLOGS))
+    {
+        perror("Server: Failed to start listening");
+        return -1;
+    }
+
+    printf("Server: Initialized\n");
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief
+ *
+ * @return
+ *******************************************************************************/
+static int tcpipc_server_connect(struct tcpipc_ctx *ctx)
+{
+    struct socket_info_t *client_info = &ctx->client_info;
+
+    printf("Server: Listening on port %d...\n", ctx->server_info.port);
+
+    client_info->addr_len = sizeof(client_info->addr);
+    client_info->fd = accept(ctx->server_info.fd,
+                             (struct sockaddr *)&client_info->addr,
+                             &client_info->addr_len);
+
+    if (client_info->fd < 0)
+    {
+        perror("Server: Failed to connect");
+        return -1;
+    }
+
+    printf("Server: Connected\n");
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief
+ *
+ * @return
+ *******************************************************************************/
+static int tcpipc_client_setup(struct tcpipc_ctx *ctx, char *serv_addr,
+                               int serv_port)
+{
+    struct socket_info_t *server_info = &ctx->server_info;
+
+    server_info->port = serv_port;
+    server_info->addr.sin_family = AF_INET;
+    server_info->addr.sin_addr.s_addr = inet_addr(serv_addr);
+    server_info->addr.sin_port = htons(server_info->port);
+
+    printf("Client: Initialized\n");
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief
+ *
+ * @return
+ *******************************************************************************/
+static int tcpipc_client_connect(struct tcpipc_ctx *ctx)
+{
+    int fd = tcpipc_client_dial(ctx, tcpipc_now_ns() +
+                                         ctx->opts.reconnect_ms * 1000000ULL);
+
+    if (fd < 0)
+    {
+        perror("Client: Failed to connect");
+        return -1;
+    }
+
+    ctx->client_info.fd = fd;
+    printf("Client: Connected\n");
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Connects to the server. Without reconnect_ms this is one attempt
+ *          waiting as long as the kernel does; with it refused or timed out
+ *          attempts are retried with exponential backoff until deadline, or
+ *          until the handle is closed.
+ *
+ * @return  Connected socket, -1 on failure with errno of the last attempt
+ *******************************************************************************/
+static int tcpipc_client_dial(struct tcpipc_ctx *ctx, uint64_t deadline)
+{
+    uint32_t backoff_ms = ctx->opts.reconnect_backoff_ms;
+    int64_t remaining_ms;
+    int fd, err;
+
+    if (ctx->opts.reconnect_ms == 0)
+        return tcpipc_connect_once(ctx, -1);
+
+    if (backoff_ms == 0)
+        backoff_ms = TCPIPC_RESUME_DEF_BACKOFF_MS;
+
+    for (;;)
+    {
+        remaining_ms = ((int64_t)(deadline - tcpipc_now_ns())) / 1000000;
+
+        if (remaining_ms > TCPIPC_RESUME_CONNECT_MS)
+            remaining_ms = TCPIPC_RESUME_CONNECT_MS;
+
+        fd = tcpipc_connect_once(ctx, remaining_ms > 0 ? remaining_ms : 0);
+
+        if (fd >= 0)
+            return fd;
+
+        err = errno;
+        remaining_ms = ((int64_t)(deadline - tcpipc_now_ns())) / 1000000;
+
+        if (remaining_ms <= 0 || ctx->client_info.exit_status)
+        {
+            errno = err;
+            return -1;
+        }
+
+        if (backoff_ms < remaining_ms)
+            remaining_ms = backoff_ms;
+
+        usleep(remaining_ms * 1000);
+
+        backoff_ms *= 2;
+
+        if (backoff_ms > TCPIPC_RESUME_BACKOFF_MAX_MS)
+            backoff_ms = TCPIPC_RESUME_BACKOFF_MAX_MS;
+    }
+}
+
+/*******************************************************************************
+ * @brief   One connection attempt waiting up to timeout_ms, forever if
+ *          negative. The socket is tuned before connecting, so the window
+ *          scale matches the buffer size.
+ *
+ * @return  Connected socket, -1 on failure with errno set
+ *******************************************************************************/
+static int tcpipc_connect_once(struct tcpipc_ctx *ctx, int timeout_ms)
+{
+    socklen_t err_len = sizeof(int);
+    struct pollfd pfd;
+    int fd, flags, ret, err = 0;
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (fd < 0)
+        return -1;
+
+    tcpipc_tune_socket(ctx, fd);
+
+    flags = fcntl(fd, F_GETFL);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+    ret = connect(fd, (struct sockaddr *)&ctx->server_info.addr,
+                  sizeof(ctx->server_info.addr));
+
+    if (ret && errno == EINPROGRESS)
+    {
+        pfd.fd = fd;
+        pfd.events = POLLOUT;
+
+        do
+            ret = poll(&pfd, 1, timeout_ms);
+        while (ret < 0 && errno == EINTR);
+
+        if (ret == 0)
+            err = ETIMEDOUT;
+        else if (ret < 0 ||
+                 getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len))
+            err = errno;
+    }
+    else if (ret)
+        err = errno;
+
+    if (err)
+    {
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, flags);
+
+    return fd;
+}
+
+/*******************************************************************************
+ * @brief   Accepts the peer's next connection, waiting until deadline in
+ *          short slices so that tcpipc_close() is noticed.
+ *
+ * @return  Connected socket, -1 on timeout or failure
+ *******************************************************************************/
+static int tcpipc_accept_wait(struct tcpipc_ctx *ctx, uint64_t deadline)
+{
+    struct pollfd pfd;
+    int64_t remaining_ms;
+    int fd;
+
+    pfd.fd = ctx->server_info.fd;
+    pfd.events = POLLIN;
+
+    while (!ctx->client_info.exit_status)
+    {
+        remaining_ms = ((int64_t)(deadline - tcpipc_now_ns())) / 1000000;
+
+        if (remaining_ms <= 0)
+        {
+            printf("Server: No peer within reconnect_ms\n");
+            return -1;
+        }
+
+        if (remaining_ms > TCPIPC_RESUME_CONNECT_MS)
+            remaining_ms = TCPIPC_RESUME_CONNECT_MS;
+
+        if (poll(&pfd, 1, remaining_ms) <= 0)
+            continue;
+
+        fd = accept(ctx->server_info.fd, NULL, NULL);
+
+        if (fd >= 0)
+            return fd;
+
+        if (errno != EINTR && errno != ECONNABORTED)
+        {
+            perror("Server: Failed to connect");
+            return -1;
+        }
+    }
+
+    return -1;
+}
+
+/*******************************************************************************
+ * @brief   Applies the per-stream options to the connected socket, at init
+ *          and again on every reconnected one.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_setup_stream(struct tcpipc_ctx *ctx)
+{
+    int fd = ctx->client_info.fd, nodelay = 1;
+    unsigned int user_timeout;
+
+    ctx->txq.fd = fd;
+
+    // Nobody sleeps in a read or write holding tx_lock, see tcpipc_txq_t
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    if (ctx->opts.tx_batch)
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    // Writes into a dead link fail about when the reader gives up on it
+    if (ctx->resume.silent_ns)
+    {
+        user_timeout = ctx->resume.silent_ns / 1000000;
+        setsockopt(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, &user_timeout,
+                   sizeof(user_timeout));
+    }
+
+    // Timestamping reads the error queue too and would eat the completions
+    if (ctx->opts.bulk_zerocopy && !ctx->opts.timestamping &&
+        tcpipc_bulk_zerocopy_enable(fd) == 0)
+        ctx->bulk_tx.zerocopy = 1;
+
+    // Nothing was sent yet, so transmit stamp keys start at the first byte
+    if (ctx->opts.timestamping && tcpipc_tstamp_enable(fd, 1) == 0)
+    {
+        tcpipc_tstamp_tx_init(&ctx->tx_stamp, fd);
+        ctx->txq.tstamp = &ctx->tx_stamp;
+    }
+}
+
+/*******************************************************************************
+ * @brief   Replaces a lost stream on the receive thread. The link is marked
+ *          down and frames queued for the old stream are dropped, they are
+ *          in the send log. The client dials again, the server accepts
+ *          again, for up to reconnect_ms; the new stream opens with a
+ *          RESUME and the link is up once the peer's RESUME arrives.
+ *
+ * @return  0 once a new stream is in place, -1 when giving up
+ *******************************************************************************/
+static int tcpipc_reconnect(struct tcpipc_ctx *ctx)
+{
+    uint64_t deadline = tcpipc_now_ns() + ctx->opts.reconnect_ms * 1000000ULL;
+    int fd;
+
+    if (ctx->resume.buf == NULL || ctx->resume.peer_closed)
+        return -1;
+
+    // A sender waiting for room on the old stream fails once it is shut
+    // down, its fd must not be closed and reused before that
+    pthread_mutex_lock(&ctx->tx_lock);
+    shutdown(ctx->client_info.fd, SHUT_RDWR);
+
+    while (ctx->tx_busy)
+        pthread_cond_wait(&ctx->tx_idle, &ctx->tx_lock);
+
+    atomic_store(&ctx->resume.link, TCPIPC_LINK_DOWN);
+    atomic_fetch_add(&ctx->resume.epoch, 1);
+    close(ctx->client_info.fd);
+    ctx->client_info.fd = -1;
+    ctx->txq.fd = -1;
+    tcpipc_txq_discard(&ctx->txq);
+
+    // Frames still queued on channels go to the log for the replay
+    tcpipc_chan_discard(&ctx->chan);
+    atomic_store(&ctx->ctl.pending, 0);
+    pthread_mutex_unlock(&ctx->tx_lock);
+
+    tcpipc_flight_record(&ctx->flight, TCPIPC_FLIGHT_DOWN, 0, 0);
+    printf("Link lost, reconnecting\n");
+
+    if (ctx->role == TCP_ROLE_SERVER)
+        fd = tcpipc_accept_wait(ctx, deadline);
+    else if ((fd = tcpipc_client_dial(ctx, deadline)) < 0)
+        perror("Client: Failed to reconnect");
+
+    if (fd < 0)
+        return -1;
+
+    // Whatever was left of a frame on the old stream
+    tcpipc_decoder_reset(&ctx->decoder);
+    tcpipc_bulk_rx_free(&ctx->bulk_rx);
+    ctx->resume.last_rx_ns = tcpipc_now_ns();
+
+    tcpipc_tx_lock(ctx);
+
+    if (ctx->client_info.exit_status)
+    {
+        pthread_mutex_unlock(&ctx->tx_lock);
+        close(fd);
+        return -1;
+    }
+
+    ctx->client_info.fd = fd;
+    tcpipc_setup_stream(ctx);
+    atomic_store(&ctx->resume.link, TCPIPC_LINK_RESUMING);
+
+    // A failed write shows up as a failed read, which reconnects again
+    ctx->txq.nowait = 1;
+    tcpipc_send_resume(ctx);
+    tcpipc_tx_unlock(ctx);
+
+    tcpipc_stat_add(&ctx->resume.reconnects, 1);
+    printf("Reconnected\n");
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Releases everything the context owns and the context itself.
+ *          Safe on a partially initialized context.
+ *
+ * @return  Always NULL, so init can return its result on failure
+ *******************************************************************************/
+static struct tcpipc_ctx *tcpipc_terminate(struct tcpipc_ctx *ctx)
+{
+    tcpipc_stats_unregister(ctx);
+
+    if (ctx->server_info.fd >= 0)
+    {
+        close(ctx->server_info.fd);
+        ctx->server_info.fd = -1;
+    }
+
+    // The datagram socket is shared with client_info, say BYE and close it
+    if (ctx->opts.transport == TCPIPC_TRANSPORT_UDP)
+    {
+        tcpipc_udp_close(&ctx->udp);
+        ctx->client_info.fd = -1;
+    }
+
+    if (ctx->client_info.fd >= 0)
+    {
+        close(ctx->client_info.fd);
+        ctx->client_info.fd = -1;
+    }
+
+    if (ctx->opts.transport == TCPIPC_TRANSPORT_SHM)
+    {
+        tcpipc_shm_shutdown(&ctx->shm);
+        tcpipc_shm_close(&ctx->shm);
+    }
+
+    recv_msg_cb_close(&ctx->recv_cb);
+    tcpipc_decoder_free(&ctx->decoder);
+    tcpipc_txq_free(&ctx->txq);
+    tcpipc_uring_free(&ctx->tx_ring);
+    pthread_mutex_destroy(&ctx->tx_lock);
+    pthread_cond_destroy(&ctx->tx_idle);
+    tcpipc_flight_free(&ctx->flight);
+    tcpipc_chan_free(&ctx->chan);
+    tcpipc_bulk_rx_free(&ctx->bulk_rx);
+    free(ctx->bulk_tx.scratch);
+    tcpipc_resume_free(&ctx->resume);
+    tcpipc_capture_close(&ctx->capture);
+    free(ctx);
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * @brief
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_print_msg(struct msg_packet_t *msg_packet)
+{
+    printf("Message details\n");
+    printf("Msg ID: %u\n", msg_packet->msg_id);
+    printf("Msg length: %u\n", msg_packet->msg_len);
+    printf("Msg Data: ");
+
+    for (int i = 0; i < msg_packet->msg_len; i++)
+    {
+        printf("%u\t", msg_packet->msg_data[i]);
+    }
+    printf("\n");
+}
+
+/*******************************************************************************
+ * @brief   One wait step of the blocking receive calls. Sleeps until the
+ *          queue may be non-empty or the deadline computed from timeout_ms
+ *          passes.
+ *
+ * @return  0 to retry, -1 on timeout or when the peer is gone
+ *******************************************************************************/
+static int tcpipc_wait(struct tcpipc_ctx *ctx, int timeout_ms,
+                       uint64_t deadline)
+{
+    int64_t remaining_ms = timeout_ms;
+
+    if (ctx->sock_info == NULL || ctx->sock_info->exit_status)
+        return -1;
+
+    if (timeout_ms >= 0)
+    {
+        remaining_ms = ((int64_t)(deadline - tcpipc_now_ns())) / 1000000;
+
+        if (remaining_ms < 0)
+            return -1;
+    }
+
+    recv_msg_cb_wait(&ctx->recv_cb, remaining_ms);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Visitor of tcpipc_dispatch(), looks up the handler of the message.
+ *
+ * @return  0, the batch always continues
+ *******************************************************************************/
+static int tcpipc_dispatch_visit(void *arg,
+                                 const struct tcpipc_msg_view_t *view)
+{
+    struct tcpipc_ctx *ctx = (struct tcpipc_ctx *)arg;
+    struct tcpipc_handler_t *entry = &ctx->handlers[view->msg_id];
+    tcpipc_handler_cb_t handler;
+
+    handler = atomic_load_explicit(&entry->cb, memory_order_acquire);
+
+    if (handler)
+        handler(atomic_load_explicit(&entry->arg, memory_order_relaxed), view);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Applies the socket options of the real-time tuning set to fd.
+ *          Failures are reported, the socket stays usable with defaults.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_tune_socket(struct tcpipc_ctx *ctx, int fd)
+{
+    int val;
+
+    if (ctx->opts.sock_rcvbuf > 0 &&
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &ctx->opts.sock_rcvbuf,
+                   sizeof(ctx->opts.sock_rcvbuf)))
+        perror("Failed to set receive buffer size");
+
+    if (ctx->opts.sock_sndbuf > 0 &&
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &ctx->opts.sock_sndbuf,
+                   sizeof(ctx->opts.sock_sndbuf)))
+        perror("Failed to set send buffer size");
+
+    if (ctx->opts.busy_poll_usec)
+    {
+        val = ctx->opts.busy_poll_usec;
+
+        if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof(val)))
+            perror("Failed to enable busy polling");
+    }
+}
+
+/*******************************************************************************
+ * @brief   Pins the calling receive thread and raises its priority as asked
+ *          by the options. Failures are reported, the thread keeps running
+ *          with defaults.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_tune_thread(struct tcpipc_ctx *ctx)
+{
+    struct sched_param param;
+    cpu_set_t cpus;
+    int ret;
+
+    if (ctx->opts.rx_cpu >= 0)
+    {
+        CPU_ZERO(&cpus);
+        CPU_SET(ctx->opts.rx_cpu, &cpus);
+        ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+        if (ret)
+        {
+            errno = ret;
+            perror("Failed to pin receive thread");
+        }
+    }
+
+    if (ctx->opts.rx_priority > 0)
+    {
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = ctx->opts.rx_priority;
+        ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+        if (ret)
+        {
+            errno = ret;
+            perror("Failed to set receive thread priority");
+        }
+    }
+}
+
+/*******************************************************************************
+ * @brief   Hands one frame to the transport. Caller holds tx_lock when
+ *          tx_shared is set. With resume enabled application frames are
+ *          logged first, or when they leave a channel queue so the log keeps
+ *          the wire order; while the link is not up they are only logged,
+ *          and one whose write fails is replayed after the reconnect.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int tcpipc_send_frame(struct tcpipc_ctx *ctx, uint8_t chan,
+                             uint8_t msg_id, const uint8_t *data,
+                             uint32_t len)
+{
+    uint8_t hdr[TCPIPC_HDR_MAX_LEN + TCPIPC_CHAN_LEN + TCPIPC_TSTAMP_LEN];
+    uint8_t prefix[TCPIPC_CHAN_LEN + TCPIPC_TSTAMP_LEN];
+    size_t hdr_len, prefix_len;
+    int link, logged = 0, chan_log = 0, ret = 0;
+
+    tcpipc_flight_record(&ctx->flight, TCPIPC_FLIGHT_TX, msg_id, len);
+
+    if (ctx->opts.transport == TCPIPC_TRANSPORT_UDP)
+    {
+        if (ctx->chan.count || ctx->opts.timestamping)
+            return tcpipc_send_dgram_prefixed(ctx, chan, msg_id, data, len);
+
+        return tcpipc_udp_send(&ctx->udp, msg_id, data, len,
+                               ctx->msg_class[msg_id]);
+    }
+
+    // The channel and the send time travel right behind the header
+    prefix_len = tcpipc_put_prefix(ctx, prefix, chan);
+    hdr_len = tcpipc_encode_header(hdr, ctx->opts.len_size, msg_id,
+                                   len + prefix_len);
+    memcpy(hdr + hdr_len, prefix, prefix_len);
+    hdr_len += prefix_len;
+
+    if (ctx->opts.transport == TCPIPC_TRANSPORT_SHM)
+        return tcpipc_shm_send(&ctx->shm, hdr, hdr_len, data, len);
+
+    if (ctx->resume.buf)
+    {
+        link = atomic_load_explicit(&ctx->resume.link, memory_order_relaxed);
 
-/** Private Function Prototypes **/
-int tcpipc_server_setup(int port);
-int tcpipc_server_connect();
-int tcpipc_client_setup(char *serv_addr, int serv_port);
-int tcpipc_client_connect();
-int tcpipc_terminate();
-void *tcpipc_recv_thread(void *argv);
+        // Unacknowledged frames only make room while they can still be sent
+        if (tcpipc_resume_logged(msg_id))
+        {
+            if (link == TCPIPC_LINK_UP && ctx->chan.size)
+                chan_log = 1;
+            else if (tcpipc_resume_log(&ctx->resume, hdr, hdr_len, data, len,
+                                       link == TCPIPC_LINK_UP))
+            {
+                printf("Send log full\n");
+                return -1;
+            }
+
+            if (link != TCPIPC_LINK_UP)
+                return 0;
+
+            logged = 1;
+        }
+        else if (link == TCPIPC_LINK_DOWN)
+            return -1;
+    }
+
+    if (ctx->chan.size)
+        ret = tcpipc_chan_push(&ctx->chan, &ctx->txq, chan, hdr, hdr_len,
+                               data, len, chan_log);
+    else if (tcpipc_txq_push(&ctx->txq, hdr, hdr_len, data, len))
+        ret = -1;
+    else if (!ctx->opts.tx_batch)
+        ret = tcpipc_txq_flush(&ctx->txq);
 
-/** Global Variables **/
-struct socket_info_t client_info;
-struct socket_info_t server_info;
-struct socket_info_t *sock_info = NULL;
-pthread_t tcpipc_recv_tid;
+    return logged ? 0 : ret;
+}
 
 /*******************************************************************************
- * @brief
+ * @brief   Writes what the options put in front of a payload to buf: the
+ *          channel, then the send time.
  *
- * @return
+ * @return  Number of bytes written
  *******************************************************************************/
-int tcpipc_init(enum tcp_role_e tcp_role, char *addr, int port)
+static size_t tcpipc_put_prefix(struct tcpipc_ctx *ctx, uint8_t *buf,
+                                uint8_t chan)
 {
-    switch (tcp_role)
-    {
-    case TCP_ROLE_SERVER:
-        if (tcpipc_server_setup(port))
-            return tcpipc_terminate();
+    size_t len = 0;
 
-        if (tcpipc_server_connect())
-            return tcpipc_terminate();
+    if (ctx->chan.count)
+        buf[len++] = chan;
 
-        sock_info = &client_info;
-        break;
-    case TCP_ROLE_CLIENT:
-        if (tcpipc_client_setup(addr, port))
-            return tcpipc_terminate();
+    if (ctx->opts.timestamping)
+    {
+        tcpipc_tstamp_put(buf + len, tcpipc_now_ns());
+        len += TCPIPC_TSTAMP_LEN;
+    }
 
-        if (tcpipc_client_connect())
-            return tcpipc_terminate();
+    return len;
+}
 
-        sock_info = &client_info;
-        break;
-    default:
-        printf("Invalid TCP role selected\n");
-        break;
-    }
+/*******************************************************************************
+ * @brief   Writes the spill and every queued frame, from the channel queues
+ *          when they are in use. Caller holds tx_lock when tx_shared is set.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int tcpipc_flush_frames(struct tcpipc_ctx *ctx)
+{
+    if (ctx->chan.size && tcpipc_chan_flush(&ctx->chan, &ctx->txq))
+        return -1;
+
+    // Also writes the spill, which bulk fragments do not go through
+    return tcpipc_txq_flush(&ctx->txq);
+}
 
-    recv_msg_init();
+/*******************************************************************************
+ * @brief   Sends a library frame right away, flushing batched frames queued
+ *          before it. Caller holds tx_lock.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int tcpipc_send_internal(struct tcpipc_ctx *ctx, uint8_t msg_id,
+                                const uint8_t *data, uint32_t len)
+{
+    if (tcpipc_send_frame(ctx, 0, msg_id, data, len))
+        return -1;
 
-    pthread_create(&tcpipc_recv_tid, NULL, tcpipc_recv_thread,
-                   (void *)&client_info);
+    if (ctx->opts.tx_batch && ctx->opts.transport == TCPIPC_TRANSPORT_TCP)
+        return tcpipc_flush_frames(ctx);
 
     return 0;
 }
 
-void tcpipc_close()
+/*******************************************************************************
+ * @brief   Sends a PING if one is due. Caller holds tx_lock.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_ping_poll(struct tcpipc_ctx *ctx)
 {
-    pthread_join(tcpipc_recv_tid, NULL);
-    recv_msg_close();
+    uint8_t ping[TCPIPC_CLOCK_PING_LEN];
+    uint64_t now = tcpipc_now_ns();
+    uint32_t len;
+
+    if (!tcpipc_clock_due(&ctx->clock, now))
+        return;
+
+    len = tcpipc_clock_ping(ping, now);
+    tcpipc_send_internal(ctx, TCPIPC_MSG_ID_PING, ping, len);
 }
 
 /*******************************************************************************
- * @brief
+ * @brief   Flushes the batched frames once the oldest aged past
+ *          tx_flush_usec, so a batch no further send comes after does not
+ *          stay queued, and writes what is left in the spill. Caller holds
+ *          tx_lock.
+ *
+ * @return  Nanoseconds until the next batch may be due, 0 without
+ *          tx_flush_usec
+ *******************************************************************************/
+static uint64_t tcpipc_flush_poll(struct tcpipc_ctx *ctx)
+{
+    uint64_t age_ns = ctx->txq.flush_usec * 1000ULL;
+    uint64_t first_ns = 0, now;
+
+    if (ctx->txq.len)
+        first_ns = ctx->txq.first_ns;
+
+    if (ctx->chan.pending && (first_ns == 0 || ctx->chan.first_ns < first_ns))
+        first_ns = ctx->chan.first_ns;
+
+    now = tcpipc_now_ns();
+
+    if (age_ns && first_ns && now - first_ns >= age_ns)
+    {
+        tcpipc_flush_frames(ctx);
+        return age_ns;
+    }
+
+    if (ctx->txq.spill_len)
+        tcpipc_txq_flush(&ctx->txq);
+
+    // A frame queued from now on is due one full age later at the earliest
+    return age_ns && first_ns ? first_ns + age_ns - now : age_ns;
+}
+
+/*******************************************************************************
+ * @brief   Handles a library frame on the receive thread: a PING is answered
+ *          through the control slots, a PONG becomes a round trip sample.
  *
  * @return
  *******************************************************************************/
-int tcpipc_send(struct msg_packet_t *msg_packet)
+static void tcpipc_recv_internal(struct tcpipc_ctx *ctx, uint8_t msg_id,
+                                 const uint8_t *data, uint32_t len)
+{
+    uint64_t now = tcpipc_now_ns();
+
+    if (msg_id == TCPIPC_MSG_ID_PONG)
+    {
+        tcpipc_clock_sample(&ctx->clock, data, len, now);
+        return;
+    }
+
+    // A PONG still waiting for the lock answers an older PING, it wins
+    if (len != TCPIPC_CLOCK_PING_LEN ||
+        (atomic_load_explicit(&ctx->ctl.pending, memory_order_acquire) &
+         TCPIPC_CTL_PONG))
+        return;
+
+    memcpy(ctx->ctl.ping, data, len);
+    ctx->ctl.ping_ns = now;
+    tcpipc_ctl_post(ctx, TCPIPC_CTL_PONG);
+}
+
+/*******************************************************************************
+ * @brief   Sends a datagram with the channel and send time in front of its
+ *          payload. The datagram API takes one buffer, so the payload is
+ *          copied.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int tcpipc_send_dgram_prefixed(struct tcpipc_ctx *ctx, uint8_t chan,
+                                      uint8_t msg_id, const uint8_t *data,
+                                      uint32_t len)
 {
-    char buffer[BUFFER_MAX_SIZE];
-    int buffer_len;
+    uint8_t buf[TCPIPC_UDP_MAX_PAYLOAD];
+    size_t prefix_len;
+
+    prefix_len = tcpipc_put_prefix(ctx, buf, chan);
+
+    if (len > TCPIPC_UDP_MAX_PAYLOAD - prefix_len)
+    {
+        printf("UDP: Message too long: %u\n", len);
+        return -1;
+    }
+
+    memcpy(buf + prefix_len, data, len);
 
-    buffer[0] = msg_packet->msg_id;
-    buffer[1] = msg_packet->msg_len;
-    memcpy(buffer + 2, msg_packet->msg_data, msg_packet->msg_len);
+    return tcpipc_udp_send(&ctx->udp, msg_id, buf, len + prefix_len,
+                           ctx->msg_class[msg_id]);
+}
 
-    buffer_len = write(sock_info->fd, buffer, msg_packet->msg_len + 2);
+/*******************************************************************************
+ * @brief   Sets up a bulk transfer from buf, or from fd at off when buf is
+ *          NULL. The message is counted as sent right away.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int tcpipc_bulk_start(struct tcpipc_ctx *ctx, uint8_t chan,
+                             uint8_t msg_id, const uint8_t *buf, int fd,
+                             off_t off, uint32_t len)
+{
+    struct tcpipc_bulk_tx_t *tx = &ctx->bulk_tx;
 
-    if (buffer_len < 0)
+    if (tx->active)
     {
-        perror("Error while sending data");
+        printf("Bulk transfer already in progress\n");
         return -1;
     }
-    else if (buffer_len == 0)
+
+    if (chan && chan >= ctx->chan.count)
     {
-        printf("Disconnected\n");
+        printf("Invalid channel: %u\n", chan);
         return -1;
     }
-    else if (buffer_len == msg_packet->msg_len + 2)
+
+    tx->frag_len = tcpipc_bulk_frag_len(ctx);
+
+    // Datagrams and the ring take one payload, the fragment is built here
+    if (ctx->opts.transport != TCPIPC_TRANSPORT_TCP)
     {
-        // printf("Sent all bytes\n");
-        return 0;
+        tx->scratch = (uint8_t *)malloc(TCPIPC_BULK_HDR_LEN + tx->frag_len);
+
+        if (tx->scratch == NULL)
+        {
+            perror("Failed to allocate bulk fragment");
+            return -1;
+        }
     }
-    else
+
+    tx->active = 1;
+    tx->last_sent = 0;
+    tx->xfer++;
+    tx->chan = chan;
+    tx->msg_id = msg_id;
+    tx->buf = buf;
+    tx->file_fd = fd;
+    tx->file_off = off;
+    tx->total = len;
+    tx->sent = 0;
+    tx->epoch = atomic_load_explicit(&ctx->resume.epoch, memory_order_relaxed);
+
+    tcpipc_stat_add(&ctx->counters.msgs_out, 1);
+    tcpipc_stat_add(&ctx->counters.bytes_out, len);
+
+    if (ctx->chan.count)
     {
-        printf("Could not write all bytes: exp: %ld \trecv: %d\n",
-               sizeof(struct msg_packet_t), buffer_len);
-        return -1;
+        tcpipc_stat_add(&ctx->chan.q[chan].msgs_out, 1);
+        tcpipc_stat_add(&ctx->chan.q[chan].bytes_out, len);
     }
+
+    return 0;
 }
 
 /*******************************************************************************
- * @brief
+ * @brief   Largest fragment the length field, the peer's decoder and the
+ *          transport allow, capped at bulk_frag_len.
  *
- * @return
+ * @return  Fragment data length
  *******************************************************************************/
-int tcpipc_recv(struct msg_packet_t *msg_packet)
+static uint32_t tcpipc_bulk_frag_len(struct tcpipc_ctx *ctx)
 {
-    return recv_msg_dequeue(msg_packet);
+    uint32_t prefix = (ctx->chan.count ? TCPIPC_CHAN_LEN : 0) +
+                      (ctx->opts.timestamping ? TCPIPC_TSTAMP_LEN : 0);
+    uint32_t max = tcpipc_len_size_max(ctx->opts.len_size) - prefix;
+
+    if (max > ctx->opts.max_msg_len)
+        max = ctx->opts.max_msg_len;
+
+    if (ctx->opts.transport == TCPIPC_TRANSPORT_UDP &&
+        max > TCPIPC_UDP_MAX_PAYLOAD - prefix)
+        max = TCPIPC_UDP_MAX_PAYLOAD - prefix;
+
+    max -= TCPIPC_BULK_HDR_LEN;
+
+    if (ctx->opts.bulk_frag_len && ctx->opts.bulk_frag_len < max)
+        return ctx->opts.bulk_frag_len;
+
+    return max;
 }
 
 /*******************************************************************************
- * @brief
+ * @brief   Sends the next fragment. On TCP queued frames are written first
+ *          to keep the order, then the fragment header and its data straight
+ *          from the caller's buffer or file. Caller holds tx_lock when
+ *          tx_shared is set.
  *
- * @return
+ * @return  0 on success, -1 on failure
  *******************************************************************************/
-void *tcpipc_recv_thread(void *argv)
+static int tcpipc_bulk_frag(struct tcpipc_ctx *ctx)
 {
-    struct socket_info_t *sock_info = (struct socket_info_t *)argv;
-    struct msg_packet_t msg_packet;
+    uint8_t hdr[TCPIPC_HDR_MAX_LEN + TCPIPC_CHAN_LEN + TCPIPC_TSTAMP_LEN +
+                TCPIPC_BULK_HDR_LEN];
+    uint8_t prefix[TCPIPC_CHAN_LEN + TCPIPC_TSTAMP_LEN];
+    struct tcpipc_bulk_tx_t *tx = &ctx->bulk_tx;
+    struct iovec iov[2];
+    uint32_t len = tx->total - tx->sent;
+    uint8_t flags = 0;
+    size_t hdr_len, prefix_len;
+    int ret;
 
-    char buffer[BUFFER_MAX_SIZE];
-    int buffer_len, buffer_index = 0;
+    if (len > tx->frag_len)
+        len = tx->frag_len;
 
-    while (!sock_info->exit_status)
+    if (tx->sent == 0)
+        flags |= TCPIPC_BULK_FIRST;
+
+    if (tx->sent + len == tx->total)
+        flags |= TCPIPC_BULK_LAST;
+
+    if (ctx->opts.transport != TCPIPC_TRANSPORT_TCP)
+        ret = tcpipc_bulk_frag_copy(ctx, len, flags);
+    else if (tcpipc_flush_frames(ctx))
+        ret = -1;
+    else
     {
-        buffer_len = read(sock_info->fd, buffer, BUFFER_MAX_SIZE);
-        buffer_index =0;
+        tcpipc_flight_record(&ctx->flight, TCPIPC_FLIGHT_TX,
+                             TCPIPC_MSG_ID_BULK, TCPIPC_BULK_HDR_LEN + len);
 
-        if (buffer_len < 0)
-        {
-            perror("Error while getting data");
-            break;
-        }
-        if (buffer_len == 0)
+        prefix_len = tcpipc_put_prefix(ctx, prefix, tx->chan);
+        hdr_len = tcpipc_encode_header(hdr, ctx->opts.len_size,
+                                       TCPIPC_MSG_ID_BULK,
+                                       prefix_len + TCPIPC_BULK_HDR_LEN +
+                                           len);
+        memcpy(hdr + hdr_len, prefix, prefix_len);
+        hdr_len += prefix_len;
+        hdr_len += tcpipc_bulk_put_hdr(hdr + hdr_len, tx->xfer, tx->msg_id,
+                                       flags, tx->total);
+
+        if (tx->buf == NULL)
         {
-            printf("Disconnected\n");
-            break;
+            ret = tcpipc_bulk_write_file(&ctx->txq, hdr, hdr_len, tx->file_fd,
+                                         tx->file_off + tx->sent, len);
+
+            // Keeps the byte keys of the transmit stamps in step
+            if (ret == 0 && ctx->txq.tstamp)
+                tcpipc_tstamp_tx_sent(ctx->txq.tstamp, hdr_len + len,
+                                      tcpipc_now_ns());
         }
+        else if (tx->zerocopy)
+            ret = tcpipc_bulk_sendzc(tx, &ctx->txq, hdr, hdr_len,
+                                     tx->buf + tx->sent, len);
         else
         {
-            while (buffer_index < buffer_len)
-            {
-                msg_packet.msg_id = 0;
-                msg_packet.msg_len = 0;
-                msg_packet.msg_data = NULL;
-
-                if (buffer_index + 2 <= buffer_len)
-                {
-                    msg_packet.msg_id = buffer[buffer_index + 0];
-                    msg_packet.msg_len = buffer[buffer_index + 1];
-                    buffer_index += 2;
-                }
-                else
-                {
-                    break;
-                }
-
-                if (buffer_index + msg_packet.msg_len <= buffer_len)
-                {
-                    if (msg_packet.msg_len != 0)
-                    {
-                        msg_packet.msg_data = (uint8_t *)malloc(msg_packet.msg_len);
-                        memcpy(msg_packet.msg_data, &buffer[buffer_index], msg_packet.msg_len);
-                    }
-
-                    buffer_index += msg_packet.msg_len;
-
-                    recv_msg_enqueue(&msg_packet);
-                }
-                else
-                {
-                    break;
-                }
-            }
+            iov[0].iov_base = hdr;
+            iov[0].iov_len = hdr_len;
+            iov[1].iov_base = (void *)(tx->buf + tx->sent);
+            iov[1].iov_len = len;
+
+            ret = tcpipc_txq_writev(&ctx->txq, iov, 2, tcpipc_now_ns());
         }
     }
 
-    sock_info->exit_status = 1;
+    if (ret)
+        return -1;
 
-    return NULL;
+    tx->sent += len;
+    tx->last_sent = (flags & TCPIPC_BULK_LAST) != 0;
+    tcpipc_stat_add(&tx->bytes, len);
+
+    return 0;
 }
 
 /*******************************************************************************
- * @brief
+ * @brief   Sends the next fragment as an ordinary frame, copied into the
+ *          scratch buffer, for the transports that take one payload.
  *
- * @return
+ * @return  0 on success, -1 on failure
  *******************************************************************************/
-int tcpipc_server_setup(int port)
+static int tcpipc_bulk_frag_copy(struct tcpipc_ctx *ctx, uint32_t len,
+                                 uint8_t flags)
 {
-    int opt = 1;
+    struct tcpipc_bulk_tx_t *tx = &ctx->bulk_tx;
+    uint8_t *data = tx->scratch + TCPIPC_BULK_HDR_LEN;
+    uint32_t done = 0;
+    ssize_t ret;
 
-    memset(&client_info, 0, sizeof(struct socket_info_t));
-    memset(&server_info, 0, sizeof(struct socket_info_t));
+    tcpipc_bulk_put_hdr(tx->scratch, tx->xfer, tx->msg_id, flags, tx->total);
 
-    server_info.fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (tx->buf)
+        memcpy(data, tx->buf + tx->sent, len);
 
-    // Check if socket is created successfully
-    if (server_info.fd < 0)
+    while (tx->buf == NULL && done < len)
     {
-        perror("Server: Failed to create socket");
-        return -1;
+        ret = pread(tx->file_fd, data + done, len - done,
+                    tx->file_off + tx->sent + done);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        if (ret <= 0)
+        {
+            printf("Failed to read bulk file\n");
+            return -1;
+        }
+
+        done += ret;
     }
 
-    // Set socket options for reusing address and port
-    if (setsockopt(server_info.fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT,
-                   &opt, sizeof(opt)))
+    return tcpipc_send_frame(ctx, tx->chan, TCPIPC_MSG_ID_BULK, tx->scratch,
+                             TCPIPC_BULK_HDR_LEN + len);
+}
+
+/*******************************************************************************
+ * @brief   Delivers the message reassembled from a bulk transfer, handing the
+ *          payload over without another copy.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_recv_bulk(struct tcpipc_ctx *ctx, uint8_t chan)
+{
+    struct msg_packet_t *msg = &ctx->bulk_rx.msg;
+    struct tcpipc_msg_view_t view;
+    tcpipc_handler_cb_t handler;
+
+    msg->msg_chan = chan;
+
+    tcpipc_stat_add(&ctx->counters.msgs_in, 1);
+    tcpipc_stat_add(&ctx->counters.bytes_in, msg->msg_len);
+
+    if (ctx->chan.count)
     {
-        perror("Server: Failed to set socket options");
-        close(server_info.fd);
-        server_info.fd = -1;
-        return -1;
+        tcpipc_stat_add(&ctx->chan.q[chan].msgs_in, 1);
+        tcpipc_stat_add(&ctx->chan.q[chan].bytes_in, msg->msg_len);
     }
 
-    server_info.port = port;
-    server_info.addr.sin_family = AF_INET;
-    server_info.addr.sin_addr.s_addr = INADDR_ANY;
-    server_info.addr.sin_port = htons(server_info.port);
+    tcpipc_capture_frame(&ctx->capture, tcpipc_now_ns(), msg->msg_id, chan,
+                         msg->msg_data, msg->msg_len);
+
+    handler = ctx->opts.rx_inline
+                  ? atomic_load_explicit(&ctx->handlers[msg->msg_id].cb,
+                                         memory_order_acquire)
+                  : NULL;
 
-    if (bind(server_info.fd, (struct sockaddr *)&server_info.addr,
-             sizeof(server_info.addr)))
+    if (handler)
     {
-        perror("Server: Failed to bind");
-        close(server_info.fd);
-        server_info.fd = -1;
-        return -1;
+        view.msg_id = msg->msg_id;
+        view.msg_chan = chan;
+        view.msg_len = msg->msg_len;
+        view.msg_data = msg->msg_data;
+        handler(atomic_load_explicit(&ctx->handlers[msg->msg_id].arg,
+                                     memory_order_relaxed),
+                &view);
+        msg_packet_free(msg);
+        return;
     }
 
-    if (listen(server_info.fd, MAX_BACKLOGS))
+    if (recv_msg_cb_enqueue(&ctx->recv_cb, msg))
     {
-        perror("Server: Failed to start listening");
-        return -1;
+        tcpipc_stat_add(&ctx->counters.rx_drops, 1);
+        tcpipc_flight_record(&ctx->flight, TCPIPC_FLIGHT_DROP, msg->msg_id,
+                             msg->msg_len);
+        msg_packet_free(msg);
     }
+}
 
-    printf("Server: Initialized\n");
+/*******************************************************************************
+ * @brief   Sends a RESUME telling the peer what we received and the oldest
+ *          frame we still have. Caller holds tx_lock.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int tcpipc_send_resume(struct tcpipc_ctx *ctx)
+{
+    uint8_t buf[TCPIPC_RESUME_LEN];
+    size_t len = tcpipc_resume_put(&ctx->resume, buf);
 
-    return 0;
+    return tcpipc_send_internal(ctx, TCPIPC_MSG_ID_RESUME, buf, len);
 }
 
 /*******************************************************************************
- * @brief
+ * @brief   Handles an ACK, which releases logged frames, or the peer's RESUME
+ *          opening a stream. The receive side is settled here; replaying what
+ *          the peer is missing and bringing the link up is posted, see
+ *          tcpipc_ctl_send(). A RESUME with an unknown session comes from a
+ *          restarted peer, both ends then number from zero again. Frames the
+ *          peer no longer has are counted as lost.
  *
  * @return
  *******************************************************************************/
-int tcpipc_server_connect()
+static void tcpipc_recv_session(struct tcpipc_ctx *ctx, uint8_t msg_id,
+                                const uint8_t *data, uint32_t len)
 {
-    printf("Server: Listening on port %d...\n", server_info.port);
+    struct tcpipc_resume_t *r = &ctx->resume;
+    uint64_t session, received, oldest;
 
-    client_info.fd = accept(server_info.fd, (struct sockaddr *)&client_info.addr,
-                            &client_info.addr_len);
+    if (msg_id == TCPIPC_MSG_ID_ACK)
+    {
+        if (len >= TCPIPC_RESUME_ACK_LEN)
+            atomic_store_explicit(&r->acked, tcpipc_resume_get64(data),
+                                  memory_order_release);
+        return;
+    }
 
-    if (client_info.fd < 0)
+    if (len == 0)
     {
-        perror("Server: Failed to connect");
-        return -1;
+        r->peer_closed = 1;
+        return;
     }
 
-    printf("Server: Connected\n");
+    if (tcpipc_resume_get(data, len, &session, &received, &oldest))
+        return;
 
-    return 0;
+    // One RESUME opens each stream, the slot is cleared on reconnect
+    if (atomic_load_explicit(&ctx->ctl.pending, memory_order_acquire) &
+        TCPIPC_CTL_RESUME)
+        return;
+
+    if (session != r->peer_session)
+    {
+        // Everything logged was meant for the previous peer
+        if (r->peer_session)
+        {
+            ctx->ctl.reset = 1;
+            r->rx_seq = 0;
+            r->rx_acked = 0;
+            r->rx_bytes = 0;
+        }
+
+        r->peer_session = session;
+        received = 0;
+        oldest = 0;
+    }
+
+    // The peer dropped what we missed, skip ahead to what it has
+    if (oldest > r->rx_seq)
+    {
+        tcpipc_stat_add(&r->lost, oldest - r->rx_seq);
+        r->rx_seq = oldest;
+        r->rx_acked = oldest;
+    }
+
+    ctx->ctl.received = received;
+    tcpipc_ctl_post(ctx, TCPIPC_CTL_RESUME);
 }
 
 /*******************************************************************************
- * @brief
+ * @brief   Counts one received application frame and ACKs the count every
+ *          TCPIPC_RESUME_ACK_FRAMES frames or TCPIPC_RESUME_ACK_BYTES bytes.
  *
  * @return
  *******************************************************************************/
-int tcpipc_client_setup(char *serv_addr, int serv_port)
+static void tcpipc_recv_count(struct tcpipc_ctx *ctx, uint32_t len)
 {
-    memset(&client_info, 0, sizeof(struct socket_info_t));
-    memset(&server_info, 0, sizeof(struct socket_info_t));
+    struct tcpipc_resume_t *r = &ctx->resume;
 
-    client_info.fd = socket(AF_INET, SOCK_STREAM, 0);
+    r->rx_seq++;
+    r->rx_bytes += len;
 
-    // Check if socket is created successfully
-    if (client_info.fd < 0)
+    if (r->rx_seq - r->rx_acked < TCPIPC_RESUME_ACK_FRAMES &&
+        r->rx_bytes < TCPIPC_RESUME_ACK_BYTES)
+        return;
+
+    r->rx_acked = r->rx_seq;
+    r->rx_bytes = 0;
+
+    // An ACK not sent yet is replaced, only the latest count matters
+    atomic_store_explicit(&ctx->ctl.ack, r->rx_seq, memory_order_relaxed);
+    tcpipc_ctl_post(ctx, TCPIPC_CTL_ACK);
+}
+
+/*******************************************************************************
+ * @brief   Takes tx_lock on behalf of a sender that may wait, once no other
+ *          sender is waiting for socket space.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_tx_lock(struct tcpipc_ctx *ctx)
+{
+    pthread_mutex_lock(&ctx->tx_lock);
+
+    while (ctx->tx_busy)
+        pthread_cond_wait(&ctx->tx_idle, &ctx->tx_lock);
+}
+
+/*******************************************************************************
+ * @brief   Takes tx_lock only if it is free and no sender is waiting for
+ *          socket space. The receive thread passes nowait, its writes then
+ *          go to the spill instead of waiting, see tcpipc_txq_t.
+ *
+ * @return  0 if taken, -1 otherwise
+ *******************************************************************************/
+static int tcpipc_tx_trylock(struct tcpipc_ctx *ctx, int nowait)
+{
+    if (pthread_mutex_trylock(&ctx->tx_lock))
+        return -1;
+
+    if (ctx->tx_busy)
     {
-        perror("Client: Failed to create socket");
+        pthread_mutex_unlock(&ctx->tx_lock);
         return -1;
     }
 
-    server_info.port = serv_port;
-    server_info.addr.sin_family = AF_INET;
-    server_info.addr.sin_addr.s_addr = inet_addr(serv_addr);
-    server_info.addr.sin_port = htons(server_info.port);
-
-    printf("Client: Initialized\n");
+    ctx->txq.nowait = nowait;
 
     return 0;
 }
 
 /*******************************************************************************
- * @brief
+ * @brief   Sends the posted control frames and lets go of tx_lock. A post
+ *          made while the lock was held found it taken and relies on us, so
+ *          the slots are checked again once it is free.
+ *
+ * @return  1 if the spill still held bytes when the lock was let go
+ *******************************************************************************/
+static int tcpipc_tx_unlock(struct tcpipc_ctx *ctx)
+{
+    int nowait = ctx->txq.nowait, spilled;
+
+    do
+    {
+        tcpipc_ctl_send(ctx);
+        spilled = ctx->txq.spill_len != 0;
+        ctx->txq.nowait = 0;
+        pthread_mutex_unlock(&ctx->tx_lock);
+
+        if (atomic_load(&ctx->ctl.pending) == 0)
+            break;
+    } while (tcpipc_tx_trylock(ctx, nowait) == 0);
+
+    return spilled;
+}
+
+/*******************************************************************************
+ * @brief   Wait callback of the transmit queue. A sender waiting for socket
+ *          space lets go of tx_lock, so the receive thread never waits for
+ *          it; tx_busy keeps other senders off the half written frame.
  *
  * @return
  *******************************************************************************/
-int tcpipc_client_connect()
+static void tcpipc_tx_wait(void *arg, int waiting)
 {
-    if (connect(client_info.fd, (struct sockaddr *)&server_info.addr,
-                sizeof(server_info.addr)))
+    struct tcpipc_ctx *ctx = (struct tcpipc_ctx *)arg;
+
+    if (waiting)
     {
-        perror("Client: Failed to connect");
-        close(client_info.fd);
-        return -1;
+        ctx->tx_busy = 1;
+        pthread_mutex_unlock(&ctx->tx_lock);
+        return;
     }
 
-    printf("Client: Connected\n");
+    pthread_mutex_lock(&ctx->tx_lock);
+    ctx->tx_busy = 0;
+    pthread_cond_broadcast(&ctx->tx_idle);
+}
 
-    return 0;
+/*******************************************************************************
+ * @brief   Marks the filled control slot ctl pending and sends it right away
+ *          if tx_lock is free. Called on the receive thread, never waits.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_ctl_post(struct tcpipc_ctx *ctx, int ctl)
+{
+    atomic_fetch_or(&ctx->ctl.pending, ctl);
+
+    if (tcpipc_tx_trylock(ctx, 1) == 0)
+        tcpipc_tx_unlock(ctx);
 }
 
 /*******************************************************************************
- * @brief
+ * @brief   Sends the pending control frames. Caller holds tx_lock.
  *
  * @return
  *******************************************************************************/
-int tcpipc_terminate()
+static void tcpipc_ctl_send(struct tcpipc_ctx *ctx)
 {
-    if (server_info.fd)
+    struct tcpipc_ctl_t *ctl = &ctx->ctl;
+    uint8_t pong[TCPIPC_CLOCK_PONG_LEN];
+    uint8_t ack[TCPIPC_RESUME_ACK_LEN];
+    uint32_t len;
+    int pending;
+
+    pending = atomic_load_explicit(&ctl->pending, memory_order_acquire);
+
+    if (pending & TCPIPC_CTL_PONG)
     {
-        close(server_info.fd);
-        server_info.fd = 0;
+        // t3 is taken when the PONG leaves, the wait counts as hold time
+        len = tcpipc_clock_pong(pong, ctl->ping, TCPIPC_CLOCK_PING_LEN,
+                                ctl->ping_ns, tcpipc_now_ns());
+        atomic_fetch_and_explicit(&ctl->pending, ~TCPIPC_CTL_PONG,
+                                  memory_order_release);
+        tcpipc_send_internal(ctx, TCPIPC_MSG_ID_PONG, pong, len);
     }
 
-    if (client_info.fd)
+    if (pending & TCPIPC_CTL_RESUME)
+        tcpipc_ctl_resume(ctx);
+
+    if (pending & TCPIPC_CTL_ACK)
     {
-        close(client_info.fd);
-        client_info.fd = 0;
+        // Cleared first, a count stored after the load posts again
+        atomic_fetch_and_explicit(&ctl->pending, ~TCPIPC_CTL_ACK,
+                                  memory_order_acq_rel);
+        len = tcpipc_resume_put64(
+            ack, atomic_load_explicit(&ctl->ack, memory_order_relaxed));
+        tcpipc_send_internal(ctx, TCPIPC_MSG_ID_ACK, ack, len);
     }
-
-    return 0;
 }
 
 /*******************************************************************************
- * @brief
+ * @brief   Answers the peer's RESUME: replays what it is missing and brings
+ *          the link up. Frames we no longer have for it are counted as lost.
+ *          Caller holds tx_lock.
  *
  * @return
  *******************************************************************************/
-void tcpipc_print_msg(struct msg_packet_t *msg_packet)
+static void tcpipc_ctl_resume(struct tcpipc_ctx *ctx)
 {
-    printf("Message details\n");
-    printf("Msg ID: %u\n", msg_packet->msg_id);
-    printf("Msg length: %u\n", msg_packet->msg_len);
-    printf("Msg Data: ");
+    struct tcpipc_resume_t *r = &ctx->resume;
+    uint64_t start = ctx->ctl.received;
+    int64_t replayed;
 
-    for (int i = 0; i < msg_packet->msg_len; i++)
+    if (ctx->ctl.reset)
     {
-        printf("%u\t", msg_packet->msg_data[i]);
+        tcpipc_resume_reset(r);
+        ctx->ctl.reset = 0;
     }
-    printf("\n");
+
+    atomic_fetch_and_explicit(&ctx->ctl.pending, ~TCPIPC_CTL_RESUME,
+                              memory_order_release);
+
+    if (start < r->first_seq)
+    {
+        tcpipc_stat_add(&r->lost, r->first_seq - start);
+        start = r->first_seq;
+    }
+
+    replayed = tcpipc_resume_replay(r, start, &ctx->txq);
+
+    if (replayed > 0)
+        tcpipc_stat_add(&r->replayed, replayed);
+
+    atomic_store_explicit(&r->link, TCPIPC_LINK_UP, memory_order_release);
+    tcpipc_flight_record(&ctx->flight, TCPIPC_FLIGHT_UP, 0, 0);
+}
+
+/*******************************************************************************
+ * @brief   Log callback of the channel queues. The frame is on the wire or
+ *          about to be, so older ones make room for it as when the link is
+ *          up. Caller holds tx_lock.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_log_frame(void *arg, const uint8_t *hdr, size_t hdr_len,
+                             const uint8_t *data, size_t len)
+{
+    struct tcpipc_ctx *ctx = (struct tcpipc_ctx *)arg;
+
+    tcpipc_resume_log(&ctx->resume, hdr, hdr_len, data, len, 1);
 }
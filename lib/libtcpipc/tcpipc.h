@@ -18,12 +18,27 @@
 
 /** Application specififc libraries **/
 #include "tcpipc_cb_fifo.h"
+#include "tcpipc_pool.h"
+#include "tcpipc_decoder.h"
+#include "tcpipc_txq.h"
+#include "tcpipc_udp.h"
+#include "tcpipc_shm.h"
+#include "tcpipc_uring.h"
+#include "tcpipc_stats.h"
+#include "tcpipc_clock.h"
+#include "tcpipc_tstamp.h"
+#include "tcpipc_flight.h"
+#include "tcpipc_chan.h"
+#include "tcpipc_bulk.h"
+#include "tcpipc_resume.h"
+#include "tcpipc_schema.h"
+#include "tcpipc_capture.h"
 
 /** Defines  **/
 #define MESSAGE_MIN_LEN (3)
-#define RECV_MESSAGE_CB_LEN (10)
 #define MAX_BACKLOGS (1)
 #define BUFFER_MAX_SIZE (1024)
+#define TCPIPC_DEF_MAX_MSG_LEN (65536)
 
 /** User Data Types **/
 enum tcp_role_e
@@ -33,16 +48,263 @@ enum tcp_role_e
     TCP_ROLE_CLIENT
 };
 
+enum tcpipc_transport_e
+{
+    TCPIPC_TRANSPORT_TCP = 0,
+    TCPIPC_TRANSPORT_UDP,
+    TCPIPC_TRANSPORT_SHM
+};
+
+/*
+ * Message IDs of the game, generated from TCPIPC_SCHEMA along with their
+ * payload layouts, see tcpipc_schema.h.
+ */
 enum msg_id_e
 {
     MSG_ID_NONE = 0,
-    MSG_ID_SYNC,
-    MSG_ID_WIN_SIZE,
-    MSG_ID_PAD_POS,
-    MSG_ID_BALL_POS,
-    MSG_ID_GAME_STATUS
+    TCPIPC_SCHEMA(TCPIPC_SCHEMA_ID, TCPIPC_SCHEMA_ID)
+};
+
+/*
+ * Init-time options, filled with defaults by tcpipc_opts_default() and
+ * grouped per feature.
+ */
+struct tcpipc_opts_t
+{
+    /*
+     * Framing. Both peers must agree on len_size, the default keeps the
+     * original one byte length field.
+     */
+    uint8_t len_size;
+    size_t rx_buf_size;
+    uint32_t max_msg_len;
+
+    /*
+     * Batching. With tx_batch set, tcpipc_send() only queues the frame; the
+     * queue goes out on tcpipc_flush(), once it holds tx_flush_bytes, or once
+     * its oldest frame aged past tx_flush_usec. The age is checked by the next
+     * send and by the receive thread, so sends then take a lock shared with
+     * it; with tx_flush_usec at zero only tcpipc_flush() and tx_flush_bytes
+     * send a batch. TCP_NODELAY is enabled in that mode since the library
+     * does its own coalescing.
+     */
+    uint8_t tx_batch;
+    size_t tx_buf_size;
+    size_t tx_flush_bytes;
+    uint32_t tx_flush_usec;
+
+    /*
+     * Stream (TCP) or datagram (UDP) backend. Over UDP the message class set
+     * with tcpipc_set_msg_class() picks the lane, a CONTROL send waits while
+     * TCPIPC_UDP_WINDOW of them are unacknowledged; length and batching
+     * options do not apply. SHM talks to a process on the same host through
+     * /dev/shm/tcpipc.<port>, addr is ignored and batching does not apply
+     * since sending makes no system call.
+     */
+    enum tcpipc_transport_e transport;
+
+    // Keep only the newest queued value of each STATE message id, overwritten
+    // in place instead of taking another slot. CONTROL messages stay FIFO.
+    uint8_t conflate;
+
+    /*
+     * Receive queue capacity and what happens when it is full, see
+     * recv_msg_overflow_e; GROW doubles it up to rx_queue_max. Both are
+     * rounded up to a power of two.
+     */
+    size_t rx_queue_len;
+    size_t rx_queue_max;
+    enum recv_msg_overflow_e rx_overflow;
+
+    // Moves a TCP connection onto io_uring when the kernel supports it and
+    // silently keeps read()/writev() otherwise.
+    uint8_t io_uring;
+
+    /*
+     * A message whose ID has a handler registered with tcpipc_on() is handled
+     * on the receive thread straight from the receive buffer and never enters
+     * the queue. Such handlers run concurrently with the application thread
+     * and stall the connection while they run. Messages without a handler
+     * are queued as usual.
+     */
+    uint8_t rx_inline;
+
+    /*
+     * Real-time tuning of the receive path, every field is off when zero. A
+     * setting the process lacks permission for is reported and skipped.
+     * Spinning under SCHED_FIFO starves everything else on that CPU, combine
+     * rx_priority with rx_busy_spin only with rx_cpu set to a core reserved
+     * for it.
+     */
+    int rx_cpu;                 // Pin the receive thread, -1 leaves it free
+    int rx_priority;            // SCHED_FIFO priority of the receive thread
+    uint32_t busy_poll_usec;    // SO_BUSY_POLL
+    int sock_rcvbuf;            // SO_RCVBUF
+    int sock_sndbuf;            // SO_SNDBUF
+    uint8_t quickack;           // Re-arm TCP_QUICKACK after every read
+    uint8_t rx_busy_spin;       // Spin reads, takes precedence over io_uring
+
+    /*
+     * Exchange PING/PONG frames with the peer at that interval to estimate
+     * round trip time and the offset between the two clocks, see
+     * tcpipc_get_rtt(). Both peers must enable it, and the IDs
+     * TCPIPC_MSG_ID_PING and TCPIPC_MSG_ID_PONG are then reserved. PINGs go
+     * out from tcpipc_send() and tcpipc_flush() and, on an idle TCP
+     * connection without io_uring or rx_busy_spin, from the receive thread. A
+     * PONG is written by the receive thread right away, taking pending
+     * batched frames along. Sends then take a lock shared with the receive
+     * thread.
+     */
+    uint32_t ping_interval_ms;
+
+    /*
+     * Trace the latency of every frame. The sender stamps each frame in
+     * tcpipc_send(), ahead of its payload, so both peers must enable it. The
+     * receiver adds the kernel receive stamp (TCP read path only, which it
+     * takes over from io_uring), the time the frame was queued and the time
+     * the application took it out; tcpipc_latency_read() returns the records.
+     * Frames handled inline are not traced. On TCP the sender also reads the
+     * kernel transmit stamps of its writes back, at the cost of a system call
+     * per write, and reports the delay from tcpipc_send() to the kernel in
+     * the statistics.
+     */
+    uint8_t timestamping;
+
+    /*
+     * Keep that many of the latest frames, sent, received or dropped, in a
+     * flight recorder with their time stamps. It is written to
+     * <flight_dir>/tcpipc_flight.<pid>.<port>.<role>.bin when the connection
+     * is lost, by tcpipc_dump_flight() or on the signal set with
+     * tcpipc_flight_signal(); a NULL flight_dir is the working directory.
+     * Decode dumps with flightdec.
+     */
+    size_t flight_len;
+    const char *flight_dir;
+
+    /*
+     * Split the connection into that many logical channels, up to
+     * TCPIPC_CHAN_MAX; both peers must agree on it. tcpipc_send_chan() picks
+     * the channel of a frame and the receiver finds it in msg_chan. On a
+     * batched TCP connection every channel queues its frames separately and a
+     * flush writes them in deficit round robin order: per round each channel
+     * may write chan_weight bytes (zero picks TCPIPC_CHAN_DEF_WEIGHT), channel
+     * 0 first. Put small urgent traffic on a low channel with a weight above
+     * its largest frame and bulk traffic on a higher one. Other transports
+     * only tag frames. Library frames such as PINGs use channel 0.
+     */
+    uint8_t channels;
+    uint32_t chan_weight[TCPIPC_CHAN_MAX];
+
+    /*
+     * tcpipc_bulk_send() and tcpipc_bulk_sendfile() cut payloads into
+     * fragments of at most bulk_frag_len bytes. A receiver with bulk_max_len
+     * set puts the fragments back together and queues the result as one
+     * message of up to that many bytes; it then reserves TCPIPC_MSG_ID_BULK.
+     * On TCP the fragments are not copied by the library, and with
+     * bulk_zerocopy (ignored with timestamping, which shares the socket error
+     * queue) neither by the kernel. Over UDP the fragments take the reliable
+     * lane and wait for its window to open.
+     */
+    uint32_t bulk_frag_len;
+    uint32_t bulk_max_len;
+    uint8_t bulk_zerocopy;
+
+    /*
+     * Keep a TCP connection alive across a lost link: the client dials again
+     * and the server accepts again for up to reconnect_ms before the
+     * connection counts as gone. Connecting does not block, failed attempts
+     * are retried after reconnect_backoff_ms, doubling up to
+     * TCPIPC_RESUME_BACKOFF_MAX_MS, which also applies to the first connect
+     * of a client. Every frame sent is kept in a send log of resume_log_size
+     * bytes until the peer acknowledges it; after a reconnect each peer
+     * replays what the other missed, so no message is delivered twice and
+     * none is lost unless the log overflowed, see resume_lost in
+     * tcpipc_stats_t. While the link is down tcpipc_send() only logs and
+     * fails once the log is full. A bulk transfer cut by the loss fails and
+     * is not resumed, and the IDs from TCPIPC_MSG_ID_PING to
+     * TCPIPC_MSG_ID_RESUME are reserved. With PINGs enabled, a peer silent
+     * for TCPIPC_RESUME_SILENT_PINGS intervals is taken as a lost link as
+     * well. Both peers must enable it, and sends then take a lock shared with
+     * the receive thread.
+     */
+    uint32_t reconnect_ms;
+    uint32_t reconnect_backoff_ms;
+    size_t resume_log_size;
+
+    /*
+     * Append every message the application receives, with its ID, channel
+     * and arrival time, to
+     * <capture_dir>/tcpipc_capture.<pid>.<port>.<role>.bin; a NULL
+     * capture_dir is the working directory. Library frames are left
+     * out and a bulk transfer is one record. The receive thread writes in
+     * large buffered chunks, the tail reaches the file when the connection
+     * closes. Play captures back into an endpoint with tcpipc_replay.
+     */
+    uint8_t capture;
+    const char *capture_dir;
 };
 
+/*
+ * Round trip estimates returned by tcpipc_get_rtt(). rtt_ns is smoothed,
+ * jitter_ns is its mean deviation. offset_ns is the peer's monotonic clock
+ * minus ours, taken from the best of the recent samples.
+ */
+struct tcpipc_rtt_t
+{
+    uint64_t samples;
+    uint64_t rtt_ns;
+    uint64_t rtt_min_ns;
+    uint64_t jitter_ns;
+    int64_t offset_ns;
+};
+
+/*
+ * Counters of one channel returned by tcpipc_get_chan_stats(). wait_max_ns
+ * is the longest a frame of the channel sat in its queue before a flush.
+ */
+struct tcpipc_chan_stats_t
+{
+    uint64_t msgs_out;
+    uint64_t bytes_out;
+    uint64_t msgs_in;
+    uint64_t bytes_in;
+    uint64_t wait_max_ns;
+};
+
+/*
+ * Borrowed view of a received message. msg_data points straight into the
+ * receive queue and stays valid until the message is released.
+ */
+struct tcpipc_msg_view_t
+{
+    uint8_t msg_id;
+    uint8_t msg_chan;
+    uint32_t msg_len;
+    const uint8_t *msg_data;
+};
+
+/*
+ * Visitor invoked by tcpipc_recv_visit(). Returning non-zero stops the visit
+ * after the current message.
+ */
+typedef int (*tcpipc_visit_cb_t)(void *arg,
+                                 const struct tcpipc_msg_view_t *view);
+
+/*
+ * Handler registered with tcpipc_on() for one message ID. The view is only
+ * valid during the call.
+ */
+typedef void (*tcpipc_handler_cb_t)(void *arg,
+                                    const struct tcpipc_msg_view_t *view);
+
+/*
+ * Opaque connection handle returned by tcpipc_init(). Every handle owns its
+ * sockets, buffers, receive thread and queue, so one process can drive many
+ * independent connections. A handle is meant to be used from one application
+ * thread at a time.
+ */
+struct tcpipc_ctx;
+
 struct socket_info_t
 {
     int fd;
@@ -55,32 +317,281 @@ struct socket_info_t
 /** Public Functions **/
 
 /*******************************************************************************
- * @brief
+ * @brief   Opens a connection with the default options.
+ *
+ * @return  Connection handle, NULL on failure
+ *******************************************************************************/
+struct tcpipc_ctx *tcpipc_init(enum tcp_role_e tcp_role, char *addr, int port);
+
+/*******************************************************************************
+ * @brief   Same as tcpipc_init() with explicit options, NULL selects defaults.
+ *
+ * @return  Connection handle, NULL on failure
+ *******************************************************************************/
+struct tcpipc_ctx *tcpipc_init_opts(enum tcp_role_e tcp_role, char *addr,
+                                    int port, const struct tcpipc_opts_t *opts);
+
+/*******************************************************************************
+ * @brief   Fills opts with the default options.
  *
  * @return
  *******************************************************************************/
-int tcpipc_init(enum tcp_role_e tcp_role, char *addr, int port);
+void tcpipc_opts_default(struct tcpipc_opts_t *opts);
 
 /*******************************************************************************
- * @brief
+ * @brief   Flushes pending frames, stops the receive thread and frees the
+ *          handle.
  *
  * @return
  *******************************************************************************/
-void tcpipc_close();
+void tcpipc_close(struct tcpipc_ctx *ctx);
 
 /*******************************************************************************
- * @brief
+ * @brief   Sends a message. With batching enabled the frame is queued and goes
+ *          out on tcpipc_flush() or when a flush threshold is crossed.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_send(struct tcpipc_ctx *ctx, struct msg_packet_t *msg_packet);
+
+/*******************************************************************************
+ * @brief   Sends a message on channel chan, see channels. tcpipc_send() uses
+ *          channel 0.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_send_chan(struct tcpipc_ctx *ctx, uint8_t chan,
+                     struct msg_packet_t *msg_packet);
+
+/*******************************************************************************
+ * @brief   Starts sending len bytes of buf as one message with msg_id on
+ *          channel chan. tcpipc_bulk_poll() or tcpipc_bulk_wait() move it
+ *          forward; buf must stay untouched until they report it done. One
+ *          transfer at a time per connection.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_bulk_send(struct tcpipc_ctx *ctx, uint8_t chan, uint8_t msg_id,
+                     const void *buf, uint32_t len);
+
+/*******************************************************************************
+ * @brief   Same as tcpipc_bulk_send() with len bytes of the file fd from off.
+ *          The file position of fd is not used.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_bulk_sendfile(struct tcpipc_ctx *ctx, uint8_t chan, uint8_t msg_id,
+                         int fd, off_t off, uint32_t len);
+
+/*******************************************************************************
+ * @brief   Sends the next fragment of the bulk transfer, or collects its
+ *          zero-copy completions once all are sent. Frames sent in between
+ *          go out between fragments.
+ *
+ * @return  1 while the transfer is in progress, 0 when it is done or none
+ *          was started, -1 on failure, which ends the transfer
+ *******************************************************************************/
+int tcpipc_bulk_poll(struct tcpipc_ctx *ctx);
+
+/*******************************************************************************
+ * @brief   Runs tcpipc_bulk_poll() until the transfer is done, waiting up to
+ *          timeout_ms in total. A negative timeout waits forever.
+ *
+ * @return  0 when done, -1 on failure or timeout
+ *******************************************************************************/
+int tcpipc_bulk_wait(struct tcpipc_ctx *ctx, int timeout_ms);
+
+/*******************************************************************************
+ * @brief   Selects how messages with the given ID are delivered. STATE
+ *          messages are latest-value-wins and may be dropped when stale,
+ *          CONTROL messages are reliable and ordered (the default).
  *
  * @return
  *******************************************************************************/
-int tcpipc_send(struct msg_packet_t *msg_packet);
+void tcpipc_set_msg_class(struct tcpipc_ctx *ctx, uint8_t msg_id,
+                          enum tcpipc_msg_class_e cls);
 
 /*******************************************************************************
- * @brief
+ * @brief   Writes all queued frames in a single system call.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_flush(struct tcpipc_ctx *ctx);
+
+/*******************************************************************************
+ * @brief   Dequeues a message without blocking.
+ *
+ * @return  0 on success, -1 if no message is pending
+ *******************************************************************************/
+int tcpipc_recv(struct tcpipc_ctx *ctx, struct msg_packet_t *msg_packet);
+
+/*******************************************************************************
+ * @brief   Dequeues a message, blocking up to timeout_ms for one to arrive.
+ *          A negative timeout waits forever.
+ *
+ * @return  0 on success, -1 on timeout or when the peer is gone
+ *******************************************************************************/
+int tcpipc_recv_wait(struct tcpipc_ctx *ctx, struct msg_packet_t *msg_packet,
+                     int timeout_ms);
+
+/*******************************************************************************
+ * @brief   Returns a file descriptor that polls readable while received
+ *          messages may be pending, for use in an external poll/epoll loop.
+ *          Drain it with tcpipc_recv() until it returns -1.
+ *
+ * @return  File descriptor, -1 if not initialized
+ *******************************************************************************/
+int tcpipc_get_fd(struct tcpipc_ctx *ctx);
+
+/*******************************************************************************
+ * @brief   Tells whether the link to the peer is up. With reconnect_ms set it
+ *          is down from a loss until the peer resumed the session.
+ *
+ * @return  1 if up, 0 if down or gone
+ *******************************************************************************/
+int tcpipc_link_up(struct tcpipc_ctx *ctx);
+
+/*******************************************************************************
+ * @brief   Releases the payload of a message returned by tcpipc_recv().
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_msg_free(struct msg_packet_t *msg_packet);
+
+/*******************************************************************************
+ * @brief   Borrows the oldest received message without copying it. The view
+ *          must be handed back with tcpipc_recv_release() before the next
+ *          borrow.
+ *
+ * @return  0 on success, -1 if no message is pending
+ *******************************************************************************/
+int tcpipc_recv_view(struct tcpipc_ctx *ctx, struct tcpipc_msg_view_t *view);
+
+/*******************************************************************************
+ * @brief   Releases the message borrowed with tcpipc_recv_view().
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_recv_release(struct tcpipc_ctx *ctx);
+
+/*******************************************************************************
+ * @brief   Calls visit_cb on up to max pending messages in order, releasing
+ *          each one after the callback returns. max <= 0 visits all.
+ *
+ * @return  Number of messages visited
+ *******************************************************************************/
+int tcpipc_recv_visit(struct tcpipc_ctx *ctx, tcpipc_visit_cb_t visit_cb,
+                      void *arg, int max);
+
+/*******************************************************************************
+ * @brief   Registers handler for msg_id, replacing the previous one. A NULL
+ *          handler unregisters it. Handlers are called by tcpipc_dispatch(),
+ *          or on the receive thread with rx_inline.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_on(struct tcpipc_ctx *ctx, uint8_t msg_id,
+               tcpipc_handler_cb_t handler, void *arg);
+
+/*******************************************************************************
+ * @brief   Drains up to max pending messages in one batch, passing each to
+ *          the handler of its ID. Messages without a handler are dropped.
+ *          max <= 0 drains all.
+ *
+ * @return  Number of messages drained
+ *******************************************************************************/
+int tcpipc_dispatch(struct tcpipc_ctx *ctx, int max);
+
+/*******************************************************************************
+ * @brief   Same as tcpipc_dispatch(), blocking up to timeout_ms for a first
+ *          message to arrive. A negative timeout waits forever.
+ *
+ * @return  Number of messages drained, -1 on timeout or when the peer is gone
+ *******************************************************************************/
+int tcpipc_dispatch_wait(struct tcpipc_ctx *ctx, int timeout_ms, int max);
+
+/*******************************************************************************
+ * @brief   Copies the counters of a connection. Safe to call from any thread,
+ *          each value is recent but the set is not an atomic snapshot.
  *
  * @return
  *******************************************************************************/
-int tcpipc_recv(struct msg_packet_t *msg_packet);
+void tcpipc_get_stats(struct tcpipc_ctx *ctx, struct tcpipc_stats_t *stats);
+
+/*******************************************************************************
+ * @brief   Copies the counters of channel chan. Safe to call from any thread.
+ *
+ * @return  0 on success, -1 if the channel does not exist
+ *******************************************************************************/
+int tcpipc_get_chan_stats(struct tcpipc_ctx *ctx, uint8_t chan,
+                          struct tcpipc_chan_stats_t *stats);
+
+/*******************************************************************************
+ * @brief   Copies the round trip and clock offset estimates of a connection
+ *          opened with ping_interval_ms. Safe to call from any thread.
+ *
+ * @return  0 on success, -1 if no PONG was received yet
+ *******************************************************************************/
+int tcpipc_get_rtt(struct tcpipc_ctx *ctx, struct tcpipc_rtt_t *rtt);
+
+/*******************************************************************************
+ * @brief   Converts a time stamp taken with the peer's tcpipc_now_ns() to our
+ *          clock, using the current offset estimate.
+ *
+ * @return  Local time stamp, peer_ns unchanged if there is no estimate yet
+ *******************************************************************************/
+uint64_t tcpipc_peer_to_local_ns(struct tcpipc_ctx *ctx, uint64_t peer_ns);
+
+/*******************************************************************************
+ * @brief   Converts a time stamp taken with our tcpipc_now_ns() to the peer's
+ *          clock, using the current offset estimate.
+ *
+ * @return  Peer time stamp, local_ns unchanged if there is no estimate yet
+ *******************************************************************************/
+uint64_t tcpipc_local_to_peer_ns(struct tcpipc_ctx *ctx, uint64_t local_ns);
+
+/*******************************************************************************
+ * @brief   Moves up to max latency records of consumed messages, oldest
+ *          first, into recs. send_ns is converted to our clock when a clock
+ *          offset estimate exists, see ping_interval_ms; without one it is
+ *          only comparable on the same host. Application thread only.
+ *
+ * @return  Number of records copied
+ *******************************************************************************/
+int tcpipc_latency_read(struct tcpipc_ctx *ctx, struct recv_msg_trace_t *recs,
+                        int max);
+
+/*******************************************************************************
+ * @brief   Writes the flight recorder of a connection to its dump file.
+ *          Async-signal-safe.
+ *
+ * @return  0 on success, -1 on failure or if the recorder is off
+ *******************************************************************************/
+int tcpipc_dump_flight(struct tcpipc_ctx *ctx);
+
+/*******************************************************************************
+ * @brief   Writes the counters of a connection as one key=value line to fd.
+ *          Async-signal-safe.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_stats_dump(struct tcpipc_ctx *ctx, int fd);
+
+/*******************************************************************************
+ * @brief   Installs a handler that dumps every open connection to stderr
+ *          when signo is received, e.g. SIGUSR1.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_stats_signal(int signo);
+
+/*******************************************************************************
+ * @brief   Installs a handler that dumps the flight recorder of every open
+ *          connection when signo is received, e.g. SIGUSR2.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_flight_signal(int signo);
 
 /*******************************************************************************
  * @brief
@@ -0,0 +1,599 @@
+/*******************************************************************************
+ * @file    tcpipc_bench.c
+ * @brief   Loopback benchmark for libtcpipc. A server context echoes every
+ *          message back to a client context in the same process, so both ends
+ *          share CLOCK_MONOTONIC and one-way latency can be measured directly.
+ *
+ *          For every combination of message size, send rate and queue depth
+ *          (messages in flight) it reports messages and bytes per second and
+ *          the one-way and round-trip latency distributions, kept in HDR-style
+ *          log-linear histograms. -j prints JSON instead of a table.
+ *
+ *          Usage: tcpipc_bench [-t tcp|shm|udp] [-n count] [-s sizes]
+ *                              [-r rates] [-d depths] [-p port] [-b] [-u]
+ *                              [-j]
+ *
+ *          sizes, rates and depths are comma separated lists, a rate of 0
+ *          sends as fast as the window allows. -b busy polls instead of
+ *          blocking in tcpipc_recv_wait(), -u asks for the io_uring backend.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "tcpipc.h"
+
+/** Defines  **/
+#define BENCH_MSG_DATA (1)
+#define BENCH_MSG_END (2)
+#define BENCH_HDR_LEN (16)
+#define BENCH_MAX_SIZE (32768)
+#define BENCH_MAX_LIST (16)
+#define BENCH_TIMEOUT_MS (1000)
+
+// Values below 2 * HIST_SUB are exact, above that each power of two range is
+// split in HIST_SUB buckets, i.e. better than 1% relative precision
+#define HIST_SUB_BITS (7)
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS) * HIST_SUB)
+
+/** User Data Types **/
+struct bench_hist_t
+{
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+};
+
+struct bench_server_t
+{
+    struct tcpipc_ctx *ctx;
+    enum tcpipc_transport_e transport;
+    int port;
+    int busy;
+    int io_uring;
+    atomic_int stop;
+    struct bench_hist_t one_way;
+};
+
+struct bench_result_t
+{
+    uint32_t size;
+    uint32_t rate;
+    uint32_t depth;
+    uint64_t sent;
+    uint64_t received;
+    double elapsed_s;
+    struct bench_hist_t rtt;
+};
+
+/** Private Function Prototypes **/
+static void bench_hist_reset(struct bench_hist_t *hist);
+static void bench_hist_record(struct bench_hist_t *hist, uint64_t value);
+static uint64_t bench_hist_value(int index);
+static uint64_t bench_hist_percentile(const struct bench_hist_t *hist,
+                                      double percentile);
+static void bench_opts(struct tcpipc_opts_t *opts,
+                       enum tcpipc_transport_e transport, int io_uring);
+static void *bench_server_thread(void *arg);
+static int bench_recv(struct tcpipc_ctx *ctx, struct msg_packet_t *msg,
+                      int timeout_ms, int busy);
+static int bench_run(struct tcpipc_ctx *ctx, struct bench_server_t *server,
+                     struct bench_result_t *res, uint64_t count, int busy);
+static int bench_parse_list(char *str, uint32_t *list);
+static void bench_print_table(const struct bench_result_t *res,
+                              const struct bench_hist_t *one_way,
+                              enum tcpipc_transport_e transport);
+static void bench_print_json(const struct bench_result_t *res,
+                             const struct bench_hist_t *one_way, int first);
+static void bench_print_json_hist(const char *name,
+                                  const struct bench_hist_t *hist);
+
+/** Global Variables **/
+static const char *transport_names[] = {"tcp", "udp", "shm"};
+static uint8_t bench_buf[BENCH_MAX_SIZE];
+
+int main(int argc, char **argv)
+{
+    uint32_t sizes[BENCH_MAX_LIST] = {16, 64, 256, 1024, 4096};
+    uint32_t rates[BENCH_MAX_LIST] = {0, 10000};
+    uint32_t depths[BENCH_MAX_LIST] = {1, 8};
+    int sizes_len = 5, rates_len = 2, depths_len = 2;
+    struct bench_server_t server;
+    struct bench_result_t res;
+    struct tcpipc_opts_t opts;
+    struct tcpipc_ctx *ctx;
+    pthread_t server_tid;
+    uint64_t count = 10000;
+    int json = 0, busy = 0, first = 1, opt;
+    int s, r, d;
+
+    memset(&server, 0, sizeof(server));
+    server.transport = TCPIPC_TRANSPORT_TCP;
+    server.port = 9500;
+
+    while ((opt = getopt(argc, argv, "t:n:s:r:d:p:buj")) != -1)
+    {
+        switch (opt)
+        {
+        case 't':
+            if (strcmp(optarg, "tcp") == 0)
+                server.transport = TCPIPC_TRANSPORT_TCP;
+            else if (strcmp(optarg, "udp") == 0)
+                server.transport = TCPIPC_TRANSPORT_UDP;
+            else if (strcmp(optarg, "shm") == 0)
+                server.transport = TCPIPC_TRANSPORT_SHM;
+            else
+            {
+                printf("Unknown transport: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'n':
+            count = strtoull(optarg, NULL, 0);
+            break;
+        case 's':
+            sizes_len = bench_parse_list(optarg, sizes);
+            break;
+        case 'r':
+            rates_len = bench_parse_list(optarg, rates);
+            break;
+        case 'd':
+            depths_len = bench_parse_list(optarg, depths);
+            break;
+        case 'p':
+            server.port = atoi(optarg);
+            break;
+        case 'b':
+            busy = 1;
+            break;
+        case 'u':
+            server.io_uring = 1;
+            break;
+        case 'j':
+            json = 1;
+            break;
+        default:
+            printf("Usage: %s [-t tcp|shm|udp] [-n count] [-s sizes] "
+                   "[-r rates] [-d depths] [-p port] [-b] [-u] [-j]\n",
+                   argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (count == 0 || sizes_len <= 0 || rates_len <= 0 || depths_len <= 0)
+    {
+        printf("Invalid sweep\n");
+        return EXIT_FAILURE;
+    }
+
+    server.busy = busy;
+    pthread_create(&server_tid, NULL, bench_server_thread, &server);
+
+    // Give the server time to listen before connecting
+    usleep(100000);
+
+    bench_opts(&opts, server.transport, server.io_uring);
+    ctx = tcpipc_init_opts(TCP_ROLE_CLIENT, "127.0.0.1", server.port, &opts);
+
+    if (ctx == NULL)
+    {
+        atomic_store(&server.stop, 1);
+        pthread_join(server_tid, NULL);
+        return EXIT_FAILURE;
+    }
+
+    if (json)
+        printf("{\"transport\": \"%s\", \"count\": %llu, \"runs\": [\n",
+               transport_names[server.transport], (unsigned long long)count);
+    else
+        printf("%-6s %6s %8s %6s %11s %12s %9s %9s %9s %9s %9s %9s\n",
+               "trans", "size", "rate", "depth", "msg/s", "MB/s",
+               "ow_p50", "ow_p99", "ow_p999", "rtt_p50", "rtt_p99",
+               "rtt_p999");
+
+    for (s = 0; s < sizes_len; s++)
+    {
+        if (sizes[s] < BENCH_HDR_LEN || sizes[s] > BENCH_MAX_SIZE ||
+            (server.transport == TCPIPC_TRANSPORT_UDP &&
+             sizes[s] > TCPIPC_UDP_MAX_PAYLOAD))
+        {
+            fprintf(stderr, "Skipping size %u, not supported\n", sizes[s]);
+            continue;
+        }
+
+        for (r = 0; r < rates_len; r++)
+        {
+            for (d = 0; d < depths_len; d++)
+            {
+                memset(&res, 0, sizeof(res));
+                res.size = sizes[s];
+                res.rate = rates[r];
+                res.depth = depths[d] ? depths[d] : 1;
+
+                bench_run(ctx, &server, &res, count, busy);
+
+                if (json)
+                    bench_print_json(&res, &server.one_way, first);
+                else
+                    bench_print_table(&res, &server.one_way, server.transport);
+
+                first = 0;
+            }
+        }
+    }
+
+    if (json)
+        printf("]}\n");
+
+    atomic_store(&server.stop, 1);
+    tcpipc_close(ctx);
+    pthread_join(server_tid, NULL);
+
+    return EXIT_SUCCESS;
+}
+
+/*******************************************************************************
+ * @brief   Clears the histogram.
+ *
+ * @return
+ *******************************************************************************/
+static void bench_hist_reset(struct bench_hist_t *hist)
+{
+    memset(hist, 0, sizeof(struct bench_hist_t));
+    hist->min = UINT64_MAX;
+}
+
+/*******************************************************************************
+ * @brief   Adds one value in nanoseconds.
+ *
+ * @return
+ *******************************************************************************/
+static void bench_hist_record(struct bench_hist_t *hist, uint64_t value)
+{
+    int index, shift;
+
+    if (value < 2 * HIST_SUB)
+    {
+        index = value;
+    }
+    else
+    {
+        shift = 63 - __builtin_clzll(value) - HIST_SUB_BITS;
+        index = (shift + 1) * HIST_SUB + (int)((value >> shift) - HIST_SUB);
+    }
+
+    hist->counts[index]++;
+    hist->total++;
+
+    if (value < hist->min)
+        hist->min = value;
+    if (value > hist->max)
+        hist->max = value;
+}
+
+/*******************************************************************************
+ * @brief   Highest value that lands in the given bucket.
+ *
+ * @return  Value in nanoseconds
+ *******************************************************************************/
+static uint64_t bench_hist_value(int index)
+{
+    int shift;
+
+    if (index < 2 * HIST_SUB)
+        return index;
+
+    shift = index / HIST_SUB - 1;
+
+    return (((uint64_t)(HIST_SUB + index % HIST_SUB) + 1) << shift) - 1;
+}
+
+/*******************************************************************************
+ * @brief   Value at or below which the given percentage of samples fall.
+ *
+ * @return  Value in nanoseconds, 0 for an empty histogram
+ *******************************************************************************/
+static uint64_t bench_hist_percentile(const struct bench_hist_t *hist,
+                                      double percentile)
+{
+    uint64_t target, seen = 0;
+    int i;
+
+    if (hist->total == 0)
+        return 0;
+
+    target = (uint64_t)(percentile / 100.0 * hist->total + 0.5);
+
+    if (target == 0)
+        target = 1;
+
+    for (i = 0; i < HIST_BUCKETS; i++)
+    {
+        seen += hist->counts[i];
+
+        if (seen >= target)
+            return bench_hist_value(i) < hist->max ? bench_hist_value(i)
+                                                   : hist->max;
+    }
+
+    return hist->max;
+}
+
+/*******************************************************************************
+ * @brief   Options shared by both ends. A 32-bit length field allows every
+ *          size of the sweep, data messages use the reliable UDP lane and a
+ *          full receive queue blocks rather than drops samples.
+ *
+ * @return
+ *******************************************************************************/
+static void bench_opts(struct tcpipc_opts_t *opts,
+                       enum tcpipc_transport_e transport, int io_uring)
+{
+    tcpipc_opts_default(opts);
+    opts->len_size = TCPIPC_LEN_32;
+    opts->transport = transport;
+    opts->rx_overflow = RECV_MSG_OVERFLOW_BLOCK;
+    opts->io_uring = io_uring;
+}
+
+/*******************************************************************************
+ * @brief   Echo server. Records the one-way latency of every data message
+ *          and returns it unchanged; an END message is answered once all
+ *          previous messages were handled.
+ *
+ * @return
+ *******************************************************************************/
+static void *bench_server_thread(void *arg)
+{
+    struct bench_server_t *server = (struct bench_server_t *)arg;
+    struct tcpipc_opts_t opts;
+    struct msg_packet_t msg;
+    uint64_t sent_ns;
+
+    bench_opts(&opts, server->transport, server->io_uring);
+    bench_hist_reset(&server->one_way);
+
+    server->ctx = tcpipc_init_opts(TCP_ROLE_SERVER, "", server->port, &opts);
+
+    if (server->ctx == NULL)
+        return NULL;
+
+    while (!atomic_load(&server->stop))
+    {
+        if (bench_recv(server->ctx, &msg, 100, server->busy))
+            continue;
+
+        if (msg.msg_id == BENCH_MSG_DATA && msg.msg_len >= BENCH_HDR_LEN)
+        {
+            memcpy(&sent_ns, msg.msg_data + 8, sizeof(sent_ns));
+            bench_hist_record(&server->one_way, tcpipc_now_ns() - sent_ns);
+        }
+
+        tcpipc_send(server->ctx, &msg);
+        tcpipc_msg_free(&msg);
+    }
+
+    tcpipc_close(server->ctx);
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * @brief   Receives one message, spinning on tcpipc_recv() in busy mode.
+ *
+ * @return  0 on success, -1 on timeout
+ *******************************************************************************/
+static int bench_recv(struct tcpipc_ctx *ctx, struct msg_packet_t *msg,
+                      int timeout_ms, int busy)
+{
+    uint64_t deadline;
+
+    if (!busy || timeout_ms == 0)
+        return timeout_ms == 0 ? tcpipc_recv(ctx, msg)
+                               : tcpipc_recv_wait(ctx, msg, timeout_ms);
+
+    deadline = tcpipc_now_ns() + (uint64_t)timeout_ms * 1000000ULL;
+
+    while (tcpipc_recv(ctx, msg))
+        if (tcpipc_now_ns() > deadline)
+            return -1;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   One point of the sweep. Keeps up to depth messages in flight,
+ *          paced to rate messages per second when rate is non-zero.
+ *
+ * @return  0 on success, -1 if echoes stopped arriving
+ *******************************************************************************/
+static int bench_run(struct tcpipc_ctx *ctx, struct bench_server_t *server,
+                     struct bench_result_t *res, uint64_t count, int busy)
+{
+    uint64_t interval_ns = res->rate ? 1000000000ULL / res->rate : 0;
+    uint64_t start_ns, next_ns, now_ns, sent_ns;
+    struct msg_packet_t msg;
+    uint32_t seq;
+    int timeout_ms;
+
+    bench_hist_reset(&res->rtt);
+    bench_hist_reset(&server->one_way);
+
+    start_ns = tcpipc_now_ns();
+    next_ns = start_ns;
+
+    while (res->received < count)
+    {
+        now_ns = tcpipc_now_ns();
+
+        if (res->sent < count && res->sent - res->received < res->depth &&
+            now_ns >= next_ns)
+        {
+            seq = res->sent;
+            memcpy(bench_buf, &seq, sizeof(seq));
+            memcpy(bench_buf + 8, &now_ns, sizeof(now_ns));
+
+            msg.msg_id = BENCH_MSG_DATA;
+            msg.msg_len = res->size;
+            msg.msg_data = bench_buf;
+
+            if (tcpipc_send(ctx, &msg))
+                break;
+
+            res->sent++;
+            next_ns += interval_ns;
+            continue;
+        }
+
+        // Only block when nothing can be sent until an echo comes back
+        if (res->sent == count || res->sent - res->received >= res->depth)
+            timeout_ms = BENCH_TIMEOUT_MS;
+        else
+            timeout_ms = 0;
+
+        if (bench_recv(ctx, &msg, timeout_ms, busy))
+        {
+            if (timeout_ms)
+                break;
+            continue;
+        }
+
+        if (msg.msg_id == BENCH_MSG_DATA && msg.msg_len >= BENCH_HDR_LEN)
+        {
+            memcpy(&sent_ns, msg.msg_data + 8, sizeof(sent_ns));
+            bench_hist_record(&res->rtt, tcpipc_now_ns() - sent_ns);
+            res->received++;
+        }
+
+        tcpipc_msg_free(&msg);
+    }
+
+    res->elapsed_s = (tcpipc_now_ns() - start_ns) / 1e9;
+
+    // The END echo tells us the server is done with its histogram
+    msg.msg_id = BENCH_MSG_END;
+    msg.msg_len = 0;
+    msg.msg_data = bench_buf;
+    tcpipc_send(ctx, &msg);
+
+    while (!bench_recv(ctx, &msg, BENCH_TIMEOUT_MS, busy))
+    {
+        tcpipc_msg_free(&msg);
+
+        if (msg.msg_id == BENCH_MSG_END)
+            break;
+    }
+
+    if (res->received < count)
+    {
+        fprintf(stderr, "Lost %llu of %llu messages\n",
+                (unsigned long long)(count - res->received),
+                (unsigned long long)count);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Parses a comma separated list of numbers.
+ *
+ * @return  Number of entries
+ *******************************************************************************/
+static int bench_parse_list(char *str, uint32_t *list)
+{
+    char *tok, *save = NULL;
+    int len = 0;
+
+    for (tok = strtok_r(str, ",", &save); tok && len < BENCH_MAX_LIST;
+         tok = strtok_r(NULL, ",", &save))
+        list[len++] = strtoul(tok, NULL, 0);
+
+    return len;
+}
+
+/*******************************************************************************
+ * @brief   Prints one sweep point as a table row, latencies in microseconds.
+ *
+ * @return
+ *******************************************************************************/
+static void bench_print_table(const struct bench_result_t *res,
+                              const struct bench_hist_t *one_way,
+                              enum tcpipc_transport_e transport)
+{
+    double msgs = res->elapsed_s > 0 ? res->received / res->elapsed_s : 0;
+
+    printf("%-6s %6u %8u %6u %11.0f %12.2f %9.1f %9.1f %9.1f %9.1f %9.1f "
+           "%9.1f\n",
+           transport_names[transport], res->size, res->rate,
+           res->depth, msgs, msgs * res->size / 1e6,
+           bench_hist_percentile(one_way, 50.0) / 1e3,
+           bench_hist_percentile(one_way, 99.0) / 1e3,
+           bench_hist_percentile(one_way, 99.9) / 1e3,
+           bench_hist_percentile(&res->rtt, 50.0) / 1e3,
+           bench_hist_percentile(&res->rtt, 99.0) / 1e3,
+           bench_hist_percentile(&res->rtt, 99.9) / 1e3);
+}
+
+/*******************************************************************************
+ * @brief   Prints one sweep point as a JSON object, latencies in nanoseconds.
+ *
+ * @return
+ *******************************************************************************/
+static void bench_print_json(const struct bench_result_t *res,
+                             const struct bench_hist_t *one_way, int first)
+{
+    double msgs = res->elapsed_s > 0 ? res->received / res->elapsed_s : 0;
+
+    printf("%s  {\"size\": %u, \"rate\": %u, \"depth\": %u, "
+           "\"sent\": %llu, \"received\": %llu, \"elapsed_s\": %.6f, "
+           "\"msgs_per_s\": %.1f, \"bytes_per_s\": %.1f,\n",
+           first ? "" : ",\n", res->size, res->rate, res->depth,
+           (unsigned long long)res->sent, (unsigned long long)res->received,
+           res->elapsed_s, msgs, msgs * res->size);
+
+    bench_print_json_hist("one_way_ns", one_way);
+    printf(",\n");
+    bench_print_json_hist("rtt_ns", &res->rtt);
+    printf("}");
+}
+
+/*******************************************************************************
+ * @brief   Prints the summary and the non-empty buckets of a histogram as
+ *          [highest value, count] pairs.
+ *
+ * @return
+ *******************************************************************************/
+static void bench_print_json_hist(const char *name,
+                                  const struct bench_hist_t *hist)
+{
+    int i, first = 1;
+
+    printf("   \"%s\": {\"count\": %llu, \"min\": %llu, \"p50\": %llu, "
+           "\"p90\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu, "
+           "\"buckets\": [",
+           name, (unsigned long long)hist->total,
+           (unsigned long long)(hist->total ? hist->min : 0),
+           (unsigned long long)bench_hist_percentile(hist, 50.0),
+           (unsigned long long)bench_hist_percentile(hist, 90.0),
+           (unsigned long long)bench_hist_percentile(hist, 99.0),
+           (unsigned long long)bench_hist_percentile(hist, 99.9),
+           (unsigned long long)hist->max);
+
+    for (i = 0; i < HIST_BUCKETS; i++)
+    {
+        if (hist->counts[i] == 0)
+            continue;
+
+        printf("%s[%llu, %llu]", first ? "" : ", ",
+               (unsigned long long)bench_hist_value(i),
+               (unsigned long long)hist->counts[i]);
+        first = 0;
+    }
+
+    printf("]}");
+}
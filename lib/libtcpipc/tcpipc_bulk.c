@@ -0,0 +1,374 @@
+/*******************************************************************************
+ * @file    tcpipc_bulk.c
+ * @brief   Bulk transfers, see tcpipc_bulk.h.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <linux/errqueue.h>
+
+#include "tcpipc_bulk.h"
+
+/** Defines  **/
+#define TCPIPC_BULK_CTRL_LEN (128)
+
+/** Private Function Prototypes **/
+static uint32_t tcpipc_bulk_get32(const uint8_t *buf);
+static void tcpipc_bulk_put32(uint8_t *buf, uint32_t val);
+static int tcpipc_bulk_write_hdr(struct tcpipc_txq_t *txq, const uint8_t *hdr,
+                                 size_t hdr_len);
+
+/*******************************************************************************
+ * @brief   Writes the fragment header to buf.
+ *
+ * @return  TCPIPC_BULK_HDR_LEN
+ *******************************************************************************/
+size_t tcpipc_bulk_put_hdr(uint8_t *buf, uint32_t xfer, uint8_t msg_id,
+                           uint8_t flags, uint32_t total)
+{
+    tcpipc_bulk_put32(buf, xfer);
+    buf[4] = msg_id;
+    buf[5] = flags;
+    tcpipc_bulk_put32(buf + 6, total);
+
+    return TCPIPC_BULK_HDR_LEN;
+}
+
+/*******************************************************************************
+ * @brief   Turns on SO_ZEROCOPY for fd.
+ *
+ * @return  0 on success, -1 if the kernel does not support it
+ *******************************************************************************/
+int tcpipc_bulk_zerocopy_enable(int fd)
+{
+    int one = 1;
+
+    if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)))
+    {
+        perror("Failed to enable zero-copy sends");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Writes hdr and then len bytes of data to the socket of txq, the
+ *          data with MSG_ZEROCOPY. The header is copied: it lives on the
+ *          caller's stack and would be overwritten before the kernel is done
+ *          with it. Every call that queued data is counted in zc_calls, the
+ *          kernel reports one completion for each. When the socket runs out
+ *          of memory for pinning pages the call is repeated as a plain copy.
+ *          A full socket is waited for with tcpipc_txq_wait().
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+int tcpipc_bulk_sendzc(struct tcpipc_bulk_tx_t *tx, struct tcpipc_txq_t *txq,
+                       const uint8_t *hdr, size_t hdr_len,
+                       const uint8_t *data, size_t len)
+{
+    int flags = MSG_ZEROCOPY;
+    ssize_t ret;
+
+    if (tcpipc_bulk_write_hdr(txq, hdr, hdr_len))
+        return -1;
+
+    while (len)
+    {
+        ret = send(txq->fd, data, len, flags | MSG_NOSIGNAL | MSG_DONTWAIT);
+        tcpipc_stat_add(&txq->syscalls, 1);
+
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN && tcpipc_txq_wait(txq) == 0)
+                continue;
+
+            if (errno == ENOBUFS && flags)
+            {
+                flags = 0;
+                continue;
+            }
+
+            perror("Error while sending data");
+            return -1;
+        }
+
+        if (flags && ret > 0)
+        {
+            tx->zc_calls++;
+            tcpipc_stat_add(&tx->zc_bytes, ret);
+        }
+
+        flags = MSG_ZEROCOPY;
+        data += ret;
+        len -= ret;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Reads the zero-copy completions queued on fd without blocking.
+ *          A completion covers a range of sends; the ones the kernel had to
+ *          copy after all, as on loopback, are counted in zc_copied.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_bulk_reap(struct tcpipc_bulk_tx_t *tx, int fd)
+{
+    uint8_t ctrl[TCPIPC_BULK_CTRL_LEN];
+    struct sock_extended_err *serr;
+    struct cmsghdr *cmsg;
+    struct msghdr msg;
+    uint32_t count;
+
+    while (tx->zc_done != tx->zc_calls)
+    {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            break;
+        }
+
+        for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (!(cmsg->cmsg_level == SOL_IP &&
+                  cmsg->cmsg_type == IP_RECVERR) &&
+                !(cmsg->cmsg_level == SOL_IPV6 &&
+                  cmsg->cmsg_type == IPV6_RECVERR))
+                continue;
+
+            serr = (struct sock_extended_err *)CMSG_DATA(cmsg);
+
+            if (serr->ee_errno != 0 ||
+                serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+
+            count = serr->ee_data - serr->ee_info + 1;
+            tx->zc_done += count;
+
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                tcpipc_stat_add(&tx->zc_copied, count);
+        }
+    }
+}
+
+/*******************************************************************************
+ * @brief   Writes hdr and then len bytes of file_fd from off to the socket of
+ *          txq, the data with sendfile(). A full socket is waited for with
+ *          tcpipc_txq_wait().
+ *
+ * @return  0 on success, -1 on error or if the file ends early
+ *******************************************************************************/
+int tcpipc_bulk_write_file(struct tcpipc_txq_t *txq, const uint8_t *hdr,
+                           size_t hdr_len, int file_fd, off_t off, size_t len)
+{
+    ssize_t ret;
+
+    if (tcpipc_bulk_write_hdr(txq, hdr, hdr_len))
+        return -1;
+
+    while (len)
+    {
+        ret = sendfile(txq->fd, file_fd, &off, len);
+        tcpipc_stat_add(&txq->syscalls, 1);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        if (ret < 0 && errno == EAGAIN && tcpipc_txq_wait(txq) == 0)
+            continue;
+
+        if (ret < 0)
+        {
+            perror("Error while sending file");
+            return -1;
+        }
+
+        // The receiver waits for the announced length, the stream is lost
+        if (ret == 0)
+        {
+            printf("File ended before the announced length\n");
+            return -1;
+        }
+
+        len -= ret;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Adds one received fragment to the reassembly. Transfers longer
+ *          than max_len, cut short or out of order are dropped.
+ *
+ * @return  1 when rx->msg holds a complete message, which the caller then
+ *          owns, else 0
+ *******************************************************************************/
+int tcpipc_bulk_rx_frag(struct tcpipc_bulk_rx_t *rx, const uint8_t *data,
+                        uint32_t len, uint32_t max_len)
+{
+    uint32_t xfer, total;
+    uint8_t flags;
+
+    if (len < TCPIPC_BULK_HDR_LEN)
+    {
+        tcpipc_stat_add(&rx->drops, 1);
+        return 0;
+    }
+
+    xfer = tcpipc_bulk_get32(data);
+    flags = data[5];
+    total = tcpipc_bulk_get32(data + 6);
+
+    if (flags & TCPIPC_BULK_FIRST)
+    {
+        // The previous transfer never saw its last fragment
+        if (rx->active)
+        {
+            tcpipc_bulk_rx_free(rx);
+            tcpipc_stat_add(&rx->drops, 1);
+        }
+
+        rx->xfer = xfer;
+        rx->got = 0;
+        rx->skipping = 1;
+
+        if (total > max_len)
+        {
+            tcpipc_stat_add(&rx->drops, 1);
+            return 0;
+        }
+
+        memset(&rx->msg, 0, sizeof(struct msg_packet_t));
+        rx->msg.msg_id = data[4];
+        rx->msg.msg_len = total;
+
+        if (total && msg_packet_alloc(&rx->msg, total) == NULL)
+        {
+            tcpipc_stat_add(&rx->drops, 1);
+            return 0;
+        }
+
+        rx->active = 1;
+        rx->skipping = 0;
+    }
+    else if (!rx->active || xfer != rx->xfer)
+    {
+        if (!rx->skipping || xfer != rx->xfer)
+            tcpipc_stat_add(&rx->drops, 1);
+
+        return 0;
+    }
+
+    data += TCPIPC_BULK_HDR_LEN;
+    len -= TCPIPC_BULK_HDR_LEN;
+
+    if (len > rx->msg.msg_len - rx->got ||
+        ((flags & TCPIPC_BULK_LAST) && rx->got + len != rx->msg.msg_len))
+    {
+        tcpipc_bulk_rx_free(rx);
+        rx->skipping = 1;
+        tcpipc_stat_add(&rx->drops, 1);
+        return 0;
+    }
+
+    if (len)
+        memcpy(rx->msg.msg_data + rx->got, data, len);
+
+    rx->got += len;
+
+    if (!(flags & TCPIPC_BULK_LAST))
+        return 0;
+
+    rx->active = 0;
+    tcpipc_stat_add(&rx->msgs, 1);
+
+    return 1;
+}
+
+/*******************************************************************************
+ * @brief   Frees a transfer still being reassembled.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_bulk_rx_free(struct tcpipc_bulk_rx_t *rx)
+{
+    if (rx->active)
+        msg_packet_free(&rx->msg);
+
+    rx->active = 0;
+}
+
+/*******************************************************************************
+ * @brief   Reads a big endian 32 bit value.
+ *
+ * @return  Value
+ *******************************************************************************/
+static uint32_t tcpipc_bulk_get32(const uint8_t *buf)
+{
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) |
+           ((uint32_t)buf[2] << 8) | buf[3];
+}
+
+/*******************************************************************************
+ * @brief   Writes a big endian 32 bit value.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_bulk_put32(uint8_t *buf, uint32_t val)
+{
+    buf[0] = val >> 24;
+    buf[1] = val >> 16;
+    buf[2] = val >> 8;
+    buf[3] = val;
+}
+
+/*******************************************************************************
+ * @brief   Writes a fragment header with MSG_MORE, so it leaves in the same
+ *          segment as the start of the data that follows.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+static int tcpipc_bulk_write_hdr(struct tcpipc_txq_t *txq, const uint8_t *hdr,
+                                 size_t hdr_len)
+{
+    ssize_t ret;
+
+    while (hdr_len)
+    {
+        ret = send(txq->fd, hdr, hdr_len,
+                   MSG_MORE | MSG_NOSIGNAL | MSG_DONTWAIT);
+        tcpipc_stat_add(&txq->syscalls, 1);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        if (ret < 0 && errno == EAGAIN && tcpipc_txq_wait(txq) == 0)
+            continue;
+
+        if (ret < 0)
+        {
+            perror("Error while sending data");
+            return -1;
+        }
+
+        hdr += ret;
+        hdr_len -= ret;
+    }
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ * @file    tcpipc_bulk.h
+ * @brief   Bulk transfers. A buffer or file of any size up to 4 GiB is cut
+ *          into fragments carried by library frames and put back together
+ *          by the receive thread, which queues it as one message. On TCP the
+ *          fragments are written without copying them into the library:
+ *          files with sendfile(), buffers straight from the caller's memory
+ *          and optionally with MSG_ZEROCOPY, whose completions are read back
+ *          from the socket error queue.
+ *
+ *          Fragment payload: | transfer (4) | msg_id (1) | flags (1) |
+ *                            | total length (4) | data |, big endian
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_BULK_H
+#define TCPIPC_BULK_H
+
+/** Standard libraries **/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+/** Application specififc libraries **/
+#include "tcpipc_cb_fifo.h"
+#include "tcpipc_pool.h"
+#include "tcpipc_stats.h"
+#include "tcpipc_txq.h"
+
+/** Defines  **/
+#define TCPIPC_MSG_ID_BULK (0xF2)
+#define TCPIPC_BULK_HDR_LEN (10)
+#define TCPIPC_BULK_DEF_FRAG_LEN (16384)
+#define TCPIPC_BULK_FIRST (0x01)
+#define TCPIPC_BULK_LAST (0x02)
+#define TCPIPC_BULK_RETRY_USEC (100)
+
+/** User Data Types **/
+
+/*
+ * Transfer in progress on the sending side, owned by the application thread.
+ * The source is buf, or file_fd from file_off when buf is NULL. scratch
+ * holds a whole fragment for transports that take one contiguous payload.
+ * zc_calls counts MSG_ZEROCOPY sends, zc_done the completions read back;
+ * the caller's buffer is in use until the two match. epoch is the link the
+ * transfer started on, see tcpipc_resume_t.
+ */
+struct tcpipc_bulk_tx_t
+{
+    int active;
+    int last_sent;
+    uint32_t xfer;
+    uint8_t chan;
+    uint8_t msg_id;
+    const uint8_t *buf;
+    int file_fd;
+    off_t file_off;
+    uint32_t total;
+    uint32_t sent;
+    uint32_t frag_len;
+    uint8_t *scratch;
+    int zerocopy;
+    uint32_t zc_calls;
+    uint32_t zc_done;
+    unsigned int epoch;
+    atomic_uint_fast64_t bytes;
+    atomic_uint_fast64_t zc_bytes;
+    atomic_uint_fast64_t zc_copied;
+};
+
+/*
+ * Reassembly on the receive thread. msg collects the payload of transfer
+ * xfer; a transfer that can not be stored is skipped until the next one.
+ */
+struct tcpipc_bulk_rx_t
+{
+    int active;
+    int skipping;
+    uint32_t xfer;
+    uint32_t got;
+    struct msg_packet_t msg;
+    atomic_uint_fast64_t msgs;
+    atomic_uint_fast64_t drops;
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Writes the fragment header to buf.
+ *
+ * @return  TCPIPC_BULK_HDR_LEN
+ *******************************************************************************/
+size_t tcpipc_bulk_put_hdr(uint8_t *buf, uint32_t xfer, uint8_t msg_id,
+                           uint8_t flags, uint32_t total);
+
+/*******************************************************************************
+ * @brief   Turns on SO_ZEROCOPY for fd.
+ *
+ * @return  0 on success, -1 if the kernel does not support it
+ *******************************************************************************/
+int tcpipc_bulk_zerocopy_enable(int fd);
+
+/*******************************************************************************
+ * @brief   Writes hdr and then len bytes of data to the socket of txq, the
+ *          data with MSG_ZEROCOPY. Every call that queued data is counted in
+ *          zc_calls.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+int tcpipc_bulk_sendzc(struct tcpipc_bulk_tx_t *tx, struct tcpipc_txq_t *txq,
+                       const uint8_t *hdr, size_t hdr_len,
+                       const uint8_t *data, size_t len);
+
+/*******************************************************************************
+ * @brief   Reads the zero-copy completions queued on fd without blocking.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_bulk_reap(struct tcpipc_bulk_tx_t *tx, int fd);
+
+/*******************************************************************************
+ * @brief   Writes hdr and then len bytes of file_fd from off to the socket of
+ *          txq, the data with sendfile().
+ *
+ * @return  0 on success, -1 on error or if the file ends early
+ *******************************************************************************/
+int tcpipc_bulk_write_file(struct tcpipc_txq_t *txq, const uint8_t *hdr,
+                           size_t hdr_len, int file_fd, off_t off, size_t len);
+
+/*******************************************************************************
+ * @brief   Adds one received fragment to the reassembly. Transfers longer
+ *          than max_len, cut short or out of order are dropped.
+ *
+ * @return  1 when rx->msg holds a complete message, which the caller then
+ *          owns, else 0
+ *******************************************************************************/
+int tcpipc_bulk_rx_frag(struct tcpipc_bulk_rx_t *rx, const uint8_t *data,
+                        uint32_t len, uint32_t max_len);
+
+/*******************************************************************************
+ * @brief   Frees a transfer still being reassembled.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_bulk_rx_free(struct tcpipc_bulk_rx_t *rx);
+
+#endif // TCPIPC_BULK_H
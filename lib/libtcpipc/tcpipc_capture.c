@@ -0,0 +1,314 @@
+/*******************************************************************************
+ * @file    tcpipc_capture.c
+ * @brief   Traffic capture file, see tcpipc_capture.h.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tcpipc_capture.h"
+
+/** Private Function Prototypes **/
+static size_t tcpipc_capture_rec_size(uint32_t len);
+static int tcpipc_capture_write(int fd, const void *buf, size_t len);
+static void tcpipc_capture_fail(struct tcpipc_capture_t *cap);
+
+/*******************************************************************************
+ * @brief   Creates <dir>/tcpipc_capture.<pid>.<port>.<role>.bin and writes
+ *          its header. A NULL dir is the working directory.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_capture_open(struct tcpipc_capture_t *cap, const char *dir,
+                        int port, const char *role)
+{
+    struct tcpipc_capture_hdr_t hdr;
+
+    memset(cap, 0, sizeof(struct tcpipc_capture_t));
+    cap->fd = -1;
+
+    snprintf(cap->path, sizeof(cap->path), "%s/tcpipc_capture.%d.%d.%s.bin",
+             dir ? dir : ".", (int)getpid(), port, role);
+
+    cap->buf = (uint8_t *)malloc(TCPIPC_CAPTURE_BUF_SIZE);
+
+    if (cap->buf == NULL)
+    {
+        perror("Failed to allocate capture buffer");
+        return -1;
+    }
+
+    cap->fd = open(cap->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (cap->fd < 0)
+    {
+        perror(cap->path);
+        tcpipc_capture_close(cap);
+        return -1;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, TCPIPC_CAPTURE_MAGIC, sizeof(hdr.magic));
+    hdr.version = TCPIPC_CAPTURE_VERSION;
+    hdr.rec_size = sizeof(struct tcpipc_capture_rec_t);
+    hdr.start_ns = tcpipc_now_ns();
+
+    memcpy(cap->buf, &hdr, sizeof(hdr));
+    cap->len = sizeof(hdr);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Appends one message received at ns. Records are gathered in the
+ *          buffer, one larger than the buffer is written straight through.
+ *          A no-op on a closed capture.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_capture_frame(struct tcpipc_capture_t *cap, uint64_t ns,
+                          uint8_t msg_id, uint8_t msg_chan,
+                          const uint8_t *data, uint32_t len)
+{
+    static const uint8_t pad[TCPIPC_CAPTURE_ALIGN];
+    struct tcpipc_capture_rec_t rec;
+    size_t size = tcpipc_capture_rec_size(len);
+
+    if (cap->fd < 0)
+        return;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.ns = ns;
+    rec.msg_len = len;
+    rec.msg_id = msg_id;
+    rec.msg_chan = msg_chan;
+
+    if (cap->len + size > TCPIPC_CAPTURE_BUF_SIZE &&
+        tcpipc_capture_flush(cap))
+        return;
+
+    if (size > TCPIPC_CAPTURE_BUF_SIZE)
+    {
+        if (tcpipc_capture_write(cap->fd, &rec, sizeof(rec)) ||
+            tcpipc_capture_write(cap->fd, data, len) ||
+            tcpipc_capture_write(cap->fd, pad, size - sizeof(rec) - len))
+        {
+            tcpipc_capture_fail(cap);
+            return;
+        }
+    }
+    else
+    {
+        memcpy(cap->buf + cap->len, &rec, sizeof(rec));
+
+        if (len)
+            memcpy(cap->buf + cap->len + sizeof(rec), data, len);
+
+        memset(cap->buf + cap->len + sizeof(rec) + len, 0,
+               size - sizeof(rec) - len);
+        cap->len += size;
+    }
+
+    tcpipc_stat_add(&cap->frames, 1);
+    tcpipc_stat_add(&cap->bytes, len);
+}
+
+/*******************************************************************************
+ * @brief   Writes buffered records to the file.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+int tcpipc_capture_flush(struct tcpipc_capture_t *cap)
+{
+    if (cap->fd < 0)
+        return -1;
+
+    if (tcpipc_capture_write(cap->fd, cap->buf, cap->len))
+    {
+        tcpipc_capture_fail(cap);
+        return -1;
+    }
+
+    cap->len = 0;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Flushes and closes the capture.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_capture_close(struct tcpipc_capture_t *cap)
+{
+    if (cap->fd >= 0)
+    {
+        tcpipc_capture_flush(cap);
+
+        if (cap->fd >= 0)
+            close(cap->fd);
+    }
+
+    cap->fd = -1;
+    free(cap->buf);
+    cap->buf = NULL;
+}
+
+/*******************************************************************************
+ * @brief   Maps a capture file for reading and checks its header.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_capture_map(struct tcpipc_capture_map_t *map, const char *path)
+{
+    const struct tcpipc_capture_hdr_t *hdr;
+    struct stat st;
+    void *base;
+    int fd;
+
+    memset(map, 0, sizeof(struct tcpipc_capture_map_t));
+
+    fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+    {
+        perror(path);
+        return -1;
+    }
+
+    if (fstat(fd, &st) || st.st_size < (off_t)sizeof(*hdr))
+    {
+        printf("%s: Not a capture file\n", path);
+        close(fd);
+        return -1;
+    }
+
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED)
+    {
+        perror(path);
+        return -1;
+    }
+
+    hdr = (const struct tcpipc_capture_hdr_t *)base;
+
+    if (memcmp(hdr->magic, TCPIPC_CAPTURE_MAGIC, sizeof(hdr->magic)) ||
+        hdr->version != TCPIPC_CAPTURE_VERSION ||
+        hdr->rec_size != sizeof(struct tcpipc_capture_rec_t))
+    {
+        printf("%s: Not a capture file of this version\n", path);
+        munmap(base, st.st_size);
+        return -1;
+    }
+
+    // Read front to back once
+    madvise(base, st.st_size, MADV_SEQUENTIAL);
+
+    map->base = (const uint8_t *)base;
+    map->size = st.st_size;
+    map->pos = sizeof(*hdr);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Returns the next record, its payload in *data. A record cut short
+ *          by the end of the file ends the capture.
+ *
+ * @return  Record, NULL at the end
+ *******************************************************************************/
+const struct tcpipc_capture_rec_t *
+tcpipc_capture_next(struct tcpipc_capture_map_t *map, const uint8_t **data)
+{
+    const struct tcpipc_capture_rec_t *rec;
+
+    if (map->size - map->pos < sizeof(*rec))
+        return NULL;
+
+    rec = (const struct tcpipc_capture_rec_t *)(map->base + map->pos);
+
+    if (map->size - map->pos - sizeof(*rec) < rec->msg_len)
+        return NULL;
+
+    *data = map->base + map->pos + sizeof(*rec);
+    map->pos += tcpipc_capture_rec_size(rec->msg_len);
+
+    // The last record may lack its padding
+    if (map->pos > map->size)
+        map->pos = map->size;
+
+    return rec;
+}
+
+/*******************************************************************************
+ * @brief   Unmaps a capture file.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_capture_unmap(struct tcpipc_capture_map_t *map)
+{
+    if (map->base)
+        munmap((void *)map->base, map->size);
+
+    map->base = NULL;
+}
+
+/*******************************************************************************
+ * @brief   Space a record with len payload bytes takes in the file.
+ *
+ * @return  Record size
+ *******************************************************************************/
+static size_t tcpipc_capture_rec_size(uint32_t len)
+{
+    return (sizeof(struct tcpipc_capture_rec_t) + (size_t)len +
+            TCPIPC_CAPTURE_ALIGN - 1) &
+           ~(size_t)(TCPIPC_CAPTURE_ALIGN - 1);
+}
+
+/*******************************************************************************
+ * @brief   write() that finishes short writes.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int tcpipc_capture_write(int fd, const void *buf, size_t len)
+{
+    const uint8_t *ptr = (const uint8_t *)buf;
+    ssize_t ret;
+
+    while (len)
+    {
+        ret = write(fd, ptr, len);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        if (ret <= 0)
+            return -1;
+
+        ptr += ret;
+        len -= ret;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Ends the capture after a write error, what was written stays
+ *          readable.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_capture_fail(struct tcpipc_capture_t *cap)
+{
+    perror("Capture stopped");
+    close(cap->fd);
+    cap->fd = -1;
+    cap->len = 0;
+}
@@ -0,0 +1,142 @@
+/*******************************************************************************
+ * @file    tcpipc_capture.h
+ * @brief   Traffic capture. The receive thread appends every message it
+ *          accepts to a capture file with its arrival time, the replay tool
+ *          plays the file back into an endpoint. Writes are buffered and go
+ *          out in large chunks.
+ *
+ *          Capture file: | tcpipc_capture_hdr_t | record... |, a record is
+ *          | tcpipc_capture_rec_t | payload | padding to 8 bytes |, in host
+ *          byte order. Every record starts 8 byte aligned, so a mapped file
+ *          is read in place.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_CAPTURE_H
+#define TCPIPC_CAPTURE_H
+
+/** Standard libraries **/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+/** Application specififc libraries **/
+#include "tcpipc_txq.h"
+
+/** Defines  **/
+#define TCPIPC_CAPTURE_MAGIC "TCPIPCCP"
+#define TCPIPC_CAPTURE_VERSION (1)
+#define TCPIPC_CAPTURE_ALIGN (8)
+#define TCPIPC_CAPTURE_BUF_SIZE (65536)
+#define TCPIPC_CAPTURE_PATH_MAX (256)
+
+/** User Data Types **/
+
+/*
+ * File header. start_ns is tcpipc_now_ns() when the capture was opened.
+ */
+struct tcpipc_capture_hdr_t
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t rec_size;
+    uint64_t start_ns;
+};
+
+/*
+ * Record header, msg_len payload bytes follow.
+ */
+struct tcpipc_capture_rec_t
+{
+    uint64_t ns;
+    uint32_t msg_len;
+    uint8_t msg_id;
+    uint8_t msg_chan;
+    uint16_t reserved;
+};
+
+/*
+ * Writer, owned by the receive thread. A write error ends the capture,
+ * fd is then -1.
+ */
+struct tcpipc_capture_t
+{
+    int fd;
+    uint8_t *buf;
+    size_t len;
+    atomic_uint_fast64_t frames;
+    atomic_uint_fast64_t bytes;
+    char path[TCPIPC_CAPTURE_PATH_MAX];
+};
+
+/*
+ * Capture file mapped for reading, pos is the offset of the next record.
+ */
+struct tcpipc_capture_map_t
+{
+    const uint8_t *base;
+    size_t size;
+    size_t pos;
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Creates <dir>/tcpipc_capture.<pid>.<port>.<role>.bin and writes
+ *          its header. A NULL dir is the working directory.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_capture_open(struct tcpipc_capture_t *cap, const char *dir,
+                        int port, const char *role);
+
+/*******************************************************************************
+ * @brief   Appends one message received at ns. A no-op on a closed capture.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_capture_frame(struct tcpipc_capture_t *cap, uint64_t ns,
+                          uint8_t msg_id, uint8_t msg_chan,
+                          const uint8_t *data, uint32_t len);
+
+/*******************************************************************************
+ * @brief   Writes buffered records to the file.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+int tcpipc_capture_flush(struct tcpipc_capture_t *cap);
+
+/*******************************************************************************
+ * @brief   Flushes and closes the capture.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_capture_close(struct tcpipc_capture_t *cap);
+
+/*******************************************************************************
+ * @brief   Maps a capture file for reading and checks its header.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_capture_map(struct tcpipc_capture_map_t *map, const char *path);
+
+/*******************************************************************************
+ * @brief   Returns the next record, its payload in *data. A record cut short
+ *          by the end of the file ends the capture.
+ *
+ * @return  Record, NULL at the end
+ *******************************************************************************/
+const struct tcpipc_capture_rec_t *
+tcpipc_capture_next(struct tcpipc_capture_map_t *map, const uint8_t **data);
+
+/*******************************************************************************
+ * @brief   Unmaps a capture file.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_capture_unmap(struct tcpipc_capture_map_t *map);
+
+#endif // TCPIPC_CAPTURE_H
@@ -5,99 +5,967 @@
  * @author  Ajay Kandagal <ajka9053@colorado.edu>
  * @date    Apr 12th 2023
  *******************************************************************************/
+#include <errno.h>
+#include <stddef.h>
+#include <poll.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/eventfd.h>
+
 #include "tcpipc_cb_fifo.h"
+#include "tcpipc_pool.h"
+#include "tcpipc_futex.h"
+
+/** Private Function Prototypes **/
+static uint64_t recv_msg_cb_now_ns();
+static void recv_msg_cb_stamp(struct recv_msg_cb_t *cb, size_t tail,
+                              struct recv_msg_stamp_t *stamp);
+static void recv_msg_cb_account(struct recv_msg_cb_t *cb,
+                                const struct recv_msg_stamp_t *stamp,
+                                const struct msg_packet_t *msg);
+static int recv_msg_cb_ready(struct recv_msg_cb_t *cb, size_t tail);
+static int recv_msg_cb_has_space(struct recv_msg_cb_t *cb, size_t head);
+static struct msg_packet_t *recv_msg_cb_take(struct recv_msg_cb_t *cb);
+static void recv_msg_cb_released(struct recv_msg_cb_t *cb);
+static int recv_msg_cb_wait_space(struct recv_msg_cb_t *cb, size_t head);
+static void recv_msg_cb_wake_producer(struct recv_msg_cb_t *cb);
+static int recv_msg_cb_grow(struct recv_msg_cb_t *cb, size_t head);
+static void recv_msg_cb_adopt(struct recv_msg_cb_t *cb, size_t tail);
+static void recv_msg_cb_resolve(struct recv_msg_cb_t *cb,
+                                struct msg_packet_t *slot);
+
+/*******************************************************************************
+ * @brief   Initializes a receive queue instance holding at least len messages.
+ *          The capacity is rounded up to the next power of two.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int recv_msg_cb_init(struct recv_msg_cb_t *cb, size_t len)
+{
+    size_t capacity = 1;
+
+    while (capacity < len)
+        capacity <<= 1;
+
+    memset(cb, 0, sizeof(struct recv_msg_cb_t));
+    cb->event_fd = -1;
+
+    cb->msg_array = (struct msg_packet_t *)
+        calloc(capacity, sizeof(struct msg_packet_t));
+
+    if (cb->msg_array == NULL)
+        return -1;
+
+    cb->capacity = capacity;
+    cb->mask = capacity - 1;
+    cb->max_capacity = capacity;
+    cb->wr_array = cb->msg_array;
+    cb->wr_capacity = capacity;
+    cb->overflow = RECV_MSG_OVERFLOW_DROP_NEWEST;
+    atomic_init(&cb->head, 0);
+    atomic_init(&cb->tail, 0);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Releases a receive queue instance and any payload still queued.
+ *
+ * @return
+ *******************************************************************************/
+void recv_msg_cb_close(struct recv_msg_cb_t *cb)
+{
+    size_t head = atomic_load_explicit(&cb->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&cb->tail, memory_order_relaxed);
+
+    if (cb->msg_array == NULL)
+        return;
 
-#define INCREMENT_CB_POINTER(ptr)       \
-    {                                   \
-        ptr++;                          \
-        if (ptr >= RECV_MESSAGE_CB_LEN) \
-            ptr = 0;                    \
+    for (; tail != head; tail++)
+    {
+        recv_msg_cb_adopt(cb, tail);
+        msg_packet_free(&cb->msg_array[tail & cb->mask]);
     }
 
-static struct recv_msg_cb_t recv_msg_cb;
+    // Rings grown for a reserved slot that was never published
+    while (cb->msg_array != cb->wr_array)
+        recv_msg_cb_adopt(cb, head);
+
+    if (cb->held_valid)
+        msg_packet_free(&cb->held);
+
+    cb->held_valid = 0;
+
+    free(cb->msg_array);
+    cb->msg_array = NULL;
+    cb->wr_array = NULL;
+    free(cb->stamp_array);
+    cb->stamp_array = NULL;
+    cb->wr_stamps = NULL;
+    free(cb->rd_seg);
+    cb->rd_seg = NULL;
+    cb->wr_seg = NULL;
+    atomic_store(&cb->grow_next, NULL);
+    free(cb->trace_log);
+    cb->trace_log = NULL;
+    free(cb->latest);
+    cb->latest = NULL;
+
+    if (cb->event_fd >= 0)
+    {
+        close(cb->event_fd);
+        cb->event_fd = -1;
+    }
+}
 
 /*******************************************************************************
- * @brief
+ * @brief   Adds a message to the given queue. Must only be called from the
+ *          single producer thread.
+ *
+ * @return  0 on success, -1 if the queue is full
+ *******************************************************************************/
+int recv_msg_cb_enqueue(struct recv_msg_cb_t *cb, struct msg_packet_t *msg)
+{
+    struct msg_packet_t *slot = recv_msg_cb_reserve(cb);
+
+    if (slot == NULL)
+        return -1;
+
+    *slot = *msg;
+
+    if (slot->msg_storage == MSG_STORAGE_INLINE)
+        slot->msg_data = slot->msg_inline;
+
+    recv_msg_cb_publish(cb);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Removes the oldest message from the given queue. Must only be
+ *          called from the single consumer thread.
+ *
+ * @return  0 on success, -1 if the queue is empty
+ *******************************************************************************/
+int recv_msg_cb_dequeue(struct recv_msg_cb_t *cb, struct msg_packet_t *msg)
+{
+    struct msg_packet_t *slot = recv_msg_cb_peek(cb);
+    struct recv_msg_stamp_t stamp;
+    size_t tail;
+
+    if (slot == NULL)
+        return -1;
+
+    *msg = *slot;
+
+    // Inline payload moved with the copy, repoint at the caller's storage
+    if (msg->msg_storage == MSG_STORAGE_INLINE)
+        msg->msg_data = msg->msg_inline;
+
+    if (slot == &cb->held)
+    {
+        cb->held_valid = 0;
+        return 0;
+    }
+
+    tail = atomic_load_explicit(&cb->tail, memory_order_relaxed);
+    recv_msg_cb_stamp(cb, tail, &stamp);
+    recv_msg_cb_account(cb, &stamp, msg);
+    atomic_store_explicit(&cb->tail, tail + 1, memory_order_release);
+    recv_msg_cb_released(cb);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Returns the next free slot so the producer can build a message in
+ *          place. The slot becomes visible with recv_msg_cb_publish().
+ *
+ * @return  Slot pointer, NULL if the queue is full
+ *******************************************************************************/
+struct msg_packet_t *recv_msg_cb_reserve(struct recv_msg_cb_t *cb)
+{
+    size_t head = atomic_load_explicit(&cb->head, memory_order_relaxed);
+    struct msg_packet_t *drop;
+    size_t tail, rounds;
+
+    if (recv_msg_cb_has_space(cb, head))
+        return &cb->wr_array[head & (cb->wr_capacity - 1)];
+
+    cb->tail_cache = atomic_load_explicit(&cb->tail, memory_order_acquire);
+
+    if (recv_msg_cb_has_space(cb, head))
+        return &cb->wr_array[head & (cb->wr_capacity - 1)];
+
+    switch (cb->overflow)
+    {
+    case RECV_MSG_OVERFLOW_DROP_OLDEST:
+        for (rounds = 0; rounds < cb->capacity; rounds++)
+        {
+            tail = cb->tail_cache;
+
+            // Loses the race only when the consumer just took the oldest
+            if (!atomic_compare_exchange_strong(&cb->tail, &tail, tail + 1))
+            {
+                cb->tail_cache = tail;
+                break;
+            }
+
+            cb->tail_cache = tail + 1;
+            drop = &cb->msg_array[tail & cb->mask];
+
+            if (drop->msg_storage != MSG_STORAGE_LATEST)
+            {
+                msg_packet_free(drop);
+                tcpipc_stat_add(&cb->drop_oldest, 1);
+                break;
+            }
+
+            // A token stands for a value that is not queued anywhere else.
+            // In a full ring its slot is the one at head, so it goes back in
+            // as the newest message without moving and the next is evicted.
+            head++;
+            atomic_store_explicit(&cb->head, head, memory_order_release);
+        }
+
+        // Nothing but tokens queued, the new message is dropped instead
+        if (rounds == cb->capacity)
+            return NULL;
+        break;
+    case RECV_MSG_OVERFLOW_BLOCK:
+        tcpipc_stat_add(&cb->block_waits, 1);
+
+        if (recv_msg_cb_wait_space(cb, head))
+            return NULL;
+        break;
+    case RECV_MSG_OVERFLOW_GROW:
+        if (cb->wr_capacity >= cb->max_capacity || recv_msg_cb_grow(cb, head))
+            return NULL;
+        break;
+    default:
+        return NULL;
+    }
+
+    return &cb->wr_array[head & (cb->wr_capacity - 1)];
+}
+
+/*******************************************************************************
+ * @brief   Publishes the slot returned by recv_msg_cb_reserve().
  *
  * @return
  *******************************************************************************/
-void recv_msg_init()
+void recv_msg_cb_publish(struct recv_msg_cb_t *cb)
+{
+    size_t head = atomic_load_explicit(&cb->head, memory_order_relaxed);
+    uint64_t one = 1;
+    size_t tail;
+
+    if (cb->wr_stamps)
+    {
+        cb->wr_stamps[head & (cb->wr_capacity - 1)] = cb->next_stamp;
+        cb->wr_stamps[head & (cb->wr_capacity - 1)].enqueue_ns =
+            recv_msg_cb_now_ns();
+    }
+
+    atomic_store_explicit(&cb->head, head + 1, memory_order_release);
+
+    // Pairs with the fence in recv_msg_cb_peek(), see recv_msg_cb_t
+    if (cb->event_fd >= 0)
+        atomic_thread_fence(memory_order_seq_cst);
+
+    tail = atomic_load_explicit(&cb->tail, memory_order_relaxed);
+    tcpipc_stat_max(&cb->high_water, head + 1 - tail);
+
+    if (cb->event_fd < 0)
+        return;
+
+    if (tail == head)
+    {
+        if (write(cb->event_fd, &one, sizeof(one)) != sizeof(one))
+            return;
+
+        atomic_store_explicit(&cb->event_pending, 1, memory_order_release);
+    }
+}
+
+/*******************************************************************************
+ * @brief   Returns the oldest message without removing it. The slot and its
+ *          payload stay valid until recv_msg_cb_consume().
+ *
+ * @return  Slot pointer, NULL if the queue is empty
+ *******************************************************************************/
+struct msg_packet_t *recv_msg_cb_peek(struct recv_msg_cb_t *cb)
 {
-    memset(&recv_msg_cb, 0, sizeof(struct recv_msg_cb_t));
+    size_t tail = atomic_load_explicit(&cb->tail, memory_order_relaxed);
+    struct msg_packet_t *slot;
+
+    if (cb->overflow == RECV_MSG_OVERFLOW_DROP_OLDEST)
+        slot = recv_msg_cb_take(cb);
+    else if (recv_msg_cb_ready(cb, tail))
+        slot = &cb->msg_array[tail & cb->mask];
+    else
+        slot = NULL;
 
-    pthread_mutex_init(&recv_msg_cb.lock, NULL);
+    if (slot == NULL)
+        return NULL;
+
+    if (slot->msg_storage == MSG_STORAGE_LATEST)
+        recv_msg_cb_resolve(cb, slot);
+
+    return slot;
 }
 
 /*******************************************************************************
- * @brief
+ * @brief   Releases the payload of the slot returned by recv_msg_cb_peek() and
+ *          removes it from the queue.
  *
  * @return
  *******************************************************************************/
-void recv_msg_close()
+void recv_msg_cb_consume(struct recv_msg_cb_t *cb)
 {
-    for (int i = 0; i < RECV_MESSAGE_CB_LEN; i++)
+    size_t tail = atomic_load_explicit(&cb->tail, memory_order_relaxed);
+    struct recv_msg_stamp_t stamp;
+
+    if (cb->held_valid)
     {
-        if (recv_msg_cb.msg_array[i].msg_data)
-            free(recv_msg_cb.msg_array[i].msg_data);
+        msg_packet_free(&cb->held);
+        cb->held_valid = 0;
+        return;
     }
 
-    pthread_mutex_destroy(&recv_msg_cb.lock);
+    recv_msg_cb_stamp(cb, tail, &stamp);
+    recv_msg_cb_account(cb, &stamp, &cb->msg_array[tail & cb->mask]);
+    msg_packet_free(&cb->msg_array[tail & cb->mask]);
+    atomic_store_explicit(&cb->tail, tail + 1, memory_order_release);
+    recv_msg_cb_released(cb);
 }
 
 /*******************************************************************************
- * @brief
+ * @brief   Attaches an eventfd to the queue which becomes readable when the
+ *          queue turns non-empty.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int recv_msg_cb_init_event(struct recv_msg_cb_t *cb)
+{
+    cb->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (cb->event_fd < 0)
+        return -1;
+
+    atomic_init(&cb->event_pending, 0);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Enables enqueue timestamps so the time messages spend in the queue
+ *          is accounted in the dwell counters.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int recv_msg_cb_init_stamps(struct recv_msg_cb_t *cb)
+{
+    cb->stamp_array = (struct recv_msg_stamp_t *)
+        calloc(cb->capacity, sizeof(struct recv_msg_stamp_t));
+    cb->wr_stamps = cb->stamp_array;
+
+    return cb->stamp_array ? 0 : -1;
+}
+
+/*******************************************************************************
+ * @brief   Sets the sender and kernel receive timestamps recorded with the
+ *          next published message. Producer only.
  *
  * @return
  *******************************************************************************/
-int recv_msg_enqueue(struct msg_packet_t *msg)
+void recv_msg_cb_stage_stamp(struct recv_msg_cb_t *cb, uint64_t send_ns,
+                             uint64_t kernel_rx_ns)
+{
+    cb->next_stamp.send_ns = send_ns;
+    cb->next_stamp.kernel_rx_ns = kernel_rx_ns;
+}
+
+/*******************************************************************************
+ * @brief   Keeps the latency breakdown of the last len consumed messages.
+ *          Needs stamps enabled with recv_msg_cb_init_stamps().
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int recv_msg_cb_init_trace(struct recv_msg_cb_t *cb, size_t len)
 {
-    pthread_mutex_lock(&recv_msg_cb.lock);
+    if (len == 0)
+        return -1;
+
+    cb->trace_log = (struct recv_msg_trace_t *)
+        calloc(len, sizeof(struct recv_msg_trace_t));
 
-    if (recv_msg_cb.length == RECV_MESSAGE_CB_LEN)
+    if (cb->trace_log == NULL)
+        return -1;
+
+    cb->trace_len = len;
+    cb->trace_head = 0;
+    cb->trace_count = 0;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Moves up to max trace records, oldest first, into recs. Consumer
+ *          only.
+ *
+ * @return  Number of records copied
+ *******************************************************************************/
+int recv_msg_cb_read_trace(struct recv_msg_cb_t *cb,
+                           struct recv_msg_trace_t *recs, int max)
+{
+    size_t first;
+    int count = 0;
+
+    if (cb->trace_log == NULL)
+        return 0;
+
+    first = cb->trace_head - cb->trace_count;
+
+    while (count < max && cb->trace_count)
     {
-        pthread_mutex_unlock(&recv_msg_cb.lock);
+        recs[count++] = cb->trace_log[(first++) % cb->trace_len];
+        cb->trace_count--;
+    }
+
+    return count;
+}
+
+/*******************************************************************************
+ * @brief   Selects what happens when the queue is full. max_len bounds the
+ *          capacity GROW may reach, rounded up to a power of two. Must be
+ *          called before the queue is used.
+ *
+ * @return  0 on success, -1 on invalid arguments
+ *******************************************************************************/
+int recv_msg_cb_set_overflow(struct recv_msg_cb_t *cb,
+                             enum recv_msg_overflow_e overflow,
+                             size_t max_len)
+{
+    size_t max_capacity = cb->capacity;
+
+    if (overflow > RECV_MSG_OVERFLOW_GROW)
+        return -1;
+
+    while (max_capacity < max_len)
+        max_capacity <<= 1;
+
+    cb->overflow = overflow;
+    cb->max_capacity = max_capacity;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Releases a producer parked by the BLOCK or GROW policy and makes
+ *          further waits fail, e.g. on disconnect.
+ *
+ * @return
+ *******************************************************************************/
+void recv_msg_cb_unblock(struct recv_msg_cb_t *cb)
+{
+    atomic_store(&cb->closing, 1);
+    atomic_fetch_add(&cb->space_seq, 1);
+    tcpipc_futex_wake(&cb->space_seq);
+}
+
+/*******************************************************************************
+ * @brief   Enables conflating mode. No msg_id is conflated until it is
+ *          switched on with recv_msg_cb_set_conflate().
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int recv_msg_cb_init_conflate(struct recv_msg_cb_t *cb)
+{
+    cb->latest = (struct recv_msg_latest_t *)
+        calloc(256, sizeof(struct recv_msg_latest_t));
+
+    return cb->latest ? 0 : -1;
+}
+
+/*******************************************************************************
+ * @brief   Switches conflation of msg_id on or off. May be called while the
+ *          queue is in use.
+ *
+ * @return  0 on success, -1 if conflating mode is not enabled
+ *******************************************************************************/
+int recv_msg_cb_set_conflate(struct recv_msg_cb_t *cb, uint8_t msg_id,
+                             int enable)
+{
+    if (cb->latest == NULL)
+        return -1;
+
+    atomic_store_explicit(&cb->latest[msg_id].enabled, enable != 0,
+                          memory_order_relaxed);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Producer side of conflating mode. Stores the newest value of a
+ *          conflated msg_id, received on channel chan, and queues a token
+ *          unless one is pending.
+ *
+ * @return  0 when stored, 1 if msg_id is not conflated (or the payload is
+ *          too large) and must be queued normally, -1 if the queue is full
+ *******************************************************************************/
+int recv_msg_cb_put_latest(struct recv_msg_cb_t *cb, uint8_t msg_id,
+                           uint8_t chan, const uint8_t *data, uint32_t len)
+{
+    struct recv_msg_latest_t *latest;
+    struct msg_packet_t *slot;
+    unsigned int seq;
+
+    if (cb->latest == NULL || len > RECV_MSG_LATEST_MAX)
+        return 1;
+
+    latest = &cb->latest[msg_id];
+
+    if (!atomic_load_explicit(&latest->enabled, memory_order_relaxed))
+        return 1;
+
+    seq = atomic_load_explicit(&latest->seq, memory_order_relaxed);
+    atomic_store_explicit(&latest->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    latest->chan = chan;
+    latest->len = len;
+    memcpy(latest->data, data, len);
+
+    atomic_store_explicit(&latest->seq, seq + 2, memory_order_release);
+
+    // A token is already queued, the consumer will pick up this value
+    if (atomic_exchange(&latest->pending, 1))
+        return 0;
+
+    slot = recv_msg_cb_reserve(cb);
+
+    if (slot == NULL)
+    {
+        atomic_store(&latest->pending, 0);
         return -1;
     }
 
-    if (recv_msg_cb.msg_array[recv_msg_cb.wptr].msg_data)
+    slot->msg_id = msg_id;
+    slot->msg_chan = chan;
+    slot->msg_storage = MSG_STORAGE_LATEST;
+    slot->msg_len = 0;
+    slot->msg_data = NULL;
+
+    recv_msg_cb_publish(cb);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Blocks until the queue may be non-empty or timeout_ms expires.
+ *          A negative timeout waits forever.
+ *
+ * @return  0 when woken, -1 on timeout or error
+ *******************************************************************************/
+int recv_msg_cb_wait(struct recv_msg_cb_t *cb, int timeout_ms)
+{
+    struct pollfd pfd;
+    uint64_t count;
+    int ret;
+
+    if (recv_msg_cb_peek(cb))
+        return 0;
+
+    if (cb->event_fd < 0)
+        return -1;
+
+    pfd.fd = cb->event_fd;
+    pfd.events = POLLIN;
+
+    do
     {
-        free(recv_msg_cb.msg_array[recv_msg_cb.wptr].msg_data);
-        recv_msg_cb.msg_array[recv_msg_cb.wptr].msg_data = NULL;
+        ret = poll(&pfd, 1, timeout_ms);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret <= 0)
+        return -1;
+
+    if (read(cb->event_fd, &count, sizeof(count)) < 0)
+        count = 0;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Wakes a consumer blocked in recv_msg_cb_wait(), e.g. on disconnect.
+ *
+ * @return
+ *******************************************************************************/
+void recv_msg_cb_notify(struct recv_msg_cb_t *cb)
+{
+    uint64_t one = 1;
+
+    if (cb->event_fd < 0)
+        return;
+
+    if (write(cb->event_fd, &one, sizeof(one)) == sizeof(one))
+        atomic_store_explicit(&cb->event_pending, 1, memory_order_release);
+}
+
+/*******************************************************************************
+ * @brief   Monotonic clock in nanoseconds.
+ *
+ * @return
+ *******************************************************************************/
+static uint64_t recv_msg_cb_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*******************************************************************************
+ * @brief   Copies the stamps of the message at tail, all zero when stamps are
+ *          disabled.
+ *
+ * @return
+ *******************************************************************************/
+static void recv_msg_cb_stamp(struct recv_msg_cb_t *cb, size_t tail,
+                              struct recv_msg_stamp_t *stamp)
+{
+    if (cb->stamp_array)
+        *stamp = cb->stamp_array[tail & cb->mask];
+    else
+        memset(stamp, 0, sizeof(struct recv_msg_stamp_t));
+}
+
+/*******************************************************************************
+ * @brief   Accounts the dwell time of msg, enqueued with stamp, and adds it to
+ *          the trace log. Called by the consumer before the slot is handed
+ *          back.
+ *
+ * @return
+ *******************************************************************************/
+static void recv_msg_cb_account(struct recv_msg_cb_t *cb,
+                                const struct recv_msg_stamp_t *stamp,
+                                const struct msg_packet_t *msg)
+{
+    struct recv_msg_trace_t *rec;
+    uint64_t now, dwell;
+
+    if (stamp->enqueue_ns == 0)
+        return;
+
+    now = recv_msg_cb_now_ns();
+    dwell = now - stamp->enqueue_ns;
+
+    tcpipc_stat_add(&cb->dwell_count, 1);
+    tcpipc_stat_add(&cb->dwell_total_ns, dwell);
+    tcpipc_stat_max(&cb->dwell_max_ns, dwell);
+
+    if (cb->trace_log == NULL)
+        return;
+
+    // Full log, the oldest record is overwritten
+    rec = &cb->trace_log[(cb->trace_head++) % cb->trace_len];
+
+    if (cb->trace_count < cb->trace_len)
+        cb->trace_count++;
+
+    rec->msg_id = msg->msg_id;
+    rec->msg_len = msg->msg_len;
+    rec->send_ns = stamp->send_ns;
+    rec->kernel_rx_ns = stamp->kernel_rx_ns;
+    rec->enqueue_ns = stamp->enqueue_ns;
+    rec->dequeue_ns = now;
+}
+
+/*******************************************************************************
+ * @brief   Replaces a conflation token with the newest value of its msg_id.
+ *          Called by the consumer only.
+ *
+ * @return
+ *******************************************************************************/
+static void recv_msg_cb_resolve(struct recv_msg_cb_t *cb,
+                                struct msg_packet_t *slot)
+{
+    struct recv_msg_latest_t *latest = &cb->latest[slot->msg_id];
+    uint8_t data[RECV_MSG_LATEST_MAX];
+    unsigned int seq;
+    uint32_t len;
+    uint8_t chan;
+
+    // Cleared before reading, a newer update queues its own token
+    atomic_store(&latest->pending, 0);
+
+    do
+    {
+        seq = atomic_load_explicit(&latest->seq, memory_order_acquire);
+
+        if (seq & 1)
+            continue;
+
+        chan = latest->chan;
+        len = latest->len;
+
+        if (len > RECV_MSG_LATEST_MAX)
+            len = RECV_MSG_LATEST_MAX;
+
+        memcpy(data, latest->data, len);
+        atomic_thread_fence(memory_order_acquire);
+    } while ((seq & 1) ||
+             seq != atomic_load_explicit(&latest->seq, memory_order_relaxed));
+
+    slot->msg_storage = MSG_STORAGE_NONE;
+    slot->msg_chan = chan;
+    slot->msg_len = len;
+
+    if (msg_packet_alloc(slot, len))
+        memcpy(slot->msg_data, data, len);
+    else
+        slot->msg_len = 0;
+}
+
+/*******************************************************************************
+ * @brief   Checks whether a message is pending at tail, draining the eventfd
+ *          when the queue is found empty. Called by the consumer only.
+ *
+ * @return  1 if a message is pending, 0 if the queue is empty
+ *******************************************************************************/
+static int recv_msg_cb_ready(struct recv_msg_cb_t *cb, size_t tail)
+{
+    uint64_t count;
+
+    // Signed, with DROP_OLDEST the producer can move tail past head_cache
+    if ((ptrdiff_t)(cb->head_cache - tail) > 0)
+    {
+        recv_msg_cb_adopt(cb, tail);
+        return 1;
     }
 
-    memcpy(&recv_msg_cb.msg_array[recv_msg_cb.wptr], msg,
-           sizeof(struct msg_packet_t));
-    INCREMENT_CB_POINTER(recv_msg_cb.wptr);
-    recv_msg_cb.length++;
+    cb->head_cache = atomic_load_explicit(&cb->head, memory_order_acquire);
+
+    if (cb->head_cache == tail && cb->event_fd >= 0)
+    {
+        if (atomic_exchange_explicit(&cb->event_pending, 0,
+                                     memory_order_acquire))
+        {
+            if (read(cb->event_fd, &count, sizeof(count)) < 0)
+                count = 0;
+        }
+
+        atomic_thread_fence(memory_order_seq_cst);
+        cb->head_cache = atomic_load_explicit(&cb->head, memory_order_acquire);
+    }
+
+    if ((ptrdiff_t)(cb->head_cache - tail) <= 0)
+        return 0;
+
+    recv_msg_cb_adopt(cb, tail);
+
+    return 1;
+}
+
+/*******************************************************************************
+ * @brief   Checks whether the producer's ring has a free slot for head. A
+ *          grown ring starts empty at wr_start, whatever older rings hold.
+ *
+ * @return  1 if head fits, else 0
+ *******************************************************************************/
+static int recv_msg_cb_has_space(struct recv_msg_cb_t *cb, size_t head)
+{
+    size_t first = cb->tail_cache;
+
+    if ((ptrdiff_t)(cb->wr_start - first) > 0)
+        first = cb->wr_start;
+
+    return head - first < cb->wr_capacity;
+}
+
+/*******************************************************************************
+ * @brief   DROP_OLDEST consumer path. Moves the oldest message into held so
+ *          the producer can no longer drop it while it is borrowed.
+ *
+ * @return  held, NULL if the queue is empty
+ *******************************************************************************/
+static struct msg_packet_t *recv_msg_cb_take(struct recv_msg_cb_t *cb)
+{
+    struct recv_msg_stamp_t stamp;
+    size_t tail;
+
+    if (cb->held_valid)
+        return &cb->held;
+
+    do
+    {
+        tail = atomic_load_explicit(&cb->tail, memory_order_acquire);
+
+        if (!recv_msg_cb_ready(cb, tail))
+            return NULL;
+
+        // Only kept if the CAS wins, otherwise the producer dropped the slot
+        cb->held = cb->msg_array[tail & cb->mask];
+        recv_msg_cb_stamp(cb, tail, &stamp);
+    } while (!atomic_compare_exchange_strong(&cb->tail, &tail, tail + 1));
+
+    if (cb->held.msg_storage == MSG_STORAGE_INLINE)
+        cb->held.msg_data = cb->held.msg_inline;
+
+    recv_msg_cb_account(cb, &stamp, &cb->held);
+    cb->held_valid = 1;
+
+    return &cb->held;
+}
+
+/*******************************************************************************
+ * @brief   Called by the consumer after it advanced tail. Wakes a producer
+ *          waiting for space.
+ *
+ * @return
+ *******************************************************************************/
+static void recv_msg_cb_released(struct recv_msg_cb_t *cb)
+{
+    if (cb->overflow == RECV_MSG_OVERFLOW_BLOCK)
+        recv_msg_cb_wake_producer(cb);
+}
+
+/*******************************************************************************
+ * @brief   Parks the producer until there is room for head. BLOCK only.
+ *
+ * @return  0 when a slot is free, -1 when unblocked
+ *******************************************************************************/
+static int recv_msg_cb_wait_space(struct recv_msg_cb_t *cb, size_t head)
+{
+    unsigned int seq;
+
+    for (;;)
+    {
+        seq = atomic_load(&cb->space_seq);
+        atomic_store(&cb->producer_waiting, 1);
+        cb->tail_cache = atomic_load(&cb->tail);
+
+        if (head - cb->tail_cache < cb->capacity)
+            break;
+
+        if (atomic_load(&cb->closing))
+        {
+            atomic_store(&cb->producer_waiting, 0);
+            return -1;
+        }
+
+        tcpipc_futex_wait(&cb->space_seq, seq, -1);
+    }
 
-    pthread_mutex_unlock(&recv_msg_cb.lock);
+    atomic_store(&cb->producer_waiting, 0);
 
     return 0;
 }
 
 /*******************************************************************************
- * @brief
+ * @brief   Wakes the producer if it is parked in recv_msg_cb_wait_space().
  *
  * @return
  *******************************************************************************/
-int recv_msg_dequeue(struct msg_packet_t *msg)
+static void recv_msg_cb_wake_producer(struct recv_msg_cb_t *cb)
+{
+    // Pairs with the store of producer_waiting before the producer rechecks
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (!atomic_load_explicit(&cb->producer_waiting, memory_order_relaxed))
+        return;
+
+    atomic_fetch_add(&cb->space_seq, 1);
+    tcpipc_futex_wake(&cb->space_seq);
+}
+
+/*******************************************************************************
+ * @brief   Links a ring of twice the size behind the producer's one, taking
+ *          messages from head on. Called by the producer only. On allocation
+ *          failure growing stops and the producer drops.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int recv_msg_cb_grow(struct recv_msg_cb_t *cb, size_t head)
 {
-    pthread_mutex_lock(&recv_msg_cb.lock);
+    size_t capacity = cb->wr_capacity << 1;
+    struct recv_msg_seg_t *seg;
+
+    seg = (struct recv_msg_seg_t *)calloc(1, sizeof(struct recv_msg_seg_t));
 
-    if (recv_msg_cb.length == 0)
+    if (seg)
     {
-        pthread_mutex_unlock(&recv_msg_cb.lock);
+        seg->msg_array = (struct msg_packet_t *)
+            calloc(capacity, sizeof(struct msg_packet_t));
+
+        if (seg->msg_array && cb->wr_stamps)
+            seg->stamp_array = (struct recv_msg_stamp_t *)
+                calloc(capacity, sizeof(struct recv_msg_stamp_t));
+    }
+
+    if (seg == NULL || seg->msg_array == NULL ||
+        (cb->wr_stamps && seg->stamp_array == NULL))
+    {
+        if (seg)
+        {
+            free(seg->msg_array);
+            free(seg);
+        }
+
+        cb->max_capacity = cb->wr_capacity;
         return -1;
     }
 
-    memcpy(msg, &recv_msg_cb.msg_array[recv_msg_cb.rptr],
-           sizeof(struct msg_packet_t));
-    memset(&recv_msg_cb.msg_array[recv_msg_cb.rptr], 0,
-           sizeof(struct msg_packet_t));
-    INCREMENT_CB_POINTER(recv_msg_cb.rptr);
-    recv_msg_cb.length--;
+    seg->capacity = capacity;
+    seg->start = head;
+    atomic_init(&seg->next, NULL);
+
+    // Released before head moves past start, see recv_msg_cb_adopt()
+    if (cb->wr_seg)
+        atomic_store_explicit(&cb->wr_seg->next, seg, memory_order_release);
+    else
+        atomic_store_explicit(&cb->grow_next, seg, memory_order_release);
 
-    pthread_mutex_unlock(&recv_msg_cb.lock);
+    cb->wr_seg = seg;
+    cb->wr_array = seg->msg_array;
+    cb->wr_stamps = seg->stamp_array;
+    cb->wr_capacity = capacity;
+    cb->wr_start = head;
+    tcpipc_stat_add(&cb->grows, 1);
 
     return 0;
-}
\ No newline at end of file
+}
+
+/*******************************************************************************
+ * @brief   Moves the consumer onto the next grown ring once tail reaches its
+ *          start, freeing the drained one. Called by the consumer only, with
+ *          the message at tail published or tail at head.
+ *
+ * @return
+ *******************************************************************************/
+static void recv_msg_cb_adopt(struct recv_msg_cb_t *cb, size_t tail)
+{
+    struct recv_msg_seg_t *next;
+
+    if (cb->overflow != RECV_MSG_OVERFLOW_GROW)
+        return;
+
+    next = atomic_load_explicit(cb->rd_seg ? &cb->rd_seg->next
+                                           : &cb->grow_next,
+                                memory_order_acquire);
+
+    if (next == NULL || next->start != tail)
+        return;
+
+    free(cb->msg_array);
+    free(cb->stamp_array);
+    free(cb->rd_seg);
+
+    cb->rd_seg = next;
+    cb->msg_array = next->msg_array;
+    cb->stamp_array = next->stamp_array;
+    cb->capacity = next->capacity;
+    cb->mask = next->capacity - 1;
+}
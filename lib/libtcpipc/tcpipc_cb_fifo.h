@@ -14,57 +14,359 @@
 #include <string.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdalign.h>
 
 /** Application specififc libraries **/
+#include "tcpipc_stats.h"
 
 /** Defines  **/
-#define RECV_MESSAGE_CB_LEN (10)
+#define RECV_MSG_CB_DEF_LEN (16)
+#define RECV_MSG_CB_DEF_MAX_LEN (1024)
+#define RECV_MSG_CACHE_LINE (64)
+#define MSG_INLINE_MAX (16)
+#define RECV_MSG_LATEST_MAX (112)
 
 /** User Data Types **/
+enum msg_storage_e
+{
+    MSG_STORAGE_NONE = 0,
+    MSG_STORAGE_INLINE,
+    MSG_STORAGE_POOL,
+    MSG_STORAGE_HEAP,
+    MSG_STORAGE_LATEST
+};
+
+/*
+ * Payloads received by the library are stored according to msg_storage and
+ * must be released with msg_packet_free(). Messages built by the application
+ * for sending only need msg_id, msg_len and msg_data. msg_chan is the
+ * channel a message was received on.
+ */
 struct msg_packet_t
 {
     uint8_t msg_id;
-    uint8_t msg_len;
+    uint8_t msg_storage;
+    uint8_t msg_chan;
+    uint32_t msg_len;
     uint8_t *msg_data;
+    uint8_t msg_inline[MSG_INLINE_MAX];
+};
+
+/*
+ * What the producer does when the ring is full. DROP_NEWEST discards the
+ * incoming message. DROP_OLDEST discards the oldest queued one to make room;
+ * conflation tokens are requeued rather than discarded, their value would be
+ * lost otherwise.
+ * BLOCK parks the producer until the consumer frees a slot; for a stream
+ * transport the receive thread stops reading and the sender sees TCP
+ * backpressure. GROW doubles the ring up to the configured limit and then
+ * behaves like DROP_NEWEST.
+ */
+enum recv_msg_overflow_e
+{
+    RECV_MSG_OVERFLOW_DROP_NEWEST = 0,
+    RECV_MSG_OVERFLOW_DROP_OLDEST,
+    RECV_MSG_OVERFLOW_BLOCK,
+    RECV_MSG_OVERFLOW_GROW
+};
+
+/*
+ * Stage timestamps of one queued message. enqueue_ns is taken on publish,
+ * send_ns and kernel_rx_ns are staged by the producer beforehand with
+ * recv_msg_cb_stage_stamp() and are zero when unknown.
+ */
+struct recv_msg_stamp_t
+{
+    uint64_t enqueue_ns;
+    uint64_t send_ns;
+    uint64_t kernel_rx_ns;
+};
+
+/*
+ * Latency breakdown of one consumed message, see recv_msg_cb_init_trace().
+ * send_ns is the sender's clock as staged by the producer.
+ */
+struct recv_msg_trace_t
+{
+    uint8_t msg_id;
+    uint32_t msg_len;
+    uint64_t send_ns;
+    uint64_t kernel_rx_ns;
+    uint64_t enqueue_ns;
+    uint64_t dequeue_ns;
+};
+
+/*
+ * Latest-value entry of a conflated msg_id, guarded by a seqlock (seq is odd
+ * while the producer writes). pending is set while a token for the entry sits
+ * in the ring; the consumer clears it before reading the value, so an update
+ * that arrives later always queues a new token and is never lost.
+ */
+struct recv_msg_latest_t
+{
+    atomic_uint seq;
+    atomic_int pending;
+    atomic_int enabled;
+    uint8_t chan;
+    uint32_t len;
+    uint8_t data[RECV_MSG_LATEST_MAX];
+};
+
+/*
+ * Ring added by the GROW policy. It holds the messages from index start on;
+ * next is set by the producer when it outgrows this one in turn.
+ */
+struct recv_msg_seg_t
+{
+    struct msg_packet_t *msg_array;
+    struct recv_msg_stamp_t *stamp_array;
+    size_t capacity;
+    size_t start;
+    _Atomic(struct recv_msg_seg_t *) next;
 };
 
+/*
+ * Single-producer/single-consumer ring. head is only written by the producer
+ * and tail only by the consumer; each side keeps a cached copy of the other
+ * index on its own cache line so the shared lines are touched only when the
+ * ring looks full or empty.
+ *
+ * A waitable ring also owns an eventfd. The producer signals it only when it
+ * publishes into an empty ring, and the consumer drains it when it finds the
+ * ring empty, so the fd stays readable exactly while work may be pending.
+ *
+ * high_water is kept by the producer, the dwell counters by the consumer when
+ * stamp_array is enabled with recv_msg_cb_init_stamps(). A conflation token
+ * keeps the stamps of the oldest update it stands for. trace_log is a
+ * consumer owned ring of the newest trace_len consumed messages.
+ *
+ * In conflating mode (recv_msg_cb_init_conflate()) an update for an enabled
+ * msg_id overwrites its latest-value entry, and the ring carries at most one
+ * MSG_STORAGE_LATEST token per msg_id at the position of its oldest pending
+ * update. The consumer calls turn tokens back into regular messages, so the
+ * queue depth is bounded by the control traffic plus one per state msg_id.
+ *
+ * The overflow policy is fixed before first use. With DROP_OLDEST the
+ * producer may advance tail too, so both sides move it with a CAS and the
+ * consumer first moves the oldest message into held, which it alone owns,
+ * before handing it out. BLOCK waits on space_seq until the consumer frees a
+ * slot.
+ *
+ * With GROW the producer never waits: when its ring is full it allocates one
+ * of twice the size, links it behind the current one as a recv_msg_seg_t
+ * starting at head and writes on into it. The wr_ fields describe the ring
+ * the producer fills, msg_array, stamp_array and mask the one the consumer
+ * reads. The consumer adopts the next ring when tail reaches its start and
+ * frees the drained one. The overflow counters and grows are written by the
+ * producer.
+ */
 struct recv_msg_cb_t
 {
-    struct msg_packet_t msg_array[RECV_MESSAGE_CB_LEN];
-    uint8_t wptr;
-    uint8_t rptr;
-    uint8_t length;
-    pthread_mutex_t lock;
+    alignas(RECV_MSG_CACHE_LINE) atomic_size_t head;
+    size_t tail_cache;
+    atomic_uint_fast64_t high_water;
+    atomic_uint_fast64_t drop_oldest;
+    atomic_uint_fast64_t block_waits;
+    atomic_uint_fast64_t grows;
+    struct recv_msg_stamp_t next_stamp;
+    struct msg_packet_t *wr_array;
+    struct recv_msg_stamp_t *wr_stamps;
+    size_t wr_capacity;
+    size_t wr_start;
+    struct recv_msg_seg_t *wr_seg;
+    alignas(RECV_MSG_CACHE_LINE) atomic_size_t tail;
+    size_t head_cache;
+    atomic_uint_fast64_t dwell_count;
+    atomic_uint_fast64_t dwell_total_ns;
+    atomic_uint_fast64_t dwell_max_ns;
+    struct msg_packet_t held;
+    int held_valid;
+    struct recv_msg_trace_t *trace_log;
+    size_t trace_len;
+    size_t trace_head;
+    size_t trace_count;
+    alignas(RECV_MSG_CACHE_LINE) atomic_int event_pending;
+    alignas(RECV_MSG_CACHE_LINE) atomic_uint space_seq;
+    atomic_int producer_waiting;
+    atomic_int closing;
+    alignas(RECV_MSG_CACHE_LINE) struct msg_packet_t *msg_array;
+    struct recv_msg_stamp_t *stamp_array;
+    struct recv_msg_seg_t *rd_seg;
+    _Atomic(struct recv_msg_seg_t *) grow_next;
+    struct recv_msg_latest_t *latest;
+    size_t capacity;
+    size_t mask;
+    size_t max_capacity;
+    enum recv_msg_overflow_e overflow;
+    int event_fd;
 };
 
 /** Public Functions **/
 
 /*******************************************************************************
- * @brief
+ * @brief   Initializes a receive queue instance holding at least len messages.
+ *          The capacity is rounded up to the next power of two.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int recv_msg_cb_init(struct recv_msg_cb_t *cb, size_t len);
+
+/*******************************************************************************
+ * @brief   Releases a receive queue instance and any payload still queued.
  *
  * @return
  *******************************************************************************/
-void recv_msg_init();
+void recv_msg_cb_close(struct recv_msg_cb_t *cb);
 
 /*******************************************************************************
- * @brief
+ * @brief   Adds a message to the given queue.
+ *
+ * @return  0 on success, -1 if the queue is full
+ *******************************************************************************/
+int recv_msg_cb_enqueue(struct recv_msg_cb_t *cb, struct msg_packet_t *msg);
+
+/*******************************************************************************
+ * @brief   Removes the oldest message from the given queue.
+ *
+ * @return  0 on success, -1 if the queue is empty
+ *******************************************************************************/
+int recv_msg_cb_dequeue(struct recv_msg_cb_t *cb, struct msg_packet_t *msg);
+
+/*******************************************************************************
+ * @brief   Returns the next free slot so the producer can build a message in
+ *          place, applying the overflow policy when the queue is full. The
+ *          slot becomes visible with recv_msg_cb_publish().
+ *
+ * @return  Slot pointer, NULL if the new message must be dropped
+ *******************************************************************************/
+struct msg_packet_t *recv_msg_cb_reserve(struct recv_msg_cb_t *cb);
+
+/*******************************************************************************
+ * @brief   Publishes the slot returned by recv_msg_cb_reserve().
  *
  * @return
  *******************************************************************************/
-void recv_msg_close();
+void recv_msg_cb_publish(struct recv_msg_cb_t *cb);
 
 /*******************************************************************************
- * @brief
+ * @brief   Returns the oldest message without removing it. The slot and its
+ *          payload stay valid until recv_msg_cb_consume().
+ *
+ * @return  Slot pointer, NULL if the queue is empty
+ *******************************************************************************/
+struct msg_packet_t *recv_msg_cb_peek(struct recv_msg_cb_t *cb);
+
+/*******************************************************************************
+ * @brief   Releases the payload of the slot returned by recv_msg_cb_peek() and
+ *          removes it from the queue.
  *
  * @return
  *******************************************************************************/
-int recv_msg_enqueue(struct msg_packet_t *msg);
+void recv_msg_cb_consume(struct recv_msg_cb_t *cb);
 
 /*******************************************************************************
- * @brief
+ * @brief   Attaches an eventfd to the queue which becomes readable when the
+ *          queue turns non-empty.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int recv_msg_cb_init_event(struct recv_msg_cb_t *cb);
+
+/*******************************************************************************
+ * @brief   Enables enqueue timestamps so the time messages spend in the queue
+ *          is accounted in the dwell counters.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int recv_msg_cb_init_stamps(struct recv_msg_cb_t *cb);
+
+/*******************************************************************************
+ * @brief   Sets the sender and kernel receive timestamps recorded with the
+ *          next published message. Producer only.
+ *
+ * @return
+ *******************************************************************************/
+void recv_msg_cb_stage_stamp(struct recv_msg_cb_t *cb, uint64_t send_ns,
+                             uint64_t kernel_rx_ns);
+
+/*******************************************************************************
+ * @brief   Keeps the latency breakdown of the last len consumed messages.
+ *          Needs stamps enabled with recv_msg_cb_init_stamps().
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int recv_msg_cb_init_trace(struct recv_msg_cb_t *cb, size_t len);
+
+/*******************************************************************************
+ * @brief   Moves up to max trace records, oldest first, into recs. Consumer
+ *          only.
+ *
+ * @return  Number of records copied
+ *******************************************************************************/
+int recv_msg_cb_read_trace(struct recv_msg_cb_t *cb,
+                           struct recv_msg_trace_t *recs, int max);
+
+/*******************************************************************************
+ * @brief   Selects what happens when the queue is full. max_len bounds the
+ *          capacity GROW may reach, rounded up to a power of two. Must be
+ *          called before the queue is used.
+ *
+ * @return  0 on success, -1 on invalid arguments
+ *******************************************************************************/
+int recv_msg_cb_set_overflow(struct recv_msg_cb_t *cb,
+                             enum recv_msg_overflow_e overflow,
+                             size_t max_len);
+
+/*******************************************************************************
+ * @brief   Releases a producer parked by the BLOCK policy and makes
+ *          further waits fail, e.g. on disconnect.
+ *
+ * @return
+ *******************************************************************************/
+void recv_msg_cb_unblock(struct recv_msg_cb_t *cb);
+
+/*******************************************************************************
+ * @brief   Enables conflating mode. No msg_id is conflated until it is
+ *          switched on with recv_msg_cb_set_conflate().
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int recv_msg_cb_init_conflate(struct recv_msg_cb_t *cb);
+
+/*******************************************************************************
+ * @brief   Switches conflation of msg_id on or off. May be called while the
+ *          queue is in use.
+ *
+ * @return  0 on success, -1 if conflating mode is not enabled
+ *******************************************************************************/
+int recv_msg_cb_set_conflate(struct recv_msg_cb_t *cb, uint8_t msg_id,
+                             int enable);
+
+/*******************************************************************************
+ * @brief   Producer side of conflating mode. Stores the newest value of a
+ *          conflated msg_id, received on channel chan, and queues a token
+ *          unless one is pending.
+ *
+ * @return  0 when stored, 1 if msg_id is not conflated (or the payload is
+ *          too large) and must be queued normally, -1 if the queue is full
+ *******************************************************************************/
+int recv_msg_cb_put_latest(struct recv_msg_cb_t *cb, uint8_t msg_id,
+                           uint8_t chan, const uint8_t *data, uint32_t len);
+
+/*******************************************************************************
+ * @brief   Blocks until the queue may be non-empty or timeout_ms expires.
+ *          A negative timeout waits forever.
+ *
+ * @return  0 when woken, -1 on timeout or error
+ *******************************************************************************/
+int recv_msg_cb_wait(struct recv_msg_cb_t *cb, int timeout_ms);
+
+/*******************************************************************************
+ * @brief   Wakes a consumer blocked in recv_msg_cb_wait(), e.g. on disconnect.
  *
  * @return
  *******************************************************************************/
-int recv_msg_dequeue(struct msg_packet_t *msg);
+void recv_msg_cb_notify(struct recv_msg_cb_t *cb);
 
 #endif // TCPIPC_CB_FIFO_H
\ No newline at end of file
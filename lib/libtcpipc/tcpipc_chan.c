@@ -0,0 +1,301 @@
+/*******************************************************************************
+ * @file    tcpipc_chan.c
+ * @brief   Logical channels over one connection, see tcpipc_chan.h.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include "tcpipc_chan.h"
+
+/** Private Function Prototypes **/
+static int tcpipc_chan_drain(struct tcpipc_chan_t *ch,
+                             struct tcpipc_txq_t *txq);
+static void tcpipc_chan_reset(struct tcpipc_chan_t *ch);
+static int tcpipc_chan_write(struct tcpipc_chan_t *ch,
+                             struct tcpipc_txq_t *txq, struct iovec *iov,
+                             int *iovcnt);
+
+/*******************************************************************************
+ * @brief   Sets up count channels with the given weights in bytes per round,
+ *          zero picks TCPIPC_CHAN_DEF_WEIGHT. With size set every channel
+ *          gets a queue of that many bytes.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_chan_init(struct tcpipc_chan_t *ch, uint8_t count,
+                     const uint32_t *weight, size_t size, size_t flush_bytes,
+                     uint32_t flush_usec)
+{
+    struct tcpipc_chan_q_t *q;
+
+    memset(ch, 0, sizeof(struct tcpipc_chan_t));
+
+    if (count == 0 || count > TCPIPC_CHAN_MAX)
+        return -1;
+
+    ch->count = count;
+    ch->size = size;
+    ch->flush_bytes = flush_bytes;
+    ch->flush_usec = flush_usec;
+
+    // A frame is at least a two byte header and the channel byte
+    ch->max_frames = size / 3 + 1;
+
+    for (int i = 0; i < count; i++)
+    {
+        q = &ch->q[i];
+        q->weight = weight[i] ? weight[i] : TCPIPC_CHAN_DEF_WEIGHT;
+
+        if (size == 0)
+            continue;
+
+        q->buf = (uint8_t *)malloc(size);
+        q->frame_len = (uint32_t *)malloc(ch->max_frames * sizeof(uint32_t));
+        q->frame_log = (uint8_t *)malloc(ch->max_frames);
+
+        if (q->buf == NULL || q->frame_len == NULL || q->frame_log == NULL)
+        {
+            perror("Failed to allocate channel queue");
+            tcpipc_chan_free(ch);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Frees the queues. Pending frames are discarded.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_chan_free(struct tcpipc_chan_t *ch)
+{
+    for (int i = 0; i < TCPIPC_CHAN_MAX; i++)
+    {
+        free(ch->q[i].buf);
+        free(ch->q[i].frame_len);
+        free(ch->q[i].frame_log);
+        ch->q[i].buf = NULL;
+        ch->q[i].frame_len = NULL;
+        ch->q[i].frame_log = NULL;
+    }
+
+    tcpipc_chan_reset(ch);
+}
+
+/*******************************************************************************
+ * @brief   Queues one frame on channel chan, for the log callback too if log
+ *          is set. A frame that does not fit its queue flushes all of them
+ *          first, one larger than the queue is then written straight from
+ *          the caller's buffers.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+int tcpipc_chan_push(struct tcpipc_chan_t *ch, struct tcpipc_txq_t *txq,
+                     uint8_t chan, const uint8_t *hdr, size_t hdr_len,
+                     const uint8_t *data, size_t len, int log)
+{
+    struct tcpipc_chan_q_t *q = &ch->q[chan];
+    struct iovec iov[2];
+    uint64_t now;
+    int ret;
+
+    if (q->len + hdr_len + len > ch->size || q->frames == ch->max_frames)
+    {
+        ret = tcpipc_chan_flush(ch, txq);
+
+        // Everything queued went first, this frame is next on the wire
+        if ((ret || hdr_len + len > ch->size) && log && ch->log_cb)
+            ch->log_cb(ch->log_arg, hdr, hdr_len, data, len);
+
+        if (ret)
+            return -1;
+
+        if (hdr_len + len > ch->size)
+        {
+            iov[0].iov_base = (void *)hdr;
+            iov[0].iov_len = hdr_len;
+            iov[1].iov_base = (void *)data;
+            iov[1].iov_len = len;
+
+            return tcpipc_txq_writev(txq, iov, 2, tcpipc_now_ns());
+        }
+    }
+
+    now = tcpipc_now_ns();
+
+    if (q->frames == 0)
+        q->first_ns = now;
+
+    if (ch->pending == 0)
+        ch->first_ns = now;
+
+    memcpy(q->buf + q->len, hdr, hdr_len);
+    memcpy(q->buf + q->len + hdr_len, data, len);
+    q->len += hdr_len + len;
+    q->frame_log[q->frames] = log;
+    q->frame_len[q->frames++] = hdr_len + len;
+    ch->pending += hdr_len + len;
+
+    if (ch->flush_bytes && ch->pending >= ch->flush_bytes)
+        return tcpipc_chan_flush(ch, txq);
+
+    if (ch->flush_usec && now - ch->first_ns >= ch->flush_usec * 1000ULL)
+        return tcpipc_chan_flush(ch, txq);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Writes every queued frame through txq in deficit round robin
+ *          order.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+int tcpipc_chan_flush(struct tcpipc_chan_t *ch, struct tcpipc_txq_t *txq)
+{
+    return tcpipc_chan_drain(ch, txq);
+}
+
+/*******************************************************************************
+ * @brief   Drops every queued frame without writing it. The ones queued for
+ *          the log are still handed to it, in the order a flush would write
+ *          them.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_chan_discard(struct tcpipc_chan_t *ch)
+{
+    tcpipc_chan_drain(ch, NULL);
+}
+
+/*******************************************************************************
+ * @brief   Empties the queues in deficit round robin order, writing through
+ *          txq unless it is NULL. Each round starts at channel 0 and grants
+ *          every backlogged channel its weight; it takes frames while its
+ *          deficit covers them and keeps the rest of the deficit for the
+ *          next round. Frames a channel writes in one turn are adjacent in
+ *          its queue and go out as one iovec. Frames for the log are handed
+ *          to it as they are taken.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+static int tcpipc_chan_drain(struct tcpipc_chan_t *ch,
+                             struct tcpipc_txq_t *txq)
+{
+    struct iovec iov[TCPIPC_CHAN_IOV_MAX];
+    struct tcpipc_chan_q_t *q;
+    uint64_t now = tcpipc_now_ns();
+    int iovcnt = 0, backlogged = 1, ret = 0;
+    uint32_t frame_len;
+    size_t start;
+
+    if (ch->pending == 0)
+        return 0;
+
+    for (int i = 0; i < ch->count && txq; i++)
+    {
+        if (ch->q[i].frames)
+            tcpipc_stat_max(&ch->q[i].wait_max_ns, now - ch->q[i].first_ns);
+    }
+
+    while (backlogged)
+    {
+        backlogged = 0;
+
+        for (int i = 0; i < ch->count; i++)
+        {
+            q = &ch->q[i];
+
+            if (q->rd_frame == q->frames)
+                continue;
+
+            q->deficit += q->weight;
+            start = q->rd;
+
+            while (q->rd_frame < q->frames &&
+                   q->frame_len[q->rd_frame] <= q->deficit)
+            {
+                frame_len = q->frame_len[q->rd_frame];
+
+                if (q->frame_log[q->rd_frame] && ch->log_cb)
+                    ch->log_cb(ch->log_arg, q->buf + q->rd, frame_len, NULL,
+                               0);
+
+                q->deficit -= frame_len;
+                q->rd += frame_len;
+                q->rd_frame++;
+            }
+
+            // An idle channel does not save up credit
+            if (q->rd_frame == q->frames)
+                q->deficit = 0;
+            else
+                backlogged = 1;
+
+            if (q->rd == start || txq == NULL)
+                continue;
+
+            // After a write error the rest still goes to the log
+            if (iovcnt == TCPIPC_CHAN_IOV_MAX &&
+                tcpipc_chan_write(ch, txq, iov, &iovcnt))
+            {
+                ret = -1;
+                txq = NULL;
+                continue;
+            }
+
+            iov[iovcnt].iov_base = q->buf + start;
+            iov[iovcnt].iov_len = q->rd - start;
+            iovcnt++;
+        }
+    }
+
+    if (txq && iovcnt)
+        ret = tcpipc_chan_write(ch, txq, iov, &iovcnt);
+
+    tcpipc_chan_reset(ch);
+
+    return ret;
+}
+
+/*******************************************************************************
+ * @brief   Empties every queue.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_chan_reset(struct tcpipc_chan_t *ch)
+{
+    struct tcpipc_chan_q_t *q;
+
+    for (int i = 0; i < TCPIPC_CHAN_MAX; i++)
+    {
+        q = &ch->q[i];
+        q->len = 0;
+        q->rd = 0;
+        q->frames = 0;
+        q->rd_frame = 0;
+        q->deficit = 0;
+        q->first_ns = 0;
+    }
+
+    ch->pending = 0;
+    ch->first_ns = 0;
+}
+
+/*******************************************************************************
+ * @brief   Writes the gathered iovecs and starts a new batch.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+static int tcpipc_chan_write(struct tcpipc_chan_t *ch,
+                             struct tcpipc_txq_t *txq, struct iovec *iov,
+                             int *iovcnt)
+{
+    int ret = tcpipc_txq_writev(txq, iov, *iovcnt, ch->first_ns);
+
+    *iovcnt = 0;
+
+    return ret;
+}
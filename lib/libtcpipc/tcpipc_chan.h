@@ -0,0 +1,139 @@
+/*******************************************************************************
+ * @file    tcpipc_chan.h
+ * @brief   Logical channels over one connection. Every frame carries the
+ *          channel it was sent on right behind its header. On a batched
+ *          stream each channel queues its frames separately and a flush
+ *          drains the queues with deficit round robin: per round a channel
+ *          may write up to its weight in bytes, lower channels first, so a
+ *          burst of bulk frames can not hold back a small urgent one queued
+ *          after it. Frames that must be kept for a resume are handed to the
+ *          log callback as the flush takes them, in the order they go out.
+ *
+ *          Channel payload: | channel (1) | payload |
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_CHAN_H
+#define TCPIPC_CHAN_H
+
+/** Standard libraries **/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+
+/** Application specififc libraries **/
+#include "tcpipc_stats.h"
+#include "tcpipc_txq.h"
+
+/** Defines  **/
+#define TCPIPC_CHAN_LEN (1)
+#define TCPIPC_CHAN_MAX (8)
+#define TCPIPC_CHAN_DEF_WEIGHT (1500)
+#define TCPIPC_CHAN_IOV_MAX (64)
+
+/** User Data Types **/
+typedef void (*tcpipc_chan_log_cb_t)(void *arg, const uint8_t *hdr,
+                                     size_t hdr_len, const uint8_t *data,
+                                     size_t len);
+
+/*
+ * Queue of one channel. Frames are stored back to back in buf with their
+ * lengths in frame_len and whether they go to the log in frame_log, rd and
+ * rd_frame advance while a flush drains it.
+ * The counters follow the stats conventions: the out side belongs to the
+ * sending thread, the in side to the receive thread.
+ */
+struct tcpipc_chan_q_t
+{
+    uint8_t *buf;
+    size_t len;
+    size_t rd;
+    uint32_t *frame_len;
+    uint8_t *frame_log;
+    uint32_t frames;
+    uint32_t rd_frame;
+    uint32_t weight;
+    uint64_t deficit;
+    uint64_t first_ns;
+    atomic_uint_fast64_t msgs_out;
+    atomic_uint_fast64_t bytes_out;
+    atomic_uint_fast64_t msgs_in;
+    atomic_uint_fast64_t bytes_in;
+    atomic_uint_fast64_t wait_max_ns;
+};
+
+/*
+ * Channels of one connection. size is the arena of every queue, zero when
+ * frames are not queued and channels only tag and count them. The flush
+ * thresholds match the ones of the transmit queue. log_cb, when set, gets
+ * every frame queued with log set.
+ */
+struct tcpipc_chan_t
+{
+    uint8_t count;
+    struct tcpipc_chan_q_t q[TCPIPC_CHAN_MAX];
+    size_t size;
+    uint32_t max_frames;
+    size_t pending;
+    uint64_t first_ns;
+    size_t flush_bytes;
+    uint32_t flush_usec;
+    tcpipc_chan_log_cb_t log_cb;
+    void *log_arg;
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Sets up count channels with the given weights in bytes per round,
+ *          zero picks TCPIPC_CHAN_DEF_WEIGHT. With size set every channel
+ *          gets a queue of that many bytes, flushed once all of them hold
+ *          flush_bytes or the oldest frame is older than flush_usec at the
+ *          next push.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_chan_init(struct tcpipc_chan_t *ch, uint8_t count,
+                     const uint32_t *weight, size_t size, size_t flush_bytes,
+                     uint32_t flush_usec);
+
+/*******************************************************************************
+ * @brief   Frees the queues. Pending frames are discarded.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_chan_free(struct tcpipc_chan_t *ch);
+
+/*******************************************************************************
+ * @brief   Queues one frame on channel chan, for the log callback too if log
+ *          is set. A frame that does not fit its queue flushes all of them
+ *          first, one larger than the queue is then written straight from
+ *          the caller's buffers.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+int tcpipc_chan_push(struct tcpipc_chan_t *ch, struct tcpipc_txq_t *txq,
+                     uint8_t chan, const uint8_t *hdr, size_t hdr_len,
+                     const uint8_t *data, size_t len, int log);
+
+/*******************************************************************************
+ * @brief   Writes every queued frame through txq in deficit round robin
+ *          order.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+int tcpipc_chan_flush(struct tcpipc_chan_t *ch, struct tcpipc_txq_t *txq);
+
+/*******************************************************************************
+ * @brief   Drops every queued frame without writing it. The ones queued for
+ *          the log are still handed to it, in the order a flush would write
+ *          them.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_chan_discard(struct tcpipc_chan_t *ch);
+
+#endif // TCPIPC_CHAN_H
@@ -0,0 +1,182 @@
+/*******************************************************************************
+ * @file    tcpipc_clock.c
+ * @brief   Round trip time and peer clock estimation from library internal
+ *          PING/PONG frames.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include "tcpipc_clock.h"
+
+/** Private Function Prototypes **/
+static void tcpipc_clock_put64(uint8_t *buf, uint64_t val);
+static uint64_t tcpipc_clock_get64(const uint8_t *buf);
+
+/*******************************************************************************
+ * @brief   Resets the estimator. A PING becomes due every interval_ms, zero
+ *          never sends any.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_clock_init(struct tcpipc_clock_t *clk, uint32_t interval_ms)
+{
+    memset(clk, 0, sizeof(struct tcpipc_clock_t));
+
+    clk->interval_ns = (uint64_t)interval_ms * 1000000;
+}
+
+/*******************************************************************************
+ * @brief   Checks whether the next PING is due at now_ns and if so schedules
+ *          the one after it. The first call is always due, so a sample is
+ *          available one round trip after the connection is up.
+ *
+ * @return  1 if a PING should be sent now, 0 otherwise
+ *******************************************************************************/
+int tcpipc_clock_due(struct tcpipc_clock_t *clk, uint64_t now_ns)
+{
+    if (clk->interval_ns == 0 || now_ns < clk->next_ping_ns)
+        return 0;
+
+    clk->next_ping_ns = now_ns + clk->interval_ns;
+
+    return 1;
+}
+
+/*******************************************************************************
+ * @brief   Encodes a PING sent at t1 into buf.
+ *
+ * @return  Payload length
+ *******************************************************************************/
+uint32_t tcpipc_clock_ping(uint8_t *buf, uint64_t t1)
+{
+    tcpipc_clock_put64(buf, t1);
+
+    return TCPIPC_CLOCK_PING_LEN;
+}
+
+/*******************************************************************************
+ * @brief   Encodes the PONG answering the PING payload ping, received at t2
+ *          and answered at t3.
+ *
+ * @return  Payload length, 0 if ping is malformed
+ *******************************************************************************/
+uint32_t tcpipc_clock_pong(uint8_t *buf, const uint8_t *ping, uint32_t len,
+                           uint64_t t2, uint64_t t3)
+{
+    if (len != TCPIPC_CLOCK_PING_LEN)
+        return 0;
+
+    memcpy(buf, ping, TCPIPC_CLOCK_PING_LEN);
+    tcpipc_clock_put64(buf + 8, t2);
+    tcpipc_clock_put64(buf + 16, t3);
+
+    return TCPIPC_CLOCK_PONG_LEN;
+}
+
+/*******************************************************************************
+ * @brief   Feeds the PONG payload pong received at t4 into the estimator.
+ *          The round trip time is smoothed like TCP does (gain 1/8, mean
+ *          deviation gain 1/4, reported as jitter). The offset is taken from
+ *          the sample with the lowest round trip time among the last
+ *          TCPIPC_CLOCK_WINDOW, since queueing delay on either path skews it
+ *          by up to half the extra delay.
+ *
+ * @return  0 on success, -1 if pong is malformed
+ *******************************************************************************/
+int tcpipc_clock_sample(struct tcpipc_clock_t *clk, const uint8_t *pong,
+                        uint32_t len, uint64_t t4)
+{
+    int64_t t1, t2, t3, rtt, srtt, dev, jitter, offset;
+    uint64_t samples;
+    uint32_t count, best;
+
+    if (len != TCPIPC_CLOCK_PONG_LEN)
+        return -1;
+
+    t1 = (int64_t)tcpipc_clock_get64(pong);
+    t2 = (int64_t)tcpipc_clock_get64(pong + 8);
+    t3 = (int64_t)tcpipc_clock_get64(pong + 16);
+
+    // Both differences come from monotonic clocks, only rounding can make
+    // the peer's hold time exceed our measured interval
+    rtt = ((int64_t)t4 - t1) - (t3 - t2);
+
+    if (rtt < 0)
+        rtt = 0;
+
+    offset = ((t2 - t1) + (t3 - (int64_t)t4)) / 2;
+
+    clk->win_rtt[clk->win_pos % TCPIPC_CLOCK_WINDOW] = rtt;
+    clk->win_offset[clk->win_pos % TCPIPC_CLOCK_WINDOW] = offset;
+    clk->win_pos++;
+
+    samples = tcpipc_stat_get(&clk->samples);
+
+    if (samples == 0)
+    {
+        srtt = rtt;
+        jitter = 0;
+        atomic_store_explicit(&clk->rtt_min_ns, rtt, memory_order_relaxed);
+    }
+    else
+    {
+        srtt = (int64_t)tcpipc_stat_get(&clk->rtt_ns);
+        jitter = (int64_t)tcpipc_stat_get(&clk->jitter_ns);
+        dev = rtt > srtt ? rtt - srtt : srtt - rtt;
+        jitter += (dev - jitter) / 4;
+        srtt += (rtt - srtt) / 8;
+
+        if ((uint64_t)rtt < tcpipc_stat_get(&clk->rtt_min_ns))
+            atomic_store_explicit(&clk->rtt_min_ns, rtt,
+                                  memory_order_relaxed);
+    }
+
+    count = clk->win_pos < TCPIPC_CLOCK_WINDOW ? clk->win_pos
+                                               : TCPIPC_CLOCK_WINDOW;
+    best = 0;
+
+    for (uint32_t i = 1; i < count; i++)
+    {
+        if (clk->win_rtt[i] < clk->win_rtt[best])
+            best = i;
+    }
+
+    atomic_store_explicit(&clk->rtt_ns, srtt, memory_order_relaxed);
+    atomic_store_explicit(&clk->jitter_ns, jitter, memory_order_relaxed);
+    atomic_store_explicit(&clk->offset_ns, (uint64_t)clk->win_offset[best],
+                          memory_order_relaxed);
+
+    // Published last, readers wait for it before trusting the estimates
+    atomic_store_explicit(&clk->samples, samples + 1, memory_order_release);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Stores val big endian.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_clock_put64(uint8_t *buf, uint64_t val)
+{
+    for (int i = 7; i >= 0; i--)
+    {
+        buf[i] = val & 0xFF;
+        val >>= 8;
+    }
+}
+
+/*******************************************************************************
+ * @brief   Loads a big endian value.
+ *
+ * @return  Value
+ *******************************************************************************/
+static uint64_t tcpipc_clock_get64(const uint8_t *buf)
+{
+    uint64_t val = 0;
+
+    for (int i = 0; i < 8; i++)
+        val = (val << 8) | buf[i];
+
+    return val;
+}
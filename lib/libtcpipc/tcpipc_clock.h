@@ -0,0 +1,99 @@
+/*******************************************************************************
+ * @file    tcpipc_clock.h
+ * @brief   Round trip time and peer clock estimation from library internal
+ *          PING/PONG frames. A PING carries the send time t1, the PONG
+ *          returns it with the peer's receive time t2 and reply time t3 and
+ *          is stamped with t4 on arrival, as in NTP:
+ *
+ *              rtt    = (t4 - t1) - (t3 - t2)
+ *              offset = ((t2 - t1) + (t3 - t4)) / 2
+ *
+ *          PING payload: | t1 (8) |
+ *          PONG payload: | t1 (8) | t2 (8) | t3 (8) |, all big endian
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_CLOCK_H
+#define TCPIPC_CLOCK_H
+
+/** Standard libraries **/
+#include <stdint.h>
+#include <string.h>
+
+/** Application specififc libraries **/
+#include "tcpipc_stats.h"
+
+/** Defines  **/
+#define TCPIPC_MSG_ID_PING (0xF0)
+#define TCPIPC_MSG_ID_PONG (0xF1)
+#define TCPIPC_CLOCK_PING_LEN (8)
+#define TCPIPC_CLOCK_PONG_LEN (24)
+#define TCPIPC_CLOCK_WINDOW (8)
+
+/** User Data Types **/
+
+/*
+ * Estimator state of one connection. Samples are taken on the receive thread,
+ * which is the only writer of the published estimates; next_ping_ns belongs
+ * to whoever holds the connection's transmit lock. offset_ns is the peer
+ * clock minus the local one, stored as its two's complement.
+ */
+struct tcpipc_clock_t
+{
+    uint64_t interval_ns;
+    uint64_t next_ping_ns;
+    int64_t win_rtt[TCPIPC_CLOCK_WINDOW];
+    int64_t win_offset[TCPIPC_CLOCK_WINDOW];
+    uint32_t win_pos;
+    atomic_uint_fast64_t samples;
+    atomic_uint_fast64_t rtt_ns;
+    atomic_uint_fast64_t rtt_min_ns;
+    atomic_uint_fast64_t jitter_ns;
+    atomic_uint_fast64_t offset_ns;
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Resets the estimator. A PING becomes due every interval_ms, zero
+ *          never sends any.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_clock_init(struct tcpipc_clock_t *clk, uint32_t interval_ms);
+
+/*******************************************************************************
+ * @brief   Checks whether the next PING is due at now_ns and if so schedules
+ *          the one after it. Caller holds the transmit lock.
+ *
+ * @return  1 if a PING should be sent now, 0 otherwise
+ *******************************************************************************/
+int tcpipc_clock_due(struct tcpipc_clock_t *clk, uint64_t now_ns);
+
+/*******************************************************************************
+ * @brief   Encodes a PING sent at t1 into buf.
+ *
+ * @return  Payload length
+ *******************************************************************************/
+uint32_t tcpipc_clock_ping(uint8_t *buf, uint64_t t1);
+
+/*******************************************************************************
+ * @brief   Encodes the PONG answering the PING payload ping, received at t2
+ *          and answered at t3.
+ *
+ * @return  Payload length, 0 if ping is malformed
+ *******************************************************************************/
+uint32_t tcpipc_clock_pong(uint8_t *buf, const uint8_t *ping, uint32_t len,
+                           uint64_t t2, uint64_t t3);
+
+/*******************************************************************************
+ * @brief   Feeds the PONG payload pong received at t4 into the estimator.
+ *          Receive thread only.
+ *
+ * @return  0 on success, -1 if pong is malformed
+ *******************************************************************************/
+int tcpipc_clock_sample(struct tcpipc_clock_t *clk, const uint8_t *pong,
+                        uint32_t len, uint64_t t4);
+
+#endif // TCPIPC_CLOCK_H
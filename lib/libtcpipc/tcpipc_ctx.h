@@ -0,0 +1,109 @@
+/*******************************************************************************
+ * @file    tcpipc_ctx.h
+ * @brief   Layout of the connection context behind the opaque tcpipc_ctx
+ *          handle. Private to the library, not installed.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_CTX_H
+#define TCPIPC_CTX_H
+
+/** Application specififc libraries **/
+#include "tcpipc.h"
+
+/** Defines  **/
+#define TCPIPC_CTL_PONG (1 << 0)
+#define TCPIPC_CTL_ACK (1 << 1)
+#define TCPIPC_CTL_RESUME (1 << 2)
+
+/** User Data Types **/
+
+/*
+ * One entry of the dispatch table. With rx_inline the receive thread reads it
+ * while the application registers, so the handler is published last.
+ */
+struct tcpipc_handler_t
+{
+    _Atomic(tcpipc_handler_cb_t) cb;
+    void *_Atomic arg;
+};
+
+/*
+ * Control frames the receive thread owes the peer. It never waits for
+ * tx_lock: it fills the slot of a frame whose bit in pending is clear, sets
+ * the bit and sends only if the lock is free. Otherwise whoever holds the
+ * lock sends it before letting go, see tcpipc_tx_unlock(). ack is the
+ * latest count to report, a newer one replaces it while the bit is set.
+ * received and reset answer the peer's RESUME: replay from received, after
+ * emptying the log if the peer started a new session.
+ */
+struct tcpipc_ctl_t
+{
+    atomic_int pending;
+    uint8_t ping[TCPIPC_CLOCK_PING_LEN];
+    uint64_t ping_ns;
+    atomic_uint_fast64_t ack;
+    uint64_t received;
+    int reset;
+};
+
+/*
+ * Everything one connection owns. The receive queue is touched by the
+ * receive thread and the application thread, it stays cache line aligned so
+ * the whole context is allocated with aligned_alloc(). tx_shared is set when
+ * the receive thread sends too, senders then take tx_lock. A sender
+ * waiting for socket space lets go of it with tx_busy set, other senders
+ * wait for tx_idle meanwhile, see tcpipc_tx_wait().
+ */
+struct tcpipc_ctx
+{
+    struct recv_msg_cb_t recv_cb;
+    struct socket_info_t client_info;
+    struct socket_info_t server_info;
+    struct socket_info_t *sock_info;
+    pthread_t recv_tid;
+    int recv_started;
+    struct tcpipc_opts_t opts;
+    struct tcpipc_decoder_t decoder;
+    struct tcpipc_txq_t txq;
+    struct tcpipc_udp_t udp;
+    struct tcpipc_shm_t shm;
+    struct tcpipc_uring_t tx_ring;
+    uint8_t msg_class[256];
+    struct tcpipc_handler_t handlers[256];
+    struct tcpipc_counters_t counters;
+    struct tcpipc_clock_t clock;
+    pthread_mutex_t tx_lock;
+    pthread_cond_t tx_idle;
+    int tx_busy;
+    struct tcpipc_ctl_t ctl;
+    struct tcpipc_tstamp_tx_t tx_stamp;
+    uint64_t rx_kernel_ns;
+    struct tcpipc_flight_t flight;
+    struct tcpipc_chan_t chan;
+    struct tcpipc_bulk_tx_t bulk_tx;
+    struct tcpipc_bulk_rx_t bulk_rx;
+    enum tcp_role_e role;
+    int tx_shared;
+    struct tcpipc_resume_t resume;
+    struct tcpipc_capture_t capture;
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Adds the context to the set dumped by the statistics signal.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_stats_register(struct tcpipc_ctx *ctx);
+
+/*******************************************************************************
+ * @brief   Removes the context from the set dumped by the statistics signal.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_stats_unregister(struct tcpipc_ctx *ctx);
+
+#endif // TCPIPC_CTX_H
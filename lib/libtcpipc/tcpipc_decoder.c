@@ -0,0 +1,258 @@
+/*******************************************************************************
+ * @file    tcpipc_decoder.c
+ * @brief   Incremental frame decoder. Keeps a persistent receive buffer across
+ *          reads so headers and payloads split by TCP are never lost, and
+ *          parses every complete frame in place.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include "tcpipc_decoder.h"
+
+/** Private Function Prototypes **/
+static size_t tcpipc_decoder_pending(struct tcpipc_decoder_t *dec);
+
+/*******************************************************************************
+ * @brief   Initializes a decoder with an initial buffer of size bytes. The
+ *          buffer grows on demand to fit a single frame of up to max_msg_len
+ *          payload bytes.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_decoder_init(struct tcpipc_decoder_t *dec, uint8_t len_size,
+                        size_t size, uint32_t max_msg_len)
+{
+    memset(dec, 0, sizeof(struct tcpipc_decoder_t));
+
+    if (len_size != TCPIPC_LEN_8 && len_size != TCPIPC_LEN_16 &&
+        len_size != TCPIPC_LEN_32)
+        return -1;
+
+    if (max_msg_len > tcpipc_len_size_max(len_size))
+        max_msg_len = tcpipc_len_size_max(len_size);
+
+    dec->len_size = len_size;
+    dec->max_size = 1 + len_size + (size_t)max_msg_len;
+    // size only bounds how much one read can fetch, it may hold many frames
+    dec->size = size ? size : dec->max_size;
+    dec->buf = (uint8_t *)malloc(dec->size);
+
+    if (dec->buf == NULL)
+        return -1;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Frees the decoder buffer.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_decoder_free(struct tcpipc_decoder_t *dec)
+{
+    free(dec->buf);
+    memset(dec, 0, sizeof(struct tcpipc_decoder_t));
+}
+
+/*******************************************************************************
+ * @brief   Drops buffered bytes, including a partial frame, before reading a
+ *          new stream.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_decoder_reset(struct tcpipc_decoder_t *dec)
+{
+    dec->rd = 0;
+    dec->wr = 0;
+}
+
+/*******************************************************************************
+ * @brief   Returns where the next read should store its data and how much room
+ *          is available there. Compacts or grows the buffer when needed.
+ *
+ * @return  Write pointer, NULL if the pending frame exceeds max_msg_len
+ *******************************************************************************/
+uint8_t *tcpipc_decoder_wbuf(struct tcpipc_decoder_t *dec, size_t *space)
+{
+    size_t needed = tcpipc_decoder_pending(dec);
+    size_t size;
+    uint8_t *buf;
+
+    if (dec->rd == dec->wr)
+    {
+        dec->rd = 0;
+        dec->wr = 0;
+    }
+
+    if (needed > dec->max_size)
+        return NULL;
+
+    // Full of complete frames, only happens when feeding without parsing
+    if (dec->rd == 0 && dec->wr == dec->size && needed <= dec->size)
+        needed = dec->size * 2;
+
+    if (needed > dec->size)
+    {
+        for (size = dec->size; size < needed; size <<= 1)
+            ;
+
+        if (size > dec->max_size && needed <= dec->max_size)
+            size = dec->max_size;
+
+        buf = (uint8_t *)realloc(dec->buf, size);
+
+        if (buf == NULL)
+            return NULL;
+
+        dec->buf = buf;
+        dec->size = size;
+    }
+
+    // Leftover is at most one partial frame, so moving it is cheap
+    if (dec->rd > 0 && (dec->rd + needed > dec->size ||
+                        dec->size - dec->wr < dec->size / 2))
+    {
+        memmove(dec->buf, dec->buf + dec->rd, dec->wr - dec->rd);
+        dec->wr -= dec->rd;
+        dec->rd = 0;
+    }
+
+    *space = dec->size - dec->wr;
+
+    return dec->buf + dec->wr;
+}
+
+/*******************************************************************************
+ * @brief   Marks len bytes at the write pointer as received.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_decoder_commit(struct tcpipc_decoder_t *dec, size_t len)
+{
+    dec->wr += len;
+}
+
+/*******************************************************************************
+ * @brief   Copies len bytes from an external buffer into the decoder.
+ *
+ * @return  0 on success, -1 if the pending frame exceeds max_msg_len
+ *******************************************************************************/
+int tcpipc_decoder_feed(struct tcpipc_decoder_t *dec, const uint8_t *data,
+                        size_t len)
+{
+    uint8_t *wbuf;
+    size_t space;
+
+    while (len > 0)
+    {
+        wbuf = tcpipc_decoder_wbuf(dec, &space);
+
+        if (wbuf == NULL)
+            return -1;
+
+        if (space > len)
+            space = len;
+
+        memcpy(wbuf, data, space);
+        tcpipc_decoder_commit(dec, space);
+        data += space;
+        len -= space;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Invokes frame_cb for every complete frame in the buffer. Incomplete
+ *          data is kept for the next call. A header announcing more than
+ *          max_msg_len stops the parse, the stream can not be resynchronized.
+ *
+ * @return  Number of frames parsed, -1 on an oversize frame
+ *******************************************************************************/
+int tcpipc_decoder_parse(struct tcpipc_decoder_t *dec,
+                         tcpipc_frame_cb_t frame_cb, void *arg)
+{
+    size_t hdr_len = 1 + dec->len_size;
+    uint8_t *frame;
+    uint32_t msg_len;
+    int count = 0;
+
+    while (dec->wr - dec->rd >= hdr_len)
+    {
+        frame = dec->buf + dec->rd;
+        msg_len = 0;
+
+        for (int i = 1; i <= dec->len_size; i++)
+            msg_len = (msg_len << 8) | frame[i];
+
+        // Checked before adding, the sum can wrap with a 32 bit size_t
+        if (msg_len > dec->max_size - hdr_len)
+            return -1;
+
+        if (dec->wr - dec->rd < hdr_len + msg_len)
+            break;
+
+        frame_cb(arg, frame[0], frame + hdr_len, msg_len);
+
+        dec->rd += hdr_len + msg_len;
+        count++;
+    }
+
+    return count;
+}
+
+/*******************************************************************************
+ * @brief   Writes a frame header into hdr.
+ *
+ * @return  Header length in bytes
+ *******************************************************************************/
+size_t tcpipc_encode_header(uint8_t *hdr, uint8_t len_size, uint8_t msg_id,
+                            uint32_t len)
+{
+    hdr[0] = msg_id;
+
+    for (int i = len_size; i >= 1; i--)
+    {
+        hdr[i] = len & 0xFF;
+        len >>= 8;
+    }
+
+    return 1 + len_size;
+}
+
+/*******************************************************************************
+ * @brief   Largest payload the given length field can describe.
+ *
+ * @return
+ *******************************************************************************/
+uint32_t tcpipc_len_size_max(uint8_t len_size)
+{
+    if (len_size >= TCPIPC_LEN_32)
+        return UINT32_MAX - TCPIPC_HDR_MAX_LEN;
+
+    return (1U << (8 * len_size)) - 1;
+}
+
+/*******************************************************************************
+ * @brief   Bytes needed in the buffer to complete the frame at the read
+ *          pointer, counted from the read pointer.
+ *
+ * @return  Byte count, SIZE_MAX for a frame longer than max_msg_len
+ *******************************************************************************/
+static size_t tcpipc_decoder_pending(struct tcpipc_decoder_t *dec)
+{
+    size_t hdr_len = 1 + dec->len_size;
+    uint8_t *frame = dec->buf + dec->rd;
+    uint32_t msg_len = 0;
+
+    if (dec->wr - dec->rd < hdr_len)
+        return hdr_len;
+
+    for (int i = 1; i <= dec->len_size; i++)
+        msg_len = (msg_len << 8) | frame[i];
+
+    if (msg_len > dec->max_size - hdr_len)
+        return SIZE_MAX;
+
+    return hdr_len + (size_t)msg_len;
+}
@@ -0,0 +1,127 @@
+/*******************************************************************************
+ * @file    tcpipc_decoder.h
+ * @brief   Incremental frame decoder. Keeps a persistent receive buffer across
+ *          reads so headers and payloads split by TCP are never lost, and
+ *          parses every complete frame in place.
+ *
+ *          Frame layout: | msg_id (1) | msg_len (1, 2 or 4, big endian) |
+ *                        | payload (msg_len) |
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_DECODER_H
+#define TCPIPC_DECODER_H
+
+/** Standard libraries **/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+/** Application specififc libraries **/
+
+/** Defines  **/
+#define TCPIPC_HDR_MAX_LEN (5)
+
+/** User Data Types **/
+enum tcpipc_len_size_e
+{
+    TCPIPC_LEN_8 = 1,
+    TCPIPC_LEN_16 = 2,
+    TCPIPC_LEN_32 = 4
+};
+
+struct tcpipc_decoder_t
+{
+    uint8_t *buf;
+    size_t size;
+    size_t max_size;
+    size_t rd;
+    size_t wr;
+    uint8_t len_size;
+};
+
+/*
+ * Called once per complete frame. data points into the decoder buffer and is
+ * only valid for the duration of the call.
+ */
+typedef void (*tcpipc_frame_cb_t)(void *arg, uint8_t msg_id,
+                                  const uint8_t *data, uint32_t len);
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Initializes a decoder with an initial buffer of size bytes. The
+ *          buffer grows on demand to fit a single frame of up to max_msg_len
+ *          payload bytes.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_decoder_init(struct tcpipc_decoder_t *dec, uint8_t len_size,
+                        size_t size, uint32_t max_msg_len);
+
+/*******************************************************************************
+ * @brief   Frees the decoder buffer.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_decoder_free(struct tcpipc_decoder_t *dec);
+
+/*******************************************************************************
+ * @brief   Drops buffered bytes, including a partial frame, before reading a
+ *          new stream.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_decoder_reset(struct tcpipc_decoder_t *dec);
+
+/*******************************************************************************
+ * @brief   Returns where the next read should store its data and how much room
+ *          is available there. Compacts or grows the buffer when needed.
+ *
+ * @return  Write pointer, NULL if the pending frame exceeds max_msg_len
+ *******************************************************************************/
+uint8_t *tcpipc_decoder_wbuf(struct tcpipc_decoder_t *dec, size_t *space);
+
+/*******************************************************************************
+ * @brief   Marks len bytes at the write pointer as received.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_decoder_commit(struct tcpipc_decoder_t *dec, size_t len);
+
+/*******************************************************************************
+ * @brief   Copies len bytes from an external buffer into the decoder.
+ *
+ * @return  0 on success, -1 if the pending frame exceeds max_msg_len
+ *******************************************************************************/
+int tcpipc_decoder_feed(struct tcpipc_decoder_t *dec, const uint8_t *data,
+                        size_t len);
+
+/*******************************************************************************
+ * @brief   Invokes frame_cb for every complete frame in the buffer. Incomplete
+ *          data is kept for the next call. A header announcing more than
+ *          max_msg_len stops the parse, the stream can not be resynchronized.
+ *
+ * @return  Number of frames parsed, -1 on an oversize frame
+ *******************************************************************************/
+int tcpipc_decoder_parse(struct tcpipc_decoder_t *dec,
+                         tcpipc_frame_cb_t frame_cb, void *arg);
+
+/*******************************************************************************
+ * @brief   Writes a frame header into hdr.
+ *
+ * @return  Header length in bytes
+ *******************************************************************************/
+size_t tcpipc_encode_header(uint8_t *hdr, uint8_t len_size, uint8_t msg_id,
+                            uint32_t len);
+
+/*******************************************************************************
+ * @brief   Largest payload the given length field can describe.
+ *
+ * @return
+ *******************************************************************************/
+uint32_t tcpipc_len_size_max(uint8_t len_size);
+
+#endif // TCPIPC_DECODER_H
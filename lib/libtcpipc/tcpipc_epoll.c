@@ -0,0 +1,782 @@
+/*******************************************************************************
+ * @file    tcpipc_epoll.c
+ * @brief   Multi-connection server mode for libtcpipc. A single edge-triggered
+ *          epoll loop accepts and serves every peer, each connection keeping
+ *          its own receive state and receive queue.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "tcpipc_epoll.h"
+#include "tcpipc_pool.h"
+
+/** Private Function Prototypes **/
+static int tcpipc_epoll_setup(struct tcpipc_epoll_t *ep, int port);
+static void tcpipc_epoll_accept(struct tcpipc_epoll_t *ep);
+static void tcpipc_epoll_read(struct tcpipc_epoll_t *ep,
+                              struct tcpipc_epoll_conn_t *conn);
+static void tcpipc_epoll_write(struct tcpipc_epoll_t *ep,
+                               struct tcpipc_epoll_conn_t *conn);
+static void tcpipc_epoll_arm(struct tcpipc_epoll_t *ep,
+                             struct tcpipc_epoll_conn_t *conn);
+static void tcpipc_epoll_frame(void *arg, uint8_t msg_id, const uint8_t *data,
+                               uint32_t len);
+static void tcpipc_epoll_drop(struct tcpipc_epoll_t *ep,
+                              struct tcpipc_epoll_conn_t *conn);
+static int tcpipc_epoll_queue_init(struct tcpipc_epoll_t *ep,
+                                   struct tcpipc_epoll_conn_t *conn);
+static void *tcpipc_epoll_thread(void *argv);
+
+/*******************************************************************************
+ * @brief   Starts listening on the given port and spawns the event loop thread
+ *          serving up to max_conns simultaneous peers. opts may be NULL.
+ *          Every connection gets a receive queue sized by rx_queue_len and
+ *          rx_queue_max; the BLOCK overflow policy is refused, it would park
+ *          the loop serving all peers.
+ *
+ * @return  Server handle on success, NULL on failure
+ *******************************************************************************/
+struct tcpipc_epoll_t *tcpipc_epoll_open(int port, int max_conns,
+                                         const struct tcpipc_opts_t *opts)
+{
+    struct tcpipc_epoll_t *ep;
+    struct epoll_event event;
+
+    if (max_conns <= 0)
+        return NULL;
+
+    // One event loop serves every peer, a parked producer would stall all
+    if (opts && opts->rx_overflow == RECV_MSG_OVERFLOW_BLOCK)
+    {
+        printf("Server: BLOCK overflow is not supported with epoll\n");
+        return NULL;
+    }
+
+    ep = (struct tcpipc_epoll_t *)calloc(1, sizeof(struct tcpipc_epoll_t));
+
+    if (ep == NULL)
+        return NULL;
+
+    ep->epoll_fd = -1;
+    ep->event_fd = -1;
+    ep->server_info.fd = -1;
+    ep->max_conns = max_conns;
+
+    if (opts)
+        ep->opts = *opts;
+    else
+        tcpipc_opts_default(&ep->opts);
+
+    // Receive rings are cache-line aligned, so the slots must be as well
+    ep->conns = (struct tcpipc_epoll_conn_t *)
+        aligned_alloc(RECV_MSG_CACHE_LINE,
+                      max_conns * sizeof(struct tcpipc_epoll_conn_t));
+
+    if (ep->conns == NULL)
+        goto err;
+
+    memset(ep->conns, 0, max_conns * sizeof(struct tcpipc_epoll_conn_t));
+
+    for (int i = 0; i < max_conns; i++)
+    {
+        ep->conns[i].id = i;
+        ep->conns[i].fd = -1;
+        ep->conns[i].ep = ep;
+        ep->conns[i].txq.fd = -1;
+        atomic_init(&ep->conns[i].state, TCPIPC_CONN_FREE);
+        pthread_mutex_init(&ep->conns[i].tx_lock, NULL);
+
+        if (tcpipc_epoll_queue_init(ep, &ep->conns[i]))
+            goto err;
+    }
+
+    if (tcpipc_epoll_setup(ep, port))
+        goto err;
+
+    ep->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    ep->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (ep->epoll_fd < 0 || ep->event_fd < 0)
+    {
+        perror("Server: Failed to create epoll instance");
+        goto err;
+    }
+
+    // Listening socket is tagged with NULL, the stop event with the handle
+    event.events = EPOLLIN | EPOLLET;
+    event.data.ptr = NULL;
+
+    if (epoll_ctl(ep->epoll_fd, EPOLL_CTL_ADD, ep->server_info.fd, &event))
+    {
+        perror("Server: Failed to register listening socket");
+        goto err;
+    }
+
+    event.events = EPOLLIN;
+    event.data.ptr = ep;
+
+    if (epoll_ctl(ep->epoll_fd, EPOLL_CTL_ADD, ep->event_fd, &event))
+    {
+        perror("Server: Failed to register stop event");
+        goto err;
+    }
+
+    if (pthread_create(&ep->tid, NULL, tcpipc_epoll_thread, (void *)ep))
+    {
+        perror("Server: Failed to start event loop");
+        goto err;
+    }
+
+    printf("Server: Serving up to %d connections on port %d\n",
+           max_conns, port);
+
+    return ep;
+
+err:
+    if (ep->conns)
+    {
+        for (int i = 0; i < max_conns; i++)
+        {
+            recv_msg_cb_close(&ep->conns[i].recv_cb);
+            pthread_mutex_destroy(&ep->conns[i].tx_lock);
+        }
+
+        free(ep->conns);
+    }
+
+    if (ep->server_info.fd >= 0)
+        close(ep->server_info.fd);
+    if (ep->epoll_fd >= 0)
+        close(ep->epoll_fd);
+    if (ep->event_fd >= 0)
+        close(ep->event_fd);
+
+    free(ep);
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * @brief   Stops the event loop, closes every connection and frees the handle.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_epoll_close(struct tcpipc_epoll_t *ep)
+{
+    uint64_t stop = 1;
+
+    if (ep == NULL)
+        return;
+
+    atomic_store(&ep->exit_status, 1);
+
+    if (write(ep->event_fd, &stop, sizeof(stop)) != sizeof(stop))
+        perror("Server: Failed to signal event loop");
+
+    pthread_join(ep->tid, NULL);
+
+    for (int i = 0; i < ep->max_conns; i++)
+    {
+        if (ep->conns[i].fd >= 0)
+            close(ep->conns[i].fd);
+
+        tcpipc_txq_free(&ep->conns[i].txq);
+        tcpipc_decoder_free(&ep->conns[i].decoder);
+        recv_msg_cb_close(&ep->conns[i].recv_cb);
+        pthread_mutex_destroy(&ep->conns[i].tx_lock);
+    }
+
+    close(ep->server_info.fd);
+    close(ep->epoll_fd);
+    close(ep->event_fd);
+    free(ep->conns);
+    free(ep);
+}
+
+/*******************************************************************************
+ * @brief   Sends a message to the peer on the given connection.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_epoll_send(struct tcpipc_epoll_t *ep, int conn_id,
+                      struct msg_packet_t *msg_packet)
+{
+    return tcpipc_epoll_send_chan(ep, conn_id, 0, msg_packet);
+}
+
+/*******************************************************************************
+ * @brief   Sends a message on channel chan to the peer on the given
+ *          connection, see channels in tcpipc_opts_t. tcpipc_epoll_send()
+ *          uses channel 0. What the socket does not take at once is kept
+ *          and written by the event loop; a write error shuts the connection
+ *          down, the peer would otherwise see a torn frame.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_epoll_send_chan(struct tcpipc_epoll_t *ep, int conn_id,
+                           uint8_t chan, struct msg_packet_t *msg_packet)
+{
+    struct tcpipc_epoll_conn_t *conn;
+    uint8_t hdr[TCPIPC_HDR_MAX_LEN + TCPIPC_CHAN_LEN + TCPIPC_TSTAMP_LEN];
+    struct iovec iov[2];
+    size_t prefix_len = 0;
+    int ret;
+
+    if (conn_id < 0 || conn_id >= ep->max_conns)
+        return -1;
+
+    conn = &ep->conns[conn_id];
+
+    if (atomic_load(&conn->state) != TCPIPC_CONN_OPEN)
+        return -1;
+
+    if (chan && chan >= ep->opts.channels)
+    {
+        printf("Server: Invalid channel: %u\n", chan);
+        return -1;
+    }
+
+    if (ep->opts.channels)
+        prefix_len += TCPIPC_CHAN_LEN;
+
+    if (ep->opts.timestamping)
+        prefix_len += TCPIPC_TSTAMP_LEN;
+
+    if ((uint64_t)msg_packet->msg_len + prefix_len >
+        tcpipc_len_size_max(ep->opts.len_size))
+        return -1;
+
+    iov[0].iov_base = hdr;
+    iov[0].iov_len = tcpipc_encode_header(hdr, ep->opts.len_size,
+                                          msg_packet->msg_id,
+                                          msg_packet->msg_len + prefix_len);
+
+    // Same layout as tcpipc_send_chan(): channel, then the send time
+    if (ep->opts.channels)
+        hdr[iov[0].iov_len++] = chan;
+
+    if (ep->opts.timestamping)
+    {
+        tcpipc_tstamp_put(hdr + iov[0].iov_len, tcpipc_now_ns());
+        iov[0].iov_len += TCPIPC_TSTAMP_LEN;
+    }
+
+    iov[1].iov_base = msg_packet->msg_data;
+    iov[1].iov_len = msg_packet->msg_len;
+
+    pthread_mutex_lock(&conn->tx_lock);
+
+    // Dropped or released while we waited for the lock
+    if (atomic_load(&conn->state) != TCPIPC_CONN_OPEN || conn->fd < 0)
+    {
+        pthread_mutex_unlock(&conn->tx_lock);
+        return -1;
+    }
+
+    ret = tcpipc_txq_writev(&conn->txq, iov, 2, 0);
+
+    if (ret == 0 && conn->txq.spill_len > TCPIPC_EPOLL_SPILL_MAX)
+    {
+        printf("Server: Peer on connection %d is not reading\n", conn_id);
+        ret = -1;
+    }
+
+    // The event loop sees the hang up and drops the connection
+    if (ret)
+        shutdown(conn->fd, SHUT_RDWR);
+    else
+        tcpipc_epoll_arm(ep, conn);
+
+    pthread_mutex_unlock(&conn->tx_lock);
+
+    return ret;
+}
+
+/*******************************************************************************
+ * @brief   Dequeues the oldest message received on the given connection.
+ *
+ * @return  0 on success, -1 if no message is pending
+ *******************************************************************************/
+int tcpipc_epoll_recv(struct tcpipc_epoll_t *ep, int conn_id,
+                      struct msg_packet_t *msg_packet)
+{
+    if (conn_id < 0 || conn_id >= ep->max_conns)
+        return -1;
+
+    return recv_msg_cb_dequeue(&ep->conns[conn_id].recv_cb, msg_packet);
+}
+
+/*******************************************************************************
+ * @brief   Returns the state of the given connection slot.
+ *
+ * @return  One of tcpipc_conn_state_e
+ *******************************************************************************/
+enum tcpipc_conn_state_e tcpipc_epoll_conn_state(struct tcpipc_epoll_t *ep,
+                                                 int conn_id)
+{
+    if (conn_id < 0 || conn_id >= ep->max_conns)
+        return TCPIPC_CONN_FREE;
+
+    return atomic_load(&ep->conns[conn_id].state);
+}
+
+/*******************************************************************************
+ * @brief   Returns the number of frames dropped on the given connection
+ *          because its receive queue was full or they were malformed.
+ *
+ * @return  Drop count
+ *******************************************************************************/
+uint64_t tcpipc_epoll_conn_drops(struct tcpipc_epoll_t *ep, int conn_id)
+{
+    if (conn_id < 0 || conn_id >= ep->max_conns)
+        return 0;
+
+    return tcpipc_stat_get(&ep->conns[conn_id].rx_drops);
+}
+
+/*******************************************************************************
+ * @brief   Frees a closed connection slot once its queue has been drained so
+ *          it can be reused for a new peer. Closes the connection socket, so
+ *          it must not race a tcpipc_epoll_send() on the same slot.
+ *
+ * @return  0 on success, -1 if the slot is not closed
+ *******************************************************************************/
+int tcpipc_epoll_release(struct tcpipc_epoll_t *ep, int conn_id)
+{
+    struct tcpipc_epoll_conn_t *conn;
+    int expected = TCPIPC_CONN_CLOSED;
+
+    if (conn_id < 0 || conn_id >= ep->max_conns)
+        return -1;
+
+    conn = &ep->conns[conn_id];
+
+    if (atomic_load(&conn->state) != TCPIPC_CONN_CLOSED)
+        return -1;
+
+    // Slot is no longer touched by the event loop, senders are kept out
+    pthread_mutex_lock(&conn->tx_lock);
+    close(conn->fd);
+    conn->fd = -1;
+    tcpipc_txq_free(&conn->txq);
+    conn->txq.fd = -1;
+    pthread_mutex_unlock(&conn->tx_lock);
+
+    recv_msg_cb_close(&conn->recv_cb);
+
+    if (tcpipc_epoll_queue_init(ep, conn))
+        return -1;
+
+    if (!atomic_compare_exchange_strong(&conn->state, &expected,
+                                        TCPIPC_CONN_FREE))
+        return -1;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Creates the non-blocking listening socket.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int tcpipc_epoll_setup(struct tcpipc_epoll_t *ep, int port)
+{
+    struct socket_info_t *server_info = &ep->server_info;
+    int opt = 1;
+
+    server_info->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                             0);
+
+    if (server_info->fd < 0)
+    {
+        perror("Server: Failed to create socket");
+        return -1;
+    }
+
+    if (setsockopt(server_info->fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT,
+                   &opt, sizeof(opt)))
+    {
+        perror("Server: Failed to set socket options");
+        return -1;
+    }
+
+    server_info->port = port;
+    server_info->addr.sin_family = AF_INET;
+    server_info->addr.sin_addr.s_addr = INADDR_ANY;
+    server_info->addr.sin_port = htons(server_info->port);
+
+    if (bind(server_info->fd, (struct sockaddr *)&server_info->addr,
+             sizeof(server_info->addr)))
+    {
+        perror("Server: Failed to bind");
+        return -1;
+    }
+
+    if (listen(server_info->fd, SOMAXCONN))
+    {
+        perror("Server: Failed to start listening");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Accepts every pending connection. Edge-triggered, so the backlog
+ *          must be drained until accept() would block.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_epoll_accept(struct tcpipc_epoll_t *ep)
+{
+    struct tcpipc_epoll_conn_t *conn;
+    struct epoll_event event;
+    struct sockaddr_in addr;
+    socklen_t addr_len;
+    int fd, i;
+
+    while (1)
+    {
+        addr_len = sizeof(addr);
+        fd = accept4(ep->server_info.fd, (struct sockaddr *)&addr, &addr_len,
+                     SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("Server: Failed to accept");
+            return;
+        }
+
+        for (i = 0; i < ep->max_conns; i++)
+        {
+            if (atomic_load(&ep->conns[i].state) == TCPIPC_CONN_FREE)
+                break;
+        }
+
+        if (i == ep->max_conns)
+        {
+            printf("Server: Connection limit reached, rejecting peer\n");
+            close(fd);
+            continue;
+        }
+
+        conn = &ep->conns[i];
+        conn->fd = fd;
+        conn->addr = addr;
+        conn->addr_len = addr_len;
+        atomic_store(&conn->rx_drops, 0);
+
+        // The channel and the send time travel on top of the payload
+        if (tcpipc_decoder_init(&conn->decoder, ep->opts.len_size,
+                                ep->opts.rx_buf_size,
+                                ep->opts.max_msg_len +
+                                    (ep->opts.channels ? TCPIPC_CHAN_LEN : 0) +
+                                    (ep->opts.timestamping ? TCPIPC_TSTAMP_LEN
+                                                           : 0)))
+        {
+            printf("Server: Failed to allocate receive buffer\n");
+            close(fd);
+            conn->fd = -1;
+            continue;
+        }
+
+        // Frames go out with tcpipc_txq_writev(), only the spill is used
+        if (tcpipc_txq_init(&conn->txq, fd, TCPIPC_HDR_MAX_LEN, 0, 0))
+        {
+            printf("Server: Failed to allocate transmit queue\n");
+            tcpipc_decoder_free(&conn->decoder);
+            close(fd);
+            conn->fd = -1;
+            continue;
+        }
+
+        conn->txq.nowait = 1;
+        conn->tx_armed = 0;
+
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = conn;
+
+        if (epoll_ctl(ep->epoll_fd, EPOLL_CTL_ADD, fd, &event))
+        {
+            perror("Server: Failed to register connection");
+            tcpipc_txq_free(&conn->txq);
+            conn->txq.fd = -1;
+            tcpipc_decoder_free(&conn->decoder);
+            close(fd);
+            conn->fd = -1;
+            continue;
+        }
+
+        atomic_store(&conn->state, TCPIPC_CONN_OPEN);
+    }
+}
+
+/*******************************************************************************
+ * @brief   Reads everything available on a connection and queues the complete
+ *          frames. Partial frames stay in the connection decoder.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_epoll_read(struct tcpipc_epoll_t *ep,
+                              struct tcpipc_epoll_conn_t *conn)
+{
+    uint8_t *buffer;
+    size_t space;
+    ssize_t buffer_len;
+
+    while (1)
+    {
+        buffer = tcpipc_decoder_wbuf(&conn->decoder, &space);
+
+        if (buffer == NULL)
+        {
+            printf("Server: Received message exceeds maximum length\n");
+            tcpipc_epoll_drop(ep, conn);
+            return;
+        }
+
+        buffer_len = read(conn->fd, buffer, space);
+
+        if (buffer_len < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return;
+
+            perror("Server: Error while getting data");
+            tcpipc_epoll_drop(ep, conn);
+            return;
+        }
+        else if (buffer_len == 0)
+        {
+            tcpipc_epoll_drop(ep, conn);
+            return;
+        }
+
+        tcpipc_decoder_commit(&conn->decoder, buffer_len);
+
+        if (tcpipc_decoder_parse(&conn->decoder, tcpipc_epoll_frame, conn) < 0)
+        {
+            printf("Server: Received message exceeds maximum length\n");
+            tcpipc_epoll_drop(ep, conn);
+            return;
+        }
+    }
+}
+
+/*******************************************************************************
+ * @brief   Writes what senders left in the spill of a connection once the
+ *          socket has room again.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_epoll_write(struct tcpipc_epoll_t *ep,
+                               struct tcpipc_epoll_conn_t *conn)
+{
+    int ret;
+
+    pthread_mutex_lock(&conn->tx_lock);
+
+    ret = tcpipc_txq_flush(&conn->txq);
+
+    if (ret == 0)
+        tcpipc_epoll_arm(ep, conn);
+
+    pthread_mutex_unlock(&conn->tx_lock);
+
+    if (ret)
+        tcpipc_epoll_drop(ep, conn);
+}
+
+/*******************************************************************************
+ * @brief   Watches a connection for EPOLLOUT while its spill holds data and
+ *          stops once it is empty. Caller holds tx_lock.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_epoll_arm(struct tcpipc_epoll_t *ep,
+                             struct tcpipc_epoll_conn_t *conn)
+{
+    struct epoll_event event;
+    int armed = conn->txq.spill_len != 0;
+
+    if (armed == conn->tx_armed)
+        return;
+
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (armed ? EPOLLOUT : 0);
+    event.data.ptr = conn;
+
+    // Fails once the event loop dropped the connection, nothing to wait for
+    if (epoll_ctl(ep->epoll_fd, EPOLL_CTL_MOD, conn->fd, &event) == 0)
+        conn->tx_armed = armed;
+}
+
+/*******************************************************************************
+ * @brief   Decoder callback, queues one frame on its connection.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_epoll_frame(void *arg, uint8_t msg_id, const uint8_t *data,
+                               uint32_t len)
+{
+    struct tcpipc_epoll_conn_t *conn = (struct tcpipc_epoll_conn_t *)arg;
+    struct tcpipc_opts_t *opts = &conn->ep->opts;
+    struct msg_packet_t *msg_packet;
+    uint8_t chan = 0;
+
+    if (opts->channels)
+    {
+        if (len < TCPIPC_CHAN_LEN || data[0] >= opts->channels)
+        {
+            tcpipc_stat_add(&conn->rx_drops, 1);
+            return;
+        }
+
+        chan = data[0];
+        data += TCPIPC_CHAN_LEN;
+        len -= TCPIPC_CHAN_LEN;
+    }
+
+    if (opts->timestamping)
+    {
+        if (len < TCPIPC_TSTAMP_LEN)
+        {
+            tcpipc_stat_add(&conn->rx_drops, 1);
+            return;
+        }
+
+        recv_msg_cb_stage_stamp(&conn->recv_cb, tcpipc_tstamp_get(data), 0);
+        data += TCPIPC_TSTAMP_LEN;
+        len -= TCPIPC_TSTAMP_LEN;
+    }
+
+    msg_packet = recv_msg_cb_reserve(&conn->recv_cb);
+
+    if (msg_packet == NULL)
+    {
+        tcpipc_stat_add(&conn->rx_drops, 1);
+        return;
+    }
+
+    msg_packet->msg_id = msg_id;
+    msg_packet->msg_chan = chan;
+    msg_packet->msg_len = len;
+
+    if (msg_packet_alloc(msg_packet, len))
+        memcpy(msg_packet->msg_data, data, len);
+    else if (len)
+    {
+        tcpipc_stat_add(&conn->rx_drops, 1);
+        return;
+    }
+
+    recv_msg_cb_publish(&conn->recv_cb);
+}
+
+/*******************************************************************************
+ * @brief   Closes a connection. The slot stays CLOSED until the consumer
+ *          releases it, so queued messages are not lost. The socket is only
+ *          shut down; closing it here would let accept() hand its number to
+ *          a new peer while a sender still holds it.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_epoll_drop(struct tcpipc_epoll_t *ep,
+                              struct tcpipc_epoll_conn_t *conn)
+{
+    epoll_ctl(ep->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    shutdown(conn->fd, SHUT_RDWR);
+    tcpipc_decoder_free(&conn->decoder);
+    atomic_store(&conn->state, TCPIPC_CONN_CLOSED);
+}
+
+/*******************************************************************************
+ * @brief   Creates the receive queue of a connection slot as configured by
+ *          rx_queue_len, rx_queue_max and rx_overflow.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int tcpipc_epoll_queue_init(struct tcpipc_epoll_t *ep,
+                                   struct tcpipc_epoll_conn_t *conn)
+{
+    if (recv_msg_cb_init(&conn->recv_cb, ep->opts.rx_queue_len) ||
+        recv_msg_cb_set_overflow(&conn->recv_cb, ep->opts.rx_overflow,
+                                 ep->opts.rx_queue_max))
+    {
+        printf("Server: Failed to create receive queue\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Event loop serving the listening socket and all connections.
+ *
+ * @return
+ *******************************************************************************/
+static void *tcpipc_epoll_thread(void *argv)
+{
+    struct tcpipc_epoll_t *ep = (struct tcpipc_epoll_t *)argv;
+    struct epoll_event events[TCPIPC_EPOLL_MAX_EVENTS];
+    struct tcpipc_epoll_conn_t *conn;
+    int n;
+
+    while (!atomic_load(&ep->exit_status))
+    {
+        n = epoll_wait(ep->epoll_fd, events, TCPIPC_EPOLL_MAX_EVENTS, -1);
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            perror("Server: Event loop failed");
+            break;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            if (events[i].data.ptr == NULL)
+            {
+                tcpipc_epoll_accept(ep);
+                continue;
+            }
+
+            if (events[i].data.ptr == ep)
+                continue;
+
+            conn = (struct tcpipc_epoll_conn_t *)events[i].data.ptr;
+
+            // Dropped earlier in this batch
+            if (atomic_load(&conn->state) != TCPIPC_CONN_OPEN)
+                continue;
+
+            // Drain pending data first so a peer's last frames are not lost
+            if (events[i].events & EPOLLIN)
+                tcpipc_epoll_read(ep, conn);
+
+            if (atomic_load(&conn->state) == TCPIPC_CONN_OPEN &&
+                (events[i].events & EPOLLOUT))
+                tcpipc_epoll_write(ep, conn);
+
+            if (atomic_load(&conn->state) == TCPIPC_CONN_OPEN &&
+                (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)))
+                tcpipc_epoll_drop(ep, conn);
+        }
+    }
+
+    return NULL;
+}
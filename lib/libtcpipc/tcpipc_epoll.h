@@ -0,0 +1,156 @@
+/*******************************************************************************
+ * @file    tcpipc_epoll.h
+ * @brief   Multi-connection server mode for libtcpipc. A single edge-triggered
+ *          epoll loop accepts and serves every peer, each connection keeping
+ *          its own receive state and receive queue.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_EPOLL_H
+#define TCPIPC_EPOLL_H
+
+/** Standard libraries **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+
+/** Application specififc libraries **/
+#include "tcpipc.h"
+#include "tcpipc_cb_fifo.h"
+#include "tcpipc_txq.h"
+
+/** Defines  **/
+#define TCPIPC_EPOLL_MAX_EVENTS (64)
+#define TCPIPC_EPOLL_SPILL_MAX (4 << 20)
+
+/** User Data Types **/
+struct tcpipc_epoll_t;
+
+enum tcpipc_conn_state_e
+{
+    TCPIPC_CONN_FREE = 0,
+    TCPIPC_CONN_OPEN,
+    TCPIPC_CONN_CLOSED
+};
+
+/*
+ * fd stays open while the slot is CLOSED, only shut down, so a concurrent
+ * tcpipc_epoll_send() fails on it instead of writing to a descriptor reused
+ * for a new peer. It is closed by tcpipc_epoll_release(). rx_drops counts
+ * frames lost to a full queue or malformed, and is reset for every new peer.
+ *
+ * Senders take tx_lock. The socket is non-blocking and txq never waits: what
+ * the socket does not take stays in its spill, EPOLLOUT is armed (tx_armed)
+ * and the event loop writes the rest. A peer whose spill grows past
+ * TCPIPC_EPOLL_SPILL_MAX, or a failed write, shuts the connection down so no
+ * torn frame is ever followed by another one.
+ */
+struct tcpipc_epoll_conn_t
+{
+    struct tcpipc_epoll_t *ep;
+    int id;
+    int fd;
+    struct sockaddr_in addr;
+    socklen_t addr_len;
+    atomic_int state;
+    atomic_uint_fast64_t rx_drops;
+    pthread_mutex_t tx_lock;
+    struct tcpipc_txq_t txq;
+    int tx_armed;
+    struct tcpipc_decoder_t decoder;
+    struct recv_msg_cb_t recv_cb;
+};
+
+struct tcpipc_epoll_t
+{
+    struct socket_info_t server_info;
+    struct tcpipc_opts_t opts;
+    int epoll_fd;
+    int event_fd;
+    int max_conns;
+    struct tcpipc_epoll_conn_t *conns;
+    pthread_t tid;
+    atomic_int exit_status;
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Starts listening on the given port and spawns the event loop thread
+ *          serving up to max_conns simultaneous peers. opts may be NULL.
+ *          Every connection gets a receive queue sized by rx_queue_len and
+ *          rx_queue_max; the BLOCK overflow policy is refused, it would park
+ *          the loop serving all peers.
+ *
+ * @return  Server handle on success, NULL on failure
+ *******************************************************************************/
+struct tcpipc_epoll_t *tcpipc_epoll_open(int port, int max_conns,
+                                         const struct tcpipc_opts_t *opts);
+
+/*******************************************************************************
+ * @brief   Stops the event loop, closes every connection and frees the handle.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_epoll_close(struct tcpipc_epoll_t *ep);
+
+/*******************************************************************************
+ * @brief   Sends a message to the peer on the given connection. Never blocks,
+ *          a frame the socket can not take at once is finished by the event
+ *          loop. Safe to call from several threads.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_epoll_send(struct tcpipc_epoll_t *ep, int conn_id,
+                      struct msg_packet_t *msg_packet);
+
+/*******************************************************************************
+ * @brief   Sends a message on channel chan to the peer on the given
+ *          connection, see channels in tcpipc_opts_t. tcpipc_epoll_send()
+ *          uses channel 0.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_epoll_send_chan(struct tcpipc_epoll_t *ep, int conn_id,
+                           uint8_t chan, struct msg_packet_t *msg_packet);
+
+/*******************************************************************************
+ * @brief   Dequeues the oldest message received on the given connection.
+ *
+ * @return  0 on success, -1 if no message is pending
+ *******************************************************************************/
+int tcpipc_epoll_recv(struct tcpipc_epoll_t *ep, int conn_id,
+                      struct msg_packet_t *msg_packet);
+
+/*******************************************************************************
+ * @brief   Returns the state of the given connection slot.
+ *
+ * @return  One of tcpipc_conn_state_e
+ *******************************************************************************/
+enum tcpipc_conn_state_e tcpipc_epoll_conn_state(struct tcpipc_epoll_t *ep,
+                                                 int conn_id);
+
+/*******************************************************************************
+ * @brief   Returns the number of frames dropped on the given connection
+ *          because its receive queue was full or they were malformed.
+ *
+ * @return  Drop count
+ *******************************************************************************/
+uint64_t tcpipc_epoll_conn_drops(struct tcpipc_epoll_t *ep, int conn_id);
+
+/*******************************************************************************
+ * @brief   Frees a closed connection slot once its queue has been drained so
+ *          it can be reused for a new peer. Closes the connection socket
+ *          under the slot's tx_lock, a concurrent tcpipc_epoll_send() fails.
+ *
+ * @return  0 on success, -1 if the slot is not closed
+ *******************************************************************************/
+int tcpipc_epoll_release(struct tcpipc_epoll_t *ep, int conn_id);
+
+#endif // TCPIPC_EPOLL_H
@@ -0,0 +1,164 @@
+/*******************************************************************************
+ * @file    tcpipc_flight.c
+ * @brief   Flight recorder ring and its dump file, see tcpipc_flight.h.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "tcpipc_flight.h"
+
+/** Private Function Prototypes **/
+static int tcpipc_flight_write(int fd, const void *buf, size_t len);
+
+/*******************************************************************************
+ * @brief   Allocates a ring of len records, rounded up to a power of two.
+ *          The dump path is built here, a signal handler can not format it.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_flight_init(struct tcpipc_flight_t *fr, size_t len, const char *dir,
+                       int port, const char *role)
+{
+    size_t capacity = 1;
+
+    memset(fr, 0, sizeof(struct tcpipc_flight_t));
+
+    if (len == 0)
+        return -1;
+
+    while (capacity < len)
+        capacity <<= 1;
+
+    fr->slots = (struct tcpipc_flight_slot_t *)
+        calloc(capacity, sizeof(struct tcpipc_flight_slot_t));
+
+    if (fr->slots == NULL)
+    {
+        perror("Failed to allocate flight recorder");
+        return -1;
+    }
+
+    fr->mask = capacity - 1;
+    fr->port = port;
+    snprintf(fr->path, sizeof(fr->path), "%s/tcpipc_flight.%d.%d.%s.bin",
+             dir ? dir : ".", (int)getpid(), port, role);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Frees the ring. Recording on a freed or never initialized ring is
+ *          a no-op.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_flight_free(struct tcpipc_flight_t *fr)
+{
+    free(fr->slots);
+    fr->slots = NULL;
+}
+
+/*******************************************************************************
+ * @brief   Writes the ring to its dump file, oldest record first. Records
+ *          being written during the dump are left out. Only uses
+ *          async-signal-safe calls.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_flight_dump(struct tcpipc_flight_t *fr)
+{
+    struct tcpipc_flight_rec_t chunk[TCPIPC_FLIGHT_DUMP_CHUNK];
+    struct tcpipc_flight_slot_t *slot;
+    struct tcpipc_flight_hdr_t hdr;
+    uint64_t head, pos;
+    unsigned int seq;
+    int fd, used = 0, ret = 0;
+
+    if (fr->slots == NULL)
+        return -1;
+
+    fd = open(fr->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+        return -1;
+
+    head = atomic_load_explicit(&fr->head, memory_order_acquire);
+    pos = head > fr->mask + 1 ? head - (fr->mask + 1) : 0;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, TCPIPC_FLIGHT_MAGIC, sizeof(hdr.magic));
+    hdr.version = TCPIPC_FLIGHT_VERSION;
+    hdr.rec_size = sizeof(struct tcpipc_flight_rec_t);
+    hdr.port = fr->port;
+    hdr.lost = pos;
+    hdr.dump_ns = tcpipc_now_ns();
+
+    // Placeholder, rewritten once the record count is known
+    ret |= tcpipc_flight_write(fd, &hdr, sizeof(hdr));
+
+    for (; pos < head; pos++)
+    {
+        slot = &fr->slots[pos & fr->mask];
+        seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+
+        if (seq != (unsigned int)(pos + 1))
+            continue;
+
+        chunk[used] = slot->rec;
+        atomic_thread_fence(memory_order_acquire);
+
+        // Overwritten while copying
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq)
+            continue;
+
+        hdr.count++;
+
+        if (++used == TCPIPC_FLIGHT_DUMP_CHUNK)
+        {
+            ret |= tcpipc_flight_write(fd, chunk, sizeof(chunk));
+            used = 0;
+        }
+    }
+
+    ret |= tcpipc_flight_write(fd, chunk, used * sizeof(chunk[0]));
+
+    if (lseek(fd, 0, SEEK_SET) == 0)
+        ret |= tcpipc_flight_write(fd, &hdr, sizeof(hdr));
+    else
+        ret = -1;
+
+    close(fd);
+
+    return ret ? -1 : 0;
+}
+
+/*******************************************************************************
+ * @brief   write() that finishes short writes.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int tcpipc_flight_write(int fd, const void *buf, size_t len)
+{
+    const uint8_t *pos = (const uint8_t *)buf;
+    ssize_t ret;
+
+    while (len)
+    {
+        ret = write(fd, pos, len);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        if (ret <= 0)
+            return -1;
+
+        pos += ret;
+        len -= ret;
+    }
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ * @file    tcpipc_flight.h
+ * @brief   Flight recorder. A fixed-size ring keeps the header, time stamp
+ *          and direction of the most recent frames of a connection. Any
+ *          thread records with one atomic increment and no lock; the ring is
+ *          written to a file on demand, from a signal handler or when the
+ *          connection is lost, and read back with the flightdec tool.
+ *
+ *          Dump file: | tcpipc_flight_hdr_t | tcpipc_flight_rec_t ... |,
+ *          oldest record first, in host byte order.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_FLIGHT_H
+#define TCPIPC_FLIGHT_H
+
+/** Standard libraries **/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <stdalign.h>
+
+/** Application specififc libraries **/
+#include "tcpipc_txq.h"
+
+/** Defines  **/
+#define TCPIPC_FLIGHT_MAGIC "TCPIPCFR"
+#define TCPIPC_FLIGHT_VERSION (1)
+#define TCPIPC_FLIGHT_PATH_MAX (256)
+#define TCPIPC_FLIGHT_DUMP_CHUNK (64)
+
+/** User Data Types **/
+enum tcpipc_flight_dir_e
+{
+    TCPIPC_FLIGHT_TX = 1,
+    TCPIPC_FLIGHT_RX,
+    TCPIPC_FLIGHT_DROP,
+    TCPIPC_FLIGHT_UP,
+    TCPIPC_FLIGHT_DOWN
+};
+
+/*
+ * One record as stored in a dump. DROP is a received frame the queue had no
+ * room for, UP and DOWN mark the connection coming up and going away.
+ */
+struct tcpipc_flight_rec_t
+{
+    uint64_t ns;
+    uint32_t msg_len;
+    uint8_t dir;
+    uint8_t msg_id;
+    uint16_t reserved;
+};
+
+/*
+ * Dump file header. lost counts records overwritten before the dump, count
+ * the records that follow. Time stamps are tcpipc_now_ns() of the dumping
+ * process, dump_ns tells when the dump was taken.
+ */
+struct tcpipc_flight_hdr_t
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t rec_size;
+    uint32_t port;
+    uint32_t count;
+    uint64_t lost;
+    uint64_t dump_ns;
+};
+
+/*
+ * A slot is valid while seq holds its ring position plus one. Writers clear
+ * seq before filling the slot and publish it last, so a dump that races a
+ * writer skips the slot instead of copying a torn record.
+ */
+struct tcpipc_flight_slot_t
+{
+    atomic_uint seq;
+    struct tcpipc_flight_rec_t rec;
+};
+
+struct tcpipc_flight_t
+{
+    alignas(64) atomic_uint_fast64_t head;
+    struct tcpipc_flight_slot_t *slots;
+    size_t mask;
+    uint32_t port;
+    char path[TCPIPC_FLIGHT_PATH_MAX];
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Allocates a ring of len records, rounded up to a power of two.
+ *          Dumps go to <dir>/tcpipc_flight.<pid>.<port>.<role>.bin.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_flight_init(struct tcpipc_flight_t *fr, size_t len, const char *dir,
+                       int port, const char *role);
+
+/*******************************************************************************
+ * @brief   Frees the ring. Recording on a freed or never initialized ring is
+ *          a no-op.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_flight_free(struct tcpipc_flight_t *fr);
+
+/*******************************************************************************
+ * @brief   Writes the ring to its dump file. Async-signal-safe.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_flight_dump(struct tcpipc_flight_t *fr);
+
+/*******************************************************************************
+ * @brief   Records one event. Safe from any thread.
+ *
+ * @return
+ *******************************************************************************/
+static inline void tcpipc_flight_record(struct tcpipc_flight_t *fr,
+                                        uint8_t dir, uint8_t msg_id,
+                                        uint32_t msg_len)
+{
+    struct tcpipc_flight_slot_t *slot;
+    uint64_t pos;
+
+    if (fr->slots == NULL)
+        return;
+
+    pos = atomic_fetch_add_explicit(&fr->head, 1, memory_order_relaxed);
+    slot = &fr->slots[pos & fr->mask];
+
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->rec.ns = tcpipc_now_ns();
+    slot->rec.msg_len = msg_len;
+    slot->rec.dir = dir;
+    slot->rec.msg_id = msg_id;
+
+    atomic_store_explicit(&slot->seq, (unsigned int)(pos + 1),
+                          memory_order_release);
+}
+
+#endif // TCPIPC_FLIGHT_H
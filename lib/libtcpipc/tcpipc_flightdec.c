@@ -0,0 +1,142 @@
+/*******************************************************************************
+ * @file    tcpipc_flightdec.c
+ * @brief   Decoder for flight recorder dumps. Prints one line per record with
+ *          its time relative to the first record, the gap to the previous
+ *          one, the direction and the frame header. -c prints CSV with
+ *          absolute tcpipc_now_ns() time stamps instead.
+ *
+ *          Usage: tcpipc_flightdec [-c] dump...
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <unistd.h>
+
+#include "tcpipc_flight.h"
+
+/** Private Function Prototypes **/
+static int flightdec_file(const char *path, int csv);
+static const char *flightdec_dir_name(uint8_t dir);
+
+int main(int argc, char **argv)
+{
+    int csv = 0, ret = EXIT_SUCCESS, opt;
+
+    while ((opt = getopt(argc, argv, "c")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            csv = 1;
+            break;
+        default:
+            printf("Usage: %s [-c] dump...\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        printf("Usage: %s [-c] dump...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (; optind < argc; optind++)
+    {
+        if (flightdec_file(argv[optind], csv))
+            ret = EXIT_FAILURE;
+    }
+
+    return ret;
+}
+
+/*******************************************************************************
+ * @brief   Decodes one dump file to stdout.
+ *
+ * @return  0 on success, -1 if the file can not be read
+ *******************************************************************************/
+static int flightdec_file(const char *path, int csv)
+{
+    struct tcpipc_flight_hdr_t hdr;
+    struct tcpipc_flight_rec_t rec;
+    uint64_t first_ns = 0, prev_ns = 0;
+    uint32_t index = 0;
+    FILE *file;
+
+    file = fopen(path, "rb");
+
+    if (file == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    if (fread(&hdr, sizeof(hdr), 1, file) != 1 ||
+        memcmp(hdr.magic, TCPIPC_FLIGHT_MAGIC, sizeof(hdr.magic)) ||
+        hdr.version != TCPIPC_FLIGHT_VERSION || hdr.rec_size != sizeof(rec))
+    {
+        printf("%s: Not a flight recorder dump of this version\n", path);
+        fclose(file);
+        return -1;
+    }
+
+    if (csv)
+        printf("port,index,ns,dir,msg_id,msg_len\n");
+    else
+        printf("# %s: port %u, %u records, %llu lost before, dumped at %llu\n"
+               "%8s %14s %12s %-5s %6s %8s\n",
+               path, hdr.port, hdr.count, (unsigned long long)hdr.lost,
+               (unsigned long long)hdr.dump_ns, "index", "time_us", "gap_us",
+               "dir", "msg_id", "msg_len");
+
+    // Reads to the end, a dump cut short still decodes up to the cut
+    while (fread(&rec, sizeof(rec), 1, file) == 1)
+    {
+        if (index == 0)
+            first_ns = prev_ns = rec.ns;
+
+        if (csv)
+            printf("%u,%u,%llu,%s,%u,%u\n", hdr.port, index,
+                   (unsigned long long)rec.ns, flightdec_dir_name(rec.dir),
+                   rec.msg_id, rec.msg_len);
+        else
+            printf("%8u %14.3f %12.3f %-5s %6u %8u\n", index,
+                   (rec.ns - first_ns) / 1000.0, (rec.ns - prev_ns) / 1000.0,
+                   flightdec_dir_name(rec.dir), rec.msg_id, rec.msg_len);
+
+        prev_ns = rec.ns;
+        index++;
+    }
+
+    if (index != hdr.count)
+        printf("# %s: expected %u records, found %u\n", path, hdr.count,
+               index);
+
+    fclose(file);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Name of a record direction.
+ *
+ * @return  Name, "?" for unknown values
+ *******************************************************************************/
+static const char *flightdec_dir_name(uint8_t dir)
+{
+    switch (dir)
+    {
+    case TCPIPC_FLIGHT_TX:
+        return "TX";
+    case TCPIPC_FLIGHT_RX:
+        return "RX";
+    case TCPIPC_FLIGHT_DROP:
+        return "DROP";
+    case TCPIPC_FLIGHT_UP:
+        return "UP";
+    case TCPIPC_FLIGHT_DOWN:
+        return "DOWN";
+    default:
+        return "?";
+    }
+}
@@ -0,0 +1,50 @@
+/*******************************************************************************
+ * @file    tcpipc_futex.h
+ * @brief   Thin futex wrappers. The words may live in memory shared between
+ *          processes, so the non-private operations are used.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_FUTEX_H
+#define TCPIPC_FUTEX_H
+
+/** Standard libraries **/
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/*******************************************************************************
+ * @brief   Sleeps while *word still equals val, up to timeout_ms (negative
+ *          waits forever). Returns early on wake-ups and signals.
+ *
+ * @return
+ *******************************************************************************/
+static inline void tcpipc_futex_wait(atomic_uint *word, unsigned int val,
+                                     int timeout_ms)
+{
+    struct timespec ts;
+
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+
+    syscall(SYS_futex, (unsigned int *)word, FUTEX_WAIT, val,
+            timeout_ms < 0 ? NULL : &ts, NULL, 0);
+}
+
+/*******************************************************************************
+ * @brief   Wakes every waiter sleeping on word.
+ *
+ * @return
+ *******************************************************************************/
+static inline void tcpipc_futex_wake(atomic_uint *word)
+{
+    syscall(SYS_futex, (unsigned int *)word, FUTEX_WAKE, INT_MAX, NULL, NULL,
+            0);
+}
+
+#endif // TCPIPC_FUTEX_H
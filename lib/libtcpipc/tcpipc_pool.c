@@ -0,0 +1,191 @@
+/*******************************************************************************
+ * @file    tcpipc_pool.c
+ * @brief   Payload storage for received messages. Small payloads live inline
+ *          in the message, larger ones come from a fixed-size block pool owned
+ *          by the library so the receive path does not touch the heap.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include "tcpipc_pool.h"
+
+/*
+ * Free blocks form a lock-free stack threaded through pool_links. The stack
+ * head packs a generation tag in the upper 32 bits and the block index plus
+ * one in the lower 32 bits, the tag protects pops against ABA. Blocks that
+ * were never handed out are taken from pool_fresh instead, so the pool needs
+ * no initialization.
+ */
+#define POOL_IDX(head) ((uint32_t)((head) & 0xFFFFFFFF))
+#define POOL_TAG(head) ((head) >> 32)
+#define POOL_HEAD(tag, idx) (((uint64_t)(tag) << 32) | (idx))
+
+/** Global Variables **/
+static uint8_t pool_blocks[TCPIPC_POOL_BLOCKS][TCPIPC_POOL_BLOCK_SIZE];
+static atomic_uint_fast32_t pool_links[TCPIPC_POOL_BLOCKS];
+static atomic_uint_fast64_t pool_head;
+static atomic_uint_fast32_t pool_fresh;
+
+static atomic_uint_fast64_t stat_inline_allocs;
+static atomic_uint_fast64_t stat_pool_allocs;
+static atomic_uint_fast64_t stat_pool_frees;
+static atomic_uint_fast64_t stat_heap_allocs;
+static atomic_uint_fast64_t stat_heap_frees;
+static atomic_uint_fast64_t stat_pool_exhausted;
+
+/** Private Function Prototypes **/
+static uint8_t *tcpipc_pool_get();
+static void tcpipc_pool_put(uint8_t *block);
+
+/*******************************************************************************
+ * @brief   Reserves len bytes of payload storage for msg and points msg_data at
+ *          it. Falls back to the heap only when the pool is exhausted or the
+ *          payload is larger than a pool block.
+ *
+ * @return  Pointer to the payload storage, NULL on failure
+ *******************************************************************************/
+uint8_t *msg_packet_alloc(struct msg_packet_t *msg, size_t len)
+{
+    msg->msg_storage = MSG_STORAGE_NONE;
+    msg->msg_data = NULL;
+
+    if (len == 0)
+        return NULL;
+
+    if (len <= MSG_INLINE_MAX)
+    {
+        atomic_fetch_add_explicit(&stat_inline_allocs, 1, memory_order_relaxed);
+        msg->msg_storage = MSG_STORAGE_INLINE;
+        msg->msg_data = msg->msg_inline;
+        return msg->msg_data;
+    }
+
+    if (len <= TCPIPC_POOL_BLOCK_SIZE)
+    {
+        msg->msg_data = tcpipc_pool_get();
+
+        if (msg->msg_data)
+        {
+            atomic_fetch_add_explicit(&stat_pool_allocs, 1,
+                                      memory_order_relaxed);
+            msg->msg_storage = MSG_STORAGE_POOL;
+            return msg->msg_data;
+        }
+
+        atomic_fetch_add_explicit(&stat_pool_exhausted, 1, memory_order_relaxed);
+    }
+
+    msg->msg_data = (uint8_t *)malloc(len);
+
+    if (msg->msg_data)
+    {
+        atomic_fetch_add_explicit(&stat_heap_allocs, 1, memory_order_relaxed);
+        msg->msg_storage = MSG_STORAGE_HEAP;
+    }
+
+    return msg->msg_data;
+}
+
+/*******************************************************************************
+ * @brief   Releases the payload storage of msg, whatever its origin.
+ *
+ * @return
+ *******************************************************************************/
+void msg_packet_free(struct msg_packet_t *msg)
+{
+    switch (msg->msg_storage)
+    {
+    case MSG_STORAGE_POOL:
+        atomic_fetch_add_explicit(&stat_pool_frees, 1, memory_order_relaxed);
+        tcpipc_pool_put(msg->msg_data);
+        break;
+    case MSG_STORAGE_HEAP:
+        atomic_fetch_add_explicit(&stat_heap_frees, 1, memory_order_relaxed);
+        free(msg->msg_data);
+        break;
+    default:
+        break;
+    }
+
+    msg->msg_storage = MSG_STORAGE_NONE;
+    msg->msg_data = NULL;
+}
+
+/*******************************************************************************
+ * @brief   Copies the allocator counters.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_pool_get_stats(struct tcpipc_pool_stats_t *stats)
+{
+    stats->inline_allocs = atomic_load_explicit(&stat_inline_allocs,
+                                                memory_order_relaxed);
+    stats->pool_allocs = atomic_load_explicit(&stat_pool_allocs,
+                                              memory_order_relaxed);
+    stats->pool_frees = atomic_load_explicit(&stat_pool_frees,
+                                             memory_order_relaxed);
+    stats->pool_in_use = stats->pool_allocs - stats->pool_frees;
+    stats->heap_allocs = atomic_load_explicit(&stat_heap_allocs,
+                                              memory_order_relaxed);
+    stats->heap_frees = atomic_load_explicit(&stat_heap_frees,
+                                             memory_order_relaxed);
+    stats->pool_exhausted = atomic_load_explicit(&stat_pool_exhausted,
+                                                 memory_order_relaxed);
+}
+
+/*******************************************************************************
+ * @brief   Pops a free block, or hands out a never used one.
+ *
+ * @return  Block pointer, NULL when the pool is exhausted
+ *******************************************************************************/
+static uint8_t *tcpipc_pool_get()
+{
+    uint64_t head, next;
+    uint32_t idx;
+
+    head = atomic_load_explicit(&pool_head, memory_order_acquire);
+
+    while (POOL_IDX(head))
+    {
+        idx = POOL_IDX(head) - 1;
+        next = POOL_HEAD(POOL_TAG(head) + 1,
+                         atomic_load_explicit(&pool_links[idx],
+                                              memory_order_relaxed));
+
+        if (atomic_compare_exchange_weak_explicit(&pool_head, &head, next,
+                                                  memory_order_acquire,
+                                                  memory_order_acquire))
+            return pool_blocks[idx];
+    }
+
+    idx = atomic_fetch_add_explicit(&pool_fresh, 1, memory_order_relaxed);
+
+    if (idx < TCPIPC_POOL_BLOCKS)
+        return pool_blocks[idx];
+
+    atomic_store_explicit(&pool_fresh, TCPIPC_POOL_BLOCKS, memory_order_relaxed);
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * @brief   Pushes a block back on the free stack.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_pool_put(uint8_t *block)
+{
+    uint32_t idx = (block - &pool_blocks[0][0]) / TCPIPC_POOL_BLOCK_SIZE;
+    uint64_t head, next;
+
+    head = atomic_load_explicit(&pool_head, memory_order_relaxed);
+
+    do
+    {
+        atomic_store_explicit(&pool_links[idx], POOL_IDX(head),
+                              memory_order_relaxed);
+        next = POOL_HEAD(POOL_TAG(head) + 1, idx + 1);
+    } while (!atomic_compare_exchange_weak_explicit(&pool_head, &head, next,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
@@ -0,0 +1,64 @@
+/*******************************************************************************
+ * @file    tcpipc_pool.h
+ * @brief   Payload storage for received messages. Small payloads live inline
+ *          in the message, larger ones come from a fixed-size block pool owned
+ *          by the library so the receive path does not touch the heap.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_POOL_H
+#define TCPIPC_POOL_H
+
+/** Standard libraries **/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+/** Application specififc libraries **/
+#include "tcpipc_cb_fifo.h"
+
+/** Defines  **/
+#define TCPIPC_POOL_BLOCK_SIZE (256)
+#define TCPIPC_POOL_BLOCKS (256)
+
+/** User Data Types **/
+struct tcpipc_pool_stats_t
+{
+    uint64_t inline_allocs;
+    uint64_t pool_allocs;
+    uint64_t pool_frees;
+    uint64_t pool_in_use;
+    uint64_t heap_allocs;
+    uint64_t heap_frees;
+    uint64_t pool_exhausted;
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Reserves len bytes of payload storage for msg and points msg_data at
+ *          it. Falls back to the heap only when the pool is exhausted or the
+ *          payload is larger than a pool block.
+ *
+ * @return  Pointer to the payload storage, NULL on failure
+ *******************************************************************************/
+uint8_t *msg_packet_alloc(struct msg_packet_t *msg, size_t len);
+
+/*******************************************************************************
+ * @brief   Releases the payload storage of msg, whatever its origin.
+ *
+ * @return
+ *******************************************************************************/
+void msg_packet_free(struct msg_packet_t *msg);
+
+/*******************************************************************************
+ * @brief   Copies the allocator counters.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_pool_get_stats(struct tcpipc_pool_stats_t *stats);
+
+#endif // TCPIPC_POOL_H
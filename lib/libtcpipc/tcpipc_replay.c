@@ -0,0 +1,217 @@
+/*******************************************************************************
+ * @file    tcpipc_replay.c
+ * @brief   Plays a capture file into a tcpipc endpoint. Every message goes
+ *          out on its captured channel with its captured ID, spaced like the
+ *          captured arrivals divided by the speed; a speed of 0 sends as fast
+ *          as possible. Messages larger than a bulk fragment are sent with
+ *          tcpipc_bulk_send(). Prints the messages sent, the time taken and
+ *          the worst lateness against the schedule.
+ *
+ *          Usage: tcpipc_replay [-x speed] [-S] [-a addr] [-p port]
+ *                               [-t tcp|shm|udp] [-c channels] [-b] capture
+ *
+ *          By default it connects to 127.0.0.1:9000 as a client, -S waits
+ *          for the endpoint as a server instead. -c must match the channels
+ *          of the endpoint, -b batches sends.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tcpipc.h"
+
+/** Defines  **/
+#define REPLAY_BULK_TIMEOUT_MS (10000)
+
+/** Private Function Prototypes **/
+static void replay_usage(const char *name);
+static void replay_sleep_until(uint64_t ns);
+static int replay_send(struct tcpipc_ctx *ctx,
+                       const struct tcpipc_opts_t *opts,
+                       const struct tcpipc_capture_rec_t *rec,
+                       const uint8_t *data);
+
+int main(int argc, char **argv)
+{
+    struct tcpipc_capture_map_t map;
+    const struct tcpipc_capture_rec_t *rec;
+    const uint8_t *data;
+    struct tcpipc_opts_t opts;
+    struct tcpipc_ctx *ctx;
+    enum tcp_role_e role = TCP_ROLE_CLIENT;
+    char *addr = "127.0.0.1";
+    double speed = 1.0;
+    uint64_t first_ns = 0, start_ns = 0, due_ns, now_ns, late_max_ns = 0;
+    uint64_t count = 0, bytes = 0;
+    int port = 9000, ret = EXIT_SUCCESS, opt;
+
+    tcpipc_opts_default(&opts);
+
+    while ((opt = getopt(argc, argv, "x:Sa:p:t:c:b")) != -1)
+    {
+        switch (opt)
+        {
+        case 'x':
+            speed = atof(optarg);
+            break;
+        case 'S':
+            role = TCP_ROLE_SERVER;
+            break;
+        case 'a':
+            addr = optarg;
+            break;
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 't':
+            if (strcmp(optarg, "tcp") == 0)
+                opts.transport = TCPIPC_TRANSPORT_TCP;
+            else if (strcmp(optarg, "udp") == 0)
+                opts.transport = TCPIPC_TRANSPORT_UDP;
+            else if (strcmp(optarg, "shm") == 0)
+                opts.transport = TCPIPC_TRANSPORT_SHM;
+            else
+            {
+                printf("Unknown transport: %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'c':
+            opts.channels = atoi(optarg);
+            break;
+        case 'b':
+            opts.tx_batch = 1;
+            break;
+        default:
+            replay_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (optind != argc - 1 || speed < 0)
+    {
+        replay_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (tcpipc_capture_map(&map, argv[optind]))
+        return EXIT_FAILURE;
+
+    ctx = tcpipc_init_opts(role, role == TCP_ROLE_SERVER ? NULL : addr, port,
+                           &opts);
+
+    if (ctx == NULL)
+    {
+        tcpipc_capture_unmap(&map);
+        return EXIT_FAILURE;
+    }
+
+    while ((rec = tcpipc_capture_next(&map, &data)) != NULL)
+    {
+        if (count == 0)
+        {
+            first_ns = rec->ns;
+            start_ns = tcpipc_now_ns();
+        }
+
+        // Keep the captured spacing, a late message goes out at once
+        if (speed > 0)
+        {
+            due_ns = start_ns + (uint64_t)((rec->ns - first_ns) / speed);
+            now_ns = tcpipc_now_ns();
+
+            if (due_ns > now_ns)
+            {
+                tcpipc_flush(ctx);
+                replay_sleep_until(due_ns);
+            }
+            else if (now_ns - due_ns > late_max_ns)
+                late_max_ns = now_ns - due_ns;
+        }
+
+        if (replay_send(ctx, &opts, rec, data))
+        {
+            printf("Failed to send message %llu\n", (unsigned long long)count);
+            ret = EXIT_FAILURE;
+            break;
+        }
+
+        count++;
+        bytes += rec->msg_len;
+    }
+
+    tcpipc_flush(ctx);
+    now_ns = tcpipc_now_ns();
+
+    printf("%llu messages, %llu bytes in %.3f ms, late by up to %.3f us\n",
+           (unsigned long long)count, (unsigned long long)bytes,
+           count ? (now_ns - start_ns) / 1e6 : 0.0, late_max_ns / 1e3);
+
+    tcpipc_close(ctx);
+    tcpipc_capture_unmap(&map);
+
+    return ret;
+}
+
+/*******************************************************************************
+ * @brief   Prints the command line.
+ *
+ * @return
+ *******************************************************************************/
+static void replay_usage(const char *name)
+{
+    printf("Usage: %s [-x speed] [-S] [-a addr] [-p port] [-t tcp|shm|udp] "
+           "[-c channels] [-b] capture\n",
+           name);
+}
+
+/*******************************************************************************
+ * @brief   Sleeps until tcpipc_now_ns() reaches ns.
+ *
+ * @return
+ *******************************************************************************/
+static void replay_sleep_until(uint64_t ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+
+    // Absolute, so a retry after a signal does not sleep longer
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+           EINTR)
+        ;
+}
+
+/*******************************************************************************
+ * @brief   Sends one captured message, as a bulk transfer when it does not
+ *          fit a fragment.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int replay_send(struct tcpipc_ctx *ctx,
+                       const struct tcpipc_opts_t *opts,
+                       const struct tcpipc_capture_rec_t *rec,
+                       const uint8_t *data)
+{
+    struct msg_packet_t msg;
+
+    if (rec->msg_len > opts->bulk_frag_len)
+    {
+        if (tcpipc_bulk_send(ctx, rec->msg_chan, rec->msg_id, data,
+                             rec->msg_len))
+            return -1;
+
+        return tcpipc_bulk_wait(ctx, REPLAY_BULK_TIMEOUT_MS);
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_id = rec->msg_id;
+    msg.msg_len = rec->msg_len;
+    msg.msg_data = (uint8_t *)data;
+
+    return tcpipc_send_chan(ctx, rec->msg_chan, &msg);
+}
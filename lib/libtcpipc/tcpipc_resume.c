@@ -0,0 +1,343 @@
+/*******************************************************************************
+ * @file    tcpipc_resume.c
+ * @brief   Send log and handshake of session resume, see tcpipc_resume.h.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <unistd.h>
+#include <sys/random.h>
+
+#include "tcpipc_resume.h"
+
+/** Defines  **/
+#define TCPIPC_RESUME_ENT_HDR (4)
+#define TCPIPC_RESUME_WRAP (0xFFFFFFFFU)
+
+/** Private Function Prototypes **/
+static size_t tcpipc_resume_ent_size(size_t len);
+static long tcpipc_resume_fit(struct tcpipc_resume_t *r, size_t need);
+static void tcpipc_resume_drop(struct tcpipc_resume_t *r);
+static void tcpipc_resume_trim(struct tcpipc_resume_t *r);
+
+/*******************************************************************************
+ * @brief   Allocates a send log of size bytes and picks the session ID.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_resume_init(struct tcpipc_resume_t *r, size_t size)
+{
+    memset(r, 0, sizeof(struct tcpipc_resume_t));
+
+    // Entries are kept four byte aligned
+    size &= ~(size_t)3;
+
+    if (size < TCPIPC_RESUME_ENT_HDR * 2)
+        return -1;
+
+    r->buf = (uint8_t *)malloc(size);
+
+    if (r->buf == NULL)
+    {
+        perror("Failed to allocate send log");
+        return -1;
+    }
+
+    r->size = size;
+
+    // Only has to differ from the peer's previous sessions
+    if (getrandom(&r->session, sizeof(r->session), GRND_NONBLOCK) !=
+        sizeof(r->session))
+        r->session = tcpipc_now_ns() ^ ((uint64_t)getpid() << 32);
+
+    r->session |= 1;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Frees the send log.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_resume_free(struct tcpipc_resume_t *r)
+{
+    free(r->buf);
+    r->buf = NULL;
+}
+
+/*******************************************************************************
+ * @brief   Empties the log and numbers frames from zero again, for a peer
+ *          that started a new session.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_resume_reset(struct tcpipc_resume_t *r)
+{
+    r->rd = 0;
+    r->wr = 0;
+    r->first_seq = 0;
+    r->next_seq = 0;
+    atomic_store_explicit(&r->acked, 0, memory_order_relaxed);
+}
+
+/*******************************************************************************
+ * @brief   Numbers one frame and stores it. Acknowledged frames are dropped
+ *          first; when that is not enough the oldest ones go too if may_drop
+ *          is set. A frame larger than the whole log is numbered but can not
+ *          be kept.
+ *
+ * @return  0 on success, -1 if the frame does not fit
+ *******************************************************************************/
+int tcpipc_resume_log(struct tcpipc_resume_t *r, const uint8_t *hdr,
+                      size_t hdr_len, const uint8_t *data, size_t len,
+                      int may_drop)
+{
+    size_t need = tcpipc_resume_ent_size(hdr_len + len);
+    uint32_t ent_len = hdr_len + len;
+    uint32_t wrap = TCPIPC_RESUME_WRAP;
+    long pos;
+
+    tcpipc_resume_trim(r);
+
+    if (need > r->size)
+    {
+        if (!may_drop)
+            return -1;
+
+        r->next_seq++;
+        r->first_seq = r->next_seq;
+        r->rd = 0;
+        r->wr = 0;
+
+        return 0;
+    }
+
+    while ((pos = tcpipc_resume_fit(r, need)) < 0)
+    {
+        if (!may_drop)
+            return -1;
+
+        tcpipc_resume_drop(r);
+    }
+
+    // The rest of the arena is skipped, the entry starts over at the front
+    if (pos == 0 && r->wr != 0)
+        memcpy(r->buf + r->wr, &wrap, sizeof(wrap));
+
+    memcpy(r->buf + pos, &ent_len, sizeof(ent_len));
+    memcpy(r->buf + pos + TCPIPC_RESUME_ENT_HDR, hdr, hdr_len);
+
+    if (len)
+        memcpy(r->buf + pos + TCPIPC_RESUME_ENT_HDR + hdr_len, data, len);
+
+    r->wr = pos + need;
+
+    if (r->wr == r->size)
+        r->wr = 0;
+
+    r->next_seq++;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Writes every logged frame numbered start or later through txq.
+ *
+ * @return  Number of frames written, -1 on write error
+ *******************************************************************************/
+int64_t tcpipc_resume_replay(struct tcpipc_resume_t *r, uint64_t start,
+                             struct tcpipc_txq_t *txq)
+{
+    struct iovec iov[TCPIPC_RESUME_IOV_MAX];
+    size_t pos;
+    uint32_t len;
+    int64_t count = 0;
+    int iovcnt = 0;
+
+    tcpipc_resume_trim(r);
+    pos = r->rd;
+
+    for (uint64_t seq = r->first_seq; seq < r->next_seq; seq++)
+    {
+        memcpy(&len, r->buf + pos, sizeof(len));
+
+        if (len == TCPIPC_RESUME_WRAP)
+        {
+            pos = 0;
+            memcpy(&len, r->buf, sizeof(len));
+        }
+
+        if (seq >= start)
+        {
+            if (iovcnt == TCPIPC_RESUME_IOV_MAX)
+            {
+                if (tcpipc_txq_writev(txq, iov, iovcnt, tcpipc_now_ns()))
+                    return -1;
+
+                iovcnt = 0;
+            }
+
+            iov[iovcnt].iov_base = r->buf + pos + TCPIPC_RESUME_ENT_HDR;
+            iov[iovcnt].iov_len = len;
+            iovcnt++;
+            count++;
+        }
+
+        pos += tcpipc_resume_ent_size(len);
+
+        if (pos == r->size)
+            pos = 0;
+    }
+
+    if (iovcnt && tcpipc_txq_writev(txq, iov, iovcnt, tcpipc_now_ns()))
+        return -1;
+
+    return count;
+}
+
+/*******************************************************************************
+ * @brief   Writes a RESUME payload for the current state to buf.
+ *
+ * @return  TCPIPC_RESUME_LEN
+ *******************************************************************************/
+size_t tcpipc_resume_put(struct tcpipc_resume_t *r, uint8_t *buf)
+{
+    tcpipc_resume_put64(buf, r->session);
+    tcpipc_resume_put64(buf + 8, r->rx_seq);
+    tcpipc_resume_put64(buf + 16, r->first_seq);
+
+    return TCPIPC_RESUME_LEN;
+}
+
+/*******************************************************************************
+ * @brief   Reads a RESUME payload.
+ *
+ * @return  0 on success, -1 if it is too short
+ *******************************************************************************/
+int tcpipc_resume_get(const uint8_t *data, uint32_t len, uint64_t *session,
+                      uint64_t *received, uint64_t *oldest)
+{
+    if (len < TCPIPC_RESUME_LEN)
+        return -1;
+
+    *session = tcpipc_resume_get64(data);
+    *received = tcpipc_resume_get64(data + 8);
+    *oldest = tcpipc_resume_get64(data + 16);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Writes a 64 bit big endian value, the ACK payload.
+ *
+ * @return  TCPIPC_RESUME_ACK_LEN
+ *******************************************************************************/
+size_t tcpipc_resume_put64(uint8_t *buf, uint64_t val)
+{
+    for (int i = 7; i >= 0; i--)
+    {
+        buf[i] = val;
+        val >>= 8;
+    }
+
+    return TCPIPC_RESUME_ACK_LEN;
+}
+
+/*******************************************************************************
+ * @brief   Reads a 64 bit big endian value.
+ *
+ * @return  Value
+ *******************************************************************************/
+uint64_t tcpipc_resume_get64(const uint8_t *buf)
+{
+    uint64_t val = 0;
+
+    for (int i = 0; i < 8; i++)
+        val = (val << 8) | buf[i];
+
+    return val;
+}
+
+/*******************************************************************************
+ * @brief   Space an entry of len frame bytes takes in the log.
+ *
+ * @return  Entry size
+ *******************************************************************************/
+static size_t tcpipc_resume_ent_size(size_t len)
+{
+    return (TCPIPC_RESUME_ENT_HDR + len + 3) & ~(size_t)3;
+}
+
+/*******************************************************************************
+ * @brief   Finds need contiguous free bytes, behind the newest entry or at
+ *          the front of the arena.
+ *
+ * @return  Offset of the space, -1 if there is none
+ *******************************************************************************/
+static long tcpipc_resume_fit(struct tcpipc_resume_t *r, size_t need)
+{
+    if (r->first_seq == r->next_seq)
+    {
+        r->rd = 0;
+        r->wr = 0;
+    }
+
+    // Free space is wr to the end and the front up to rd
+    if (r->wr > r->rd || r->first_seq == r->next_seq)
+    {
+        if (r->size - r->wr >= need)
+            return r->wr;
+
+        if (r->rd >= need)
+            return 0;
+
+        return -1;
+    }
+
+    if (r->rd - r->wr >= need)
+        return r->wr;
+
+    return -1;
+}
+
+/*******************************************************************************
+ * @brief   Drops the oldest entry.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_resume_drop(struct tcpipc_resume_t *r)
+{
+    uint32_t len;
+
+    if (r->first_seq == r->next_seq)
+        return;
+
+    memcpy(&len, r->buf + r->rd, sizeof(len));
+
+    if (len == TCPIPC_RESUME_WRAP)
+    {
+        r->rd = 0;
+        memcpy(&len, r->buf, sizeof(len));
+    }
+
+    r->rd += tcpipc_resume_ent_size(len);
+
+    if (r->rd == r->size)
+        r->rd = 0;
+
+    r->first_seq++;
+}
+
+/*******************************************************************************
+ * @brief   Drops the entries the peer acknowledged.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_resume_trim(struct tcpipc_resume_t *r)
+{
+    uint64_t acked = atomic_load_explicit(&r->acked, memory_order_acquire);
+
+    while (r->first_seq < acked && r->first_seq < r->next_seq)
+        tcpipc_resume_drop(r);
+}
@@ -0,0 +1,174 @@
+/*******************************************************************************
+ * @file    tcpipc_resume.h
+ * @brief   Session resume over a reconnected stream. Every application frame
+ *          is numbered and kept in a send log until the peer acknowledges
+ *          it. The receiver counts the frames it got and ACKs them in
+ *          batches. After a reconnect both ends open with a RESUME frame
+ *          telling the peer what they received, and each replays what the
+ *          other is missing from its log.
+ *
+ *          ACK payload:    | received (8) |, big endian
+ *          RESUME payload: | session (8) | received (8) | oldest logged (8) |
+ *
+ *          An empty RESUME says the peer closed its handle, the stream is
+ *          then not replaced when it ends.
+ *
+ *          IDs from TCPIPC_MSG_ID_PING to TCPIPC_MSG_ID_RESUME are library
+ *          traffic and are neither numbered nor logged.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_RESUME_H
+#define TCPIPC_RESUME_H
+
+/** Standard libraries **/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+/** Application specififc libraries **/
+#include "tcpipc_clock.h"
+#include "tcpipc_stats.h"
+#include "tcpipc_txq.h"
+
+/** Defines  **/
+#define TCPIPC_MSG_ID_ACK (0xF3)
+#define TCPIPC_MSG_ID_RESUME (0xF4)
+#define TCPIPC_RESUME_LEN (24)
+#define TCPIPC_RESUME_ACK_LEN (8)
+#define TCPIPC_RESUME_DEF_LOG_SIZE (1 << 20)
+#define TCPIPC_RESUME_DEF_BACKOFF_MS (5)
+#define TCPIPC_RESUME_BACKOFF_MAX_MS (250)
+#define TCPIPC_RESUME_CONNECT_MS (250)
+#define TCPIPC_RESUME_ACK_FRAMES (32)
+#define TCPIPC_RESUME_ACK_BYTES (65536)
+#define TCPIPC_RESUME_SILENT_PINGS (4)
+#define TCPIPC_RESUME_IOV_MAX (64)
+
+/** User Data Types **/
+enum tcpipc_link_e
+{
+    TCPIPC_LINK_UP = 0,
+    TCPIPC_LINK_DOWN,
+    TCPIPC_LINK_RESUMING
+};
+
+/*
+ * Resume state of one connection. The log is a ring of frames stored whole,
+ * header included, from rd to wr; first_seq is the number of the oldest one
+ * and next_seq the number the next frame gets. It belongs to the sending
+ * side and is guarded by the transmit lock. acked is the last count the
+ * peer reported, written by the receive thread. The rx fields belong to the
+ * receive thread. epoch counts links lost, a bulk transfer started on an
+ * earlier link can not be finished.
+ */
+struct tcpipc_resume_t
+{
+    uint8_t *buf;
+    size_t size;
+    size_t rd;
+    size_t wr;
+    uint64_t first_seq;
+    uint64_t next_seq;
+    atomic_uint_fast64_t acked;
+    uint64_t session;
+    uint64_t peer_session;
+    uint64_t rx_seq;
+    uint64_t rx_acked;
+    size_t rx_bytes;
+    uint64_t silent_ns;
+    uint64_t last_rx_ns;
+    int peer_closed;
+    atomic_int link;
+    atomic_uint epoch;
+    atomic_uint_fast64_t reconnects;
+    atomic_uint_fast64_t replayed;
+    atomic_uint_fast64_t lost;
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Tells whether frames with msg_id are numbered and logged.
+ *
+ * @return  1 for application frames, 0 for library ones
+ *******************************************************************************/
+static inline int tcpipc_resume_logged(uint8_t msg_id)
+{
+    return msg_id < TCPIPC_MSG_ID_PING || msg_id > TCPIPC_MSG_ID_RESUME;
+}
+
+/*******************************************************************************
+ * @brief   Allocates a send log of size bytes and picks the session ID.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_resume_init(struct tcpipc_resume_t *r, size_t size);
+
+/*******************************************************************************
+ * @brief   Frees the send log.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_resume_free(struct tcpipc_resume_t *r);
+
+/*******************************************************************************
+ * @brief   Empties the log and numbers frames from zero again, for a peer
+ *          that started a new session.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_resume_reset(struct tcpipc_resume_t *r);
+
+/*******************************************************************************
+ * @brief   Numbers one frame and stores it. Acknowledged frames are dropped
+ *          first; when that is not enough the oldest ones go too if may_drop
+ *          is set.
+ *
+ * @return  0 on success, -1 if the frame does not fit
+ *******************************************************************************/
+int tcpipc_resume_log(struct tcpipc_resume_t *r, const uint8_t *hdr,
+                      size_t hdr_len, const uint8_t *data, size_t len,
+                      int may_drop);
+
+/*******************************************************************************
+ * @brief   Writes every logged frame numbered start or later through txq.
+ *
+ * @return  Number of frames written, -1 on write error
+ *******************************************************************************/
+int64_t tcpipc_resume_replay(struct tcpipc_resume_t *r, uint64_t start,
+                             struct tcpipc_txq_t *txq);
+
+/*******************************************************************************
+ * @brief   Writes a RESUME payload for the current state to buf.
+ *
+ * @return  TCPIPC_RESUME_LEN
+ *******************************************************************************/
+size_t tcpipc_resume_put(struct tcpipc_resume_t *r, uint8_t *buf);
+
+/*******************************************************************************
+ * @brief   Reads a RESUME payload.
+ *
+ * @return  0 on success, -1 if it is too short
+ *******************************************************************************/
+int tcpipc_resume_get(const uint8_t *data, uint32_t len, uint64_t *session,
+                      uint64_t *received, uint64_t *oldest);
+
+/*******************************************************************************
+ * @brief   Writes a 64 bit big endian value, the ACK payload.
+ *
+ * @return  TCPIPC_RESUME_ACK_LEN
+ *******************************************************************************/
+size_t tcpipc_resume_put64(uint8_t *buf, uint64_t val);
+
+/*******************************************************************************
+ * @brief   Reads a 64 bit big endian value.
+ *
+ * @return  Value
+ *******************************************************************************/
+uint64_t tcpipc_resume_get64(const uint8_t *buf);
+
+#endif // TCPIPC_RESUME_H
@@ -0,0 +1,177 @@
+/*******************************************************************************
+ * @file    tcpipc_schema.h
+ * @brief   Payload layouts of the msg_id_e messages, declared once and
+ *          expanded into everything else. TCPIPC_SCHEMA lists the messages
+ *          in ID order, TCPIPC_SCHEMA_<ID> the fields of each. From them come
+ *          the msg_id_e values, a packed struct per message, its length
+ *          TCPIPC_MSG_<ID>_LEN and inline tcpipc_msg_<name>_encode() and
+ *          tcpipc_msg_<name>_decode(). A message without fields only gets
+ *          its ID and a TCPIPC_MSG_<ID>_LEN of 0.
+ *
+ *          Fields are unsigned integers, little endian on the wire with no
+ *          padding. On a little endian host encoding is one copy of the
+ *          struct and decoding a length check and one copy back.
+ *
+ *          A new message is one line in TCPIPC_SCHEMA and one field list, or
+ *          just the line for a message without fields.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_SCHEMA_H
+#define TCPIPC_SCHEMA_H
+
+/** Standard libraries **/
+#include <stdint.h>
+#include <string.h>
+
+/** Defines  **/
+
+/*
+ * X(ID, name) for every message with fields, E(ID, name) for every message
+ * without, ID order. The IDs count from 1, 0 is MSG_ID_NONE. SYNC only
+ * matters by its arrival.
+ */
+#define TCPIPC_SCHEMA(X, E)         \
+    E(SYNC, sync)                   \
+    X(WIN_SIZE, win_size)           \
+    X(PAD_POS, pad_pos)             \
+    X(BALL_POS, ball_pos)           \
+    X(GAME_STATUS, game_status)
+
+/*
+ * F(type, field) for every field, wire order. BALL_POS flags has the
+ * horizontal direction in bit 0 and the vertical one in bit 4.
+ */
+#define TCPIPC_SCHEMA_WIN_SIZE(F) F(uint16_t, width) F(uint16_t, height)
+#define TCPIPC_SCHEMA_PAD_POS(F) F(uint16_t, x)
+#define TCPIPC_SCHEMA_BALL_POS(F) \
+    F(uint16_t, x) F(uint16_t, y) F(uint8_t, flags)
+#define TCPIPC_SCHEMA_GAME_STATUS(F) F(uint8_t, wins) F(uint8_t, opp_wins)
+
+#define TCPIPC_SCHEMA_ID(ID, name) MSG_ID_##ID,
+#define TCPIPC_SCHEMA_SKIP(ID, name)
+#define TCPIPC_SCHEMA_FIELD(type, field) type field;
+#define TCPIPC_SCHEMA_FIELD_SIZE(type, field) sizeof(type) +
+#define TCPIPC_SCHEMA_FIELD_TO_LE(type, field) \
+    le.field = tcpipc_schema_le_##type(msg->field);
+#define TCPIPC_SCHEMA_FIELD_FROM_LE(type, field) \
+    msg->field = tcpipc_schema_le_##type(msg->field);
+
+#define TCPIPC_SCHEMA_STRUCT(ID, name)                      \
+    struct tcpipc_msg_##name##_t                            \
+    {                                                       \
+        TCPIPC_SCHEMA_##ID(TCPIPC_SCHEMA_FIELD)             \
+    } __attribute__((packed));                              \
+                                                            \
+    _Static_assert(sizeof(struct tcpipc_msg_##name##_t) ==  \
+                       TCPIPC_SCHEMA_##ID(                  \
+                           TCPIPC_SCHEMA_FIELD_SIZE) 0,     \
+                   "tcpipc_msg_" #name "_t is padded");
+
+#define TCPIPC_SCHEMA_LEN(ID, name) \
+    TCPIPC_MSG_##ID##_LEN = sizeof(struct tcpipc_msg_##name##_t),
+#define TCPIPC_SCHEMA_LEN_EMPTY(ID, name) TCPIPC_MSG_##ID##_LEN = 0,
+
+#define TCPIPC_SCHEMA_MEMBER(ID, name) struct tcpipc_msg_##name##_t name;
+
+#define TCPIPC_SCHEMA_CODEC(ID, name)                                         \
+    static inline size_t tcpipc_msg_##name##_encode(                          \
+        uint8_t *buf, const struct tcpipc_msg_##name##_t *msg)                \
+    {                                                                         \
+        struct tcpipc_msg_##name##_t le;                                      \
+                                                                              \
+        TCPIPC_SCHEMA_##ID(TCPIPC_SCHEMA_FIELD_TO_LE)                         \
+        memcpy(buf, &le, sizeof(le));                                         \
+                                                                              \
+        return TCPIPC_MSG_##ID##_LEN;                                         \
+    }                                                                         \
+                                                                              \
+    static inline int tcpipc_msg_##name##_decode(                             \
+        struct tcpipc_msg_##name##_t *msg, const uint8_t *data, uint32_t len) \
+    {                                                                         \
+        if (len < TCPIPC_MSG_##ID##_LEN)                                      \
+            return -1;                                                        \
+                                                                              \
+        memcpy(msg, data, TCPIPC_MSG_##ID##_LEN);                             \
+        TCPIPC_SCHEMA_##ID(TCPIPC_SCHEMA_FIELD_FROM_LE)                       \
+                                                                              \
+        return 0;                                                             \
+    }
+
+#define TCPIPC_MSG_MAX_LEN (sizeof(union tcpipc_msg_u))
+
+/** User Data Types **/
+TCPIPC_SCHEMA(TCPIPC_SCHEMA_STRUCT, TCPIPC_SCHEMA_SKIP)
+
+enum
+{
+    TCPIPC_SCHEMA(TCPIPC_SCHEMA_LEN, TCPIPC_SCHEMA_LEN_EMPTY)
+};
+
+/*
+ * Large enough for any message, TCPIPC_MSG_MAX_LEN is its size.
+ */
+union tcpipc_msg_u
+{
+    TCPIPC_SCHEMA(TCPIPC_SCHEMA_MEMBER, TCPIPC_SCHEMA_SKIP)
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Converts between host and little endian order, the same swap both
+ *          ways. Named after the field types so that field lists can paste
+ *          them.
+ *
+ * @return  Converted value
+ *******************************************************************************/
+static inline uint8_t tcpipc_schema_le_uint8_t(uint8_t val)
+{
+    return val;
+}
+
+static inline uint16_t tcpipc_schema_le_uint16_t(uint16_t val)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap16(val);
+#else
+    return val;
+#endif
+}
+
+static inline uint32_t tcpipc_schema_le_uint32_t(uint32_t val)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap32(val);
+#else
+    return val;
+#endif
+}
+
+static inline uint64_t tcpipc_schema_le_uint64_t(uint64_t val)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap64(val);
+#else
+    return val;
+#endif
+}
+
+/*******************************************************************************
+ * For every message with fields:
+ *
+ * @brief   tcpipc_msg_<name>_encode() writes msg to buf in wire layout, buf
+ *          holds at least TCPIPC_MSG_<ID>_LEN bytes.
+ *
+ * @return  TCPIPC_MSG_<ID>_LEN
+ *
+ * @brief   tcpipc_msg_<name>_decode() reads msg from a received payload of
+ *          len bytes. Longer payloads are accepted, fields appended by a
+ *          newer peer are ignored.
+ *
+ * @return  0 on success, -1 if the payload is too short
+ *******************************************************************************/
+TCPIPC_SCHEMA(TCPIPC_SCHEMA_CODEC, TCPIPC_SCHEMA_SKIP)
+
+#endif // TCPIPC_SCHEMA_H
@@ -0,0 +1,422 @@
+/*******************************************************************************
+ * @file    tcpipc_shm.c
+ * @brief   Same-host shared-memory transport. Each direction is a single
+ *          producer, single consumer byte ring; frames are laid out exactly
+ *          as on the TCP stream so the regular decoder parses them.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tcpipc_shm.h"
+#include "tcpipc_futex.h"
+
+/** Private Function Prototypes **/
+static int tcpipc_shm_create(struct tcpipc_shm_t *shm);
+static int tcpipc_shm_attach(struct tcpipc_shm_t *shm);
+static void tcpipc_shm_ring_write(struct tcpipc_shm_ring_t *ring,
+                                  uint64_t pos, const uint8_t *src,
+                                  size_t len);
+static void tcpipc_shm_wait_data(struct tcpipc_shm_t *shm,
+                                 volatile int *exit_status);
+static int tcpipc_shm_wait_space(struct tcpipc_shm_t *shm, size_t need);
+static void tcpipc_shm_kick(atomic_uint *seq, atomic_uint *sleeping);
+
+/*******************************************************************************
+ * @brief   Creates (server) or attaches to (client) the shared region of the
+ *          given port and waits for the other side. The server removes the
+ *          file once the client has mapped it.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_shm_setup(struct tcpipc_shm_t *shm, int is_server, int port)
+{
+    memset(shm, 0, sizeof(struct tcpipc_shm_t));
+    snprintf(shm->path, sizeof(shm->path), TCPIPC_SHM_PATH_FMT, port);
+
+    if (is_server)
+    {
+        if (tcpipc_shm_create(shm))
+            return -1;
+
+        printf("Server: Waiting for shared memory peer on %s...\n", shm->path);
+
+        while (atomic_load(&shm->region->state) == TCPIPC_SHM_LISTENING)
+            tcpipc_futex_wait(&shm->region->state, TCPIPC_SHM_LISTENING, -1);
+
+        unlink(shm->path);
+
+        shm->tx = &shm->region->ring[0];
+        shm->rx = &shm->region->ring[1];
+
+        printf("Server: Connected\n");
+    }
+    else
+    {
+        if (tcpipc_shm_attach(shm))
+            return -1;
+
+        shm->tx = &shm->region->ring[1];
+        shm->rx = &shm->region->ring[0];
+
+        printf("Client: Connected\n");
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Marks the region closed and wakes both ends, so the local receive
+ *          loop and the peer stop waiting.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_shm_shutdown(struct tcpipc_shm_t *shm)
+{
+    int i;
+
+    if (shm->region == NULL)
+        return;
+
+    atomic_store(&shm->region->state, TCPIPC_SHM_CLOSED);
+
+    for (i = 0; i < 2; i++)
+    {
+        atomic_fetch_add(&shm->region->ring[i].data_seq, 1);
+        atomic_fetch_add(&shm->region->ring[i].space_seq, 1);
+        tcpipc_futex_wake(&shm->region->ring[i].data_seq);
+        tcpipc_futex_wake(&shm->region->ring[i].space_seq);
+    }
+}
+
+/*******************************************************************************
+ * @brief   Unmaps the region. The receive loop must have returned.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_shm_close(struct tcpipc_shm_t *shm)
+{
+    if (shm->region == NULL)
+        return;
+
+    munmap(shm->region, sizeof(struct tcpipc_shm_region_t));
+    shm->region = NULL;
+    shm->tx = NULL;
+    shm->rx = NULL;
+}
+
+/*******************************************************************************
+ * @brief   Copies one frame (header and payload) into the transmit ring,
+ *          waiting for room if the peer is behind. No system call is made
+ *          unless the reader is asleep or the ring is full.
+ *
+ * @return  0 on success, -1 if the frame can never fit or the peer is gone
+ *******************************************************************************/
+int tcpipc_shm_send(struct tcpipc_shm_t *shm, const uint8_t *hdr,
+                    size_t hdr_len, const uint8_t *data, size_t len)
+{
+    struct tcpipc_shm_ring_t *ring = shm->tx;
+    size_t total = hdr_len + len;
+    uint64_t head;
+
+    if (ring == NULL)
+        return -1;
+
+    if (total > TCPIPC_SHM_RING_SIZE)
+    {
+        printf("Message too long for shared memory ring: %zu\n", len);
+        return -1;
+    }
+
+    if (tcpipc_shm_wait_space(shm, total))
+        return -1;
+
+    head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    tcpipc_shm_ring_write(ring, head, hdr, hdr_len);
+    tcpipc_shm_ring_write(ring, head + hdr_len, data, len);
+
+    atomic_store_explicit(&ring->head, head + total, memory_order_release);
+    tcpipc_shm_kick(&ring->data_seq, &ring->reader_sleeping);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Receive loop, runs until *exit_status is set or the peer closes.
+ *          Bytes are moved from the ring into the decoder buffer and parsed
+ *          the same way as bytes read from a socket.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_shm_recv_loop(struct tcpipc_shm_t *shm, volatile int *exit_status,
+                          struct tcpipc_decoder_t *dec,
+                          tcpipc_frame_cb_t frame_cb, void *arg)
+{
+    struct tcpipc_shm_ring_t *ring = shm->rx;
+    uint64_t head, tail;
+    uint8_t *buffer;
+    size_t space, off, count;
+
+    while (!*exit_status)
+    {
+        tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+        if (head == tail)
+        {
+            // Drain what the peer wrote before it left
+            if (atomic_load(&shm->region->state) == TCPIPC_SHM_CLOSED)
+            {
+                printf("Disconnected\n");
+                break;
+            }
+
+            tcpipc_shm_wait_data(shm, exit_status);
+            continue;
+        }
+
+        buffer = tcpipc_decoder_wbuf(dec, &space);
+
+        if (buffer == NULL)
+        {
+            printf("Received message exceeds maximum length\n");
+            break;
+        }
+
+        off = tail & (TCPIPC_SHM_RING_SIZE - 1);
+        count = head - tail;
+
+        if (count > TCPIPC_SHM_RING_SIZE - off)
+            count = TCPIPC_SHM_RING_SIZE - off;
+        if (count > space)
+            count = space;
+
+        memcpy(buffer, ring->data + off, count);
+
+        atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+        tcpipc_shm_kick(&ring->space_seq, &ring->writer_sleeping);
+
+        tcpipc_decoder_commit(dec, count);
+
+        if (tcpipc_decoder_parse(dec, frame_cb, arg) < 0)
+        {
+            printf("Received message exceeds maximum length\n");
+            break;
+        }
+    }
+}
+
+/*******************************************************************************
+ * @brief   Creates the backing file, maps it and opens it for the client.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int tcpipc_shm_create(struct tcpipc_shm_t *shm)
+{
+    struct tcpipc_shm_region_t *region;
+    int fd;
+
+    // A file left behind by a crashed server is simply replaced
+    unlink(shm->path);
+
+    fd = open(shm->path, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+    if (fd < 0)
+    {
+        perror("Server: Failed to create shared memory");
+        return -1;
+    }
+
+    if (ftruncate(fd, sizeof(struct tcpipc_shm_region_t)))
+    {
+        perror("Server: Failed to size shared memory");
+        close(fd);
+        unlink(shm->path);
+        return -1;
+    }
+
+    region = mmap(NULL, sizeof(struct tcpipc_shm_region_t),
+                  PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (region == MAP_FAILED)
+    {
+        perror("Server: Failed to map shared memory");
+        unlink(shm->path);
+        return -1;
+    }
+
+    region->magic = TCPIPC_SHM_MAGIC;
+    atomic_store(&region->state, TCPIPC_SHM_LISTENING);
+
+    shm->region = region;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Maps the server's region, retrying until it shows up, and tells
+ *          the server we are in.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int tcpipc_shm_attach(struct tcpipc_shm_t *shm)
+{
+    struct tcpipc_shm_region_t *region;
+    unsigned int expected;
+    struct stat st;
+    int fd, tries;
+
+    for (tries = 0; tries < TCPIPC_SHM_ATTACH_TRIES; tries++)
+    {
+        if (tries)
+            usleep(TCPIPC_SHM_ATTACH_USEC);
+
+        fd = open(shm->path, O_RDWR);
+
+        if (fd < 0)
+            continue;
+
+        if (fstat(fd, &st) || st.st_size < sizeof(struct tcpipc_shm_region_t))
+        {
+            close(fd);
+            continue;
+        }
+
+        region = mmap(NULL, sizeof(struct tcpipc_shm_region_t),
+                      PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (region == MAP_FAILED)
+        {
+            perror("Client: Failed to map shared memory");
+            return -1;
+        }
+
+        expected = TCPIPC_SHM_LISTENING;
+
+        if (atomic_compare_exchange_strong(&region->state, &expected,
+                                           TCPIPC_SHM_ATTACHED) &&
+            region->magic == TCPIPC_SHM_MAGIC)
+        {
+            tcpipc_futex_wake(&region->state);
+            shm->region = region;
+            return 0;
+        }
+
+        munmap(region, sizeof(struct tcpipc_shm_region_t));
+    }
+
+    printf("Client: No shared memory server on %s\n", shm->path);
+
+    return -1;
+}
+
+/*******************************************************************************
+ * @brief   Copies len bytes into the ring at byte position pos, wrapping
+ *          around the end of the data area.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_shm_ring_write(struct tcpipc_shm_ring_t *ring,
+                                  uint64_t pos, const uint8_t *src,
+                                  size_t len)
+{
+    size_t off = pos & (TCPIPC_SHM_RING_SIZE - 1);
+    size_t first = TCPIPC_SHM_RING_SIZE - off;
+
+    if (first > len)
+        first = len;
+
+    memcpy(ring->data + off, src, first);
+    memcpy(ring->data, src + first, len - first);
+}
+
+/*******************************************************************************
+ * @brief   Waits for the writer to publish bytes. Spins for a short while
+ *          before sleeping on the futex, the writer only wakes us if we set
+ *          reader_sleeping first.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_shm_wait_data(struct tcpipc_shm_t *shm,
+                                 volatile int *exit_status)
+{
+    struct tcpipc_shm_ring_t *ring = shm->rx;
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned int seq;
+    int spin;
+
+    for (spin = 0; spin < TCPIPC_SHM_SPIN; spin++)
+        if (atomic_load_explicit(&ring->head, memory_order_acquire) != tail)
+            return;
+
+    seq = atomic_load(&ring->data_seq);
+    atomic_store(&ring->reader_sleeping, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_load(&ring->head) == tail && !*exit_status &&
+        atomic_load(&shm->region->state) != TCPIPC_SHM_CLOSED)
+        tcpipc_futex_wait(&ring->data_seq, seq, -1);
+
+    atomic_store(&ring->reader_sleeping, 0);
+}
+
+/*******************************************************************************
+ * @brief   Waits until the transmit ring has room for need bytes.
+ *
+ * @return  0 once there is room, -1 if the region was closed
+ *******************************************************************************/
+static int tcpipc_shm_wait_space(struct tcpipc_shm_t *shm, size_t need)
+{
+    struct tcpipc_shm_ring_t *ring = shm->tx;
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int seq;
+    int spin = 0;
+
+    while (head + need - atomic_load_explicit(&ring->tail,
+                                              memory_order_acquire) >
+           TCPIPC_SHM_RING_SIZE)
+    {
+        if (atomic_load(&shm->region->state) == TCPIPC_SHM_CLOSED)
+            return -1;
+
+        if (spin++ < TCPIPC_SHM_SPIN)
+            continue;
+
+        seq = atomic_load(&ring->space_seq);
+        atomic_store(&ring->writer_sleeping, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        if (head + need - atomic_load(&ring->tail) > TCPIPC_SHM_RING_SIZE &&
+            atomic_load(&shm->region->state) != TCPIPC_SHM_CLOSED)
+            tcpipc_futex_wait(&ring->space_seq, seq, -1);
+
+        atomic_store(&ring->writer_sleeping, 0);
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Wakes the other side if it announced itself asleep. The fence pairs
+ *          with the one in the wait functions so a wake-up is never lost.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_shm_kick(atomic_uint *seq, atomic_uint *sleeping)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_load_explicit(sleeping, memory_order_relaxed))
+    {
+        atomic_fetch_add(seq, 1);
+        tcpipc_futex_wake(seq);
+    }
+}
@@ -0,0 +1,119 @@
+/*******************************************************************************
+ * @file    tcpipc_shm.h
+ * @brief   Same-host shared-memory transport for libtcpipc. Both endpoints
+ *          map /dev/shm/tcpipc.<port>, which holds one byte ring per
+ *          direction carrying the regular tcpipc frames. Sending is a copy
+ *          and a release store; a futex wake is only issued when the reader
+ *          is asleep.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_SHM_H
+#define TCPIPC_SHM_H
+
+/** Standard libraries **/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <stdalign.h>
+
+/** Application specififc libraries **/
+#include "tcpipc_decoder.h"
+
+/** Defines  **/
+#define TCPIPC_SHM_PATH_FMT ("/dev/shm/tcpipc.%d")
+#define TCPIPC_SHM_MAGIC (0x54435049)
+#define TCPIPC_SHM_RING_SIZE (65536)
+#define TCPIPC_SHM_SPIN (2000)
+#define TCPIPC_SHM_ATTACH_TRIES (1000)
+#define TCPIPC_SHM_ATTACH_USEC (10000)
+#define TCPIPC_SHM_CACHE_LINE (64)
+
+/** User Data Types **/
+enum tcpipc_shm_state_e
+{
+    TCPIPC_SHM_CREATED = 0,
+    TCPIPC_SHM_LISTENING,
+    TCPIPC_SHM_ATTACHED,
+    TCPIPC_SHM_CLOSED
+};
+
+/*
+ * head and tail count bytes since creation. data_seq and space_seq are the
+ * futex words, bumped by the opposite side only when the reader or writer has
+ * announced itself in the matching *_sleeping flag.
+ */
+struct tcpipc_shm_ring_t
+{
+    alignas(TCPIPC_SHM_CACHE_LINE) atomic_uint_fast64_t head;
+    alignas(TCPIPC_SHM_CACHE_LINE) atomic_uint_fast64_t tail;
+    alignas(TCPIPC_SHM_CACHE_LINE) atomic_uint data_seq;
+    atomic_uint reader_sleeping;
+    alignas(TCPIPC_SHM_CACHE_LINE) atomic_uint space_seq;
+    atomic_uint writer_sleeping;
+    alignas(TCPIPC_SHM_CACHE_LINE) uint8_t data[TCPIPC_SHM_RING_SIZE];
+};
+
+struct tcpipc_shm_region_t
+{
+    uint32_t magic;
+    atomic_uint state;
+    struct tcpipc_shm_ring_t ring[2];
+};
+
+struct tcpipc_shm_t
+{
+    struct tcpipc_shm_region_t *region;
+    struct tcpipc_shm_ring_t *tx;
+    struct tcpipc_shm_ring_t *rx;
+    char path[32];
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Creates (server) or attaches to (client) the shared region of the
+ *          given port and waits for the other side.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_shm_setup(struct tcpipc_shm_t *shm, int is_server, int port);
+
+/*******************************************************************************
+ * @brief   Marks the region closed and wakes both ends, so the local receive
+ *          loop and the peer stop waiting.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_shm_shutdown(struct tcpipc_shm_t *shm);
+
+/*******************************************************************************
+ * @brief   Unmaps the region. The receive loop must have returned.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_shm_close(struct tcpipc_shm_t *shm);
+
+/*******************************************************************************
+ * @brief   Copies one frame (header and payload) into the transmit ring,
+ *          waiting for room if the peer is behind.
+ *
+ * @return  0 on success, -1 if the frame can never fit or the peer is gone
+ *******************************************************************************/
+int tcpipc_shm_send(struct tcpipc_shm_t *shm, const uint8_t *hdr,
+                    size_t hdr_len, const uint8_t *data, size_t len);
+
+/*******************************************************************************
+ * @brief   Receive loop, runs until *exit_status is set or the peer closes.
+ *          Spins briefly on an empty ring before sleeping on the futex.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_shm_recv_loop(struct tcpipc_shm_t *shm, volatile int *exit_status,
+                          struct tcpipc_decoder_t *dec,
+                          tcpipc_frame_cb_t frame_cb, void *arg);
+
+#endif // TCPIPC_SHM_H
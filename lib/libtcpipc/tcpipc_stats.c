@@ -0,0 +1,393 @@
+/*******************************************************************************
+ * @file    tcpipc_stats.c
+ * @brief   Statistics snapshot and the signal triggered dumps of every open
+ *          connection.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <signal.h>
+#include <errno.h>
+#include <sched.h>
+
+#include "tcpipc_ctx.h"
+
+/** Defines  **/
+#define STATS_LINE_MAX (1024)
+
+/** Private Function Prototypes **/
+static void tcpipc_stats_handler(int signo);
+static void tcpipc_flight_handler(int signo);
+static int tcpipc_stats_install(int signo, void (*handler)(int),
+                                const char *what);
+static size_t tcpipc_stats_append(char *line, size_t pos, const char *key,
+                                  uint64_t val);
+static struct tcpipc_ctx *tcpipc_stats_hold(int slot);
+
+/** Global Variables **/
+// A handler counts itself in stats_busy before it loads the slot, so
+// unregistering waits for a dump of the context that is still running
+static struct tcpipc_ctx *_Atomic stats_registry[TCPIPC_STATS_MAX_CTX];
+static atomic_int stats_busy[TCPIPC_STATS_MAX_CTX];
+
+/*******************************************************************************
+ * @brief   Copies the counters of a connection. Safe to call from any thread,
+ *          each value is recent but the set is not an atomic snapshot.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_get_stats(struct tcpipc_ctx *ctx, struct tcpipc_stats_t *stats)
+{
+    struct tcpipc_counters_t *cnt = &ctx->counters;
+    struct recv_msg_cb_t *cb = &ctx->recv_cb;
+    size_t head, tail;
+
+    memset(stats, 0, sizeof(struct tcpipc_stats_t));
+
+    stats->msgs_in = tcpipc_stat_get(&cnt->msgs_in);
+    stats->bytes_in = tcpipc_stat_get(&cnt->bytes_in);
+    stats->msgs_out = tcpipc_stat_get(&cnt->msgs_out);
+    stats->bytes_out = tcpipc_stat_get(&cnt->bytes_out);
+    stats->rx_syscalls = tcpipc_stat_get(&cnt->rx_syscalls);
+    stats->tx_syscalls = tcpipc_stat_get(&ctx->txq.syscalls);
+    stats->partial_reads = tcpipc_stat_get(&cnt->partial_reads);
+    stats->partial_writes = tcpipc_stat_get(&ctx->txq.partial_writes);
+    stats->rx_drops = tcpipc_stat_get(&cnt->rx_drops);
+    stats->rx_drop_oldest = tcpipc_stat_get(&cb->drop_oldest);
+    stats->rx_block_waits = tcpipc_stat_get(&cb->block_waits);
+    stats->rx_queue_grows = tcpipc_stat_get(&cb->grows);
+
+    tail = atomic_load_explicit(&cb->tail, memory_order_relaxed);
+    head = atomic_load_explicit(&cb->head, memory_order_relaxed);
+    stats->queue_depth = head - tail;
+    stats->queue_high_water = tcpipc_stat_get(&cb->high_water);
+
+    stats->dwell_count = tcpipc_stat_get(&cb->dwell_count);
+    stats->dwell_max_ns = tcpipc_stat_get(&cb->dwell_max_ns);
+
+    if (stats->dwell_count)
+        stats->dwell_avg_ns = tcpipc_stat_get(&cb->dwell_total_ns) /
+                              stats->dwell_count;
+
+    if (ctx->opts.transport == TCPIPC_TRANSPORT_UDP)
+    {
+        stats->udp_stale_drops = tcpipc_stat_get(&ctx->udp.stale_drops);
+        stats->udp_retransmits = tcpipc_stat_get(&ctx->udp.retransmits);
+    }
+
+    if (atomic_load_explicit(&ctx->clock.samples, memory_order_acquire))
+    {
+        stats->rtt_ns = tcpipc_stat_get(&ctx->clock.rtt_ns);
+        stats->rtt_min_ns = tcpipc_stat_get(&ctx->clock.rtt_min_ns);
+        stats->rtt_jitter_ns = tcpipc_stat_get(&ctx->clock.jitter_ns);
+    }
+
+    stats->tx_kernel_stamps = tcpipc_stat_get(&ctx->tx_stamp.count);
+    stats->tx_kernel_max_ns = tcpipc_stat_get(&ctx->tx_stamp.max_ns);
+
+    if (stats->tx_kernel_stamps)
+        stats->tx_kernel_avg_ns = tcpipc_stat_get(&ctx->tx_stamp.total_ns) /
+                                  stats->tx_kernel_stamps;
+
+    stats->bulk_tx_bytes = tcpipc_stat_get(&ctx->bulk_tx.bytes);
+    stats->bulk_tx_zerocopy = tcpipc_stat_get(&ctx->bulk_tx.zc_bytes);
+    stats->bulk_tx_copied = tcpipc_stat_get(&ctx->bulk_tx.zc_copied);
+    stats->bulk_rx_msgs = tcpipc_stat_get(&ctx->bulk_rx.msgs);
+    stats->bulk_rx_drops = tcpipc_stat_get(&ctx->bulk_rx.drops);
+    stats->reconnects = tcpipc_stat_get(&ctx->resume.reconnects);
+    stats->resume_replayed = tcpipc_stat_get(&ctx->resume.replayed);
+    stats->resume_lost = tcpipc_stat_get(&ctx->resume.lost);
+}
+
+/*******************************************************************************
+ * @brief   Writes the counters of a connection as one key=value line to fd.
+ *          Only uses async-signal-safe calls, so it can run in a signal
+ *          handler.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_stats_dump(struct tcpipc_ctx *ctx, int fd)
+{
+    struct tcpipc_stats_t stats;
+    char line[STATS_LINE_MAX];
+    size_t pos = 0;
+
+    tcpipc_get_stats(ctx, &stats);
+
+    pos = tcpipc_stats_append(line, pos, "tcpipc_port",
+                              ctx->client_info.port ? ctx->client_info.port
+                                                    : ctx->server_info.port);
+    pos = tcpipc_stats_append(line, pos, "msgs_in", stats.msgs_in);
+    pos = tcpipc_stats_append(line, pos, "bytes_in", stats.bytes_in);
+    pos = tcpipc_stats_append(line, pos, "msgs_out", stats.msgs_out);
+    pos = tcpipc_stats_append(line, pos, "bytes_out", stats.bytes_out);
+    pos = tcpipc_stats_append(line, pos, "rx_syscalls", stats.rx_syscalls);
+    pos = tcpipc_stats_append(line, pos, "tx_syscalls", stats.tx_syscalls);
+
+    // Integer only, per thousand messages
+    pos = tcpipc_stats_append(line, pos, "rx_syscalls_per_kmsg",
+                              stats.msgs_in ? stats.rx_syscalls * 1000 /
+                                                  stats.msgs_in
+                                            : 0);
+    pos = tcpipc_stats_append(line, pos, "tx_syscalls_per_kmsg",
+                              stats.msgs_out ? stats.tx_syscalls * 1000 /
+                                                   stats.msgs_out
+                                             : 0);
+    pos = tcpipc_stats_append(line, pos, "partial_reads", stats.partial_reads);
+    pos = tcpipc_stats_append(line, pos, "partial_writes",
+                              stats.partial_writes);
+    pos = tcpipc_stats_append(line, pos, "rx_drops", stats.rx_drops);
+    pos = tcpipc_stats_append(line, pos, "rx_drop_oldest",
+                              stats.rx_drop_oldest);
+    pos = tcpipc_stats_append(line, pos, "rx_block_waits",
+                              stats.rx_block_waits);
+    pos = tcpipc_stats_append(line, pos, "rx_queue_grows",
+                              stats.rx_queue_grows);
+    pos = tcpipc_stats_append(line, pos, "queue_depth", stats.queue_depth);
+    pos = tcpipc_stats_append(line, pos, "queue_high_water",
+                              stats.queue_high_water);
+    pos = tcpipc_stats_append(line, pos, "dwell_count", stats.dwell_count);
+    pos = tcpipc_stats_append(line, pos, "dwell_avg_ns", stats.dwell_avg_ns);
+    pos = tcpipc_stats_append(line, pos, "dwell_max_ns", stats.dwell_max_ns);
+
+    if (ctx->opts.transport == TCPIPC_TRANSPORT_UDP)
+    {
+        pos = tcpipc_stats_append(line, pos, "udp_stale_drops",
+                                  stats.udp_stale_drops);
+        pos = tcpipc_stats_append(line, pos, "udp_retransmits",
+                                  stats.udp_retransmits);
+    }
+
+    if (ctx->opts.ping_interval_ms)
+    {
+        pos = tcpipc_stats_append(line, pos, "rtt_ns", stats.rtt_ns);
+        pos = tcpipc_stats_append(line, pos, "rtt_min_ns", stats.rtt_min_ns);
+        pos = tcpipc_stats_append(line, pos, "rtt_jitter_ns",
+                                  stats.rtt_jitter_ns);
+    }
+
+    if (ctx->opts.timestamping)
+    {
+        pos = tcpipc_stats_append(line, pos, "tx_kernel_stamps",
+                                  stats.tx_kernel_stamps);
+        pos = tcpipc_stats_append(line, pos, "tx_kernel_avg_ns",
+                                  stats.tx_kernel_avg_ns);
+        pos = tcpipc_stats_append(line, pos, "tx_kernel_max_ns",
+                                  stats.tx_kernel_max_ns);
+    }
+
+    if (ctx->opts.bulk_max_len || stats.bulk_tx_bytes)
+    {
+        pos = tcpipc_stats_append(line, pos, "bulk_tx_bytes",
+                                  stats.bulk_tx_bytes);
+        pos = tcpipc_stats_append(line, pos, "bulk_tx_zerocopy",
+                                  stats.bulk_tx_zerocopy);
+        pos = tcpipc_stats_append(line, pos, "bulk_tx_copied",
+                                  stats.bulk_tx_copied);
+        pos = tcpipc_stats_append(line, pos, "bulk_rx_msgs",
+                                  stats.bulk_rx_msgs);
+        pos = tcpipc_stats_append(line, pos, "bulk_rx_drops",
+                                  stats.bulk_rx_drops);
+    }
+
+    if (ctx->opts.reconnect_ms)
+    {
+        pos = tcpipc_stats_append(line, pos, "reconnects", stats.reconnects);
+        pos = tcpipc_stats_append(line, pos, "resume_replayed",
+                                  stats.resume_replayed);
+        pos = tcpipc_stats_append(line, pos, "resume_lost",
+                                  stats.resume_lost);
+    }
+
+    line[pos++] = '\n';
+
+    while (write(fd, line, pos) < 0 && errno == EINTR)
+        ;
+}
+
+/*******************************************************************************
+ * @brief   Installs a handler that dumps every open connection to stderr
+ *          when signo is received, e.g. SIGUSR1.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_stats_signal(int signo)
+{
+    return tcpipc_stats_install(signo, tcpipc_stats_handler,
+                                "Failed to install statistics signal");
+}
+
+/*******************************************************************************
+ * @brief   Installs a handler that dumps the flight recorder of every open
+ *          connection when signo is received, e.g. SIGUSR2.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_flight_signal(int signo)
+{
+    return tcpipc_stats_install(signo, tcpipc_flight_handler,
+                                "Failed to install flight recorder signal");
+}
+
+/*******************************************************************************
+ * @brief   Adds the context to the set dumped by the statistics signal.
+ *          Silently skipped when the registry is full.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_stats_register(struct tcpipc_ctx *ctx)
+{
+    struct tcpipc_ctx *expected;
+
+    for (int i = 0; i < TCPIPC_STATS_MAX_CTX; i++)
+    {
+        expected = NULL;
+
+        if (atomic_compare_exchange_strong(&stats_registry[i], &expected, ctx))
+            return;
+    }
+}
+
+/*******************************************************************************
+ * @brief   Removes the context from the set dumped by the statistics signal
+ *          and waits for a dump of it running in a handler on another thread.
+ *          Must not be called from a signal handler.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_stats_unregister(struct tcpipc_ctx *ctx)
+{
+    struct tcpipc_ctx *expected;
+
+    for (int i = 0; i < TCPIPC_STATS_MAX_CTX; i++)
+    {
+        expected = ctx;
+
+        if (atomic_compare_exchange_strong(&stats_registry[i], &expected,
+                                           NULL))
+        {
+            while (atomic_load(&stats_busy[i]))
+                sched_yield();
+            return;
+        }
+    }
+}
+
+/*******************************************************************************
+ * @brief   Signal handler, dumps every registered connection.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_stats_handler(int signo)
+{
+    struct tcpipc_ctx *ctx;
+    int saved_errno = errno;
+
+    for (int i = 0; i < TCPIPC_STATS_MAX_CTX; i++)
+    {
+        ctx = tcpipc_stats_hold(i);
+
+        if (ctx)
+            tcpipc_stats_dump(ctx, STDERR_FILENO);
+
+        atomic_fetch_sub(&stats_busy[i], 1);
+    }
+
+    errno = saved_errno;
+}
+
+/*******************************************************************************
+ * @brief   Signal handler, dumps the flight recorder of every registered
+ *          connection.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_flight_handler(int signo)
+{
+    struct tcpipc_ctx *ctx;
+    int saved_errno = errno;
+
+    for (int i = 0; i < TCPIPC_STATS_MAX_CTX; i++)
+    {
+        ctx = tcpipc_stats_hold(i);
+
+        if (ctx)
+            tcpipc_dump_flight(ctx);
+
+        atomic_fetch_sub(&stats_busy[i], 1);
+    }
+
+    errno = saved_errno;
+}
+
+/*******************************************************************************
+ * @brief   Marks a registry slot in use and loads it. The caller drops the
+ *          mark from stats_busy once it is done with the context.
+ *
+ * @return  Registered context, NULL if the slot is empty
+ *******************************************************************************/
+static struct tcpipc_ctx *tcpipc_stats_hold(int slot)
+{
+    atomic_fetch_add(&stats_busy[slot], 1);
+
+    return atomic_load(&stats_registry[slot]);
+}
+
+/*******************************************************************************
+ * @brief   Installs handler for signo, reporting failures with what.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int tcpipc_stats_install(int signo, void (*handler)(int),
+                                const char *what)
+{
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+
+    if (sigaction(signo, &sa, NULL))
+    {
+        perror(what);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Appends " key=val" to line without using stdio.
+ *
+ * @return  New length of line
+ *******************************************************************************/
+static size_t tcpipc_stats_append(char *line, size_t pos, const char *key,
+                                  uint64_t val)
+{
+    char digits[20];
+    int len = 0;
+
+    // Room for the key, '=', 20 digits and the final newline
+    if (pos + strlen(key) + 23 > STATS_LINE_MAX)
+        return pos;
+
+    if (pos)
+        line[pos++] = ' ';
+
+    while (*key)
+        line[pos++] = *key++;
+
+    line[pos++] = '=';
+
+    do
+    {
+        digits[len++] = '0' + val % 10;
+        val /= 10;
+    } while (val);
+
+    while (len)
+        line[pos++] = digits[--len];
+
+    return pos;
+}
@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * @file    tcpipc_stats.h
+ * @brief   Per-connection counters. Every counter has a single writer thread,
+ *          so updates are a relaxed load and store rather than a locked
+ *          read-modify-write; readers on other threads see a recent value.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_STATS_H
+#define TCPIPC_STATS_H
+
+/** Standard libraries **/
+#include <stdint.h>
+#include <stdatomic.h>
+
+/** Defines  **/
+#define TCPIPC_STATS_MAX_CTX (64)
+
+/** User Data Types **/
+
+/*
+ * Live counters of one connection. The in/rx side is written by the receive
+ * thread, the out/tx side by the sending thread.
+ */
+struct tcpipc_counters_t
+{
+    atomic_uint_fast64_t msgs_in;
+    atomic_uint_fast64_t bytes_in;
+    atomic_uint_fast64_t rx_syscalls;
+    atomic_uint_fast64_t partial_reads;
+    atomic_uint_fast64_t rx_drops;
+    atomic_uint_fast64_t msgs_out;
+    atomic_uint_fast64_t bytes_out;
+};
+
+/*
+ * Snapshot returned by tcpipc_get_stats(). partial_reads counts reads that
+ * ended in the middle of a frame, partial_writes writes the kernel only
+ * accepted in part. rx_drops are incoming messages lost because the receive
+ * queue was full, rx_drop_oldest queued ones discarded to make room for them.
+ * rx_block_waits counts how often the receive thread parked on a full queue
+ * and rx_queue_grows how often the queue doubled. Dwell time is measured from
+ * the moment a message is queued by the receive thread until the application
+ * takes it out. The rtt fields stay zero unless PINGs are enabled, see
+ * tcpipc_get_rtt(). tx_kernel_* measure the delay from tcpipc_send() to the
+ * kernel transmit stamp of the write that carried the frame, on TCP with
+ * timestamping enabled. bulk_tx_zerocopy counts bulk bytes sent with
+ * MSG_ZEROCOPY, bulk_tx_copied the zero-copy sends the kernel had to copy
+ * after all. bulk_rx_drops are transfers the receiver could not reassemble.
+ * reconnects counts links re-established after a loss, resume_replayed the
+ * frames sent again from the send log and resume_lost the frames either
+ * side no longer had in its log when the other asked for them.
+ */
+struct tcpipc_stats_t
+{
+    uint64_t msgs_in;
+    uint64_t bytes_in;
+    uint64_t msgs_out;
+    uint64_t bytes_out;
+    uint64_t rx_syscalls;
+    uint64_t tx_syscalls;
+    uint64_t partial_reads;
+    uint64_t partial_writes;
+    uint64_t rx_drops;
+    uint64_t rx_drop_oldest;
+    uint64_t rx_block_waits;
+    uint64_t rx_queue_grows;
+    uint64_t queue_depth;
+    uint64_t queue_high_water;
+    uint64_t dwell_count;
+    uint64_t dwell_avg_ns;
+    uint64_t dwell_max_ns;
+    uint64_t udp_stale_drops;
+    uint64_t udp_retransmits;
+    uint64_t rtt_ns;
+    uint64_t rtt_min_ns;
+    uint64_t rtt_jitter_ns;
+    uint64_t tx_kernel_stamps;
+    uint64_t tx_kernel_avg_ns;
+    uint64_t tx_kernel_max_ns;
+    uint64_t bulk_tx_bytes;
+    uint64_t bulk_tx_zerocopy;
+    uint64_t bulk_tx_copied;
+    uint64_t bulk_rx_msgs;
+    uint64_t bulk_rx_drops;
+    uint64_t reconnects;
+    uint64_t resume_replayed;
+    uint64_t resume_lost;
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Adds val to a counter owned by the calling thread.
+ *
+ * @return
+ *******************************************************************************/
+static inline void tcpipc_stat_add(atomic_uint_fast64_t *stat, uint64_t val)
+{
+    atomic_store_explicit(stat,
+                          atomic_load_explicit(stat, memory_order_relaxed) +
+                              val,
+                          memory_order_relaxed);
+}
+
+/*******************************************************************************
+ * @brief   Raises a maximum owned by the calling thread to val.
+ *
+ * @return
+ *******************************************************************************/
+static inline void tcpipc_stat_max(atomic_uint_fast64_t *stat, uint64_t val)
+{
+    if (val > atomic_load_explicit(stat, memory_order_relaxed))
+        atomic_store_explicit(stat, val, memory_order_relaxed);
+}
+
+/*******************************************************************************
+ * @brief   Reads a counter.
+ *
+ * @return  Counter value
+ *******************************************************************************/
+static inline uint64_t tcpipc_stat_get(atomic_uint_fast64_t *stat)
+{
+    return atomic_load_explicit(stat, memory_order_relaxed);
+}
+
+#endif // TCPIPC_STATS_H
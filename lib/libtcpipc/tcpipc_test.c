@@ -0,0 +1,246 @@
+/*******************************************************************************
+ * @file    tcpipc_test.c
+ * @brief   Runner of the libtcpipc self-checking tests. Prints one line per
+ *          test and exits non-zero when any of them fails. What a test and
+ *          the library print goes to a scratch file, shown only when the
+ *          test fails.
+ *
+ *          Usage: tcpipc_test [-v] [test ...]
+ *
+ *          Without test names every test runs, -v shows all output as it is
+ *          printed. Tests that need a port pick a free one.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "tcpipc_test.h"
+
+/** Defines  **/
+#define TEST_PAIR_RETRY_USEC (10000)
+
+/** User Data Types **/
+struct test_server_t
+{
+    const struct tcpipc_opts_t *opts;
+    int port;
+    struct tcpipc_ctx *ctx;
+};
+
+/** Private Function Prototypes **/
+static int test_run(const struct test_case_t *test, int verbose);
+static void *test_pair_server(void *arg);
+
+/** Global Variables **/
+static const struct test_case_t test_cases[] = {
+    {"epoll_senders", test_epoll_senders},
+    {"epoll_stalled_peer", test_epoll_stalled_peer},
+    {"decoder_split", test_decoder_split},
+    {"decoder_oversize", test_decoder_oversize},
+    {"udp_reorder", test_udp_reorder},
+    {"udp_window", test_udp_window},
+    {"shm", test_shm},
+    {"conflate", test_conflate},
+    {"conflate_drop_oldest", test_conflate_drop_oldest},
+    {"overflow_drop_newest", test_overflow_drop_newest},
+    {"overflow_drop_oldest", test_overflow_drop_oldest},
+    {"overflow_block", test_overflow_block},
+    {"overflow_grow", test_overflow_grow},
+    {"chan_drr", test_chan_drr},
+    {"bulk", test_bulk},
+    {"resume", test_resume},
+    {"resume_batch", test_resume_batch},
+    {"capture_replay", test_capture_replay},
+};
+
+int main(int argc, char **argv)
+{
+    size_t count = sizeof(test_cases) / sizeof(test_cases[0]);
+    int failed = 0, ran = 0, verbose = 0, opt, i;
+    size_t t;
+
+    while ((opt = getopt(argc, argv, "v")) != -1)
+    {
+        switch (opt)
+        {
+        case 'v':
+            verbose = 1;
+            break;
+        default:
+            printf("Usage: %s [-v] [test ...]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (t = 0; t < count; t++)
+    {
+        // Only the named tests, when any are given
+        for (i = optind; i < argc; i++)
+            if (strcmp(argv[i], test_cases[t].name) == 0)
+                break;
+
+        if (optind < argc && i == argc)
+            continue;
+
+        if (test_run(&test_cases[t], verbose))
+        {
+            printf("%-24s FAILED\n", test_cases[t].name);
+            failed++;
+        }
+        else
+            printf("%-24s ok\n", test_cases[t].name);
+
+        fflush(stdout);
+        ran++;
+    }
+
+    printf("%d of %d tests passed\n", ran - failed, ran);
+
+    return failed || ran == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*******************************************************************************
+ * @brief   Picks a loopback port of the given socket type that is free right
+ *          now, by binding port 0 and reading back what the kernel chose.
+ *
+ * @return  Port on success, -1 on failure
+ *******************************************************************************/
+int test_port(int type)
+{
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int fd, port = -1;
+
+    fd = socket(AF_INET, type, 0);
+
+    if (fd < 0)
+        return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+        getsockname(fd, (struct sockaddr *)&addr, &addr_len) == 0)
+        port = ntohs(addr.sin_port);
+
+    close(fd);
+
+    return port;
+}
+
+/*******************************************************************************
+ * @brief   Connects a client to a server on a free port, both with opts. The
+ *          server is set up on its own thread while the client retries until
+ *          it listens.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_pair(const struct tcpipc_opts_t *opts, struct tcpipc_ctx **server,
+              struct tcpipc_ctx **client)
+{
+    struct test_server_t srv;
+    uint64_t deadline;
+    pthread_t tid;
+
+    srv.opts = opts;
+    srv.port = test_port(SOCK_STREAM);
+    srv.ctx = NULL;
+    *client = NULL;
+
+    if (srv.port < 0 ||
+        pthread_create(&tid, NULL, test_pair_server, &srv) != 0)
+        return -1;
+
+    deadline = tcpipc_now_ns() + TEST_TIMEOUT_MS * 1000000ULL;
+
+    while (*client == NULL && tcpipc_now_ns() < deadline)
+    {
+        *client = tcpipc_init_opts(TCP_ROLE_CLIENT, "127.0.0.1", srv.port,
+                                   opts);
+
+        if (*client == NULL)
+            usleep(TEST_PAIR_RETRY_USEC);
+    }
+
+    // Without a client the server never returns from accepting one
+    if (*client == NULL)
+    {
+        pthread_cancel(tid);
+        pthread_join(tid, NULL);
+        return -1;
+    }
+
+    pthread_join(tid, NULL);
+    *server = srv.ctx;
+
+    if (*server == NULL)
+    {
+        tcpipc_close(*client);
+        *client = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Runs one test. Unless verbose, stdout and stderr go to a scratch
+ *          file for the duration, which is shown if the test fails.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int test_run(const struct test_case_t *test, int verbose)
+{
+    int saved_out, saved_err, ret;
+    char buf[4096];
+    size_t len;
+    FILE *log;
+
+    if (verbose || (log = tmpfile()) == NULL)
+        return test->run();
+
+    fflush(stdout);
+    fflush(stderr);
+    saved_out = dup(STDOUT_FILENO);
+    saved_err = dup(STDERR_FILENO);
+    dup2(fileno(log), STDOUT_FILENO);
+    dup2(fileno(log), STDERR_FILENO);
+
+    ret = test->run();
+
+    fflush(stdout);
+    fflush(stderr);
+    dup2(saved_out, STDOUT_FILENO);
+    dup2(saved_err, STDERR_FILENO);
+    close(saved_out);
+    close(saved_err);
+
+    if (ret)
+    {
+        rewind(log);
+
+        while ((len = fread(buf, 1, sizeof(buf), log)) > 0)
+            fwrite(buf, 1, len, stdout);
+    }
+
+    fclose(log);
+
+    return ret;
+}
+
+/*******************************************************************************
+ * @brief   Server side of test_pair(), returns once a client connected.
+ *
+ * @return
+ *******************************************************************************/
+static void *test_pair_server(void *arg)
+{
+    struct test_server_t *srv = (struct test_server_t *)arg;
+
+    srv->ctx = tcpipc_init_opts(TCP_ROLE_SERVER, NULL, srv->port, srv->opts);
+
+    return NULL;
+}
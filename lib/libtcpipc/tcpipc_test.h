@@ -0,0 +1,104 @@
+/*******************************************************************************
+ * @file    tcpipc_test.h
+ * @brief   Shared by the libtcpipc self-checking tests. Every
+ *          tcpipc_test_<area>.c holds the tests of one part of the library,
+ *          declared here and listed in the table of tcpipc_test.c.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_TEST_H
+#define TCPIPC_TEST_H
+
+/** Standard libraries **/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/** Application specififc libraries **/
+#include "tcpipc.h"
+#include "tcpipc_ctx.h"
+
+/** Defines  **/
+#define TEST_MSG_DATA (1)
+#define TEST_MSG_STATE (2)
+#define TEST_TIMEOUT_MS (5000)
+
+// Fails the calling test, naming the expectation that did not hold
+#define TEST_CHECK(cond)                                              \
+    do                                                                \
+    {                                                                 \
+        if (!(cond))                                                  \
+        {                                                             \
+            printf("    %s:%d: %s\n", __FILE__, __LINE__, #cond);     \
+            return -1;                                                \
+        }                                                             \
+    } while (0)
+
+/** User Data Types **/
+struct test_case_t
+{
+    const char *name;
+    int (*run)(void);
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Picks a loopback port of the given socket type that is free right
+ *          now, by binding port 0 and reading back what the kernel chose.
+ *
+ * @return  Port on success, -1 on failure
+ *******************************************************************************/
+int test_port(int type);
+
+/*******************************************************************************
+ * @brief   Connects a client to a server on a free port, both with opts. The
+ *          server is set up on its own thread while the client retries until
+ *          it listens.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_pair(const struct tcpipc_opts_t *opts, struct tcpipc_ctx **server,
+              struct tcpipc_ctx **client);
+
+/** tcpipc_test_epoll.c **/
+int test_epoll_senders(void);
+int test_epoll_stalled_peer(void);
+
+/** tcpipc_test_decoder.c **/
+int test_decoder_split(void);
+int test_decoder_oversize(void);
+
+/** tcpipc_test_udp.c **/
+int test_udp_reorder(void);
+int test_udp_window(void);
+
+/** tcpipc_test_shm.c **/
+int test_shm(void);
+
+/** tcpipc_test_queue.c **/
+int test_conflate(void);
+int test_conflate_drop_oldest(void);
+int test_overflow_drop_newest(void);
+int test_overflow_drop_oldest(void);
+int test_overflow_block(void);
+int test_overflow_grow(void);
+
+/** tcpipc_test_chan.c **/
+int test_chan_drr(void);
+
+/** tcpipc_test_bulk.c **/
+int test_bulk(void);
+
+/** tcpipc_test_resume.c **/
+int test_resume(void);
+int test_resume_batch(void);
+
+/** tcpipc_test_capture.c **/
+int test_capture_replay(void);
+
+#endif // TCPIPC_TEST_H
@@ -0,0 +1,206 @@
+/*******************************************************************************
+ * @file    tcpipc_test_bulk.c
+ * @brief   Bulk transfer test: payloads cut into many fragments, from memory
+ *          and from a file, with other messages sent in between, are put back
+ *          together into one message each.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include "tcpipc_test.h"
+
+/** Defines  **/
+#define TEST_BULK_MSG_MEM (5)
+#define TEST_BULK_MSG_FILE (6)
+#define TEST_BULK_MSG_EMPTY (7)
+#define TEST_BULK_LEN ((3 << 20) + 17)
+#define TEST_BULK_FILE_OFF (100)
+#define TEST_BULK_FILE_LEN ((1 << 20) + 123)
+#define TEST_BULK_SMALL (3)
+
+/** Private Function Prototypes **/
+static uint8_t test_bulk_byte(uint32_t index, uint8_t seed);
+static int test_bulk_check(const struct msg_packet_t *msg, uint32_t len,
+                           uint8_t seed);
+static int test_bulk_file(uint32_t len);
+
+/*******************************************************************************
+ * @brief   Sends a transfer from memory on channel 1 with small messages
+ *          between its fragments, one from a file and an empty one. The
+ *          receiver must get each transfer whole on its channel and the
+ *          small messages in order.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_bulk(void)
+{
+    struct tcpipc_ctx *server, *client;
+    struct tcpipc_stats_t stats;
+    struct tcpipc_opts_t opts;
+    struct msg_packet_t msg;
+    uint32_t small = 0, got = 0, i;
+    uint8_t *buf;
+    int fd, ret, seen[3] = {0};
+
+    buf = malloc(TEST_BULK_LEN);
+    TEST_CHECK(buf != NULL);
+
+    for (i = 0; i < TEST_BULK_LEN; i++)
+        buf[i] = test_bulk_byte(i, 1);
+
+    fd = test_bulk_file(TEST_BULK_FILE_OFF + TEST_BULK_FILE_LEN);
+    TEST_CHECK(fd >= 0);
+
+    tcpipc_opts_default(&opts);
+    opts.len_size = TCPIPC_LEN_32;
+    opts.channels = 2;
+    opts.bulk_max_len = 8 << 20;
+    opts.rx_queue_len = 64;
+
+    TEST_CHECK(test_pair(&opts, &server, &client) == 0);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_id = TEST_MSG_DATA;
+    msg.msg_len = sizeof(small);
+    msg.msg_data = (uint8_t *)&small;
+
+    TEST_CHECK(tcpipc_bulk_send(client, 1, TEST_BULK_MSG_MEM, buf,
+                                TEST_BULK_LEN) == 0);
+
+    // One transfer at a time
+    TEST_CHECK(tcpipc_bulk_send(client, 1, TEST_BULK_MSG_MEM, buf,
+                                TEST_BULK_LEN) == -1);
+
+    while ((ret = tcpipc_bulk_poll(client)) == 1)
+    {
+        if (small < TEST_BULK_SMALL)
+        {
+            TEST_CHECK(tcpipc_send(client, &msg) == 0);
+            small++;
+        }
+    }
+
+    TEST_CHECK(ret == 0);
+    TEST_CHECK(tcpipc_bulk_sendfile(client, 0, TEST_BULK_MSG_FILE, fd,
+                                    TEST_BULK_FILE_OFF,
+                                    TEST_BULK_FILE_LEN) == 0);
+    TEST_CHECK(tcpipc_bulk_wait(client, TEST_TIMEOUT_MS) == 0);
+    TEST_CHECK(tcpipc_bulk_send(client, 0, TEST_BULK_MSG_EMPTY, buf, 0) == 0);
+    TEST_CHECK(tcpipc_bulk_wait(client, TEST_TIMEOUT_MS) == 0);
+    close(fd);
+
+    small = 0;
+
+    for (got = 0; got < TEST_BULK_SMALL + 3; got++)
+    {
+        TEST_CHECK(tcpipc_recv_wait(server, &msg, TEST_TIMEOUT_MS) == 0);
+
+        switch (msg.msg_id)
+        {
+        case TEST_MSG_DATA:
+            TEST_CHECK(msg.msg_len == sizeof(i));
+            memcpy(&i, msg.msg_data, sizeof(i));
+            TEST_CHECK(i == small++);
+            break;
+        case TEST_BULK_MSG_MEM:
+            TEST_CHECK(msg.msg_chan == 1);
+            TEST_CHECK(test_bulk_check(&msg, TEST_BULK_LEN, 1) == 0);
+            seen[0]++;
+            break;
+        case TEST_BULK_MSG_FILE:
+            TEST_CHECK(msg.msg_chan == 0);
+            TEST_CHECK(test_bulk_check(&msg, TEST_BULK_FILE_LEN, 2) == 0);
+            seen[1]++;
+            break;
+        case TEST_BULK_MSG_EMPTY:
+            TEST_CHECK(msg.msg_len == 0);
+            seen[2]++;
+            break;
+        default:
+            TEST_CHECK(0);
+        }
+
+        tcpipc_msg_free(&msg);
+    }
+
+    tcpipc_get_stats(server, &stats);
+    tcpipc_close(client);
+    tcpipc_close(server);
+    free(buf);
+
+    TEST_CHECK(small == TEST_BULK_SMALL);
+    TEST_CHECK(seen[0] == 1 && seen[1] == 1 && seen[2] == 1);
+    TEST_CHECK(stats.bulk_rx_msgs == 3);
+    TEST_CHECK(stats.bulk_rx_drops == 0);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Byte at index of a transfer, seed tells the transfers apart.
+ *
+ * @return  Byte value
+ *******************************************************************************/
+static uint8_t test_bulk_byte(uint32_t index, uint8_t seed)
+{
+    return (uint8_t)(index * 7 + seed);
+}
+
+/*******************************************************************************
+ * @brief   Compares a reassembled transfer against what was sent.
+ *
+ * @return  0 if it matches, -1 otherwise
+ *******************************************************************************/
+static int test_bulk_check(const struct msg_packet_t *msg, uint32_t len,
+                           uint8_t seed)
+{
+    uint32_t i;
+
+    TEST_CHECK(msg->msg_len == len);
+
+    for (i = 0; i < len; i++)
+        TEST_CHECK(msg->msg_data[i] == test_bulk_byte(i, seed));
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Creates an unlinked scratch file of len bytes, the transfer from
+ *          TEST_BULK_FILE_OFF on is the one test_bulk_check() expects.
+ *
+ * @return  File descriptor, -1 on failure
+ *******************************************************************************/
+static int test_bulk_file(uint32_t len)
+{
+    char path[] = "/tmp/tcpipc_test_bulk.XXXXXX";
+    uint8_t *buf;
+    uint32_t i;
+    int fd;
+
+    fd = mkstemp(path);
+
+    if (fd < 0)
+        return -1;
+
+    unlink(path);
+    buf = malloc(len);
+
+    if (buf == NULL)
+    {
+        close(fd);
+        return -1;
+    }
+
+    for (i = 0; i < len; i++)
+        buf[i] = test_bulk_byte(i - TEST_BULK_FILE_OFF, 2);
+
+    if (write(fd, buf, len) != len)
+    {
+        close(fd);
+        fd = -1;
+    }
+
+    free(buf);
+
+    return fd;
+}
@@ -0,0 +1,330 @@
+/*******************************************************************************
+ * @file    tcpipc_test_capture.c
+ * @brief   Capture and replay test: traffic captured by one endpoint, played
+ *          back the way tcpipc_replay does into a second capturing
+ *          endpoint, must come out as the same records.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <dirent.h>
+
+#include "tcpipc_test.h"
+
+/** Defines  **/
+#define TEST_CAPTURE_COUNT (2000)
+#define TEST_CAPTURE_CHANNELS (3)
+#define TEST_CAPTURE_IDS (5)
+#define TEST_CAPTURE_MAX_LEN (37)
+#define TEST_CAPTURE_BULK_ID (9)
+#define TEST_CAPTURE_BULK_LEN (200000)
+#define TEST_CAPTURE_QUEUE_LEN (4096)
+#define TEST_CAPTURE_SUFFIX ".server.bin"
+
+/** Private Function Prototypes **/
+static void test_capture_opts(struct tcpipc_opts_t *opts, const char *dir);
+static int test_capture_record(struct tcpipc_ctx *server, const char *dir,
+                               const uint8_t *bulk,
+                               struct tcpipc_capture_map_t *map);
+static int test_capture_replay_into(struct tcpipc_capture_map_t *map,
+                                    const char *dir,
+                                    struct tcpipc_capture_map_t *out);
+static int test_capture_find(const char *dir, char *path, size_t size);
+static void test_capture_cleanup(const char *dir);
+
+/*******************************************************************************
+ * @brief   Captures TEST_CAPTURE_COUNT messages over all channels and one
+ *          bulk transfer, checks the records against what was sent, replays
+ *          them and compares the second capture with the first.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_capture_replay(void)
+{
+    char dirs[2][32] = {"/tmp/tcpipc_test_cap.XXXXXX",
+                        "/tmp/tcpipc_test_cap.XXXXXX"};
+    struct tcpipc_capture_map_t map, out;
+    const struct tcpipc_capture_rec_t *rec, *rec_out;
+    const uint8_t *data, *data_out;
+    struct tcpipc_ctx *server, *client;
+    struct tcpipc_opts_t opts;
+    struct msg_packet_t msg;
+    uint8_t buf[TEST_CAPTURE_MAX_LEN + sizeof(uint32_t)];
+    uint8_t *bulk;
+    uint32_t i, count = 0;
+    int ret = 0;
+
+    TEST_CHECK(mkdtemp(dirs[0]) && mkdtemp(dirs[1]));
+
+    bulk = malloc(TEST_CAPTURE_BULK_LEN);
+    TEST_CHECK(bulk != NULL);
+
+    for (i = 0; i < TEST_CAPTURE_BULK_LEN; i++)
+        bulk[i] = (uint8_t)(i * 7);
+
+    test_capture_opts(&opts, dirs[0]);
+    TEST_CHECK(test_pair(&opts, &server, &client) == 0);
+
+    memset(buf, 0, sizeof(buf));
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_data = buf;
+
+    for (i = 0; i < TEST_CAPTURE_COUNT && ret == 0; i++)
+    {
+        memcpy(buf, &i, sizeof(i));
+        msg.msg_id = 1 + i % TEST_CAPTURE_IDS;
+        msg.msg_len = sizeof(i) + i % TEST_CAPTURE_MAX_LEN;
+        ret = tcpipc_send_chan(client, i % TEST_CAPTURE_CHANNELS, &msg);
+    }
+
+    TEST_CHECK(ret == 0);
+    TEST_CHECK(tcpipc_bulk_send(client, TEST_CAPTURE_CHANNELS - 1,
+                                TEST_CAPTURE_BULK_ID, bulk,
+                                TEST_CAPTURE_BULK_LEN) == 0);
+    TEST_CHECK(tcpipc_bulk_wait(client, TEST_TIMEOUT_MS) == 0);
+
+    ret = test_capture_record(server, dirs[0], bulk, &map);
+    tcpipc_close(client);
+    free(bulk);
+    TEST_CHECK(ret == 0);
+
+    ret = test_capture_replay_into(&map, dirs[1], &out);
+
+    if (ret == 0)
+    {
+        // Same records apart from the arrival times
+        map.pos = sizeof(struct tcpipc_capture_hdr_t);
+
+        while ((rec = tcpipc_capture_next(&map, &data)) != NULL)
+        {
+            rec_out = tcpipc_capture_next(&out, &data_out);
+
+            if (rec_out == NULL || rec_out->msg_id != rec->msg_id ||
+                rec_out->msg_chan != rec->msg_chan ||
+                rec_out->msg_len != rec->msg_len ||
+                memcmp(data_out, data, rec->msg_len) != 0)
+                break;
+
+            count++;
+        }
+
+        if (tcpipc_capture_next(&out, &data_out) != NULL)
+            count = 0;
+
+        tcpipc_capture_unmap(&out);
+    }
+
+    tcpipc_capture_unmap(&map);
+    test_capture_cleanup(dirs[0]);
+    test_capture_cleanup(dirs[1]);
+
+    TEST_CHECK(ret == 0);
+    TEST_CHECK(count == TEST_CAPTURE_COUNT + 1);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Options of both ends, with the capture going to dir. The receive
+ *          queue holds everything sent.
+ *
+ * @return
+ *******************************************************************************/
+static void test_capture_opts(struct tcpipc_opts_t *opts, const char *dir)
+{
+    tcpipc_opts_default(opts);
+    opts->channels = TEST_CAPTURE_CHANNELS;
+    opts->bulk_max_len = 1 << 20;
+    opts->rx_queue_len = TEST_CAPTURE_QUEUE_LEN;
+    opts->rx_queue_max = TEST_CAPTURE_QUEUE_LEN;
+    opts->capture = 1;
+    opts->capture_dir = dir;
+}
+
+/*******************************************************************************
+ * @brief   Takes every message the server was sent, closes it so the capture
+ *          reaches the file, maps the capture and checks each record.
+ *
+ * @return  0 on success with the capture mapped, -1 on failure
+ *******************************************************************************/
+static int test_capture_record(struct tcpipc_ctx *server, const char *dir,
+                               const uint8_t *bulk,
+                               struct tcpipc_capture_map_t *map)
+{
+    const struct tcpipc_capture_rec_t *rec;
+    char path[TCPIPC_CAPTURE_PATH_MAX];
+    struct msg_packet_t msg;
+    const uint8_t *data;
+    uint32_t i, value;
+    int ret = 0;
+
+    for (i = 0; i <= TEST_CAPTURE_COUNT && ret == 0; i++)
+    {
+        ret = tcpipc_recv_wait(server, &msg, TEST_TIMEOUT_MS);
+
+        if (ret == 0)
+            tcpipc_msg_free(&msg);
+    }
+
+    tcpipc_close(server);
+
+    TEST_CHECK(ret == 0);
+    TEST_CHECK(test_capture_find(dir, path, sizeof(path)) == 0);
+    TEST_CHECK(tcpipc_capture_map(map, path) == 0);
+
+    for (i = 0; i < TEST_CAPTURE_COUNT; i++)
+    {
+        rec = tcpipc_capture_next(map, &data);
+
+        if (rec == NULL)
+            break;
+
+        memcpy(&value, data, sizeof(value));
+
+        if (value != i || rec->msg_id != 1 + i % TEST_CAPTURE_IDS ||
+            rec->msg_chan != i % TEST_CAPTURE_CHANNELS ||
+            rec->msg_len != sizeof(i) + i % TEST_CAPTURE_MAX_LEN)
+            break;
+    }
+
+    rec = tcpipc_capture_next(map, &data);
+
+    if (i < TEST_CAPTURE_COUNT || rec == NULL ||
+        rec->msg_id != TEST_CAPTURE_BULK_ID ||
+        rec->msg_len != TEST_CAPTURE_BULK_LEN ||
+        memcmp(data, bulk, TEST_CAPTURE_BULK_LEN) != 0 ||
+        tcpipc_capture_next(map, &data) != NULL)
+    {
+        printf("    Capture differs from the traffic at record %u\n", i);
+        tcpipc_capture_unmap(map);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Sends every record of map, on its channel and with its ID, to a
+ *          server capturing into dir, as a bulk transfer when it does not fit
+ *          a fragment. Maps the new capture into out.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int test_capture_replay_into(struct tcpipc_capture_map_t *map,
+                                    const char *dir,
+                                    struct tcpipc_capture_map_t *out)
+{
+    const struct tcpipc_capture_rec_t *rec;
+    char path[TCPIPC_CAPTURE_PATH_MAX];
+    struct tcpipc_ctx *server, *client;
+    struct tcpipc_opts_t opts;
+    struct msg_packet_t msg;
+    const uint8_t *data;
+    uint32_t count = 0;
+    int ret = 0;
+
+    test_capture_opts(&opts, dir);
+    TEST_CHECK(test_pair(&opts, &server, &client) == 0);
+
+    map->pos = sizeof(struct tcpipc_capture_hdr_t);
+    memset(&msg, 0, sizeof(msg));
+
+    while (ret == 0 && (rec = tcpipc_capture_next(map, &data)) != NULL)
+    {
+        if (rec->msg_len > opts.bulk_frag_len)
+        {
+            ret = tcpipc_bulk_send(client, rec->msg_chan, rec->msg_id, data,
+                                   rec->msg_len);
+
+            if (ret == 0)
+                ret = tcpipc_bulk_wait(client, TEST_TIMEOUT_MS);
+        }
+        else
+        {
+            msg.msg_id = rec->msg_id;
+            msg.msg_len = rec->msg_len;
+            msg.msg_data = (uint8_t *)data;
+            ret = tcpipc_send_chan(client, rec->msg_chan, &msg);
+        }
+
+        count++;
+    }
+
+    tcpipc_close(client);
+
+    // Receiving them all means the capture holds them all once closed
+    while (ret == 0 && count--)
+    {
+        ret = tcpipc_recv_wait(server, &msg, TEST_TIMEOUT_MS);
+
+        if (ret == 0)
+            tcpipc_msg_free(&msg);
+    }
+
+    tcpipc_close(server);
+
+    TEST_CHECK(ret == 0);
+    TEST_CHECK(test_capture_find(dir, path, sizeof(path)) == 0);
+    TEST_CHECK(tcpipc_capture_map(out, path) == 0);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Finds the server capture in dir.
+ *
+ * @return  0 on success, -1 if there is none
+ *******************************************************************************/
+static int test_capture_find(const char *dir, char *path, size_t size)
+{
+    size_t len, suffix_len = strlen(TEST_CAPTURE_SUFFIX);
+    struct dirent *entry;
+    DIR *d = opendir(dir);
+    int ret = -1;
+
+    if (d == NULL)
+        return -1;
+
+    while (ret && (entry = readdir(d)) != NULL)
+    {
+        len = strlen(entry->d_name);
+
+        if (len > suffix_len &&
+            strcmp(entry->d_name + len - suffix_len, TEST_CAPTURE_SUFFIX) == 0)
+        {
+            snprintf(path, size, "%s/%s", dir, entry->d_name);
+            ret = 0;
+        }
+    }
+
+    closedir(d);
+
+    return ret;
+}
+
+/*******************************************************************************
+ * @brief   Removes the captures in dir and dir itself.
+ *
+ * @return
+ *******************************************************************************/
+static void test_capture_cleanup(const char *dir)
+{
+    struct dirent *entry;
+    char path[TCPIPC_CAPTURE_PATH_MAX + sizeof(entry->d_name)];
+    DIR *d = opendir(dir);
+
+    if (d == NULL)
+        return;
+
+    while ((entry = readdir(d)) != NULL)
+    {
+        if (entry->d_name[0] == '.')
+            continue;
+
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        unlink(path);
+    }
+
+    closedir(d);
+    rmdir(dir);
+}
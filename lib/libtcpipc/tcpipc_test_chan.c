@@ -0,0 +1,119 @@
+/*******************************************************************************
+ * @file    tcpipc_test_chan.c
+ * @brief   Channel test: a flush of a batched TCP connection writes the
+ *          channel queues in deficit round robin order, channel 0 first and
+ *          each channel its weight per round.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include "tcpipc_test.h"
+
+/** Defines  **/
+#define TEST_CHAN_COUNT (3)
+#define TEST_CHAN_LEN (1000)
+#define TEST_CHAN_BUF_SIZE (65536)
+#define TEST_CHAN_SLOW (6)
+#define TEST_CHAN_FAST (12)
+#define TEST_CHAN_QUEUE_LEN (32)
+
+/** Private Function Prototypes **/
+static int test_chan_send(struct tcpipc_ctx *ctx, uint8_t chan,
+                          uint32_t value, uint32_t len);
+
+/*******************************************************************************
+ * @brief   Channel 2 is queued first and weighs three frames per round,
+ *          channel 1 one frame, channel 0 holds one small frame. Nothing goes
+ *          out before the flush, which must write channel 0, then rounds of
+ *          one channel 1 and three channel 2 frames, then the rest of
+ *          channel 1. Each channel keeps its own order.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_chan_drr(void)
+{
+    static const char order[] = "0122212221222122211";
+    uint32_t expect[TEST_CHAN_COUNT] = {0}, frame_len, i;
+    struct tcpipc_ctx *server, *client;
+    uint8_t hdr[TCPIPC_HDR_MAX_LEN];
+    struct tcpipc_opts_t opts;
+    struct msg_packet_t msg;
+    char got[sizeof(order)];
+    uint32_t value;
+
+    tcpipc_opts_default(&opts);
+    opts.len_size = TCPIPC_LEN_16;
+    opts.channels = TEST_CHAN_COUNT;
+    opts.tx_batch = 1;
+    opts.tx_buf_size = TEST_CHAN_BUF_SIZE;
+    opts.tx_flush_bytes = TEST_CHAN_BUF_SIZE;
+    opts.tx_flush_usec = 0;
+    opts.rx_queue_len = TEST_CHAN_QUEUE_LEN;
+
+    // Weights in whole frames, channel prefix included
+    frame_len = tcpipc_encode_header(hdr, opts.len_size, TEST_MSG_DATA,
+                                     TCPIPC_CHAN_LEN + TEST_CHAN_LEN) +
+                TCPIPC_CHAN_LEN + TEST_CHAN_LEN;
+    opts.chan_weight[1] = frame_len;
+    opts.chan_weight[2] = 3 * frame_len;
+
+    TEST_CHECK(test_pair(&opts, &server, &client) == 0);
+
+    for (i = 0; i < TEST_CHAN_FAST; i++)
+        TEST_CHECK(test_chan_send(client, 2, i, TEST_CHAN_LEN) == 0);
+
+    for (i = 0; i < TEST_CHAN_SLOW; i++)
+        TEST_CHECK(test_chan_send(client, 1, i, TEST_CHAN_LEN) == 0);
+
+    TEST_CHECK(test_chan_send(client, 0, 0, sizeof(value)) == 0);
+    TEST_CHECK(tcpipc_recv_wait(server, &msg, 100) == -1);
+    TEST_CHECK(tcpipc_flush(client) == 0);
+
+    for (i = 0; i < sizeof(order) - 1; i++)
+    {
+        TEST_CHECK(tcpipc_recv_wait(server, &msg, TEST_TIMEOUT_MS) == 0);
+        memcpy(&value, msg.msg_data, sizeof(value));
+
+        got[i] = '0' + msg.msg_chan;
+        got[i + 1] = '\0';
+
+        if (msg.msg_chan >= TEST_CHAN_COUNT || value != expect[msg.msg_chan])
+            printf("    Channel %u got %u\n", msg.msg_chan, value);
+        else
+            expect[msg.msg_chan]++;
+
+        tcpipc_msg_free(&msg);
+    }
+
+    tcpipc_close(client);
+    tcpipc_close(server);
+
+    printf("    Order %s\n", got);
+    TEST_CHECK(strcmp(got, order) == 0);
+    TEST_CHECK(expect[0] == 1);
+    TEST_CHECK(expect[1] == TEST_CHAN_SLOW);
+    TEST_CHECK(expect[2] == TEST_CHAN_FAST);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Queues a message of len bytes starting with value on chan.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int test_chan_send(struct tcpipc_ctx *ctx, uint8_t chan,
+                          uint32_t value, uint32_t len)
+{
+    uint8_t buf[TEST_CHAN_LEN];
+    struct msg_packet_t msg;
+
+    memset(buf, 0, sizeof(buf));
+    memcpy(buf, &value, sizeof(value));
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_id = TEST_MSG_DATA;
+    msg.msg_len = len;
+    msg.msg_data = buf;
+
+    return tcpipc_send_chan(ctx, chan, &msg);
+}
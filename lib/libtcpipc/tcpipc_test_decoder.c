@@ -0,0 +1,234 @@
+/*******************************************************************************
+ * @file    tcpipc_test_decoder.c
+ * @brief   Decoder tests: framing across reads split at every point, for
+ *          every length field size, and frames over max_msg_len.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include "tcpipc_test.h"
+
+/** Defines  **/
+#define TEST_DEC_FRAMES (1000)
+#define TEST_DEC_MAX_LEN (300)
+#define TEST_DEC_STREAM_SIZE \
+    (TEST_DEC_FRAMES * (TCPIPC_HDR_MAX_LEN + TEST_DEC_MAX_LEN))
+
+/** User Data Types **/
+struct test_dec_state_t
+{
+    uint8_t len_size;
+    uint32_t frames;
+    uint32_t bad;
+};
+
+/** Private Function Prototypes **/
+static uint32_t test_dec_len(uint32_t index, uint8_t len_size);
+static size_t test_dec_stream(uint8_t *stream, uint8_t len_size);
+static void test_dec_frame(void *arg, uint8_t msg_id, const uint8_t *data,
+                           uint32_t len);
+static int test_dec_read(struct test_dec_state_t *state,
+                         const uint8_t *stream, size_t len, size_t chunk);
+
+/** Global Variables **/
+static uint8_t test_stream[TEST_DEC_STREAM_SIZE];
+
+/*******************************************************************************
+ * @brief   Every length field size, with headers and payloads split at every
+ *          point by reads of 1 to 1024 bytes.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_decoder_split(void)
+{
+    static const uint8_t len_sizes[] = {TCPIPC_LEN_8, TCPIPC_LEN_16,
+                                        TCPIPC_LEN_32};
+    static const size_t chunks[] = {1, 2, 3, 5, 7, 64, 1024};
+    struct test_dec_state_t state;
+    size_t len, l, c;
+
+    for (l = 0; l < sizeof(len_sizes); l++)
+    {
+        state.len_size = len_sizes[l];
+        len = test_dec_stream(test_stream, state.len_size);
+
+        for (c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++)
+        {
+            TEST_CHECK(test_dec_read(&state, test_stream, len, chunks[c]) ==
+                       0);
+            TEST_CHECK(state.frames == TEST_DEC_FRAMES);
+            TEST_CHECK(state.bad == 0);
+        }
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   A frame of max_msg_len passes, one byte more stops the parse after
+ *          the frames before it, also when its header arrives byte by byte,
+ *          until the decoder is reset.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_decoder_oversize(void)
+{
+    struct test_dec_state_t state;
+    struct tcpipc_decoder_t dec;
+    uint8_t hdr[TCPIPC_HDR_MAX_LEN];
+    size_t hdr_len, len, space, i;
+
+    memset(&state, 0, sizeof(state));
+    state.len_size = TCPIPC_LEN_16;
+
+    TEST_CHECK(tcpipc_decoder_init(&dec, TCPIPC_LEN_16, 16,
+                                   TEST_DEC_MAX_LEN) == 0);
+
+    // Frame 0 carries exactly max_msg_len, frame 1 one byte more
+    len = tcpipc_encode_header(test_stream, TCPIPC_LEN_16, 0,
+                               TEST_DEC_MAX_LEN);
+    memset(test_stream + len, 0, TEST_DEC_MAX_LEN);
+    len += TEST_DEC_MAX_LEN;
+    len += tcpipc_encode_header(test_stream + len, TCPIPC_LEN_16, 1,
+                                TEST_DEC_MAX_LEN + 1);
+
+    TEST_CHECK(tcpipc_decoder_feed(&dec, test_stream, len) == 0);
+    TEST_CHECK(tcpipc_decoder_parse(&dec, test_dec_frame, &state) == -1);
+    TEST_CHECK(state.frames == 1);
+    TEST_CHECK(tcpipc_decoder_wbuf(&dec, &space) == NULL);
+    TEST_CHECK(tcpipc_decoder_feed(&dec, test_stream, 1) == -1);
+
+    tcpipc_decoder_reset(&dec);
+    TEST_CHECK(tcpipc_decoder_wbuf(&dec, &space) != NULL);
+
+    hdr_len = tcpipc_encode_header(hdr, TCPIPC_LEN_16, 1,
+                                   TEST_DEC_MAX_LEN + 1);
+
+    for (i = 0; i < hdr_len; i++)
+    {
+        TEST_CHECK(tcpipc_decoder_feed(&dec, hdr + i, 1) == 0);
+        TEST_CHECK(tcpipc_decoder_parse(&dec, test_dec_frame, &state) ==
+                   (i + 1 < hdr_len ? 0 : -1));
+    }
+
+    TEST_CHECK(state.frames == 1);
+
+    tcpipc_decoder_free(&dec);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Payload length of the index-th frame of the decoder stream, capped
+ *          to what the length field can describe.
+ *
+ * @return  Length in bytes
+ *******************************************************************************/
+static uint32_t test_dec_len(uint32_t index, uint8_t len_size)
+{
+    uint32_t len = index * 7 % TEST_DEC_MAX_LEN;
+
+    return len < tcpipc_len_size_max(len_size) ? len
+                                               : tcpipc_len_size_max(len_size);
+}
+
+/*******************************************************************************
+ * @brief   Encodes TEST_DEC_FRAMES frames into stream. Frame i has ID i and a
+ *          payload filled with i.
+ *
+ * @return  Stream length in bytes
+ *******************************************************************************/
+static size_t test_dec_stream(uint8_t *stream, uint8_t len_size)
+{
+    size_t pos = 0;
+    uint32_t i, len;
+
+    for (i = 0; i < TEST_DEC_FRAMES; i++)
+    {
+        len = test_dec_len(i, len_size);
+        pos += tcpipc_encode_header(stream + pos, len_size, (uint8_t)i, len);
+        memset(stream + pos, (uint8_t)i, len);
+        pos += len;
+    }
+
+    return pos;
+}
+
+/*******************************************************************************
+ * @brief   Frame callback, checks every frame against the encoded stream.
+ *
+ * @return
+ *******************************************************************************/
+static void test_dec_frame(void *arg, uint8_t msg_id, const uint8_t *data,
+                           uint32_t len)
+{
+    struct test_dec_state_t *state = (struct test_dec_state_t *)arg;
+    uint8_t fill = (uint8_t)state->frames;
+    uint32_t i;
+
+    for (i = 0; i < len; i++)
+        if (data[i] != fill)
+            break;
+
+    if (msg_id != fill || len != test_dec_len(state->frames, state->len_size) ||
+        i != len)
+        state->bad++;
+
+    state->frames++;
+}
+
+/*******************************************************************************
+ * @brief   Feeds the stream through the decoder the way the receive thread
+ *          does, as reads of at most chunk bytes, parsing after each one.
+ *
+ * @return  0 on success, -1 on a decoder error
+ *******************************************************************************/
+static int test_dec_read(struct test_dec_state_t *state,
+                         const uint8_t *stream, size_t len, size_t chunk)
+{
+    struct tcpipc_decoder_t dec;
+    size_t pos = 0, space;
+    uint8_t *wbuf;
+    int ret = 0;
+
+    // Start small so the buffer has to compact and grow on the way
+    if (tcpipc_decoder_init(&dec, state->len_size, 16, TEST_DEC_MAX_LEN))
+        return -1;
+
+    state->frames = 0;
+    state->bad = 0;
+
+    while (pos < len)
+    {
+        wbuf = tcpipc_decoder_wbuf(&dec, &space);
+
+        if (wbuf == NULL)
+        {
+            ret = -1;
+            break;
+        }
+
+        if (space > chunk)
+            space = chunk;
+        if (space > len - pos)
+            space = len - pos;
+
+        memcpy(wbuf, stream + pos, space);
+        tcpipc_decoder_commit(&dec, space);
+        pos += space;
+
+        if (tcpipc_decoder_parse(&dec, test_dec_frame, state) < 0)
+        {
+            ret = -1;
+            break;
+        }
+    }
+
+    // Nothing may be left over once the last frame was parsed
+    if (dec.rd != dec.wr)
+        ret = -1;
+
+    tcpipc_decoder_free(&dec);
+
+    return ret;
+}
@@ -0,0 +1,215 @@
+/*******************************************************************************
+ * @file    tcpipc_test_epoll.c
+ * @brief   Multi-connection server tests: frames sent from several threads to
+ *          a peer reading slower than they are sent arrive whole and in
+ *          order, and a peer that stops reading is disconnected instead of
+ *          growing the spill without bound.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <sys/socket.h>
+
+#include "tcpipc_test.h"
+#include "tcpipc_epoll.h"
+
+/** Defines  **/
+#define TEST_EPOLL_CONNS (4)
+#define TEST_EPOLL_SENDERS (2)
+// All senders together stay below TCPIPC_EPOLL_SPILL_MAX
+#define TEST_EPOLL_COUNT (2000)
+#define TEST_EPOLL_STALL_COUNT (20000)
+#define TEST_EPOLL_LEN (1000)
+#define TEST_EPOLL_QUEUE_LEN (16)
+
+/** User Data Types **/
+struct test_epoll_sender_t
+{
+    struct tcpipc_epoll_t *ep;
+    uint8_t msg_id;
+    uint32_t count;
+    uint32_t fails;
+};
+
+/** Private Function Prototypes **/
+static int test_epoll_setup(struct tcpipc_epoll_t **ep,
+                            struct tcpipc_ctx **client);
+static void *test_epoll_sender(void *arg);
+
+/*******************************************************************************
+ * @brief   Two threads send to one peer whose receive queue holds only a few
+ *          messages, so the socket fills up and the event loop has to finish
+ *          the frames. Every frame must arrive intact and in per-sender
+ *          order.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_epoll_senders(void)
+{
+    struct test_epoll_sender_t senders[TEST_EPOLL_SENDERS];
+    uint32_t expect[TEST_EPOLL_SENDERS + 1], value, got = 0, bad = 0, s;
+    pthread_t tids[TEST_EPOLL_SENDERS];
+    struct tcpipc_epoll_t *ep;
+    struct tcpipc_ctx *client;
+    struct msg_packet_t msg;
+
+    TEST_CHECK(test_epoll_setup(&ep, &client) == 0);
+
+    for (s = 0; s < TEST_EPOLL_SENDERS; s++)
+    {
+        senders[s].ep = ep;
+        senders[s].msg_id = s + 1;
+        senders[s].count = TEST_EPOLL_COUNT;
+        senders[s].fails = 0;
+        expect[s + 1] = 0;
+        TEST_CHECK(pthread_create(&tids[s], NULL, test_epoll_sender,
+                                  &senders[s]) == 0);
+    }
+
+    // Read only once the senders got ahead of the peer
+    usleep(100000);
+
+    while (got < TEST_EPOLL_SENDERS * TEST_EPOLL_COUNT &&
+           tcpipc_recv_wait(client, &msg, TEST_TIMEOUT_MS) == 0)
+    {
+        memcpy(&value, msg.msg_data, sizeof(value));
+
+        if (msg.msg_id < 1 || msg.msg_id > TEST_EPOLL_SENDERS ||
+            msg.msg_len != TEST_EPOLL_LEN || value != expect[msg.msg_id] ||
+            msg.msg_data[TEST_EPOLL_LEN - 1] != (uint8_t)value)
+            bad++;
+        else
+            expect[msg.msg_id]++;
+
+        got++;
+        tcpipc_msg_free(&msg);
+    }
+
+    for (s = 0; s < TEST_EPOLL_SENDERS; s++)
+        pthread_join(tids[s], NULL);
+
+    tcpipc_close(client);
+    tcpipc_epoll_close(ep);
+
+    TEST_CHECK(got == TEST_EPOLL_SENDERS * TEST_EPOLL_COUNT);
+    TEST_CHECK(bad == 0);
+
+    for (s = 0; s < TEST_EPOLL_SENDERS; s++)
+        TEST_CHECK(senders[s].fails == 0);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   A peer that stops reading lets the spill grow past
+ *          TCPIPC_EPOLL_SPILL_MAX, the connection is then closed and further
+ *          sends fail rather than queue.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_epoll_stalled_peer(void)
+{
+    struct test_epoll_sender_t sender;
+    struct tcpipc_epoll_t *ep;
+    struct tcpipc_ctx *client;
+    pthread_t tid;
+
+    TEST_CHECK(test_epoll_setup(&ep, &client) == 0);
+
+    sender.ep = ep;
+    sender.msg_id = 1;
+    sender.count = TEST_EPOLL_STALL_COUNT;
+    sender.fails = 0;
+    TEST_CHECK(pthread_create(&tid, NULL, test_epoll_sender, &sender) == 0);
+    pthread_join(tid, NULL);
+
+    TEST_CHECK(tcpipc_epoll_conn_state(ep, 0) == TCPIPC_CONN_CLOSED);
+    TEST_CHECK(sender.fails > 0);
+
+    tcpipc_close(client);
+    tcpipc_epoll_close(ep);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Opens a server on a free port and connects one client to it, in
+ *          slot 0. The client queue is small and blocks, so the receive
+ *          thread stops reading while the application does not take
+ *          messages.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int test_epoll_setup(struct tcpipc_epoll_t **ep,
+                            struct tcpipc_ctx **client)
+{
+    struct tcpipc_opts_t opts;
+    uint64_t deadline;
+    int port;
+
+    tcpipc_opts_default(&opts);
+    opts.len_size = TCPIPC_LEN_16;
+    opts.rx_overflow = RECV_MSG_OVERFLOW_DROP_NEWEST;
+
+    port = test_port(SOCK_STREAM);
+    *ep = port < 0 ? NULL : tcpipc_epoll_open(port, TEST_EPOLL_CONNS, &opts);
+
+    if (*ep == NULL)
+        return -1;
+
+    opts.rx_overflow = RECV_MSG_OVERFLOW_BLOCK;
+    opts.rx_queue_len = TEST_EPOLL_QUEUE_LEN;
+    opts.rx_queue_max = TEST_EPOLL_QUEUE_LEN;
+    *client = tcpipc_init_opts(TCP_ROLE_CLIENT, "127.0.0.1", port, &opts);
+
+    if (*client == NULL)
+    {
+        tcpipc_epoll_close(*ep);
+        return -1;
+    }
+
+    deadline = tcpipc_now_ns() + TEST_TIMEOUT_MS * 1000000ULL;
+
+    while (tcpipc_epoll_conn_state(*ep, 0) != TCPIPC_CONN_OPEN &&
+           tcpipc_now_ns() < deadline)
+        usleep(1000);
+
+    if (tcpipc_epoll_conn_state(*ep, 0) != TCPIPC_CONN_OPEN)
+    {
+        tcpipc_close(*client);
+        tcpipc_epoll_close(*ep);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Sends count frames of TEST_EPOLL_LEN bytes to slot 0, frame i
+ *          starting with i and filled with its low byte, counting failures.
+ *
+ * @return
+ *******************************************************************************/
+static void *test_epoll_sender(void *arg)
+{
+    struct test_epoll_sender_t *sender = (struct test_epoll_sender_t *)arg;
+    uint8_t buf[TEST_EPOLL_LEN];
+    struct msg_packet_t msg;
+    uint32_t i;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_id = sender->msg_id;
+    msg.msg_len = sizeof(buf);
+    msg.msg_data = buf;
+
+    for (i = 0; i < sender->count; i++)
+    {
+        memset(buf, (uint8_t)i, sizeof(buf));
+        memcpy(buf, &i, sizeof(i));
+
+        if (tcpipc_epoll_send(sender->ep, 0, &msg))
+            sender->fails++;
+    }
+
+    return NULL;
+}
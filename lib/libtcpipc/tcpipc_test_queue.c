@@ -0,0 +1,349 @@
+/*******************************************************************************
+ * @file    tcpipc_test_queue.c
+ * @brief   Receive queue tests: conflation of STATE messages and every
+ *          overflow policy.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include "tcpipc_test.h"
+
+/** Defines  **/
+#define TEST_QUEUE_LEN (4)
+#define TEST_QUEUE_MAX (16)
+#define TEST_BLOCK_COUNT (64)
+
+/** User Data Types **/
+struct test_block_t
+{
+    struct recv_msg_cb_t *cb;
+    uint32_t count;
+    int ret;
+};
+
+/** Private Function Prototypes **/
+static int test_queue_put(struct recv_msg_cb_t *cb, uint32_t value);
+static int test_queue_get(struct recv_msg_cb_t *cb, uint8_t *msg_id,
+                          uint32_t *value);
+static void *test_block_producer(void *arg);
+
+/*******************************************************************************
+ * @brief   Updates of a conflated ID collapse into its newest value, queued
+ *          at the position of the oldest pending update, while other IDs
+ *          stay FIFO. A later update queues again.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_conflate(void)
+{
+    struct recv_msg_cb_t cb;
+    uint32_t i, value;
+    uint8_t msg_id;
+
+    TEST_CHECK(recv_msg_cb_init(&cb, TEST_QUEUE_MAX) == 0);
+    TEST_CHECK(recv_msg_cb_init_conflate(&cb) == 0);
+    TEST_CHECK(recv_msg_cb_set_conflate(&cb, TEST_MSG_STATE, 1) == 0);
+
+    // Not conflated, must be queued normally
+    i = 0;
+    TEST_CHECK(recv_msg_cb_put_latest(&cb, TEST_MSG_DATA, 0, (uint8_t *)&i,
+                                      sizeof(i)) == 1);
+
+    for (i = 0; i < 10; i++)
+    {
+        TEST_CHECK(recv_msg_cb_put_latest(&cb, TEST_MSG_STATE, 0,
+                                          (uint8_t *)&i, sizeof(i)) == 0);
+
+        if (i % 5 == 0)
+            TEST_CHECK(test_queue_put(&cb, i) == 0);
+    }
+
+    TEST_CHECK(test_queue_get(&cb, &msg_id, &value) == 0);
+    TEST_CHECK(msg_id == TEST_MSG_STATE && value == 9);
+    TEST_CHECK(test_queue_get(&cb, &msg_id, &value) == 0);
+    TEST_CHECK(msg_id == TEST_MSG_DATA && value == 0);
+    TEST_CHECK(test_queue_get(&cb, &msg_id, &value) == 0);
+    TEST_CHECK(msg_id == TEST_MSG_DATA && value == 5);
+    TEST_CHECK(test_queue_get(&cb, &msg_id, &value) == -1);
+
+    i = 10;
+    TEST_CHECK(recv_msg_cb_put_latest(&cb, TEST_MSG_STATE, 0, (uint8_t *)&i,
+                                      sizeof(i)) == 0);
+    TEST_CHECK(test_queue_get(&cb, &msg_id, &value) == 0);
+    TEST_CHECK(msg_id == TEST_MSG_STATE && value == 10);
+    TEST_CHECK(test_queue_get(&cb, &msg_id, &value) == -1);
+
+    recv_msg_cb_close(&cb);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   DROP_OLDEST never evicts a conflated value, its token goes back
+ *          in as the newest message and the next oldest is dropped.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_conflate_drop_oldest(void)
+{
+    static const uint8_t ids[] = {TEST_MSG_DATA, TEST_MSG_STATE,
+                                  TEST_MSG_DATA, TEST_MSG_DATA};
+    static const uint32_t values[] = {2, 7, 3, 4};
+    struct recv_msg_cb_t cb;
+    uint32_t i, value;
+    uint8_t msg_id;
+
+    TEST_CHECK(recv_msg_cb_init(&cb, TEST_QUEUE_LEN) == 0);
+    TEST_CHECK(recv_msg_cb_set_overflow(&cb, RECV_MSG_OVERFLOW_DROP_OLDEST,
+                                        0) == 0);
+    TEST_CHECK(recv_msg_cb_init_conflate(&cb) == 0);
+    TEST_CHECK(recv_msg_cb_set_conflate(&cb, TEST_MSG_STATE, 1) == 0);
+
+    i = 7;
+    TEST_CHECK(recv_msg_cb_put_latest(&cb, TEST_MSG_STATE, 0, (uint8_t *)&i,
+                                      sizeof(i)) == 0);
+
+    for (i = 0; i < TEST_QUEUE_LEN + 1; i++)
+        TEST_CHECK(test_queue_put(&cb, i) == 0);
+
+    TEST_CHECK(atomic_load(&cb.drop_oldest) == 2);
+
+    for (i = 0; i < TEST_QUEUE_LEN; i++)
+    {
+        TEST_CHECK(test_queue_get(&cb, &msg_id, &value) == 0);
+        TEST_CHECK(msg_id == ids[i] && value == values[i]);
+    }
+
+    TEST_CHECK(test_queue_get(&cb, &msg_id, &value) == -1);
+
+    recv_msg_cb_close(&cb);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   A full queue refuses new messages and keeps the queued ones.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_overflow_drop_newest(void)
+{
+    struct recv_msg_cb_t cb;
+    uint32_t i, value;
+    uint8_t msg_id;
+
+    TEST_CHECK(recv_msg_cb_init(&cb, TEST_QUEUE_LEN) == 0);
+    TEST_CHECK(recv_msg_cb_set_overflow(&cb, RECV_MSG_OVERFLOW_DROP_NEWEST,
+                                        0) == 0);
+
+    for (i = 0; i < TEST_QUEUE_LEN + 2; i++)
+        TEST_CHECK(test_queue_put(&cb, i) == (i < TEST_QUEUE_LEN ? 0 : -1));
+
+    for (i = 0; i < TEST_QUEUE_LEN; i++)
+    {
+        TEST_CHECK(test_queue_get(&cb, &msg_id, &value) == 0);
+        TEST_CHECK(value == i);
+    }
+
+    TEST_CHECK(test_queue_get(&cb, &msg_id, &value) == -1);
+
+    recv_msg_cb_close(&cb);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   A full queue evicts its oldest messages for new ones.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_overflow_drop_oldest(void)
+{
+    struct recv_msg_cb_t cb;
+    uint32_t i, value;
+    uint8_t msg_id;
+
+    TEST_CHECK(recv_msg_cb_init(&cb, TEST_QUEUE_LEN) == 0);
+    TEST_CHECK(recv_msg_cb_set_overflow(&cb, RECV_MSG_OVERFLOW_DROP_OLDEST,
+                                        0) == 0);
+
+    for (i = 0; i < TEST_QUEUE_LEN + 2; i++)
+        TEST_CHECK(test_queue_put(&cb, i) == 0);
+
+    TEST_CHECK(atomic_load(&cb.drop_oldest) == 2);
+
+    for (i = 2; i < TEST_QUEUE_LEN + 2; i++)
+    {
+        TEST_CHECK(test_queue_get(&cb, &msg_id, &value) == 0);
+        TEST_CHECK(value == i);
+    }
+
+    TEST_CHECK(test_queue_get(&cb, &msg_id, &value) == -1);
+
+    recv_msg_cb_close(&cb);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   A producer on a full queue waits for the consumer and loses
+ *          nothing, and a parked producer is released by unblocking.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_overflow_block(void)
+{
+    struct test_block_t block;
+    struct recv_msg_cb_t cb;
+    pthread_t tid;
+    uint64_t deadline;
+    uint32_t i = 0, value;
+    uint8_t msg_id;
+
+    TEST_CHECK(recv_msg_cb_init(&cb, TEST_QUEUE_LEN) == 0);
+    TEST_CHECK(recv_msg_cb_set_overflow(&cb, RECV_MSG_OVERFLOW_BLOCK, 0) ==
+               0);
+
+    block.cb = &cb;
+    block.count = TEST_BLOCK_COUNT;
+    TEST_CHECK(pthread_create(&tid, NULL, test_block_producer, &block) == 0);
+
+    // Let the producer fill the queue and park before draining it
+    usleep(50000);
+    deadline = tcpipc_now_ns() + TEST_TIMEOUT_MS * 1000000ULL;
+
+    while (i < TEST_BLOCK_COUNT && tcpipc_now_ns() < deadline)
+    {
+        if (test_queue_get(&cb, &msg_id, &value))
+        {
+            usleep(1000);
+            continue;
+        }
+
+        if (value != i)
+            break;
+
+        i++;
+    }
+
+    pthread_join(tid, NULL);
+
+    TEST_CHECK(i == TEST_BLOCK_COUNT);
+    TEST_CHECK(block.ret == 0);
+    TEST_CHECK(atomic_load(&cb.block_waits) > 0);
+
+    // Fill the queue, then park a producer on it until unblocked
+    for (i = 0; i < TEST_QUEUE_LEN; i++)
+        TEST_CHECK(test_queue_put(&cb, i) == 0);
+
+    block.count = 1;
+    TEST_CHECK(pthread_create(&tid, NULL, test_block_producer, &block) == 0);
+
+    usleep(50000);
+    recv_msg_cb_unblock(&cb);
+    pthread_join(tid, NULL);
+
+    TEST_CHECK(block.ret == -1);
+
+    recv_msg_cb_close(&cb);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   A full queue doubles up to its limit, keeping the order, and then
+ *          refuses new messages. Rings outgrown while nothing was consumed
+ *          stay queued, so more than the limit may go in.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_overflow_grow(void)
+{
+    struct recv_msg_cb_t cb;
+    uint32_t i, count, value;
+    uint8_t msg_id;
+
+    TEST_CHECK(recv_msg_cb_init(&cb, TEST_QUEUE_LEN) == 0);
+    TEST_CHECK(recv_msg_cb_set_overflow(&cb, RECV_MSG_OVERFLOW_GROW,
+                                        TEST_QUEUE_MAX) == 0);
+
+    for (count = 0; count < 4 * TEST_QUEUE_MAX; count++)
+        if (test_queue_put(&cb, count))
+            break;
+
+    TEST_CHECK(count >= TEST_QUEUE_MAX && count < 4 * TEST_QUEUE_MAX);
+    TEST_CHECK(atomic_load(&cb.grows) == 2);
+    TEST_CHECK(cb.wr_capacity == TEST_QUEUE_MAX);
+
+    for (i = 0; i < count; i++)
+    {
+        TEST_CHECK(test_queue_get(&cb, &msg_id, &value) == 0);
+        TEST_CHECK(value == i);
+    }
+
+    TEST_CHECK(test_queue_get(&cb, &msg_id, &value) == -1);
+
+    recv_msg_cb_close(&cb);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Queues a data message carrying value inline.
+ *
+ * @return  0 on success, -1 if the queue refused it
+ *******************************************************************************/
+static int test_queue_put(struct recv_msg_cb_t *cb, uint32_t value)
+{
+    struct msg_packet_t msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_id = TEST_MSG_DATA;
+    msg.msg_storage = MSG_STORAGE_INLINE;
+    msg.msg_len = sizeof(value);
+    memcpy(msg.msg_inline, &value, sizeof(value));
+
+    return recv_msg_cb_enqueue(cb, &msg);
+}
+
+/*******************************************************************************
+ * @brief   Takes the oldest message and the value it carries.
+ *
+ * @return  0 on success, -1 if the queue is empty
+ *******************************************************************************/
+static int test_queue_get(struct recv_msg_cb_t *cb, uint8_t *msg_id,
+                          uint32_t *value)
+{
+    struct msg_packet_t msg;
+
+    if (recv_msg_cb_dequeue(cb, &msg))
+        return -1;
+
+    *msg_id = msg.msg_id;
+    *value = UINT32_MAX;
+
+    if (msg.msg_len == sizeof(*value) && msg.msg_data)
+        memcpy(value, msg.msg_data, sizeof(*value));
+
+    msg_packet_free(&msg);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Queues count values from 0 on, recording whether all went in.
+ *
+ * @return
+ *******************************************************************************/
+static void *test_block_producer(void *arg)
+{
+    struct test_block_t *block = (struct test_block_t *)arg;
+    uint32_t i;
+
+    block->ret = 0;
+
+    for (i = 0; i < block->count && block->ret == 0; i++)
+        block->ret = test_queue_put(block->cb, i);
+
+    return NULL;
+}
@@ -0,0 +1,200 @@
+/*******************************************************************************
+ * @file    tcpipc_test_resume.c
+ * @brief   Reconnect and resume tests: a TCP connection cut repeatedly under
+ *          a sender must still deliver every message exactly once and in
+ *          order, batched over two channels or not.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <sys/socket.h>
+
+#include "tcpipc_test.h"
+
+/** Defines  **/
+#define TEST_RESUME_COUNT (20000)
+#define TEST_RESUME_CUT (5000)
+#define TEST_RESUME_LEN (64)
+#define TEST_RESUME_LOG_SIZE (4 << 20)
+
+/** User Data Types **/
+struct test_resume_t
+{
+    int port;
+    int batch;
+    uint32_t received;
+    int failed;
+};
+
+/** Private Function Prototypes **/
+static void test_resume_opts(struct tcpipc_opts_t *opts, int batch);
+static void *test_resume_server(void *arg);
+static int test_resume_run(int batch);
+
+/*******************************************************************************
+ * @brief   Resume of an unbatched connection.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_resume(void)
+{
+    return test_resume_run(0);
+}
+
+/*******************************************************************************
+ * @brief   Resume of a batched connection with two channels.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_resume_batch(void)
+{
+    return test_resume_run(1);
+}
+
+/*******************************************************************************
+ * @brief   Options shared by both ends of a resume test. The log holds all
+ *          messages of the test, so the replay never runs out of frames, and
+ *          the receive queue blocks rather than drops.
+ *
+ * @return
+ *******************************************************************************/
+static void test_resume_opts(struct tcpipc_opts_t *opts, int batch)
+{
+    tcpipc_opts_default(opts);
+    opts->reconnect_ms = TEST_TIMEOUT_MS;
+    opts->resume_log_size = TEST_RESUME_LOG_SIZE;
+    opts->rx_overflow = RECV_MSG_OVERFLOW_BLOCK;
+    opts->tx_batch = batch;
+    opts->channels = batch ? 2 : 0;
+}
+
+/*******************************************************************************
+ * @brief   Receiving end. Every channel must see its values exactly once and
+ *          in order.
+ *
+ * @return
+ *******************************************************************************/
+static void *test_resume_server(void *arg)
+{
+    struct test_resume_t *resume = (struct test_resume_t *)arg;
+    uint32_t expect[2] = {0, 1}, step = resume->batch ? 2 : 1, value;
+    struct tcpipc_opts_t opts;
+    struct msg_packet_t msg;
+    struct tcpipc_ctx *ctx;
+
+    test_resume_opts(&opts, resume->batch);
+    ctx = tcpipc_init_opts(TCP_ROLE_SERVER, NULL, resume->port, &opts);
+
+    if (ctx == NULL)
+    {
+        resume->failed = 1;
+        return NULL;
+    }
+
+    if (!resume->batch)
+        expect[1] = UINT32_MAX;
+
+    while (resume->received < TEST_RESUME_COUNT)
+    {
+        if (tcpipc_recv_wait(ctx, &msg, TEST_TIMEOUT_MS))
+        {
+            printf("    Timed out after %u messages\n", resume->received);
+            resume->failed = 1;
+            break;
+        }
+
+        memcpy(&value, msg.msg_data, sizeof(value));
+
+        if (msg.msg_chan > 1 || value != expect[msg.msg_chan])
+        {
+            printf("    Channel %u got %u, expected %u\n", msg.msg_chan,
+                   value, msg.msg_chan > 1 ? 0 : expect[msg.msg_chan]);
+            resume->failed = 1;
+            tcpipc_msg_free(&msg);
+            break;
+        }
+
+        expect[msg.msg_chan] += step;
+        resume->received++;
+        tcpipc_msg_free(&msg);
+    }
+
+    tcpipc_close(ctx);
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * @brief   Sends TEST_RESUME_COUNT messages and cuts the connection under
+ *          them every TEST_RESUME_CUT messages. The batched run spreads them
+ *          over two channels, so the replay also covers frames still queued
+ *          on a channel when the link went down.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int test_resume_run(int batch)
+{
+    struct test_resume_t resume;
+    struct tcpipc_stats_t stats;
+    struct tcpipc_opts_t opts;
+    struct msg_packet_t msg;
+    struct tcpipc_ctx *ctx;
+    uint8_t buf[TEST_RESUME_LEN];
+    pthread_t tid;
+    uint32_t i;
+    int ret = 0, fd;
+
+    memset(&resume, 0, sizeof(resume));
+    resume.port = test_port(SOCK_STREAM);
+    resume.batch = batch;
+
+    TEST_CHECK(resume.port > 0);
+    TEST_CHECK(pthread_create(&tid, NULL, test_resume_server, &resume) == 0);
+
+    // Dialing retries until the server listens, as after a lost link
+    test_resume_opts(&opts, batch);
+    ctx = tcpipc_init_opts(TCP_ROLE_CLIENT, "127.0.0.1", resume.port, &opts);
+
+    if (ctx == NULL)
+    {
+        pthread_join(tid, NULL);
+        return -1;
+    }
+
+    memset(buf, 0, sizeof(buf));
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_id = TEST_MSG_DATA;
+    msg.msg_len = sizeof(buf);
+    msg.msg_data = buf;
+
+    for (i = 0; i < TEST_RESUME_COUNT && ret == 0; i++)
+    {
+        memcpy(buf, &i, sizeof(i));
+        ret = tcpipc_send_chan(ctx, batch ? i % 2 : 0, &msg);
+
+        if (i % 100 == 0)
+            tcpipc_flush(ctx);
+
+        // Pull the link from under the sender, the receive thread reconnects
+        if (i % TEST_RESUME_CUT == TEST_RESUME_CUT / 2)
+        {
+            fd = ctx->client_info.fd;
+
+            if (fd >= 0)
+                shutdown(fd, SHUT_RDWR);
+        }
+    }
+
+    tcpipc_flush(ctx);
+    pthread_join(tid, NULL);
+    tcpipc_get_stats(ctx, &stats);
+    tcpipc_close(ctx);
+
+    TEST_CHECK(ret == 0);
+    TEST_CHECK(!resume.failed);
+    TEST_CHECK(resume.received == TEST_RESUME_COUNT);
+    TEST_CHECK(stats.reconnects > 0);
+    TEST_CHECK(stats.resume_lost == 0);
+
+    return 0;
+}
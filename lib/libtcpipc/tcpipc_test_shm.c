@@ -0,0 +1,118 @@
+/*******************************************************************************
+ * @file    tcpipc_test_shm.c
+ * @brief   Shared-memory transport test: messages of every size up to a few
+ *          kilobytes wrap the ring many times and must arrive intact and in
+ *          order.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include "tcpipc_test.h"
+
+/** Defines  **/
+#define TEST_SHM_COUNT (20000)
+#define TEST_SHM_IDS (5)
+#define TEST_SHM_MAX_LEN (3000)
+
+/** User Data Types **/
+struct test_shm_sender_t
+{
+    struct tcpipc_ctx *ctx;
+    uint32_t fails;
+};
+
+/** Private Function Prototypes **/
+static uint32_t test_shm_len(uint32_t index);
+static void *test_shm_sender(void *arg);
+
+/*******************************************************************************
+ * @brief   One thread sends through the ring while the other end takes the
+ *          messages. Message i has ID 1 + i % TEST_SHM_IDS, starts with i
+ *          and the rest is filled with its low byte.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_shm(void)
+{
+    struct test_shm_sender_t sender;
+    struct tcpipc_ctx *server, *client;
+    struct tcpipc_opts_t opts;
+    struct msg_packet_t msg;
+    uint32_t got = 0, bad = 0, value;
+    pthread_t tid;
+
+    tcpipc_opts_default(&opts);
+    opts.transport = TCPIPC_TRANSPORT_SHM;
+    opts.len_size = TCPIPC_LEN_16;
+    opts.rx_overflow = RECV_MSG_OVERFLOW_BLOCK;
+
+    TEST_CHECK(test_pair(&opts, &server, &client) == 0);
+
+    sender.ctx = client;
+    sender.fails = 0;
+    TEST_CHECK(pthread_create(&tid, NULL, test_shm_sender, &sender) == 0);
+
+    while (got < TEST_SHM_COUNT &&
+           tcpipc_recv_wait(server, &msg, TEST_TIMEOUT_MS) == 0)
+    {
+        memcpy(&value, msg.msg_data, sizeof(value));
+
+        if (value != got || msg.msg_id != 1 + got % TEST_SHM_IDS ||
+            msg.msg_len != test_shm_len(got) ||
+            (msg.msg_len > sizeof(value) &&
+             msg.msg_data[msg.msg_len - 1] != (uint8_t)got))
+            bad++;
+
+        got++;
+        tcpipc_msg_free(&msg);
+    }
+
+    pthread_join(tid, NULL);
+    tcpipc_close(client);
+    tcpipc_close(server);
+
+    TEST_CHECK(sender.fails == 0);
+    TEST_CHECK(got == TEST_SHM_COUNT);
+    TEST_CHECK(bad == 0);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Payload length of the index-th message.
+ *
+ * @return  Length in bytes
+ *******************************************************************************/
+static uint32_t test_shm_len(uint32_t index)
+{
+    return sizeof(index) + index % TEST_SHM_MAX_LEN;
+}
+
+/*******************************************************************************
+ * @brief   Sends the TEST_SHM_COUNT messages, counting failures.
+ *
+ * @return
+ *******************************************************************************/
+static void *test_shm_sender(void *arg)
+{
+    struct test_shm_sender_t *sender = (struct test_shm_sender_t *)arg;
+    uint8_t buf[sizeof(uint32_t) + TEST_SHM_MAX_LEN];
+    struct msg_packet_t msg;
+    uint32_t i;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_data = buf;
+
+    for (i = 0; i < TEST_SHM_COUNT; i++)
+    {
+        msg.msg_id = 1 + i % TEST_SHM_IDS;
+        msg.msg_len = test_shm_len(i);
+        memset(buf, (uint8_t)i, msg.msg_len);
+        memcpy(buf, &i, sizeof(i));
+
+        if (tcpipc_send(sender->ctx, &msg))
+            sender->fails++;
+    }
+
+    return NULL;
+}
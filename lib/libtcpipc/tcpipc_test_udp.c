@@ -0,0 +1,286 @@
+/*******************************************************************************
+ * @file    tcpipc_test_udp.c
+ * @brief   Datagram transport tests: the reliable lane delivers datagrams
+ *          that arrive out of order, duplicated or ahead of the window in
+ *          sequence and once, and a sender stops at TCPIPC_UDP_WINDOW
+ *          unacknowledged messages until ACKs are read.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <sys/socket.h>
+
+#include "tcpipc_test.h"
+#include "tcpipc_udp.h"
+
+/** Defines  **/
+#define TEST_UDP_MAX (1024)
+#define TEST_UDP_COUNT (500)
+
+/** User Data Types **/
+struct test_udp_peer_t
+{
+    struct tcpipc_udp_t udp;
+    volatile int exit_status;
+    int port;
+    int ret;
+    pthread_t tid;
+    atomic_uint received;
+    uint32_t values[TEST_UDP_MAX];
+};
+
+/** Private Function Prototypes **/
+static int test_udp_pair(struct test_udp_peer_t *server,
+                         struct test_udp_peer_t *client);
+static void test_udp_close(struct test_udp_peer_t *server,
+                           struct test_udp_peer_t *client);
+static void *test_udp_server(void *arg);
+static void *test_udp_loop(void *arg);
+static void test_udp_frame(void *arg, uint8_t msg_id, const uint8_t *data,
+                           uint32_t len);
+static void test_udp_inject(struct test_udp_peer_t *peer, uint32_t seq);
+static uint32_t test_udp_wait(struct test_udp_peer_t *peer, uint32_t count);
+
+/*******************************************************************************
+ * @brief   Reliable datagrams written straight to the socket, out of order,
+ *          duplicated and one past the window, reach the application in
+ *          sequence and exactly once; the one past the window is dropped.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_udp_reorder(void)
+{
+    static const uint32_t seqs[] = {2, 1, 3, 3, 4 + TCPIPC_UDP_WINDOW, 0, 5,
+                                    4};
+    struct test_udp_peer_t *server, *client;
+    uint32_t i, got;
+
+    server = calloc(1, sizeof(*server));
+    client = calloc(1, sizeof(*client));
+    TEST_CHECK(server && client);
+    TEST_CHECK(test_udp_pair(server, client) == 0);
+
+    for (i = 0; i < sizeof(seqs) / sizeof(seqs[0]); i++)
+        test_udp_inject(client, seqs[i]);
+
+    test_udp_wait(server, 6);
+
+    // Anything past the six in sequence would be a late duplicate
+    usleep(50000);
+    got = atomic_load(&server->received);
+
+    test_udp_close(server, client);
+
+    TEST_CHECK(got == 6);
+
+    for (i = 0; i < got; i++)
+        TEST_CHECK(server->values[i] == i);
+
+    free(server);
+    free(client);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Without a receive loop the client never reads ACKs, so its window
+ *          fills after TCPIPC_UDP_WINDOW sends. Once the loop runs the
+ *          window opens and every message arrives in order.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int test_udp_window(void)
+{
+    struct test_udp_peer_t *server, *client;
+    uint64_t deadline;
+    uint32_t i, got;
+    int fails = 0;
+
+    server = calloc(1, sizeof(*server));
+    client = calloc(1, sizeof(*client));
+    TEST_CHECK(server && client);
+    TEST_CHECK(test_udp_pair(server, client) == 0);
+
+    for (i = 0; i < TCPIPC_UDP_WINDOW; i++)
+        if (tcpipc_udp_send(&client->udp, TEST_MSG_DATA, (uint8_t *)&i,
+                            sizeof(i), TCPIPC_MSG_CONTROL))
+            fails++;
+
+    TEST_CHECK(fails == 0);
+    TEST_CHECK(tcpipc_udp_window_full(&client->udp));
+    TEST_CHECK(test_udp_wait(server, TCPIPC_UDP_WINDOW) ==
+               TCPIPC_UDP_WINDOW);
+
+    TEST_CHECK(pthread_create(&client->tid, NULL, test_udp_loop, client) ==
+               0);
+    deadline = tcpipc_now_ns() + TEST_TIMEOUT_MS * 1000000ULL;
+
+    while (tcpipc_udp_window_full(&client->udp) && tcpipc_now_ns() < deadline)
+        usleep(1000);
+
+    TEST_CHECK(!tcpipc_udp_window_full(&client->udp));
+
+    for (; i < TEST_UDP_COUNT; i++)
+        if (tcpipc_udp_send(&client->udp, TEST_MSG_DATA, (uint8_t *)&i,
+                            sizeof(i), TCPIPC_MSG_CONTROL))
+            fails++;
+
+    got = test_udp_wait(server, TEST_UDP_COUNT);
+
+    test_udp_close(server, client);
+
+    TEST_CHECK(fails == 0);
+    TEST_CHECK(got == TEST_UDP_COUNT);
+
+    for (i = 0; i < got; i++)
+        TEST_CHECK(server->values[i] == i);
+
+    free(server);
+    free(client);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Pairs a client with a server on a free port. The server runs its
+ *          receive loop on its own thread, the client none yet.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int test_udp_pair(struct test_udp_peer_t *server,
+                         struct test_udp_peer_t *client)
+{
+    server->port = test_port(SOCK_DGRAM);
+
+    if (server->port < 0 ||
+        pthread_create(&server->tid, NULL, test_udp_server, server) != 0)
+        return -1;
+
+    // The client repeats its HELLO until the server is up
+    if (tcpipc_udp_setup(&client->udp, 0, "127.0.0.1", server->port,
+                         &client->exit_status))
+    {
+        server->exit_status = 1;
+        pthread_join(server->tid, NULL);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Stops both receive loops and closes the client, whose BYE ends the
+ *          server loop, then the server.
+ *
+ * @return
+ *******************************************************************************/
+static void test_udp_close(struct test_udp_peer_t *server,
+                           struct test_udp_peer_t *client)
+{
+    client->exit_status = 1;
+
+    if (client->tid)
+        pthread_join(client->tid, NULL);
+
+    tcpipc_udp_close(&client->udp);
+
+    server->exit_status = 1;
+    pthread_join(server->tid, NULL);
+
+    if (server->ret == 0)
+        tcpipc_udp_close(&server->udp);
+}
+
+/*******************************************************************************
+ * @brief   Server thread, waits for the client and runs the receive loop.
+ *
+ * @return
+ *******************************************************************************/
+static void *test_udp_server(void *arg)
+{
+    struct test_udp_peer_t *peer = (struct test_udp_peer_t *)arg;
+
+    peer->ret = tcpipc_udp_setup(&peer->udp, 1, NULL, peer->port,
+                                 &peer->exit_status);
+
+    if (peer->ret == 0)
+        tcpipc_udp_recv_loop(&peer->udp, &peer->exit_status, test_udp_frame,
+                             peer);
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * @brief   Client receive loop, reads the ACKs.
+ *
+ * @return
+ *******************************************************************************/
+static void *test_udp_loop(void *arg)
+{
+    struct test_udp_peer_t *peer = (struct test_udp_peer_t *)arg;
+
+    tcpipc_udp_recv_loop(&peer->udp, &peer->exit_status, test_udp_frame,
+                         peer);
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * @brief   Records the value every delivered message carries.
+ *
+ * @return
+ *******************************************************************************/
+static void test_udp_frame(void *arg, uint8_t msg_id, const uint8_t *data,
+                           uint32_t len)
+{
+    struct test_udp_peer_t *peer = (struct test_udp_peer_t *)arg;
+    uint32_t count = atomic_load(&peer->received), value = UINT32_MAX;
+
+    if (len == sizeof(value))
+        memcpy(&value, data, sizeof(value));
+
+    if (count < TEST_UDP_MAX)
+        peer->values[count] = value;
+
+    atomic_store(&peer->received, count + 1);
+}
+
+/*******************************************************************************
+ * @brief   Writes a reliable datagram with sequence number seq, carrying seq,
+ *          bypassing the sender's window.
+ *
+ * @return
+ *******************************************************************************/
+static void test_udp_inject(struct test_udp_peer_t *peer, uint32_t seq)
+{
+    uint8_t buf[TCPIPC_UDP_HDR_LEN + sizeof(seq)];
+
+    buf[0] = TCPIPC_UDP_PKT_RELIABLE;
+    buf[1] = TEST_MSG_DATA;
+    buf[2] = seq >> 24;
+    buf[3] = seq >> 16;
+    buf[4] = seq >> 8;
+    buf[5] = seq;
+    buf[6] = 0;
+    buf[7] = sizeof(seq);
+    memcpy(buf + TCPIPC_UDP_HDR_LEN, &seq, sizeof(seq));
+
+    send(peer->udp.fd, buf, sizeof(buf), 0);
+}
+
+/*******************************************************************************
+ * @brief   Waits until the peer received count messages or the timeout ran
+ *          out.
+ *
+ * @return  Messages received
+ *******************************************************************************/
+static uint32_t test_udp_wait(struct test_udp_peer_t *peer, uint32_t count)
+{
+    uint64_t deadline = tcpipc_now_ns() + TEST_TIMEOUT_MS * 1000000ULL;
+
+    while (atomic_load(&peer->received) < count &&
+           tcpipc_now_ns() < deadline)
+        usleep(1000);
+
+    return atomic_load(&peer->received);
+}
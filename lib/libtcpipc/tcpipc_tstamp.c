@@ -0,0 +1,246 @@
+/*******************************************************************************
+ * @file    tcpipc_tstamp.c
+ * @brief   Frame timestamping, see tcpipc_tstamp.h.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <errno.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+#include "tcpipc_tstamp.h"
+
+/** Private Function Prototypes **/
+static uint64_t tcpipc_tstamp_to_mono(const struct timespec *ts);
+static void tcpipc_tstamp_tx_account(struct tcpipc_tstamp_tx_t *tx,
+                                     uint32_t key, uint64_t ns);
+
+/*******************************************************************************
+ * @brief   Turns on software receive stamps for fd, and transmit stamps keyed
+ *          by byte offset when tx is set. Must be called before the first
+ *          byte is sent, the kernel counts keys from that point.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_tstamp_enable(int fd, int tx)
+{
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+
+    if (tx)
+        flags |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_OPT_ID |
+                 SOF_TIMESTAMPING_OPT_TSONLY;
+
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)))
+    {
+        perror("Failed to enable timestamping");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Extracts the software receive stamp from the control data of a
+ *          recvmsg() call. For a stream it belongs to the last segment the
+ *          read consumed.
+ *
+ * @return  Monotonic time stamp, 0 if the message carries none
+ *******************************************************************************/
+uint64_t tcpipc_tstamp_rx(struct msghdr *msg)
+{
+    struct scm_timestamping *tss;
+    struct cmsghdr *cmsg;
+
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET ||
+            cmsg->cmsg_type != SCM_TIMESTAMPING)
+            continue;
+
+        tss = (struct scm_timestamping *)CMSG_DATA(cmsg);
+
+        return tcpipc_tstamp_to_mono(&tss->ts[0]);
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Resets the transmit side for fd.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_tstamp_tx_init(struct tcpipc_tstamp_tx_t *tx, int fd)
+{
+    memset(tx, 0, sizeof(struct tcpipc_tstamp_tx_t));
+
+    tx->fd = fd;
+}
+
+/*******************************************************************************
+ * @brief   Records a write of bytes bytes whose oldest frame was queued at
+ *          queued_ns. The kernel reports a write under the key of its last
+ *          byte, counted modulo 2^32 from when stamping was enabled.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_tstamp_tx_sent(struct tcpipc_tstamp_tx_t *tx, size_t bytes,
+                           uint64_t queued_ns)
+{
+    if (bytes == 0)
+        return;
+
+    tx->bytes += (uint32_t)bytes;
+
+    if (tx->head - tx->tail == TCPIPC_TSTAMP_TX_PENDING)
+        tx->tail++;
+
+    tx->key[tx->head % TCPIPC_TSTAMP_TX_PENDING] = tx->bytes - 1;
+    tx->queued_ns[tx->head % TCPIPC_TSTAMP_TX_PENDING] = queued_ns;
+    tx->head++;
+}
+
+/*******************************************************************************
+ * @brief   Drains the error queue without blocking and accounts every
+ *          transmit stamp against the write it belongs to.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_tstamp_tx_reap(struct tcpipc_tstamp_tx_t *tx)
+{
+    uint8_t ctrl[TCPIPC_TSTAMP_CTRL_LEN];
+    struct sock_extended_err *serr;
+    struct scm_timestamping *tss;
+    struct cmsghdr *cmsg;
+    struct msghdr msg;
+    uint64_t ns;
+
+    while (tx->head != tx->tail)
+    {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+
+        if (recvmsg(tx->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            break;
+        }
+
+        ns = 0;
+        serr = NULL;
+
+        for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET &&
+                cmsg->cmsg_type == SCM_TIMESTAMPING)
+            {
+                tss = (struct scm_timestamping *)CMSG_DATA(cmsg);
+                ns = tcpipc_tstamp_to_mono(&tss->ts[0]);
+            }
+            else if ((cmsg->cmsg_level == SOL_IP &&
+                      cmsg->cmsg_type == IP_RECVERR) ||
+                     (cmsg->cmsg_level == SOL_IPV6 &&
+                      cmsg->cmsg_type == IPV6_RECVERR))
+            {
+                serr = (struct sock_extended_err *)CMSG_DATA(cmsg);
+            }
+        }
+
+        if (ns && serr && serr->ee_errno == ENOMSG &&
+            serr->ee_origin == SO_EE_ORIGIN_TIMESTAMPING)
+            tcpipc_tstamp_tx_account(tx, serr->ee_data, ns);
+    }
+}
+
+/*******************************************************************************
+ * @brief   Writes the send time ns in front of a payload.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_tstamp_put(uint8_t *buf, uint64_t ns)
+{
+    for (int i = TCPIPC_TSTAMP_LEN - 1; i >= 0; i--)
+    {
+        buf[i] = ns & 0xFF;
+        ns >>= 8;
+    }
+}
+
+/*******************************************************************************
+ * @brief   Reads the send time in front of a payload.
+ *
+ * @return  Send time
+ *******************************************************************************/
+uint64_t tcpipc_tstamp_get(const uint8_t *buf)
+{
+    uint64_t ns = 0;
+
+    for (int i = 0; i < TCPIPC_TSTAMP_LEN; i++)
+        ns = (ns << 8) | buf[i];
+
+    return ns;
+}
+
+/*******************************************************************************
+ * @brief   Moves a CLOCK_REALTIME kernel stamp onto the monotonic clock,
+ *          using the current distance between the two clocks.
+ *
+ * @return  Monotonic time stamp, 0 for an empty stamp
+ *******************************************************************************/
+static uint64_t tcpipc_tstamp_to_mono(const struct timespec *ts)
+{
+    struct timespec real, mono;
+    uint64_t ns;
+
+    if (ts->tv_sec == 0 && ts->tv_nsec == 0)
+        return 0;
+
+    clock_gettime(CLOCK_REALTIME, &real);
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+
+    ns = (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+
+    return ns - ((uint64_t)real.tv_sec * 1000000000ULL + real.tv_nsec) +
+           ((uint64_t)mono.tv_sec * 1000000000ULL + mono.tv_nsec);
+}
+
+/*******************************************************************************
+ * @brief   Retires every pending write up to key. Only the write ending at
+ *          key is accounted, earlier ones had their stamp lost.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_tstamp_tx_account(struct tcpipc_tstamp_tx_t *tx,
+                                     uint32_t key, uint64_t ns)
+{
+    uint32_t slot;
+    uint64_t delay;
+
+    while (tx->head != tx->tail)
+    {
+        slot = tx->tail % TCPIPC_TSTAMP_TX_PENDING;
+
+        // Keys wrap, the stamp belongs to a later write
+        if ((int32_t)(key - tx->key[slot]) < 0)
+            return;
+
+        tx->tail++;
+
+        if (tx->key[slot] != key)
+            continue;
+
+        delay = ns > tx->queued_ns[slot] ? ns - tx->queued_ns[slot] : 0;
+
+        tcpipc_stat_add(&tx->count, 1);
+        tcpipc_stat_add(&tx->total_ns, delay);
+        tcpipc_stat_max(&tx->max_ns, delay);
+
+        return;
+    }
+}
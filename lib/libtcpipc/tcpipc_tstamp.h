@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * @file    tcpipc_tstamp.h
+ * @brief   Frame timestamping. Every frame carries the time it was handed to
+ *          tcpipc_send() in front of its payload, and the socket reports
+ *          software SO_TIMESTAMPING stamps: the receive stamp comes with each
+ *          read, the transmit stamp later on the sender's error queue.
+ *          Kernel stamps use CLOCK_REALTIME and are converted to the
+ *          monotonic clock of tcpipc_now_ns() when read.
+ *
+ *          Stamped payload: | send time (8, big endian) | payload |
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_TSTAMP_H
+#define TCPIPC_TSTAMP_H
+
+/** Standard libraries **/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+
+/** Application specififc libraries **/
+#include "tcpipc_stats.h"
+
+/** Defines  **/
+#define TCPIPC_TSTAMP_LEN (8)
+#define TCPIPC_TSTAMP_TX_PENDING (64)
+#define TCPIPC_TSTAMP_CTRL_LEN (256)
+#define TCPIPC_TSTAMP_LOG_LEN (1024)
+
+/** User Data Types **/
+
+/*
+ * Transmit side of a stream socket. Every write is remembered with the byte
+ * key the kernel will report for it and the time its oldest frame was
+ * queued, so the stamp read back from the error queue gives the delay from
+ * tcpipc_send() to the kernel handing the data to the device. Owned by the
+ * sending thread; the delay counters follow the stats conventions.
+ */
+struct tcpipc_tstamp_tx_t
+{
+    int fd;
+    uint32_t bytes;
+    uint32_t key[TCPIPC_TSTAMP_TX_PENDING];
+    uint64_t queued_ns[TCPIPC_TSTAMP_TX_PENDING];
+    uint32_t head;
+    uint32_t tail;
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t total_ns;
+    atomic_uint_fast64_t max_ns;
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Turns on software receive stamps for fd, and transmit stamps keyed
+ *          by byte offset when tx is set. Must be called before the first
+ *          byte is sent.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_tstamp_enable(int fd, int tx);
+
+/*******************************************************************************
+ * @brief   Extracts the software receive stamp from the control data of a
+ *          recvmsg() call.
+ *
+ * @return  Monotonic time stamp, 0 if the message carries none
+ *******************************************************************************/
+uint64_t tcpipc_tstamp_rx(struct msghdr *msg);
+
+/*******************************************************************************
+ * @brief   Resets the transmit side for fd.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_tstamp_tx_init(struct tcpipc_tstamp_tx_t *tx, int fd);
+
+/*******************************************************************************
+ * @brief   Records a write of bytes bytes whose oldest frame was queued at
+ *          queued_ns. The oldest record is forgotten when too many are
+ *          pending.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_tstamp_tx_sent(struct tcpipc_tstamp_tx_t *tx, size_t bytes,
+                           uint64_t queued_ns);
+
+/*******************************************************************************
+ * @brief   Drains the error queue without blocking and accounts every
+ *          transmit stamp against the write it belongs to.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_tstamp_tx_reap(struct tcpipc_tstamp_tx_t *tx);
+
+/*******************************************************************************
+ * @brief   Writes the send time ns in front of a payload.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_tstamp_put(uint8_t *buf, uint64_t ns);
+
+/*******************************************************************************
+ * @brief   Reads the send time in front of a payload.
+ *
+ * @return  Send time
+ *******************************************************************************/
+uint64_t tcpipc_tstamp_get(const uint8_t *buf);
+
+#endif // TCPIPC_TSTAMP_H
@@ -0,0 +1,396 @@
+/*******************************************************************************
+ * @file    tcpipc_txq.c
+ * @brief   Coalescing transmit queue. Frames are gathered in a byte arena and
+ *          flushed with a single writev(), either explicitly or once a size or
+ *          age threshold is crossed.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <errno.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "tcpipc_txq.h"
+#include "tcpipc_uring.h"
+#include "tcpipc_tstamp.h"
+
+/** Private Function Prototypes **/
+static void tcpipc_txq_reset(struct tcpipc_txq_t *txq);
+static int tcpipc_txq_write(struct tcpipc_txq_t *txq, struct iovec *iov,
+                            int iovcnt);
+static int tcpipc_txq_send(struct tcpipc_txq_t *txq, struct iovec *iov,
+                           int iovcnt);
+static int tcpipc_txq_unspill(struct tcpipc_txq_t *txq);
+static int tcpipc_txq_keep(struct tcpipc_txq_t *txq, const struct iovec *iov,
+                           int iovcnt);
+
+/*******************************************************************************
+ * @brief   Initializes a queue writing to fd with an arena of size bytes.
+ *          The queue is flushed once it holds flush_bytes, or when its oldest
+ *          frame is older than flush_usec at the next push. Zero disables the
+ *          respective threshold.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_txq_init(struct tcpipc_txq_t *txq, int fd, size_t size,
+                    size_t flush_bytes, uint32_t flush_usec)
+{
+    memset(txq, 0, sizeof(struct tcpipc_txq_t));
+
+    txq->buf = (uint8_t *)malloc(size);
+
+    if (txq->buf == NULL)
+        return -1;
+
+    txq->fd = fd;
+    txq->size = size;
+    txq->flush_bytes = flush_bytes < size ? flush_bytes : size;
+    txq->flush_usec = flush_usec;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Frees the queue arena and the spill. Pending frames are discarded.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_txq_free(struct tcpipc_txq_t *txq)
+{
+    free(txq->buf);
+    txq->buf = NULL;
+    free(txq->spill);
+    txq->spill = NULL;
+    txq->spill_len = 0;
+    txq->spill_size = 0;
+    tcpipc_txq_reset(txq);
+}
+
+/*******************************************************************************
+ * @brief   Appends one frame. Payloads that do not fit the arena are not
+ *          copied, they are written together with the pending frames in the
+ *          same writev() call.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+int tcpipc_txq_push(struct tcpipc_txq_t *txq, const uint8_t *hdr,
+                    size_t hdr_len, const uint8_t *data, size_t len)
+{
+    struct iovec iov[3];
+    int ret;
+
+    if (txq->len + hdr_len + len > txq->size)
+    {
+        if (hdr_len + len > txq->size)
+        {
+            iov[0].iov_base = txq->buf;
+            iov[0].iov_len = txq->len;
+            iov[1].iov_base = (void *)hdr;
+            iov[1].iov_len = hdr_len;
+            iov[2].iov_base = (void *)data;
+            iov[2].iov_len = len;
+
+            ret = tcpipc_txq_write(txq, iov, 3);
+            tcpipc_txq_reset(txq);
+
+            return ret;
+        }
+
+        if (tcpipc_txq_flush(txq))
+            return -1;
+    }
+
+    if (txq->frames == 0)
+        txq->first_ns = tcpipc_now_ns();
+
+    memcpy(txq->buf + txq->len, hdr, hdr_len);
+    memcpy(txq->buf + txq->len + hdr_len, data, len);
+    txq->len += hdr_len + len;
+    txq->frames++;
+
+    if (txq->flush_bytes && txq->len >= txq->flush_bytes)
+        return tcpipc_txq_flush(txq);
+
+    if (txq->flush_usec &&
+        tcpipc_now_ns() - txq->first_ns >= txq->flush_usec * 1000ULL)
+        return tcpipc_txq_flush(txq);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Writes the spill and every pending frame.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+int tcpipc_txq_flush(struct tcpipc_txq_t *txq)
+{
+    struct iovec iov;
+    int ret;
+
+    if (txq->len == 0)
+        return txq->spill_len ? tcpipc_txq_unspill(txq) : 0;
+
+    iov.iov_base = txq->buf;
+    iov.iov_len = txq->len;
+
+    ret = tcpipc_txq_write(txq, &iov, 1);
+    tcpipc_txq_reset(txq);
+
+    return ret;
+}
+
+/*******************************************************************************
+ * @brief   Drops every pending frame and the spill without writing them.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_txq_discard(struct tcpipc_txq_t *txq)
+{
+    tcpipc_txq_reset(txq);
+    txq->spill_len = 0;
+}
+
+/*******************************************************************************
+ * @brief   Writes frames gathered elsewhere, after the pending ones, through
+ *          the same backend. queued_ns is when the oldest of them was queued.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+int tcpipc_txq_writev(struct tcpipc_txq_t *txq, struct iovec *iov, int iovcnt,
+                      uint64_t queued_ns)
+{
+    int ret;
+
+    if (tcpipc_txq_flush(txq))
+        return -1;
+
+    txq->first_ns = queued_ns;
+    ret = tcpipc_txq_write(txq, iov, iovcnt);
+    tcpipc_txq_reset(txq);
+
+    return ret;
+}
+
+/*******************************************************************************
+ * @brief   Waits until fd has room for more data. wait_cb, when set, is told
+ *          before and after.
+ *
+ * @return  0 once the write may be retried, -1 on failure
+ *******************************************************************************/
+int tcpipc_txq_wait(struct tcpipc_txq_t *txq)
+{
+    struct pollfd pfd;
+    int ret;
+
+    pfd.fd = txq->fd;
+    pfd.events = POLLOUT;
+
+    if (txq->wait_cb)
+        txq->wait_cb(txq->wait_arg, 1);
+
+    do
+        ret = poll(&pfd, 1, -1);
+    while (ret < 0 && errno == EINTR);
+
+    if (txq->wait_cb)
+        txq->wait_cb(txq->wait_arg, 0);
+
+    return ret < 0 ? -1 : 0;
+}
+
+/*******************************************************************************
+ * @brief   Empties the queue.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_txq_reset(struct tcpipc_txq_t *txq)
+{
+    txq->len = 0;
+    txq->frames = 0;
+    txq->first_ns = 0;
+}
+
+/*******************************************************************************
+ * @brief   Writes the iovecs after the spill, remembering the write for its
+ *          transmit stamp when timestamping is on. Stamps of earlier writes
+ *          are collected first, which costs one extra system call per write.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+static int tcpipc_txq_write(struct tcpipc_txq_t *txq, struct iovec *iov,
+                            int iovcnt)
+{
+    size_t bytes = 0;
+    int ret;
+
+    if (txq->tstamp)
+    {
+        // Counted up front, a partial write advances the iovecs
+        for (int i = 0; i < iovcnt; i++)
+            bytes += iov[i].iov_len;
+
+        tcpipc_tstamp_tx_reap(txq->tstamp);
+    }
+
+    // Left behind by a writer that could not wait, it goes out first
+    if (txq->spill_len && tcpipc_txq_unspill(txq))
+        ret = -1;
+    else if (txq->spill_len)
+        ret = tcpipc_txq_keep(txq, iov, iovcnt);
+    else
+        ret = tcpipc_txq_send(txq, iov, iovcnt);
+
+    if (ret == 0 && txq->tstamp)
+        tcpipc_tstamp_tx_sent(txq->tstamp, bytes,
+                              txq->first_ns ? txq->first_ns : tcpipc_now_ns());
+
+    return ret;
+}
+
+/*******************************************************************************
+ * @brief   Writes all iovecs through io_uring when attached, else sendmsg().
+ *          The socket is corked while retrying partial writes so the
+ *          remainder does not go out as small segments. When the socket is
+ *          full the writer waits, or with nowait the rest goes to the spill.
+ *          A peer that reset the connection fails the write instead of
+ *          raising SIGPIPE.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+static int tcpipc_txq_send(struct tcpipc_txq_t *txq, struct iovec *iov,
+                           int iovcnt)
+{
+    struct msghdr msg;
+    ssize_t ret;
+    int corked = 0, opt;
+
+    while (iovcnt > 0)
+    {
+        if (txq->uring)
+            ret = tcpipc_uring_sendv(txq->uring, txq->fd, iov, iovcnt,
+                                     &txq->syscalls);
+        else
+        {
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = iovcnt;
+
+            ret = sendmsg(txq->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+            tcpipc_stat_add(&txq->syscalls, 1);
+        }
+
+        if (ret < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN && txq->nowait)
+            {
+                if (tcpipc_txq_keep(txq, iov, iovcnt) == 0)
+                    iovcnt = 0;
+
+                break;
+            }
+
+            if (errno == EAGAIN && tcpipc_txq_wait(txq) == 0)
+                continue;
+
+            perror("Error while sending data");
+            break;
+        }
+
+        while (iovcnt > 0 && (size_t)ret >= iov->iov_len)
+        {
+            ret -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+
+        if (iovcnt == 0)
+            break;
+
+        iov->iov_base = (uint8_t *)iov->iov_base + ret;
+        iov->iov_len -= ret;
+
+        tcpipc_stat_add(&txq->partial_writes, 1);
+
+        if (!corked)
+        {
+            opt = 1;
+            setsockopt(txq->fd, IPPROTO_TCP, TCP_CORK, &opt, sizeof(opt));
+            corked = 1;
+        }
+    }
+
+    if (corked)
+    {
+        opt = 0;
+        setsockopt(txq->fd, IPPROTO_TCP, TCP_CORK, &opt, sizeof(opt));
+    }
+
+    return iovcnt == 0 ? 0 : -1;
+}
+
+/*******************************************************************************
+ * @brief   Writes the spill. With nowait what the socket does not take stays
+ *          in it.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+static int tcpipc_txq_unspill(struct tcpipc_txq_t *txq)
+{
+    struct iovec iov;
+
+    iov.iov_base = txq->spill;
+    iov.iov_len = txq->spill_len;
+
+    // What is left is moved back to the front of the same buffer
+    txq->spill_len = 0;
+
+    return tcpipc_txq_send(txq, &iov, 1);
+}
+
+/*******************************************************************************
+ * @brief   Appends the iovecs to the spill, growing it as needed.
+ *
+ * @return  0 on success, -1 if the spill can not grow
+ *******************************************************************************/
+static int tcpipc_txq_keep(struct tcpipc_txq_t *txq, const struct iovec *iov,
+                           int iovcnt)
+{
+    size_t need = txq->spill_len;
+    uint8_t *spill;
+
+    for (int i = 0; i < iovcnt; i++)
+        need += iov[i].iov_len;
+
+    if (need > txq->spill_size)
+    {
+        if (need < txq->spill_size * 2)
+            need = txq->spill_size * 2;
+
+        spill = (uint8_t *)realloc(txq->spill, need);
+
+        if (spill == NULL)
+        {
+            perror("Failed to grow transmit spill");
+            return -1;
+        }
+
+        txq->spill = spill;
+        txq->spill_size = need;
+    }
+
+    for (int i = 0; i < iovcnt; i++)
+    {
+        memmove(txq->spill + txq->spill_len, iov[i].iov_base,
+                iov[i].iov_len);
+        txq->spill_len += iov[i].iov_len;
+    }
+
+    return 0;
+}
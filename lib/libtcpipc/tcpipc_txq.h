@@ -0,0 +1,143 @@
+/*******************************************************************************
+ * @file    tcpipc_txq.h
+ * @brief   Coalescing transmit queue. Frames are gathered in a byte arena and
+ *          flushed with a single writev(), either explicitly or once a size or
+ *          age threshold is crossed.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_TXQ_H
+#define TCPIPC_TXQ_H
+
+/** Standard libraries **/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/uio.h>
+
+/** Application specififc libraries **/
+#include "tcpipc_stats.h"
+
+/** Defines  **/
+#define TCPIPC_TXQ_DEF_SIZE (4096)
+
+/** User Data Types **/
+struct tcpipc_uring_t;
+struct tcpipc_tstamp_tx_t;
+
+/*
+ * Called with waiting set before a writer waits for socket space and with it
+ * clear once the writer is done waiting, see tcpipc_txq_wait().
+ */
+typedef void (*tcpipc_txq_wait_cb_t)(void *arg, int waiting);
+
+/*
+ * uring, when set, carries the writes instead of sendmsg(), see
+ * tcpipc_uring_sendv(). tstamp, when set, remembers every write for its
+ * kernel transmit stamp, see tcpipc_tstamp_tx_sent().
+ *
+ * fd is non-blocking. A writer the socket has no room for waits in
+ * tcpipc_txq_wait(), unless nowait is set: the rest of the write is then
+ * kept in spill and every later write sends the spill first.
+ */
+struct tcpipc_txq_t
+{
+    int fd;
+    struct tcpipc_uring_t *uring;
+    struct tcpipc_tstamp_tx_t *tstamp;
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    uint32_t frames;
+    uint64_t first_ns;
+    size_t flush_bytes;
+    uint32_t flush_usec;
+    atomic_uint_fast64_t syscalls;
+    atomic_uint_fast64_t partial_writes;
+    tcpipc_txq_wait_cb_t wait_cb;
+    void *wait_arg;
+    int nowait;
+    uint8_t *spill;
+    size_t spill_len;
+    size_t spill_size;
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Initializes a queue writing to fd with an arena of size bytes.
+ *          The queue is flushed once it holds flush_bytes, or when its oldest
+ *          frame is older than flush_usec at the next push. Zero disables the
+ *          respective threshold.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_txq_init(struct tcpipc_txq_t *txq, int fd, size_t size,
+                    size_t flush_bytes, uint32_t flush_usec);
+
+/*******************************************************************************
+ * @brief   Frees the queue arena and the spill. Pending frames are discarded.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_txq_free(struct tcpipc_txq_t *txq);
+
+/*******************************************************************************
+ * @brief   Appends one frame. Payloads that do not fit the arena are not
+ *          copied, they are written together with the pending frames in the
+ *          same writev() call.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+int tcpipc_txq_push(struct tcpipc_txq_t *txq, const uint8_t *hdr,
+                    size_t hdr_len, const uint8_t *data, size_t len);
+
+/*******************************************************************************
+ * @brief   Writes the spill and every pending frame.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+int tcpipc_txq_flush(struct tcpipc_txq_t *txq);
+
+/*******************************************************************************
+ * @brief   Drops every pending frame and the spill without writing them.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_txq_discard(struct tcpipc_txq_t *txq);
+
+/*******************************************************************************
+ * @brief   Writes frames gathered elsewhere, after the pending ones, through
+ *          the same backend. queued_ns is when the oldest of them was queued.
+ *
+ * @return  0 on success, -1 on write error
+ *******************************************************************************/
+int tcpipc_txq_writev(struct tcpipc_txq_t *txq, struct iovec *iov, int iovcnt,
+                      uint64_t queued_ns);
+
+/*******************************************************************************
+ * @brief   Waits until fd has room for more data. wait_cb, when set, is told
+ *          before and after.
+ *
+ * @return  0 once the write may be retried, -1 on failure
+ *******************************************************************************/
+int tcpipc_txq_wait(struct tcpipc_txq_t *txq);
+
+/*******************************************************************************
+ * @brief   Monotonic clock in nanoseconds.
+ *
+ * @return
+ *******************************************************************************/
+static inline uint64_t tcpipc_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#endif // TCPIPC_TXQ_H
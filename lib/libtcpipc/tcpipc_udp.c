@@ -0,0 +1,555 @@
+/*******************************************************************************
+ * @file    tcpipc_udp.c
+ * @brief   Datagram transport for libtcpipc. State messages travel on an
+ *          unreliable lane where each msg_id keeps only the newest sequence
+ *          number, so a lost packet never stalls later updates. Control
+ *          messages travel on a go-back-N reliable lane that is delivered in
+ *          order; the receiver holds datagrams that arrive ahead of a gap,
+ *          up to the window, and hands them on once it is filled.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "tcpipc_udp.h"
+#include "tcpipc_txq.h"
+
+#define SEQ_AFTER(a, b) ((int32_t)((uint32_t)(a) - (uint32_t)(b)) > 0)
+
+/** Private Function Prototypes **/
+static size_t tcpipc_udp_build(uint8_t *buf, uint8_t type, uint8_t msg_id,
+                               uint32_t seq, const uint8_t *data,
+                               uint32_t len);
+static int tcpipc_udp_send_ctrl(struct tcpipc_udp_t *udp, uint8_t type,
+                                uint32_t seq);
+static void tcpipc_udp_retransmit(struct tcpipc_udp_t *udp);
+static int tcpipc_udp_wait_window(struct tcpipc_udp_t *udp);
+static void tcpipc_udp_accept(struct tcpipc_udp_t *udp, uint32_t seq,
+                              const uint8_t *dgram, size_t dgram_len,
+                              tcpipc_frame_cb_t frame_cb, void *arg);
+static int tcpipc_udp_wait_hello(struct tcpipc_udp_t *udp);
+
+/*******************************************************************************
+ * @brief   Creates the datagram socket and pairs with the peer. The server
+ *          waits for the client's HELLO, the client repeats it until the
+ *          server answers. Either gives up once *exit_status is set.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_udp_setup(struct tcpipc_udp_t *udp, int is_server, char *addr,
+                     int port, volatile int *exit_status)
+{
+    uint8_t buf[TCPIPC_UDP_MAX_DGRAM];
+    struct sockaddr_in local;
+    pthread_condattr_t attr;
+    struct pollfd pfd;
+    ssize_t len;
+    int opt = 1;
+
+    memset(udp, 0, sizeof(struct tcpipc_udp_t));
+    udp->exit_status = exit_status;
+    pthread_mutex_init(&udp->tx_lock, NULL);
+
+    // Window waits are timed against the clock tcpipc_now_ns() reads
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&udp->rel_open, &attr);
+    pthread_condattr_destroy(&attr);
+
+    udp->fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+    if (udp->fd < 0)
+    {
+        perror("UDP: Failed to create socket");
+        return -1;
+    }
+
+    if (is_server)
+    {
+        setsockopt(udp->fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = INADDR_ANY;
+        local.sin_port = htons(port);
+
+        if (bind(udp->fd, (struct sockaddr *)&local, sizeof(local)))
+        {
+            perror("UDP: Failed to bind");
+            goto err;
+        }
+
+        printf("UDP: Waiting for peer on port %d...\n", port);
+
+        if (tcpipc_udp_wait_hello(udp))
+            goto err;
+    }
+    else
+    {
+        memset(&udp->peer_addr, 0, sizeof(udp->peer_addr));
+        udp->peer_addr.sin_family = AF_INET;
+        udp->peer_addr.sin_addr.s_addr = inet_addr(addr);
+        udp->peer_addr.sin_port = htons(port);
+    }
+
+    // Connected datagram socket, send()/recv() only talk to the peer
+    if (connect(udp->fd, (struct sockaddr *)&udp->peer_addr,
+                sizeof(udp->peer_addr)))
+    {
+        perror("UDP: Failed to connect");
+        goto err;
+    }
+
+    if (is_server)
+    {
+        tcpipc_udp_send_ctrl(udp, TCPIPC_UDP_PKT_HELLO, 0);
+        printf("UDP: Connected\n");
+        return 0;
+    }
+
+    pfd.fd = udp->fd;
+    pfd.events = POLLIN;
+
+    for (int i = 0; i < TCPIPC_UDP_HELLO_TRIES && !*exit_status; i++)
+    {
+        tcpipc_udp_send_ctrl(udp, TCPIPC_UDP_PKT_HELLO, 0);
+
+        if (poll(&pfd, 1, TCPIPC_UDP_HELLO_USEC / 1000) <= 0)
+            continue;
+
+        len = recv(udp->fd, buf, sizeof(buf), 0);
+
+        if (len >= 1 && buf[0] == TCPIPC_UDP_PKT_HELLO)
+        {
+            printf("UDP: Connected\n");
+            return 0;
+        }
+
+        // Refused while the server is not up yet, the error ended the poll
+        // early, so wait out the interval before trying again
+        if (len < 0)
+            usleep(TCPIPC_UDP_HELLO_USEC);
+    }
+
+    printf("UDP: Peer did not answer\n");
+
+err:
+    close(udp->fd);
+    udp->fd = -1;
+    pthread_mutex_destroy(&udp->tx_lock);
+    pthread_cond_destroy(&udp->rel_open);
+    return -1;
+}
+
+/*******************************************************************************
+ * @brief   Tells the peer we are leaving and closes the socket.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_udp_close(struct tcpipc_udp_t *udp)
+{
+    if (udp->fd < 0)
+        return;
+
+    tcpipc_udp_send_ctrl(udp, TCPIPC_UDP_PKT_BYE, 0);
+    close(udp->fd);
+    udp->fd = -1;
+    pthread_mutex_destroy(&udp->tx_lock);
+    pthread_cond_destroy(&udp->rel_open);
+}
+
+/*******************************************************************************
+ * @brief   Sends one message on the lane selected by msg_class. While the
+ *          reliable window is full it waits for the peer's ACKs; the receive
+ *          thread, which reads them, fails instead.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_udp_send(struct tcpipc_udp_t *udp, uint8_t msg_id,
+                    const uint8_t *data, uint32_t len, uint8_t msg_class)
+{
+    uint8_t buf[TCPIPC_UDP_MAX_DGRAM];
+    struct tcpipc_udp_slot_t *slot;
+    size_t buf_len;
+
+    if (len > TCPIPC_UDP_MAX_PAYLOAD)
+    {
+        printf("UDP: Message too long: %u\n", len);
+        return -1;
+    }
+
+    if (msg_class == TCPIPC_MSG_STATE)
+    {
+        buf_len = tcpipc_udp_build(buf, TCPIPC_UDP_PKT_STATE, msg_id,
+                                   udp->state_seq++, data, len);
+
+        if (send(udp->fd, buf, buf_len, MSG_NOSIGNAL) != buf_len)
+            return -1;
+
+        return 0;
+    }
+
+    pthread_mutex_lock(&udp->tx_lock);
+
+    if (tcpipc_udp_wait_window(udp))
+    {
+        pthread_mutex_unlock(&udp->tx_lock);
+        return -1;
+    }
+
+    slot = &udp->rel_window[udp->rel_next % TCPIPC_UDP_WINDOW];
+    slot->len = tcpipc_udp_build(slot->buf, TCPIPC_UDP_PKT_RELIABLE, msg_id,
+                                 udp->rel_next, data, len);
+
+    if (udp->rel_next == udp->rel_acked)
+        udp->rel_sent_ns = tcpipc_now_ns();
+
+    udp->rel_next++;
+
+    // A lost datagram is recovered by the retransmit timer
+    send(udp->fd, slot->buf, slot->len, MSG_NOSIGNAL);
+
+    pthread_mutex_unlock(&udp->tx_lock);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Tells whether the reliable lane has TCPIPC_UDP_WINDOW messages
+ *          waiting for their ACK, so the next send would wait.
+ *
+ * @return  1 if full, else 0
+ *******************************************************************************/
+int tcpipc_udp_window_full(struct tcpipc_udp_t *udp)
+{
+    int full;
+
+    pthread_mutex_lock(&udp->tx_lock);
+    full = udp->rel_next - udp->rel_acked >= TCPIPC_UDP_WINDOW;
+    pthread_mutex_unlock(&udp->tx_lock);
+
+    return full;
+}
+
+/*******************************************************************************
+ * @brief   Receive loop, runs until *exit_status is set or the peer leaves.
+ *          Delivers every accepted message through frame_cb and drives the
+ *          reliable lane retransmissions.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_udp_recv_loop(struct tcpipc_udp_t *udp, volatile int *exit_status,
+                          tcpipc_frame_cb_t frame_cb, void *arg)
+{
+    uint8_t buf[TCPIPC_UDP_MAX_DGRAM];
+    struct pollfd pfd;
+    uint32_t seq, len;
+    ssize_t buf_len;
+    uint8_t msg_id;
+    int ret;
+
+    pfd.fd = udp->fd;
+    pfd.events = POLLIN;
+
+    // Senders tell from it that they must not wait for ACKs
+    pthread_mutex_lock(&udp->tx_lock);
+    udp->rx_tid = pthread_self();
+    udp->rx_running = 1;
+    pthread_mutex_unlock(&udp->tx_lock);
+
+    while (!*exit_status)
+    {
+        ret = poll(&pfd, 1, TCPIPC_UDP_RTO_USEC / 1000);
+
+        if (ret < 0 && errno != EINTR)
+        {
+            perror("UDP: Poll failed");
+            break;
+        }
+
+        if (ret > 0)
+        {
+            buf_len = recv(udp->fd, buf, sizeof(buf), 0);
+
+            if (buf_len < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                perror("UDP: Error while getting data");
+                break;
+            }
+
+            if (buf_len < TCPIPC_UDP_HDR_LEN)
+                continue;
+
+            msg_id = buf[1];
+            seq = ((uint32_t)buf[2] << 24) | ((uint32_t)buf[3] << 16) |
+                  ((uint32_t)buf[4] << 8) | buf[5];
+            len = ((uint32_t)buf[6] << 8) | buf[7];
+
+            if (TCPIPC_UDP_HDR_LEN + len > buf_len)
+                continue;
+
+            switch (buf[0])
+            {
+            case TCPIPC_UDP_PKT_HELLO:
+                // Our HELLO answer was lost, the client is still asking
+                tcpipc_udp_send_ctrl(udp, TCPIPC_UDP_PKT_HELLO, 0);
+                break;
+
+            case TCPIPC_UDP_PKT_BYE:
+                printf("Disconnected\n");
+                goto out;
+
+            case TCPIPC_UDP_PKT_STATE:
+                if (udp->state_seen[msg_id] &&
+                    !SEQ_AFTER(seq, udp->state_last[msg_id]))
+                {
+                    tcpipc_stat_add(&udp->stale_drops, 1);
+                    break;
+                }
+
+                udp->state_seen[msg_id] = 1;
+                udp->state_last[msg_id] = seq;
+                frame_cb(arg, msg_id, buf + TCPIPC_UDP_HDR_LEN, len);
+                break;
+
+            case TCPIPC_UDP_PKT_RELIABLE:
+                tcpipc_udp_accept(udp, seq, buf, TCPIPC_UDP_HDR_LEN + len,
+                                  frame_cb, arg);
+
+                // Cumulative ack, also repeats it for duplicates and gaps
+                tcpipc_udp_send_ctrl(udp, TCPIPC_UDP_PKT_ACK,
+                                     udp->rel_expected);
+                break;
+
+            case TCPIPC_UDP_PKT_ACK:
+                pthread_mutex_lock(&udp->tx_lock);
+
+                if (SEQ_AFTER(seq, udp->rel_acked) &&
+                    !SEQ_AFTER(seq, udp->rel_next))
+                {
+                    udp->rel_acked = seq;
+                    udp->rel_sent_ns = tcpipc_now_ns();
+                    pthread_cond_broadcast(&udp->rel_open);
+                }
+
+                pthread_mutex_unlock(&udp->tx_lock);
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        tcpipc_udp_retransmit(udp);
+    }
+
+out:
+    // Nothing opens the window any more, waiting senders give up
+    pthread_mutex_lock(&udp->tx_lock);
+    udp->rx_running = 0;
+    pthread_cond_broadcast(&udp->rel_open);
+    pthread_mutex_unlock(&udp->tx_lock);
+}
+
+/*******************************************************************************
+ * @brief   Writes a datagram header followed by the payload into buf.
+ *
+ * @return  Datagram length
+ *******************************************************************************/
+static size_t tcpipc_udp_build(uint8_t *buf, uint8_t type, uint8_t msg_id,
+                               uint32_t seq, const uint8_t *data,
+                               uint32_t len)
+{
+    buf[0] = type;
+    buf[1] = msg_id;
+    buf[2] = (seq >> 24) & 0xFF;
+    buf[3] = (seq >> 16) & 0xFF;
+    buf[4] = (seq >> 8) & 0xFF;
+    buf[5] = (seq >> 0) & 0xFF;
+    buf[6] = (len >> 8) & 0xFF;
+    buf[7] = (len >> 0) & 0xFF;
+
+    if (len)
+        memcpy(buf + TCPIPC_UDP_HDR_LEN, data, len);
+
+    return TCPIPC_UDP_HDR_LEN + len;
+}
+
+/*******************************************************************************
+ * @brief   Sends a payload-less protocol datagram.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int tcpipc_udp_send_ctrl(struct tcpipc_udp_t *udp, uint8_t type,
+                                uint32_t seq)
+{
+    uint8_t buf[TCPIPC_UDP_HDR_LEN];
+
+    tcpipc_udp_build(buf, type, 0, seq, NULL, 0);
+
+    if (send(udp->fd, buf, sizeof(buf), MSG_NOSIGNAL) != sizeof(buf))
+        return -1;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Go-back-N: resends every unacknowledged reliable datagram once the
+ *          oldest one has waited longer than the retransmit timeout.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_udp_retransmit(struct tcpipc_udp_t *udp)
+{
+    struct tcpipc_udp_slot_t *slot;
+    uint64_t now;
+
+    pthread_mutex_lock(&udp->tx_lock);
+
+    now = tcpipc_now_ns();
+
+    if (udp->rel_acked != udp->rel_next &&
+        now - udp->rel_sent_ns >= TCPIPC_UDP_RTO_USEC * 1000ULL)
+    {
+        for (uint32_t seq = udp->rel_acked; seq != udp->rel_next; seq++)
+        {
+            slot = &udp->rel_window[seq % TCPIPC_UDP_WINDOW];
+            send(udp->fd, slot->buf, slot->len, MSG_NOSIGNAL);
+        }
+
+        udp->rel_sent_ns = now;
+        tcpipc_stat_add(&udp->retransmits, 1);
+    }
+
+    pthread_mutex_unlock(&udp->tx_lock);
+}
+
+/*******************************************************************************
+ * @brief   Waits until the reliable window has room. Waking up every
+ *          retransmit timeout, it gives up once *exit_status is set or the
+ *          receive loop ended. The receive thread itself never waits, the
+ *          ACKs are for it to read. Caller holds tx_lock.
+ *
+ * @return  0 once there is room, -1 when giving up
+ *******************************************************************************/
+static int tcpipc_udp_wait_window(struct tcpipc_udp_t *udp)
+{
+    struct timespec ts;
+    uint64_t ns;
+    int self;
+
+    while (udp->rel_next - udp->rel_acked >= TCPIPC_UDP_WINDOW)
+    {
+        self = udp->rx_running && pthread_equal(udp->rx_tid, pthread_self());
+
+        if (self || *udp->exit_status)
+            return -1;
+
+        ns = tcpipc_now_ns() + TCPIPC_UDP_RTO_USEC * 1000ULL;
+        ts.tv_sec = ns / 1000000000ULL;
+        ts.tv_nsec = ns % 1000000000ULL;
+
+        pthread_cond_timedwait(&udp->rel_open, &udp->tx_lock, &ts);
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Takes one reliable datagram. The expected one is delivered along
+ *          with the held ones it completes, one ahead of a gap is held while
+ *          it is within the window. Duplicates are dropped.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_udp_accept(struct tcpipc_udp_t *udp, uint32_t seq,
+                              const uint8_t *dgram, size_t dgram_len,
+                              tcpipc_frame_cb_t frame_cb, void *arg)
+{
+    struct tcpipc_udp_slot_t *slot;
+
+    if (seq != udp->rel_expected)
+    {
+        slot = &udp->rel_held[seq % TCPIPC_UDP_WINDOW];
+
+        if (SEQ_AFTER(seq, udp->rel_expected) &&
+            seq - udp->rel_expected < TCPIPC_UDP_WINDOW && slot->len == 0)
+        {
+            memcpy(slot->buf, dgram, dgram_len);
+            slot->len = dgram_len;
+        }
+
+        return;
+    }
+
+    udp->rel_expected++;
+    frame_cb(arg, dgram[1], dgram + TCPIPC_UDP_HDR_LEN,
+             dgram_len - TCPIPC_UDP_HDR_LEN);
+
+    slot = &udp->rel_held[udp->rel_expected % TCPIPC_UDP_WINDOW];
+
+    while (slot->len)
+    {
+        udp->rel_expected++;
+        frame_cb(arg, slot->buf[1], slot->buf + TCPIPC_UDP_HDR_LEN,
+                 slot->len - TCPIPC_UDP_HDR_LEN);
+        slot->len = 0;
+        slot = &udp->rel_held[udp->rel_expected % TCPIPC_UDP_WINDOW];
+    }
+}
+
+/*******************************************************************************
+ * @brief   Server side of the pairing: waits for a client's HELLO and takes
+ *          its address as the peer. Polls in slices so *exit_status is
+ *          noticed.
+ *
+ * @return  0 on success, -1 on failure or once *exit_status is set
+ *******************************************************************************/
+static int tcpipc_udp_wait_hello(struct tcpipc_udp_t *udp)
+{
+    uint8_t buf[TCPIPC_UDP_MAX_DGRAM];
+    socklen_t addr_len;
+    struct pollfd pfd;
+    ssize_t len;
+    int ret;
+
+    pfd.fd = udp->fd;
+    pfd.events = POLLIN;
+
+    while (!*udp->exit_status)
+    {
+        ret = poll(&pfd, 1, TCPIPC_UDP_HELLO_USEC / 1000);
+
+        if (ret < 0 && errno != EINTR)
+        {
+            perror("UDP: Poll failed");
+            return -1;
+        }
+
+        if (ret <= 0)
+            continue;
+
+        addr_len = sizeof(udp->peer_addr);
+        len = recvfrom(udp->fd, buf, sizeof(buf), MSG_DONTWAIT,
+                       (struct sockaddr *)&udp->peer_addr, &addr_len);
+
+        if (len < 0 && errno != EINTR && errno != EAGAIN)
+        {
+            perror("UDP: Failed to receive HELLO");
+            return -1;
+        }
+
+        if (len >= 1 && buf[0] == TCPIPC_UDP_PKT_HELLO)
+            return 0;
+    }
+
+    return -1;
+}
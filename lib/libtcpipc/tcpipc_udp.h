@@ -0,0 +1,140 @@
+/*******************************************************************************
+ * @file    tcpipc_udp.h
+ * @brief   Datagram transport for libtcpipc. State messages travel on an
+ *          unreliable lane where each msg_id keeps only the newest sequence
+ *          number, so a lost packet never stalls later updates. Control
+ *          messages travel on a go-back-N reliable lane that is delivered in
+ *          order; the receiver holds datagrams that arrive ahead of a gap,
+ *          up to the window, and hands them on once it is filled.
+ *
+ *          Datagram layout: | type (1) | msg_id (1) | seq (4, big endian) |
+ *                           | msg_len (2, big endian) | payload (msg_len) |
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_UDP_H
+#define TCPIPC_UDP_H
+
+/** Standard libraries **/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+
+/** Application specififc libraries **/
+#include "tcpipc_decoder.h"
+#include "tcpipc_stats.h"
+
+/** Defines  **/
+#define TCPIPC_UDP_HDR_LEN (8)
+#define TCPIPC_UDP_MAX_DGRAM (1400)
+#define TCPIPC_UDP_MAX_PAYLOAD (TCPIPC_UDP_MAX_DGRAM - TCPIPC_UDP_HDR_LEN)
+#define TCPIPC_UDP_WINDOW (32)
+#define TCPIPC_UDP_RTO_USEC (50000)
+#define TCPIPC_UDP_HELLO_USEC (100000)
+#define TCPIPC_UDP_HELLO_TRIES (100)
+
+/** User Data Types **/
+enum tcpipc_msg_class_e
+{
+    TCPIPC_MSG_CONTROL = 0,
+    TCPIPC_MSG_STATE
+};
+
+enum tcpipc_udp_pkt_e
+{
+    TCPIPC_UDP_PKT_HELLO = 1,
+    TCPIPC_UDP_PKT_BYE,
+    TCPIPC_UDP_PKT_STATE,
+    TCPIPC_UDP_PKT_RELIABLE,
+    TCPIPC_UDP_PKT_ACK
+};
+
+/*
+ * One reliable datagram, header included. An empty slot has len zero.
+ */
+struct tcpipc_udp_slot_t
+{
+    uint8_t buf[TCPIPC_UDP_MAX_DGRAM];
+    size_t len;
+};
+
+/*
+ * Datagram endpoint. The reliable sender fields are guarded by tx_lock,
+ * rel_open is signalled when ACKs open the window. rel_held keeps the
+ * datagrams received ahead of rel_expected and belongs to the receive
+ * thread, rx_tid is that thread once the receive loop runs.
+ */
+struct tcpipc_udp_t
+{
+    int fd;
+    struct sockaddr_in peer_addr;
+    uint32_t state_seq;
+    uint32_t state_last[256];
+    uint8_t state_seen[256];
+    uint32_t rel_next;
+    uint32_t rel_acked;
+    uint64_t rel_sent_ns;
+    struct tcpipc_udp_slot_t rel_window[TCPIPC_UDP_WINDOW];
+    uint32_t rel_expected;
+    struct tcpipc_udp_slot_t rel_held[TCPIPC_UDP_WINDOW];
+    pthread_mutex_t tx_lock;
+    pthread_cond_t rel_open;
+    volatile int *exit_status;
+    pthread_t rx_tid;
+    int rx_running;
+    atomic_uint_fast64_t stale_drops;
+    atomic_uint_fast64_t retransmits;
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Creates the datagram socket and pairs with the peer. The server
+ *          waits for the client's HELLO, the client repeats it until the
+ *          server answers. Either gives up once *exit_status is set.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_udp_setup(struct tcpipc_udp_t *udp, int is_server, char *addr,
+                     int port, volatile int *exit_status);
+
+/*******************************************************************************
+ * @brief   Tells the peer we are leaving and closes the socket.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_udp_close(struct tcpipc_udp_t *udp);
+
+/*******************************************************************************
+ * @brief   Sends one message on the lane selected by msg_class. While the
+ *          reliable window is full it waits for the peer's ACKs; the receive
+ *          thread, which reads them, fails instead.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_udp_send(struct tcpipc_udp_t *udp, uint8_t msg_id,
+                    const uint8_t *data, uint32_t len, uint8_t msg_class);
+
+/*******************************************************************************
+ * @brief   Tells whether the reliable lane has TCPIPC_UDP_WINDOW messages
+ *          waiting for their ACK, so the next send would wait.
+ *
+ * @return  1 if full, else 0
+ *******************************************************************************/
+int tcpipc_udp_window_full(struct tcpipc_udp_t *udp);
+
+/*******************************************************************************
+ * @brief   Receive loop, runs until *exit_status is set or the peer leaves.
+ *          Delivers every accepted message through frame_cb and drives the
+ *          reliable lane retransmissions.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_udp_recv_loop(struct tcpipc_udp_t *udp, volatile int *exit_status,
+                          tcpipc_frame_cb_t frame_cb, void *arg);
+
+#endif // TCPIPC_UDP_H
@@ -0,0 +1,576 @@
+/*******************************************************************************
+ * @file    tcpipc_uring.c
+ * @brief   io_uring backend for stream connections, using the raw system
+ *          calls and the ring layout from <linux/io_uring.h>.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include "tcpipc_uring.h"
+#include "tcpipc_txq.h"
+
+/** Defines  **/
+#define URING_UNKNOWN (0)
+#define URING_YES (1)
+#define URING_NO (2)
+
+/** Private Function Prototypes **/
+static int tcpipc_uring_enter(struct tcpipc_uring_t *ring,
+                              unsigned int min_complete);
+static struct io_uring_sqe *tcpipc_uring_get_sqe(struct tcpipc_uring_t *ring);
+static void tcpipc_uring_unget_sqes(struct tcpipc_uring_t *ring);
+static int tcpipc_uring_init_bufs(struct tcpipc_uring_t *ring, uint16_t count,
+                                  uint32_t size);
+static void tcpipc_uring_put_buf(struct tcpipc_uring_t *ring, uint16_t bid);
+static int tcpipc_uring_arm_recv(struct tcpipc_uring_t *ring, int fd);
+static ssize_t tcpipc_uring_sendmsg(int fd, struct msghdr *msg,
+                                    atomic_uint_fast64_t *syscalls);
+
+/** Global Variables **/
+static atomic_int uring_state = URING_UNKNOWN;
+
+/*******************************************************************************
+ * @brief   Checks once per process whether the kernel offers io_uring with
+ *          the operations this backend needs.
+ *
+ * @return  1 if available, 0 otherwise
+ *******************************************************************************/
+int tcpipc_uring_available()
+{
+    struct
+    {
+        struct io_uring_probe probe;
+        struct io_uring_probe_op ops[256];
+    } probe;
+    struct io_uring_params params;
+    int state = atomic_load(&uring_state);
+    int fd;
+
+    if (state != URING_UNKNOWN)
+        return state == URING_YES;
+
+    state = URING_NO;
+    memset(&params, 0, sizeof(params));
+    memset(&probe, 0, sizeof(probe));
+
+    // Fails with ENOSYS on old kernels and EPERM when disabled by sysctl
+    fd = syscall(__NR_io_uring_setup, 2, &params);
+
+    if (fd >= 0)
+    {
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, &probe,
+                    256) == 0 &&
+            probe.probe.last_op >= IORING_OP_RECV &&
+            (probe.ops[IORING_OP_SENDMSG].flags & IO_URING_OP_SUPPORTED) &&
+            (probe.ops[IORING_OP_RECV].flags & IO_URING_OP_SUPPORTED))
+            state = URING_YES;
+
+        close(fd);
+    }
+
+    atomic_store(&uring_state, state);
+
+    return state == URING_YES;
+}
+
+/*******************************************************************************
+ * @brief   Creates a ring with room for entries submissions. single_issuer
+ *          asks for the cheaper single-thread mode where the kernel has it;
+ *          the ring must then only be used by the calling thread.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_uring_init(struct tcpipc_uring_t *ring, unsigned int entries,
+                      int single_issuer)
+{
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof(struct tcpipc_uring_t));
+    memset(&params, 0, sizeof(params));
+
+    if (single_issuer)
+        params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+
+    ring->ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+
+    // Both flags are 6.1+, older kernels reject them
+    if (ring->ring_fd < 0 && single_issuer)
+    {
+        memset(&params, 0, sizeof(params));
+        ring->ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+    }
+
+    if (ring->ring_fd < 0)
+        return -1;
+
+    ring->sq_map_len = params.sq_off.array +
+                       params.sq_entries * sizeof(unsigned int);
+    ring->cq_map_len = params.cq_off.cqes +
+                       params.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cq_map_len > ring->sq_map_len)
+            ring->sq_map_len = ring->cq_map_len;
+
+        ring->cq_map_len = 0;
+    }
+
+    ring->sq_map = mmap(NULL, ring->sq_map_len, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->ring_fd,
+                        IORING_OFF_SQ_RING);
+
+    if (ring->sq_map == MAP_FAILED)
+    {
+        ring->sq_map = NULL;
+        tcpipc_uring_free(ring);
+        return -1;
+    }
+
+    ring->cq_map = ring->sq_map;
+
+    if (ring->cq_map_len)
+    {
+        ring->cq_map = mmap(NULL, ring->cq_map_len, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ring->ring_fd,
+                            IORING_OFF_CQ_RING);
+
+        if (ring->cq_map == MAP_FAILED)
+        {
+            ring->cq_map = NULL;
+            tcpipc_uring_free(ring);
+            return -1;
+        }
+    }
+
+    ring->sqes_map_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_map_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->ring_fd,
+                      IORING_OFF_SQES);
+
+    if (ring->sqes == MAP_FAILED)
+    {
+        ring->sqes = NULL;
+        tcpipc_uring_free(ring);
+        return -1;
+    }
+
+    ring->sq_head = (atomic_uint *)((uint8_t *)ring->sq_map +
+                                    params.sq_off.head);
+    ring->sq_tail = (atomic_uint *)((uint8_t *)ring->sq_map +
+                                    params.sq_off.tail);
+    ring->sq_mask = (unsigned int *)((uint8_t *)ring->sq_map +
+                                     params.sq_off.ring_mask);
+    ring->sq_array = (unsigned int *)((uint8_t *)ring->sq_map +
+                                      params.sq_off.array);
+    ring->cq_head = (atomic_uint *)((uint8_t *)ring->cq_map +
+                                    params.cq_off.head);
+    ring->cq_tail = (atomic_uint *)((uint8_t *)ring->cq_map +
+                                    params.cq_off.tail);
+    ring->cq_mask = (unsigned int *)((uint8_t *)ring->cq_map +
+                                     params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((uint8_t *)ring->cq_map +
+                                         params.cq_off.cqes);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Unmaps and closes the ring, including its buffer ring.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_uring_free(struct tcpipc_uring_t *ring)
+{
+    // Closing first drops the kernel's hold on the buffer ring
+    if (ring->ring_fd >= 0)
+        close(ring->ring_fd);
+
+    if (ring->buf_ring)
+        munmap(ring->buf_ring, ring->buf_ring_len);
+
+    free(ring->bufs);
+
+    if (ring->sqes)
+        munmap(ring->sqes, ring->sqes_map_len);
+
+    if (ring->cq_map && ring->cq_map != ring->sq_map)
+        munmap(ring->cq_map, ring->cq_map_len);
+
+    if (ring->sq_map)
+        munmap(ring->sq_map, ring->sq_map_len);
+
+    memset(ring, 0, sizeof(struct tcpipc_uring_t));
+    ring->ring_fd = -1;
+}
+
+/*******************************************************************************
+ * @brief   Receives from a stream socket until EOF, an error or until
+ *          *exit_status is set, passing every complete frame to frame_cb.
+ *          Each io_uring_enter() is added to syscalls and reads that end
+ *          inside a frame to partial_reads.
+ *
+ * @return  0 when the connection ended, -1 if io_uring could not be used
+ *          before any data arrived and the caller should fall back to read()
+ *******************************************************************************/
+int tcpipc_uring_recv_loop(int fd, volatile int *exit_status,
+                           struct tcpipc_decoder_t *dec,
+                           tcpipc_frame_cb_t frame_cb, void *arg,
+                           atomic_uint_fast64_t *syscalls,
+                           atomic_uint_fast64_t *partial_reads)
+{
+    struct tcpipc_uring_t ring;
+    struct io_uring_cqe *cqe;
+    unsigned int head, tail;
+    int armed = 0, received = 0, done = 0, fallback = 0, oversize;
+    uint16_t bid;
+
+    if (!tcpipc_uring_available())
+        return -1;
+
+    // Created here so the single issuer is the receive thread itself
+    if (tcpipc_uring_init(&ring, TCPIPC_URING_ENTRIES, 1))
+        return -1;
+
+    if (tcpipc_uring_init_bufs(&ring, TCPIPC_URING_RX_BUFS,
+                               TCPIPC_URING_RX_BUF_SIZE))
+    {
+        tcpipc_uring_free(&ring);
+        return -1;
+    }
+
+    while (!done && !*exit_status)
+    {
+        if (!armed)
+        {
+            if (tcpipc_uring_arm_recv(&ring, fd))
+                break;
+
+            armed = 1;
+        }
+
+        if (tcpipc_uring_enter(&ring, 1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            fallback = !received;
+            break;
+        }
+
+        tcpipc_stat_add(syscalls, 1);
+
+        head = atomic_load_explicit(ring.cq_head, memory_order_relaxed);
+        tail = atomic_load_explicit(ring.cq_tail, memory_order_acquire);
+
+        for (; head != tail && !done; head++)
+        {
+            cqe = &ring.cqes[head & *ring.cq_mask];
+
+            if (!(cqe->flags & IORING_CQE_F_MORE))
+                armed = 0;
+
+            if (cqe->res > 0 && (cqe->flags & IORING_CQE_F_BUFFER))
+            {
+                bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+                received = 1;
+
+                oversize = tcpipc_decoder_feed(dec,
+                                               ring.bufs +
+                                                   bid * ring.rx_buf_size,
+                                               cqe->res) != 0;
+                tcpipc_uring_put_buf(&ring, bid);
+
+                // Frames ahead of an oversize one are still delivered
+                if (tcpipc_decoder_parse(dec, frame_cb, arg) < 0 || oversize)
+                {
+                    printf("Received message exceeds maximum length\n");
+                    done = 1;
+                }
+
+                // The read ended inside a frame, the rest comes with the next
+                if (dec->wr != dec->rd)
+                    tcpipc_stat_add(partial_reads, 1);
+            }
+            else if (cqe->res == 0)
+            {
+                printf("Disconnected\n");
+                done = 1;
+            }
+            else if (cqe->res == -ENOBUFS)
+            {
+                // Every buffer was in flight, rearmed below
+            }
+            else if (!received &&
+                     (cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP))
+            {
+                // Multishot recv needs 6.0+
+                fallback = 1;
+                done = 1;
+            }
+            else if (cqe->res < 0)
+            {
+                errno = -cqe->res;
+                perror("Error while getting data");
+                done = 1;
+            }
+        }
+
+        atomic_store_explicit(ring.cq_head, head, memory_order_release);
+        atomic_store_explicit((_Atomic uint16_t *)&ring.buf_ring->tail,
+                              ring.buf_tail, memory_order_release);
+    }
+
+    tcpipc_uring_free(&ring);
+
+    return fallback ? -1 : 0;
+}
+
+/*******************************************************************************
+ * @brief   Sends the iovecs with one sendmsg that does not wait for socket
+ *          space, like sendmsg() with MSG_DONTWAIT. When the ring can not
+ *          carry it the send is made with sendmsg() directly.
+ *
+ * @return  Number of bytes sent, -1 on failure with errno set
+ *******************************************************************************/
+ssize_t tcpipc_uring_sendv(struct tcpipc_uring_t *ring, int fd,
+                           struct iovec *iov, int iovcnt,
+                           atomic_uint_fast64_t *syscalls)
+{
+    struct msghdr *msg = &ring->tx_msg;
+    struct io_uring_sqe *sqe;
+    struct io_uring_cqe *cqe;
+    unsigned int head, tail;
+    int res = -ECANCELED, reaped = 0;
+
+    // One sendmsg rather than a send per iovec, separate sends would leave
+    // the payload behind the header in Nagle's queue. The header lives in
+    // the ring, an entry the kernel took must never point at a dead frame.
+    memset(msg, 0, sizeof(struct msghdr));
+    msg->msg_iov = iov;
+    msg->msg_iovlen = iovcnt;
+
+    // Every call reaps what it submits, so the ring is empty here
+    sqe = tcpipc_uring_get_sqe(ring);
+
+    if (sqe == NULL)
+        return tcpipc_uring_sendmsg(fd, msg, syscalls);
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)msg;
+    sqe->len = 1;
+
+    // A full socket completes the entry with -EAGAIN instead of parking it
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+
+    while (!reaped)
+    {
+        if (tcpipc_uring_enter(ring, 1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            // Never submitted, withdraw it so nothing is sent twice
+            if (ring->sq_pending)
+            {
+                tcpipc_uring_unget_sqes(ring);
+                return tcpipc_uring_sendmsg(fd, msg, syscalls);
+            }
+
+            return -1;
+        }
+
+        tcpipc_stat_add(syscalls, 1);
+
+        head = atomic_load_explicit(ring->cq_head, memory_order_relaxed);
+        tail = atomic_load_explicit(ring->cq_tail, memory_order_acquire);
+
+        for (; head != tail; head++)
+        {
+            cqe = &ring->cqes[head & *ring->cq_mask];
+            res = cqe->res;
+            reaped = 1;
+        }
+
+        atomic_store_explicit(ring->cq_head, head, memory_order_release);
+    }
+
+    if (res < 0)
+    {
+        errno = -res;
+        return -1;
+    }
+
+    return res;
+}
+
+/*******************************************************************************
+ * @brief   Submits every queued entry and waits for min_complete completions.
+ *
+ * @return  Number of entries submitted, -1 on failure with errno set
+ *******************************************************************************/
+static int tcpipc_uring_enter(struct tcpipc_uring_t *ring,
+                              unsigned int min_complete)
+{
+    int ret;
+
+    ret = syscall(__NR_io_uring_enter, ring->ring_fd, ring->sq_pending,
+                  min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0,
+                  NULL, 0);
+
+    if (ret > 0)
+        ring->sq_pending -= ret;
+
+    return ret;
+}
+
+/*******************************************************************************
+ * @brief   Takes the next free submission entry and queues it. The entry is
+ *          cleared, the caller fills it before the next io_uring_enter().
+ *
+ * @return  Entry pointer, NULL if the submission ring is full
+ *******************************************************************************/
+static struct io_uring_sqe *tcpipc_uring_get_sqe(struct tcpipc_uring_t *ring)
+{
+    unsigned int head = atomic_load_explicit(ring->sq_head,
+                                             memory_order_acquire);
+    unsigned int tail = atomic_load_explicit(ring->sq_tail,
+                                             memory_order_relaxed);
+    unsigned int idx;
+
+    if (tail - head > *ring->sq_mask)
+        return NULL;
+
+    idx = tail & *ring->sq_mask;
+    memset(&ring->sqes[idx], 0, sizeof(struct io_uring_sqe));
+    ring->sq_array[idx] = idx;
+
+    // The kernel only reads the entry during io_uring_enter()
+    atomic_store_explicit(ring->sq_tail, tail + 1, memory_order_release);
+    ring->sq_pending++;
+
+    return &ring->sqes[idx];
+}
+
+/*******************************************************************************
+ * @brief   Withdraws the queued entries the kernel has not taken yet, after a
+ *          failed io_uring_enter().
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_uring_unget_sqes(struct tcpipc_uring_t *ring)
+{
+    unsigned int tail = atomic_load_explicit(ring->sq_tail,
+                                             memory_order_relaxed);
+
+    atomic_store_explicit(ring->sq_tail, tail - ring->sq_pending,
+                          memory_order_release);
+    ring->sq_pending = 0;
+}
+
+/*******************************************************************************
+ * @brief   Registers count receive buffers of size bytes as buffer group
+ *          TCPIPC_URING_BGID. count must be a power of two.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+static int tcpipc_uring_init_bufs(struct tcpipc_uring_t *ring, uint16_t count,
+                                  uint32_t size)
+{
+    struct io_uring_buf_reg reg;
+
+    ring->buf_ring_len = count * sizeof(struct io_uring_buf);
+    ring->buf_ring = mmap(NULL, ring->buf_ring_len, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (ring->buf_ring == MAP_FAILED)
+    {
+        ring->buf_ring = NULL;
+        return -1;
+    }
+
+    ring->bufs = (uint8_t *)malloc((size_t)count * size);
+
+    if (ring->bufs == NULL)
+        return -1;
+
+    ring->rx_buf_count = count;
+    ring->rx_buf_size = size;
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring->buf_ring;
+    reg.ring_entries = count;
+    reg.bgid = TCPIPC_URING_BGID;
+
+    // Provided buffer rings need 5.19+
+    if (syscall(__NR_io_uring_register, ring->ring_fd,
+                IORING_REGISTER_PBUF_RING, &reg, 1))
+        return -1;
+
+    for (uint16_t i = 0; i < count; i++)
+        tcpipc_uring_put_buf(ring, i);
+
+    atomic_store_explicit((_Atomic uint16_t *)&ring->buf_ring->tail,
+                          ring->buf_tail, memory_order_release);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   Hands a receive buffer back to the kernel. It becomes visible with
+ *          the next store of buf_ring->tail.
+ *
+ * @return
+ *******************************************************************************/
+static void tcpipc_uring_put_buf(struct tcpipc_uring_t *ring, uint16_t bid)
+{
+    struct io_uring_buf *buf;
+
+    buf = &ring->buf_ring->bufs[ring->buf_tail & (ring->rx_buf_count - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(ring->bufs + bid * ring->rx_buf_size);
+    buf->len = ring->rx_buf_size;
+    buf->bid = bid;
+    ring->buf_tail++;
+}
+
+/*******************************************************************************
+ * @brief   Queues a multishot recv that picks its buffers from the group.
+ *
+ * @return  0 on success, -1 if the submission ring is full
+ *******************************************************************************/
+static int tcpipc_uring_arm_recv(struct tcpipc_uring_t *ring, int fd)
+{
+    struct io_uring_sqe *sqe = tcpipc_uring_get_sqe(ring);
+
+    if (sqe == NULL)
+        return -1;
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = TCPIPC_URING_BGID;
+
+    return 0;
+}
+
+/*******************************************************************************
+ * @brief   sendmsg() that does not wait for socket space, for sends the ring
+ *          can not carry.
+ *
+ * @return  Number of bytes sent, -1 on failure with errno set
+ *******************************************************************************/
+static ssize_t tcpipc_uring_sendmsg(int fd, struct msghdr *msg,
+                                    atomic_uint_fast64_t *syscalls)
+{
+    tcpipc_stat_add(syscalls, 1);
+
+    return sendmsg(fd, msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+}
@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * @file    tcpipc_uring.h
+ * @brief   Optional io_uring backend for stream connections. The receive side
+ *          keeps one multishot recv armed over a ring of provided buffers, so
+ *          a single io_uring_enter() can return many reads. The send side
+ *          submits a flush as one sendmsg and reaps it in the same call.
+ *          Talks to the kernel directly, liburing is not needed.
+ *
+ * @author  Ajay Kandagal <ajka9053@colorado.edu>
+ * @date    Oct 17th 2026
+ *******************************************************************************/
+#ifndef TCPIPC_URING_H
+#define TCPIPC_URING_H
+
+/** Standard libraries **/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <linux/io_uring.h>
+
+/** Application specififc libraries **/
+#include "tcpipc_decoder.h"
+#include "tcpipc_stats.h"
+
+/** Defines  **/
+#define TCPIPC_URING_ENTRIES (64)
+#define TCPIPC_URING_RX_BUFS (64)
+#define TCPIPC_URING_RX_BUF_SIZE (4096)
+#define TCPIPC_URING_BGID (0)
+
+/** User Data Types **/
+
+/*
+ * One submission/completion ring pair mapped from the kernel. The buffer ring
+ * is only set up on the receive side; bufs holds rx_buf_count buffers of
+ * rx_buf_size bytes, handed to the kernel through buf_ring. tx_msg is the
+ * message header of the send in flight.
+ */
+struct tcpipc_uring_t
+{
+    int ring_fd;
+    void *sq_map;
+    size_t sq_map_len;
+    void *cq_map;
+    size_t cq_map_len;
+    struct io_uring_sqe *sqes;
+    size_t sqes_map_len;
+    atomic_uint *sq_head;
+    atomic_uint *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    atomic_uint *cq_head;
+    atomic_uint *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned int sq_pending;
+    struct msghdr tx_msg;
+    struct io_uring_buf_ring *buf_ring;
+    size_t buf_ring_len;
+    uint8_t *bufs;
+    uint16_t buf_tail;
+    uint16_t rx_buf_count;
+    uint32_t rx_buf_size;
+};
+
+/** Public Functions **/
+
+/*******************************************************************************
+ * @brief   Checks once per process whether the kernel offers io_uring with
+ *          the operations this backend needs.
+ *
+ * @return  1 if available, 0 otherwise
+ *******************************************************************************/
+int tcpipc_uring_available();
+
+/*******************************************************************************
+ * @brief   Creates a ring with room for entries submissions. single_issuer
+ *          asks for the cheaper single-thread mode where the kernel has it;
+ *          the ring must then only be used by the calling thread.
+ *
+ * @return  0 on success, -1 on failure
+ *******************************************************************************/
+int tcpipc_uring_init(struct tcpipc_uring_t *ring, unsigned int entries,
+                      int single_issuer);
+
+/*******************************************************************************
+ * @brief   Unmaps and closes the ring, including its buffer ring.
+ *
+ * @return
+ *******************************************************************************/
+void tcpipc_uring_free(struct tcpipc_uring_t *ring);
+
+/*******************************************************************************
+ * @brief   Receives from a stream socket until EOF, an error or until
+ *          *exit_status is set, passing every complete frame to frame_cb.
+ *          Each io_uring_enter() is added to syscalls and reads that end
+ *          inside a frame to partial_reads.
+ *
+ * @return  0 when the connection ended, -1 if io_uring could not be used
+ *          before any data arrived and the caller should fall back to read()
+ *******************************************************************************/
+int tcpipc_uring_recv_loop(int fd, volatile int *exit_status,
+                           struct tcpipc_decoder_t *dec,
+                           tcpipc_frame_cb_t frame_cb, void *arg,
+                           atomic_uint_fast64_t *syscalls,
+                           atomic_uint_fast64_t *partial_reads);
+
+/*******************************************************************************
+ * @brief   Sends the iovecs with one sendmsg that does not wait for socket
+ *          space, like sendmsg() with MSG_DONTWAIT. Each system call is added
+ *          to syscalls.
+ *
+ * @return  Number of bytes sent, -1 on failure with errno set
+ *******************************************************************************/
+ssize_t tcpipc_uring_sendv(struct tcpipc_uring_t *ring, int fd,
+                           struct iovec *iov, int iovcnt,
+                           atomic_uint_fast64_t *syscalls);
+
+#endif // TCPIPC_URING_H